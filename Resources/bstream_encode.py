@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""
+bstream_encode.py - encode a Gcode program as a g2core binary motion stream
+
+Reference host encoder for the framed binary records in g2core/binary_stream.h.
+Reads a Gcode file (or the first string in a Resources/gcode/gcode_xxx.h file) and
+writes the lines to send: {bin:1}, then '@' frames for the G0-G3 moves and Gcode text
+for everything else.
+
+  python3 bstream_encode.py gcode/gcode_zoetrope.h > zoetrope.bin.txt
+  ../g2core/build/sim/g2core-sim -r zoetrope.bin.txt
+
+A line is sent as records only if it is a G0, G1, G2 or G3 move (modal or not) made of
+X Y Z A B C, F, N and (for arcs) I J K words, in G90 and G91.1, with an axis word and
+every value a whole number of counts. Anything else is sent as text, which ends the
+frame and makes every axis unknown, as it does in the controller. Text lines that the
+controller would take as comments (blank or only comments) do not.
+
+This does no flow control - it is meant for the sim, or to be sent in line mode.
+"""
+
+import argparse
+import base64
+import re
+import sys
+
+BS_FRAME_MAX = 256          # must match binary_stream.h
+BS_COUNTS_PER_UNIT = 100000
+BS_FEED_PER_UNIT = 1000
+BS_AXES = 'XYZABC'
+
+BS_HEAD_ABSOLUTE = 0x04
+BS_HEAD_FEED = 0x08
+BS_HEAD_LINENUM = 0x10
+
+RECORDS_MAX = 16            # most records in a frame (default)
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def uvarint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+
+def svarint(v):
+    return uvarint((v << 1) if v >= 0 else ((-v << 1) - 1))
+
+
+def b64(data):
+    return base64.b64encode(bytes(data)).decode('ascii').rstrip('=')
+
+
+def load_program(path):
+    """Return the program text: a plain file, or the first string in a C header"""
+    text = open(path).read()
+    if not path.endswith('.h'):
+        return text
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    text = re.sub(r'//[^\n]*', '', text)
+    m = re.search(r'"((?:\\.|[^"\\])*)"((?:\s*"(?:\\.|[^"\\])*")*)', text, flags=re.S)
+    if m is None:
+        sys.exit('%s: no Gcode string found' % path)
+    literal = m.group(1) + ''.join(re.findall(r'"((?:\\.|[^"\\])*)"', m.group(2)))
+    escapes = {'n': '\n', 'r': '\r', 't': '\t', '\n': ''}
+    return re.sub(r'\\(.)', lambda e: escapes.get(e.group(1), e.group(1)), literal, flags=re.S)
+
+
+WORD = re.compile(r'([A-Z])\s*([-+]?(?:\d+\.?\d*|\.\d+))')
+
+
+def strip_comments(line):
+    line = re.sub(r'\([^)]*\)', '', line)
+    return line.split(';')[0].strip().upper()
+
+
+class Encoder:
+    def __init__(self, out, records_max=RECORDS_MAX):
+        self.out = out
+        self.records_max = records_max
+        self.seq = 0
+        self.records = []
+        self.size = 0
+        self.motion = None          # modal motion 0-3, or None if not G0-G3
+        self.absolute = True        # G90
+        self.arc_incremental = True # G91.1
+        self.known = {}             # axis -> last value sent, in counts
+        self.frames = 0
+        self.moves = 0
+        self.text_lines = 0
+        out.write('{bin:1}\n')
+
+    def flush(self):
+        if not self.records:
+            return
+        frame = bytearray([self.seq & 0xFF])
+        for r in self.records:
+            frame += r
+        crc = crc16(frame)
+        frame += bytearray([crc & 0xFF, crc >> 8])
+        self.out.write('@' + b64(frame) + '\n')
+        self.seq += 1
+        self.frames += 1
+        self.records = []
+        self.size = 0
+
+    def text(self, line, block):
+        self.flush()
+        self.out.write(line + '\n')
+        self.text_lines += 1
+        if block:
+            self.known = {}
+        for g in re.findall(r'G\s*(\d+(?:\.\d+)?)', block):
+            g = float(g)
+            if g in (0, 1, 2, 3):
+                self.motion = int(g)
+            elif g == 90:
+                self.absolute = True
+            elif g == 91:
+                self.absolute = False
+            elif g == 90.1:
+                self.arc_incremental = False
+            elif g == 91.1:
+                self.arc_incremental = True
+            elif (g == 80) or (38 <= g < 39) or (81 <= g <= 89):
+                self.motion = None
+        if re.search(r'M\s*0*(2|30)(?!\d)', block):
+            self.motion = None
+            self.absolute = True
+            self.arc_incremental = True
+
+    def _counts(self, value):
+        counts = round(float(value) * BS_COUNTS_PER_UNIT)
+        if '.' in value and len(value.split('.')[1].rstrip('0')) > 5:
+            return None                     # finer than a count - send as text
+        return counts
+
+    def _record(self, block):
+        """Return the record for a block, or None if it has to go as text"""
+        if ('*' in block) or block.startswith('/'):
+            return None
+        words = WORD.findall(block)
+        if ''.join(l + v for l, v in words) != re.sub(r'\s', '', block):
+            return None                     # something that isn't a word
+        motion = self.motion
+        axes, feed, linenum, ijk = {}, None, None, {}
+        for letter, value in words:
+            if letter == 'G':
+                if (float(value) not in (0, 1, 2, 3)) or (motion != self.motion):
+                    return None             # another G code, or two motions
+                motion = int(float(value))
+            elif letter in BS_AXES:
+                if letter in axes:
+                    return None
+                axes[letter] = self._counts(value)
+            elif letter == 'F':
+                feed = round(float(value) * BS_FEED_PER_UNIT)
+                if feed < 0 or abs(feed - float(value) * BS_FEED_PER_UNIT) > 1e-6 * max(1, feed):
+                    return None
+            elif letter == 'N':
+                linenum = int(float(value))
+            elif letter in 'IJK':
+                ijk[letter] = self._counts(value)
+            else:
+                return None
+        if (motion is None) or (not axes) or (not self.absolute) or (None in axes.values()):
+            return None
+        if ijk and (motion < 2 or None in ijk.values()):
+            return None
+        if motion >= 2 and (not ijk or not self.arc_incremental):
+            return None                     # radius arcs and G90.1 go as text
+        if any(abs(c) >= 2**31 for c in list(axes.values()) + list(ijk.values())):
+            return None
+
+        head = motion
+        absolute = any(a not in self.known for a in axes)
+        if absolute:
+            head |= BS_HEAD_ABSOLUTE
+        if feed is not None:
+            head |= BS_HEAD_FEED
+        if linenum is not None:
+            head |= BS_HEAD_LINENUM
+        mask = 0
+        body = bytearray()
+        for i, a in enumerate(BS_AXES):
+            if a in axes:
+                mask |= 1 << i
+                body += svarint(axes[a] if absolute else axes[a] - self.known[a])
+        record = bytearray([head, mask])
+        if feed is not None:
+            record += uvarint(feed)
+        if linenum is not None:
+            record += uvarint(linenum)
+        record += body
+        if motion >= 2:
+            omask = 0
+            for i, a in enumerate('IJK'):
+                if a in ijk:
+                    omask |= 1 << i
+            record.append(omask)
+            for a in 'IJK':
+                if a in ijk:
+                    record += svarint(ijk[a])
+        self.motion = motion
+        self.known.update(axes)
+        return record
+
+    def line(self, line):
+        line = line.rstrip('\r')
+        block = strip_comments(line)
+        if line.strip().startswith('{') or line.strip().startswith('$') or line.strip() in ('%', '!', '~'):
+            self.text(line, line.strip())
+            return
+        record = self._record(block)
+        if record is None:
+            self.text(line, block)
+            return
+        if (len(self.records) == self.records_max) or (self.size + len(record) + 3 > BS_FRAME_MAX):
+            self.flush()
+        self.records.append(record)
+        self.size += len(record)
+        self.moves += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Encode Gcode as a g2core binary motion stream')
+    parser.add_argument('program', help='Gcode file, or a Resources/gcode/gcode_xxx.h file')
+    parser.add_argument('-o', '--output', help='write the stream here (default stdout)')
+    parser.add_argument('-r', '--records', type=int, default=RECORDS_MAX,
+                        help='most records per frame (default %d). With 1 the controller sees the '
+                             'moves one line at a time, as it does the text' % RECORDS_MAX)
+    args = parser.parse_args()
+
+    out = open(args.output, 'w') if args.output else sys.stdout
+    encoder = Encoder(out, max(1, args.records))
+    for line in load_program(args.program).split('\n'):
+        encoder.line(line)
+    encoder.flush()
+    sys.stderr.write('%s: %d moves in %d frames, %d text lines\n' %
+                     (args.program, encoder.moves, encoder.frames, encoder.text_lines))
+
+
+if __name__ == '__main__':
+    main()
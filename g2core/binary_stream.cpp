@@ -0,0 +1,391 @@
+/*
+ * binary_stream.cpp - framed binary motion records
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "binary_stream.h"
+#include "controller.h"
+#include "canonical_machine.h"
+#include "plan_arc.h"
+#include "planner.h"
+#include "json_parser.h"
+#include "text_parser.h"
+#include "report.h"
+#include "xio.h"
+
+#ifdef __BINARY_STREAM
+
+bsSingleton_t bs;
+
+static void _respond(const stat_t status);
+
+/**** Frame decoding ****/
+
+/*
+ * _b64() - value of a base64 character, or -1
+ * _crc16() - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, no final XOR)
+ */
+
+static int8_t _b64(const char c)
+{
+    if ((c >= 'A') && (c <= 'Z')) { return (c - 'A'); }
+    if ((c >= 'a') && (c <= 'z')) { return (c - 'a' + 26); }
+    if ((c >= '0') && (c <= '9')) { return (c - '0' + 52); }
+    if (c == '+') { return (62); }
+    if (c == '/') { return (63); }
+    return (-1);
+}
+
+static uint16_t _crc16(const uint8_t *data, uint16_t length)
+{
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i=0; i<8; i++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return (crc);
+}
+
+/*
+ * bs_frame() - decode and check a frame line. Its records are run by bs_callback().
+ * _decode() - decode the line into bs.frame, as it is only valid until the next line is read
+ *
+ *  A frame that can't be run is answered here.
+ */
+
+static stat_t _decode(const char *line);
+
+stat_t bs_frame(const char *line, uint16_t linelen)
+{
+    bs.linelen = linelen;
+    bs.records = 0;
+    bs.status = STAT_OK;
+    stat_t status = _decode(line);
+    if (status != STAT_OK) {
+        _respond(status);
+    }
+    return (status);
+}
+
+static stat_t _decode(const char *line)
+{
+    if (!bs.enable) {
+        return (STAT_BINARY_STREAM_DISABLED);
+    }
+    uint16_t length = 0;
+    uint32_t bits = 0;
+    uint8_t nbits = 0;
+    for (const char *p = line+1; (*p != NUL) && (*p != '='); p++) {   // skip the '@'
+        int8_t value = _b64(*p);
+        if (value < 0) {
+            return (STAT_BINARY_FRAME_MALFORMED);
+        }
+        bits = (bits << 6) | value;
+        if ((nbits += 6) >= 8) {
+            if (length == BS_FRAME_MAX) {
+                return (STAT_BINARY_FRAME_MALFORMED);
+            }
+            nbits -= 8;
+            bs.frame[length++] = (uint8_t)(bits >> nbits);
+        }
+    }
+    if (length < 5) {                                   // seq, head, axes and CRC at the least
+        return (STAT_BINARY_FRAME_MALFORMED);
+    }
+    length -= 2;
+    if (_crc16(bs.frame, length) != (bs.frame[length] | (bs.frame[length+1] << 8))) {
+        return (STAT_BINARY_FRAME_CRC_ERROR);
+    }
+    if (bs.frame[0] != bs.next_seq) {
+        return (STAT_BINARY_FRAME_SEQUENCE_ERROR);
+    }
+    bs.next_seq++;
+    bs.rd = 1;
+    bs.end = length;
+    return (STAT_OK);
+}
+
+/**** Record execution ****/
+
+/*
+ * _uvarint() - read an unsigned LEB128 value from the frame
+ * _svarint() - read a zigzag coded signed value from the frame
+ *
+ *  Both return false if the value runs past the end of the records or is over 32 bits,
+ *  which includes a 5th byte with any of its bits above bit 31 set.
+ */
+
+static bool _uvarint(uint32_t *value)
+{
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (bs.rd >= bs.end) {
+            return (false);
+        }
+        uint8_t b = bs.frame[bs.rd++];
+        if ((shift == 28) && (b & 0x70)) {             // only 4 bits left in 32
+            return (false);
+        }
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return (true);
+        }
+    }
+    return (false);
+}
+
+static bool _svarint(int32_t *value)
+{
+    uint32_t v;
+    if (!_uvarint(&v)) {
+        return (false);
+    }
+    *value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    return (true);
+}
+
+/*
+ * _run_record() - decode the next record and queue it to the canonical machine
+ *
+ *  The targets are set up the way _execute_gcode_block() would for the same block in G90
+ *  and G91.1. The distance modes are put back afterwards. Counts are converted by division
+ *  rather than by multiplying by 0.00001, so values with 5 or fewer decimals come out as the
+ *  nearest float.
+ */
+
+static stat_t _run_record()
+{
+    float target[AXES] = {0};
+    bool target_f[AXES] = {0};
+    float offset[3] = {0};
+    bool offset_f[3] = {0};
+    int32_t value;
+
+    if (bs.end - bs.rd < 2) {
+        return (STAT_BINARY_FRAME_MALFORMED);
+    }
+    uint8_t head = bs.frame[bs.rd++];
+    uint8_t axes = bs.frame[bs.rd++];
+    if ((head & BS_HEAD_RESERVED) || (axes >> BS_AXES)) {
+        return (STAT_BINARY_FRAME_MALFORMED);
+    }
+    uint32_t feed = 0;
+    uint32_t linenum = 0;
+    if ((head & BS_HEAD_FEED) && !_uvarint(&feed)) {
+        return (STAT_BINARY_FRAME_MALFORMED);
+    }
+    if ((head & BS_HEAD_LINENUM) && !_uvarint(&linenum)) {
+        return (STAT_BINARY_FRAME_MALFORMED);
+    }
+    int32_t pos[BS_AXES];
+    for (uint8_t axis = AXIS_X; axis < BS_AXES; axis++) {
+        pos[axis] = bs.pos[axis];
+        if (!(axes & (1 << axis))) {
+            continue;
+        }
+        if (!_svarint(&value)) {
+            return (STAT_BINARY_FRAME_MALFORMED);
+        }
+        if (head & BS_HEAD_ABSOLUTE) {
+            pos[axis] = value;
+        } else if (bs.known & (1 << axis)) {
+            pos[axis] += value;
+        } else {
+            return (STAT_BINARY_FRAME_UNKNOWN_POSITION);
+        }
+        target[axis] = (float)pos[axis] / (float)BS_COUNTS_PER_UNIT;
+        target_f[axis] = true;
+    }
+    cmMotionMode motion_mode = (cmMotionMode)(head & BS_HEAD_MOTION);
+    if (motion_mode >= MOTION_MODE_CW_ARC) {
+        if (bs.rd >= bs.end) {
+            return (STAT_BINARY_FRAME_MALFORMED);
+        }
+        uint8_t offsets = bs.frame[bs.rd++];
+        if (offsets >> 3) {
+            return (STAT_BINARY_FRAME_MALFORMED);
+        }
+        for (uint8_t i=0; i<3; i++) {
+            if (offsets & (1 << i)) {
+                if (!_svarint(&value)) {
+                    return (STAT_BINARY_FRAME_MALFORMED);
+                }
+                offset[i] = (float)value / (float)BS_COUNTS_PER_UNIT;
+                offset_f[i] = true;
+            }
+        }
+    }
+
+    // the record is whole - take its positions, whether or not it runs, as the text would
+    for (uint8_t axis = AXIS_X; axis < BS_AXES; axis++) {
+        bs.pos[axis] = pos[axis];
+    }
+    bs.known |= axes;
+
+    ritorno(cm_is_alarmed());
+    if (head & BS_HEAD_LINENUM) {
+        cm_set_model_linenum(linenum);
+    }
+    if (head & BS_HEAD_FEED) {
+        ritorno(cm_set_feed_rate((float)feed / (float)BS_FEED_PER_UNIT));
+    }
+    cmDistanceMode distance_mode = cm.gm.distance_mode;
+    cmDistanceMode arc_distance_mode = cm.gm.arc_distance_mode;
+    cm_set_distance_mode(ABSOLUTE_DISTANCE_MODE);
+    cm_set_arc_distance_mode(INCREMENTAL_DISTANCE_MODE);
+
+    stat_t status;
+    switch (motion_mode) {
+        case MOTION_MODE_STRAIGHT_TRAVERSE: { status = cm_straight_traverse(target, target_f); break; }
+        case MOTION_MODE_STRAIGHT_FEED:     { status = cm_straight_feed(target, target_f); break; }
+        default: { status = cm_arc_feed(target, target_f, offset, offset_f, 0, false, 0, false, true, motion_mode); }
+    }
+    cm_set_distance_mode(distance_mode);
+    cm_set_arc_distance_mode(arc_distance_mode);
+    return (status);
+}
+
+/*
+ * bs_callback() - run the records of the current frame as the planner takes them
+ *
+ *  Runs from the controller loop ahead of the line dispatchers, and returns EAGAIN until
+ *  the frame is done so no other line is read before its records are queued. Stops after
+ *  an arc that is being queued as segments (see cm_arc_callback()).
+ *
+ *  A record that is rejected (e.g. by a soft limit, or in alarm) is skipped as a Gcode
+ *  line would be, and the first error is returned for the frame. A record that can't be
+ *  decoded, or has a delta for an unknown axis, ends the frame.
+ */
+
+stat_t bs_callback()
+{
+    if (!bs_is_busy()) {
+        return (STAT_NOOP);
+    }
+    while (bs.rd < bs.end) {
+        if ((arc.run_state != BLOCK_INACTIVE) || mp_planner_is_full()) {
+            return (STAT_EAGAIN);
+        }
+        stat_t status = _run_record();
+        if ((status == STAT_BINARY_FRAME_MALFORMED) || (status == STAT_BINARY_FRAME_UNKNOWN_POSITION)) {
+            bs_invalidate();                            // drop the rest of the frame
+            _respond(status);
+            return (STAT_OK);
+        }
+        if ((status != STAT_OK) && (status != STAT_NOOP) && (status != STAT_EAGAIN) && (bs.status == STAT_OK)) {
+            bs.status = status;
+        }
+        bs.records++;
+    }
+    _respond(bs.status);
+    return (STAT_OK);
+}
+
+bool bs_is_busy()
+{
+    return (bs.end != 0);
+}
+
+/*
+ * _respond() - send the response for the frame and finish with it
+ */
+
+static void _respond(const stat_t status)
+{
+    cs.linelen = bs.linelen;                            // footer counts the frame line
+    bs.end = 0;
+    if (js.json_mode == JSON_MODE) {
+        nv_reset_nv_list();
+        nv_add_integer((const char *)"bsq", bs.next_seq);
+        nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+        sr_request_status_report(SR_REQUEST_TIMED);
+    } else {
+        char where[40];
+        sprintf(where, "bsq %d, %d records run", (int)bs.next_seq, (int)bs.records);
+        text_response(status, where);
+    }
+}
+
+/*
+ * bs_reset() - stop and reset the stream - on {bin:...} and disconnect
+ * bs_invalidate() - forget the axis positions. The next record to move an axis is absolute
+ * bs_abort() - forget the axis positions and drop the rest of the frame - on a queue flush
+ */
+
+void bs_reset()
+{
+    bs.next_seq = 0;
+    bs.end = 0;
+    bs_invalidate();
+}
+
+void bs_invalidate()
+{
+    bs.known = 0;
+}
+
+void bs_abort()
+{
+    bs_invalidate();
+    if (bs_is_busy()) {
+        _respond(bs.status);                            // ends the frame
+    }
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * bs_set_bin() - enable or disable the stream. Either resets the sequence
+ */
+
+stat_t bs_set_bin(nvObj_t *nv)
+{
+    ritorno(set_01(nv));
+    bs_reset();
+    return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+    static const char fmt_bin[] = "[bin] binary motion stream%9d [0=off,1=on]\n";
+    static const char fmt_bsq[] = "[bsq] binary next frame sequence%3d\n";
+
+    void bs_print_bin(nvObj_t *nv) { text_print(nv, fmt_bin);}
+    void bs_print_bsq(nvObj_t *nv) { text_print(nv, fmt_bsq);}
+
+#endif // __TEXT_MODE
+
+#endif // __BINARY_STREAM
@@ -0,0 +1,150 @@
+/*
+ * binary_stream.h - framed binary motion records
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BINARY_STREAM_H_ONCE
+#define BINARY_STREAM_H_ONCE
+
+#include "g2core.h"
+#include "config.h"
+
+#ifdef __BINARY_STREAM
+
+/*
+ * Frames
+ *
+ *  A host that sends mostly G0-G3 moves can send them as binary records instead of Gcode
+ *  text. The stream is off until the host sets {bin:1}, which also resets the sequence.
+ *  It is turned off again by {bin:0} and when the host disconnects.
+ *
+ *  A frame is one line: '@' followed by the frame bytes in base64 (RFC 4648, '=' padding
+ *  optional). So it goes through xio, line mode and the RX buffers like any other line.
+ *  The frame bytes are:
+ *
+ *    seq       1 byte    frame sequence number, 0 after {bin:1}, then +1 per frame (mod 256)
+ *    records   ...       one or more motion records
+ *    crc       2 bytes   CRC-16/CCITT-FALSE of seq and records, low byte first
+ *
+ *  A frame with a bad CRC or the wrong sequence number is not run and the sequence does not
+ *  advance, so the host resends from that frame. It gets one response per frame, once the
+ *  last record is queued. In JSON mode that is {"r":{"bsq":n},"f":[...]} where bsq is the
+ *  next sequence number expected. A record that is rejected (say by a soft limit) is
+ *  skipped, as a Gcode line would be, and the first such error is returned in the footer.
+ *  A record that can't be decoded drops the rest of the frame. Either way the sequence
+ *  still advances.
+ *
+ * Records
+ *
+ *    head      1 byte    bits 0-1 motion (0=G0 1=G1 2=G2 3=G3)
+ *                        bit 2 axis values are absolute, otherwise deltas from the last record
+ *                        bit 3 feed rate follows
+ *                        bit 4 line number follows
+ *    axes      1 byte    axis mask: bit 0=X ... bit 5=C
+ *    feed      uvarint   F in 0.001 units per minute (or G93 inverse time units)
+ *    linenum   uvarint   N
+ *    values    svarint   one per axis in the mask, X first, in BS_COUNTS_PER_UNIT counts
+ *    offsets   1 byte    arcs only: offset mask, bit 0=I 1=J 2=K
+ *    ijk       svarint   one per offset in the mask, in counts, relative to the arc start
+ *
+ *  uvarints are LEB128: 7 bits per byte, low bits first, high bit set if more follow.
+ *  svarints are zigzag coded first (0,-1,1,-2... as 0,1,2,3...). Unused bits must be 0.
+ *
+ *  Values are in the active units (G20/G21), in work coordinates, as if the block were run
+ *  in G90 and G91.1 - whatever distance modes are set. Feed, plane, units, offsets and the
+ *  rest of the Gcode state are the ones set by the Gcode lines sent before the frame.
+ *  Anything else - radius arcs, G53, G38.2 and so on - is sent as Gcode text.
+ *
+ *  Deltas are taken from the last value of that axis sent in a record, which the stream
+ *  keeps as integer counts, so they do not accumulate rounding. Each target is the nearest
+ *  float to its count, which is not always the float the text parser makes of the same
+ *  value, so a stream can end a step away from the same program sent as text. That is the value sent
+ *  even if the record was rejected, as with G90 text. After {bin:1}, a Gcode block (from
+ *  a line or a JSON "gc"), a queue flush or a record that can't be decoded every axis is
+ *  unknown, and the first record to move an axis must carry an absolute value for it.
+ *  A delta on an unknown axis is an error.
+ *
+ *  A frame's records go to the canonical machine as the planner has room for them, and
+ *  no more lines are read until they are all queued (see bs_callback()). A queue flush (%)
+ *  drops the records not yet queued and answers the frame with the records run.
+ *
+ *  See Resources/bstream_encode.py for a host encoder. On the programs in Resources/gcode
+ *  the text takes 0.8 to 2.4 times the bytes of the stream, and 1.5 to 2.4 times on the
+ *  long ones (see sim-compare-binary). That is short of the 3-5x more moves per second
+ *  over USB the stream was meant for. Parsing time per move on the board is not measured.
+ */
+
+#define BS_FRAME_MAX            256         // most bytes in a decoded frame (344 base64 characters)
+#define BS_COUNTS_PER_UNIT      100000      // axis values and offsets are in 0.00001 units
+#define BS_FEED_PER_UNIT        1000        // feed rates are in 0.001 units per minute
+#define BS_AXES                 6           // axes carried in records - X, Y, Z, A, B, C
+
+#define BS_HEAD_MOTION          0x03        // record head bits
+#define BS_HEAD_ABSOLUTE        0x04
+#define BS_HEAD_FEED            0x08
+#define BS_HEAD_LINENUM         0x10
+#define BS_HEAD_RESERVED        0xE0
+
+typedef struct bsSingleton {                // binary stream state
+    uint8_t enable;                         // set by {bin:1}
+    uint8_t next_seq;                       // sequence number of the next frame
+
+    uint8_t known;                          // axes whose position is in pos[]
+    int32_t pos[BS_AXES];                   // last value sent for each axis, in counts
+
+    uint8_t frame[BS_FRAME_MAX];            // decoded frame
+    uint16_t rd;                            // next record in frame[]
+    uint16_t end;                           // end of the records (start of the CRC)
+    uint16_t linelen;                       // length of the frame line, for the response footer
+    uint8_t records;                        // records run from this frame
+    stat_t status;                          // first error from a record in this frame
+} bsSingleton_t;
+
+extern bsSingleton_t bs;
+
+/**** function prototypes ****/
+
+void bs_reset(void);
+void bs_invalidate(void);
+void bs_abort(void);
+bool bs_is_busy(void);
+stat_t bs_frame(const char *line, uint16_t linelen);
+stat_t bs_callback(void);
+
+stat_t bs_set_bin(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void bs_print_bin(nvObj_t *nv);
+    void bs_print_bsq(nvObj_t *nv);
+#else
+    #define bs_print_bin tx_print_stub
+    #define bs_print_bsq tx_print_stub
+#endif
+
+#else   // __BINARY_STREAM
+
+#define bs_reset()
+#define bs_invalidate()
+#define bs_abort()
+
+#endif  // __BINARY_STREAM
+#endif  // End of include guard: BINARY_STREAM_H_ONCE
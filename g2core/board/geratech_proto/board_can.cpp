@@ -18,10 +18,17 @@
 
 
 #include "board_can.h"
+#include "../../isr_timing.h"
+#include "../../can_bus.h"          // TX classes
+#include "../../canopen.h"
+#include "../../stepper.h"          // motion clock
+
+#include <atomic>                   // std::atomic_signal_fence - orders the RX ring handoff
 
 CANRaw::CANRaw(Can* pCan, uint32_t En ) {
 	m_pCan = pCan;
   nIRQ=(m_pCan == CAN0 ? CAN0_IRQn : CAN1_IRQn);
+  irqLocks=0;
 	enablePin = En;
 	bigEndian = false;
 	busSpeed = 0;
@@ -192,6 +199,11 @@ uint32_t CANRaw::init(uint32_t ul_baudrate)
 
 	numBusErrors = 0;
   numRxFrames = 0;
+  numRxDropped = 0;
+  numRxOverruns = 0;
+  numBusOffs = 0;
+  busOff = false;
+  txMaxDepth = 0;
 
 	//initialize all function pointers to null
 	for (int i = 0; i < getNumMailBoxes()+1; i++) cbCANFrame[i] = 0;
@@ -333,8 +345,9 @@ bool CANRaw::addToRingBuffer (ringbuffer_t &ring, const CAN_FRAME &msg)
 
     memcpy ((void *)&ring.buffer[ring.head], (void *)&msg, sizeof (CAN_FRAME));
 
-    /* bump the head to point to the next free entry */
+    /* bump the head to point to the next free entry - after the frame is written */
 
+    std::atomic_signal_fence(std::memory_order_release);
     ring.head = nextEntry;
 
     return (true);
@@ -361,10 +374,12 @@ bool CANRaw::removeFromRingBuffer (ringbuffer_t &ring, CAN_FRAME &msg)
 
     /* copy the message */
 
+    std::atomic_signal_fence(std::memory_order_acquire);
     memcpy ((void *)&msg, (void *)&ring.buffer[ring.tail], sizeof (CAN_FRAME));
 
-    /* bump the tail pointer */
+    /* bump the tail pointer - after the frame is read */
 
+    std::atomic_signal_fence(std::memory_order_release);
     ring.tail = (ring.tail + 1) % ring.size;
 
     return (true);
@@ -938,6 +953,9 @@ bool CANRaw::sendFrame(CAN_FRAME& txFrame, uint8_t mbox)
   }
   if ( !result && txRings[mbox]!=0 && addToRingBuffer(*txRings[mbox], txFrame) ) {
     result=true;
+    if (ringBufferCount(*txRings[mbox]) > txMaxDepth) {
+      txMaxDepth = ringBufferCount(*txRings[mbox]);
+    }
   }
   irqRelease();
 
@@ -1238,10 +1256,24 @@ uint32_t CANRaw::get_rx_buff(CAN_FRAME& msg) {
 	return result;
 }
 
+/**
+ * \brief Retrieve a frame from the RX buffer without masking the CAN interrupt
+ *
+ * \param msg Reference to the frame structure to fill out
+ *
+ * \retval true if a frame was returned
+ *
+ * \note Only safe with a single consumer, i.e. can_rx_callback()
+ */
+bool CANRaw::readRx(CAN_FRAME& msg) {
+  return removeFromRingBuffer(rxRing, msg);
+}
+
 /**
 * \brief Handle all interrupt reasons
 */
 void CANRaw::interruptHandler() {
+	IsrTimer isr_timer(ISR_CAN);
 
 	uint32_t ul_status = m_pCan->CAN_SR; //get status of interrupts
 
@@ -1269,38 +1301,46 @@ void CANRaw::interruptHandler() {
 	if (ul_status & CAN_SR_MB7) { //mailbox 7 event
 		mailbox_int_handler(7, ul_status);
 	}
-	if (ul_status & CAN_SR_ERRA) { //error active
-        numBusErrors++;
-	}
-	if (ul_status & CAN_SR_WARN) { //warning limit
-	}
-	if (ul_status & CAN_SR_ERRP) { //error passive
-	}
-	if (ul_status & CAN_SR_BOFF) { //bus off
-        numBusErrors++;
-	}
-	if (ul_status & CAN_SR_SLEEP) { //controller in sleep mode
-	}
-	if (ul_status & CAN_SR_WAKEUP) { //controller woke up
-	}
-	if (ul_status & CAN_SR_TOVF) { //timer overflow
-	}
-	if (ul_status & CAN_SR_TSTP) { //timestamp - start or end of frame
-	}
-	if (ul_status & CAN_SR_CERR) { //CRC error in mailbox
-	}
-	if (ul_status & CAN_SR_SERR) { //stuffing error in mailbox
-        numBusErrors++;
-	}
-	if (ul_status & CAN_SR_AERR) { //ack error
-        numBusErrors++;
-	}
-	if (ul_status & CAN_SR_FERR) { //form error
-        numBusErrors++;
+	countErrors(ul_status);
+}
+
+/**
+* \brief Count the error flags and bus off entries in a status register value
+*
+* \note Error active, warning and error passive are states, not events, and error active
+* is the normal one, so they are not counted. The error flags clear when the status is read.
+*/
+void CANRaw::countErrors(uint32_t status) {
+	if (status & (CAN_SR_CERR | CAN_SR_SERR | CAN_SR_AERR | CAN_SR_FERR | CAN_SR_BERR)) {
+        numBusErrors++; //CRC, stuffing, ack, form or bit error since the last read
 	}
-	if (ul_status & CAN_SR_BERR) { //bit error
-        numBusErrors++;
+	bool off = (status & CAN_SR_BOFF);
+	if (off && !busOff) {
+        numBusOffs++;
 	}
+	busOff = off;
+}
+
+/**
+* \brief Read the status for errors from the main loop
+*/
+void CANRaw::pollStatus() {
+	irqLock();
+	countErrors(m_pCan->CAN_SR);
+	irqRelease();
+}
+
+/**
+* \brief Clear the error counts and high water marks
+*/
+void CANRaw::clearStatistics() {
+	irqLock();
+	numBusErrors = 0;
+	numBusOffs = 0;
+	numRxDropped = 0;
+	numRxOverruns = 0;
+	txMaxDepth = 0;
+	irqRelease();
 }
 
 /**
@@ -1465,6 +1505,7 @@ uint32_t CANRaw::getMailboxIer(int8_t mailbox) {
 */
 void CANRaw::mailbox_int_handler(uint8_t mb, uint32_t /* ul_status */) {
 	CAN_FRAME tempFrame;
+	uint32_t waited;
 	bool caughtFrame = false;
 	CANListener *thisListener;
   ringbuffer_t *pRing;
@@ -1475,8 +1516,16 @@ void CANRaw::mailbox_int_handler(uint8_t mb, uint32_t /* ul_status */) {
 		case 1: //receive
 		case 2: //receive w/ overwrite
 		case 4: //consumer - technically still a receive buffer
-			mailbox_read(mb, &tempFrame);
+			if (mailbox_read(mb, &tempFrame) & CAN_MAILBOX_RX_OVER) {
+                numRxOverruns++;
+            }
             numRxFrames++;
+            // the CAN timer counts bit times - convert the wait since the frame's timestamp to
+            // cycles, and to DDA ticks to put the frame on the motion clock (see can_bus.h).
+            // While the motion clock is stopped the frame gets the clock as it stands.
+            waited = (uint16_t)(m_pCan->CAN_TIM - tempFrame.time);
+            isr_can_latency(waited * (SystemCoreClock / busSpeed));
+            tempFrame.ticks = st_get_motion_ticks_ago(waited * (FREQUENCY_DDA / 1000) / (busSpeed / 1000));
 			//First, try to send a callback. If no callback registered then buffer the frame.
 			if (cbCANFrame[mb])
 			{
@@ -1510,7 +1559,9 @@ void CANRaw::mailbox_int_handler(uint8_t mb, uint32_t /* ul_status */) {
 			}
 			if (!caughtFrame) //if none of the callback types caught this frame then queue it in the buffer
 			{
-        addToRingBuffer(rxRing,tempFrame);
+        if (!addToRingBuffer(rxRing,tempFrame)) {
+          numRxDropped++;
+        }
 			}
 			break;
 		case 3: //transmit
@@ -1584,41 +1635,40 @@ void CAN1_Handler(void)
 CANRaw Can0(CAN0, 0);
 CANRaw Can1(CAN1, 0);
 
-void hw_can_message_received (CAN_FRAME *frame) {
-	can_message_received(frame->id, frame->length, frame->data.bytes);
-}
-
 void hw_can_init () {
-  Can0.begin(CAN_BPS_250K);
+  Can0.begin(CAN_BITRATE);
+  Can0.set_timestamp_capture_point(0); //timestamp received frames at their start, nearest the input changing
+
+  //one TX mailbox per class (see can_bus.h), each with its own queue. The top mailbox is
+  //the motion class. A lower priority value is sent first when more than one is ready.
+  Can0.setNumTXBoxes(CAN_TX_CLASSES);
+  Can0.setMailBoxTxBufferSize(Can0.getFirstTxBox() + CAN_TX_MOTION, SIZE_TX_MOTION_BUFFER);
+  Can0.setMailBoxTxBufferSize(Can0.getFirstTxBox() + CAN_TX_IO, SIZE_TX_IO_BUFFER);
+  Can0.setMailBoxTxBufferSize(Can0.getFirstTxBox() + CAN_TX_DIAGNOSTIC, SIZE_TX_DIAGNOSTIC_BUFFER);
 
-  //By default there are 7 RX mailboxes for each device
-  //extended
+  //that leaves 5 RX mailboxes
   //syntax is mailbox, ID, mask, extended
   Can0.setRXFilter(0, 0x2FF00, 0x1FF2FF00, true);
   Can0.setRXFilter(1, 0x1F0000, 0x1F1F0000, true);
-  Can0.setRXFilter(2, 0, 0, true); //catch all mailbox
+  Can0.setRXFilter(2, 0, 0, true); //extended catch all mailbox
 
   //standard
-  Can0.setRXFilter(3, 0x40F, 0x7FF, false);
-  Can0.setRXFilter(4, 0x310, 0x7F0, false);
-  Can0.watchFor(0x200, 0x700); //used in place of above syntax
-  Can0.setRXFilter(0, 0, false); //catch all mailbox - no mailbox ID specified
-
-  //now register all of the callback functions.
-  Can0.setCallback(0, hw_can_message_received);
-  Can0.setCallback(1, hw_can_message_received);
-  Can0.setCallback(3, hw_can_message_received);
-  Can0.setCallback(4, hw_can_message_received);
-  Can0.setCallback(5, hw_can_message_received);
-  //this function will get a callback for any mailbox that doesn't have a registered callback from above -> 2 and 6
-  Can0.setGeneralCallback(hw_can_message_received);
-}
-
-void hw_can_send_frame (uint32_t id, uint8_t length, uint8_t *data) {
+  Can0.setRXFilter(3, CANOPEN_TPDO1, CANOPEN_FUNCTION_MASK, false); //CAN servo positions, apart from the rest
+  Can0.setRXFilter(4, 0, 0, false); //standard catch all mailbox
+
+  //no callbacks are registered, so the interrupt queues every frame in the RX ring.
+  //can_rx_callback() hands them to can_message_received() from the main loop.
+}
+
+bool hw_can_send_frame (uint32_t id, uint8_t length, uint8_t *data, uint8_t tx_class) {
 	CAN_FRAME f;
 	f.id = id;
+	f.fid = 0;
+	f.rtr = 0;
+	f.priority = tx_class;
+	f.extended = (id > 0x7FF);
 	f.length = length;
 	for (int i=0; i<length; i++) f.data.bytes[i] = data[i];
 
-	Can0.sendFrame(f);
+	return (Can0.sendFrame(f, Can0.getFirstTxBox() + tx_class));
 }
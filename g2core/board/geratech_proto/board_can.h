@@ -89,8 +89,13 @@ namespace libsam {
 #define CAN_MAILBOX_RX_OVER           0x02  //! Message overwriting happens or there're messages lost in different receive modes.
 #define CAN_MAILBOX_RX_NEED_RD_AGAIN  0x04  //! Application needs to re-read the data register in Receive with Overwrite mode.
 
+#define CAN_BITRATE	CAN_BPS_250K //bus bit rate - canopen.cpp budgets the bus against it
+
 #define SIZE_RX_BUFFER	32 //RX incoming ring buffer is this big
 #define SIZE_TX_BUFFER	16 //TX ring buffer is this big
+#define SIZE_TX_MOTION_BUFFER	16 //TX ring of each class mailbox (see hw_can_init())
+#define SIZE_TX_IO_BUFFER	8
+#define SIZE_TX_DIAGNOSTIC_BUFFER	8
 #define SIZE_LISTENERS	4 //number of classes that can register as listeners with this class
 
 	/** Define the timemark mask. */
@@ -169,6 +174,7 @@ typedef struct
   uint8_t priority;	// Priority but only important for TX frames and then only for special uses.
   uint8_t extended;	// Extended ID flag
   uint16_t time;      // CAN timer value when mailbox message was received.
+  uint32_t ticks;     // motion clock when it was received (see st_get_motion_ticks()). RX only
   uint8_t length;		// Number of data bytes
   BytesUnion data;	// 64 bits - lots of ways to access it.
 } CAN_FRAME;
@@ -212,8 +218,11 @@ class CANRaw
   inline bool isRingBufferEmpty (ringbuffer_t &ring) { return (ring.head == ring.tail); }
   uint16_t ringBufferCount (ringbuffer_t &ring);
 
-  void irqLock() { NVIC_DisableIRQ(nIRQ); }
-  void irqRelease() { NVIC_EnableIRQ(nIRQ); }
+  //the lock nests, as frames are sent from the CSP interrupt as well as the main loop.
+  //The count goes up before the IRQ is disabled, so an interrupt taken in between
+  //doesn't enable it again on its way out.
+  void irqLock() { irqLocks++; NVIC_DisableIRQ(nIRQ); }
+  void irqRelease() { if (--irqLocks == 0) NVIC_EnableIRQ(nIRQ); }
 
   void initializeBuffers();
   bool isInitialized() { return tx_frame_buff!=0; }
@@ -225,6 +234,7 @@ class CANRaw
 	/* CAN peripheral, set by constructor */
 	Can* m_pCan;
   IRQn_Type nIRQ;
+  volatile uint8_t irqLocks; //irqLock() depth
 
 	volatile CAN_FRAME *rx_frame_buff; //[SIZE_RX_BUFFER];
 	volatile CAN_FRAME *tx_frame_buff; //[SIZE_TX_BUFFER];
@@ -243,6 +253,12 @@ class CANRaw
 
     uint32_t numBusErrors;
     uint32_t numRxFrames;
+    volatile uint32_t numRxDropped;     // frames lost because the RX ring was full
+    volatile uint32_t numRxOverruns;    // frames lost in a mailbox before the interrupt read it
+    volatile uint32_t numBusOffs;       // times the controller went bus off
+    volatile bool busOff;               // controller was bus off at the last status read
+    uint16_t txMaxDepth;                // most frames waiting in a TX ring
+    void countErrors(uint32_t status);
 
 	void (*cbCANFrame[CANMB_NUMBER+1])(CAN_FRAME *); //8 mailboxes plus an optional catch all
 	CANListener *listener[SIZE_LISTENERS];
@@ -319,6 +335,23 @@ class CANRaw
   //wrapper for syntactic sugar reasons
 	inline uint32_t read(CAN_FRAME &msg) { return get_rx_buff(msg); }
 
+  // Lock-free read for the single consumer of the RX ring (see can_rx_callback()).
+  // The interrupt only writes head and the consumer only writes tail, so the CAN
+  // interrupt does not need to be masked.
+  bool readRx(CAN_FRAME &msg);
+  uint16_t rxCount() { return ringBufferCount(rxRing); }
+  uint32_t getRxDropped() { return numRxDropped; }
+  uint32_t getRxOverruns() { return numRxOverruns; }
+
+  // Bus health. pollStatus() reads the status register, which clears its error flags, so
+  // call it often (every controller pass) to catch the errors and bus off events the
+  // interrupt does not see.
+  void pollStatus();
+  uint32_t getBusErrors() { return numBusErrors; }
+  uint32_t getBusOffs() { return numBusOffs; }
+  uint16_t getTxMaxDepth() { return txMaxDepth; }
+  void clearStatistics();
+
 	void disable_autobaud_listen_mode();
 	void enable_autobaud_listen_mode();
 
@@ -366,11 +399,11 @@ class CANRaw
 };
 
 void hw_can_init();
-void hw_can_send_frame(uint32_t, uint8_t, uint8_t*);
+bool hw_can_send_frame(uint32_t, uint8_t, uint8_t*, uint8_t);
 
 extern CANRaw Can0;
 extern CANRaw Can1;
 
-extern void can_message_received (uint32_t, uint8_t, uint8_t*);
+extern void can_message_received (uint32_t, uint8_t, uint8_t*, uint32_t);
 
 #endif // _CAN_LIBRARY_
@@ -87,6 +87,46 @@ extern StepDirStepper<Motate::kSocket4_StepPinNumber,
 
 extern Stepper* Motors[MOTORS];
 
+/*
+ * Port-batched step output
+ *
+ *  Instead of a pin write per motor per DDA tick, the DDA interrupt ORs the step bit of
+ *  each motor that steps into a per-port image and writes each port once with SODR. The
+ *  next tick ends all pulses with one CODR per port. CODR on a pin that is already low
+ *  does nothing, so the clear mask is a compile-time constant and nothing is tracked.
+ *  Only ports that carry a step pin are written - the tests below fold at compile time.
+ *
+ *  Motor step bits come from the Motate pin assignments (step_port, step_mask in
+ *  step_dir_driver.h). Pulses from different ports start one store apart.
+ */
+
+#define STEP_PORT_BATCHING                  // the DDA uses step_ports_set() / step_ports_clear()
+#define STEP_PORTS 4                        // PIOA - PIOD
+
+constexpr uint32_t step_port_mask(const uint8_t port)     // all step pins on a port
+{
+    return (((decltype(motor_1)::step_port == port) ? decltype(motor_1)::step_mask : 0) |
+            ((decltype(motor_2)::step_port == port) ? decltype(motor_2)::step_mask : 0) |
+            ((decltype(motor_3)::step_port == port) ? decltype(motor_3)::step_mask : 0) |
+            ((decltype(motor_4)::step_port == port) ? decltype(motor_4)::step_mask : 0));
+}
+
+inline void step_ports_clear()
+{
+    if (step_port_mask(0)) { PIOA->PIO_CODR = step_port_mask(0); }
+    if (step_port_mask(1)) { PIOB->PIO_CODR = step_port_mask(1); }
+    if (step_port_mask(2)) { PIOC->PIO_CODR = step_port_mask(2); }
+    if (step_port_mask(3)) { PIOD->PIO_CODR = step_port_mask(3); }
+}
+
+inline void step_ports_set(const uint32_t image[STEP_PORTS])
+{
+    if (step_port_mask(0)) { PIOA->PIO_SODR = image[0]; }
+    if (step_port_mask(1)) { PIOB->PIO_SODR = image[1]; }
+    if (step_port_mask(2)) { PIOC->PIO_SODR = image[2]; }
+    if (step_port_mask(3)) { PIOD->PIO_SODR = image[3]; }
+}
+
 void board_stepper_init();
 
 #endif  // BOARD_STEPPER_H_ONCE
\ No newline at end of file
@@ -118,6 +118,7 @@ using Motate::OutputPin;
  *	 2	LOADER software generated interrupt (STIR / SGI)
  *	 3	Serial read character interrupt
  *	 4	EXEC software generated interrupt (STIR / SGI)
+ *	 4	CSP_TIMER (6) for the CAN servo interpolation period (see canopen.h)
  *	 5	Serial write character interrupt
  */
 
@@ -134,6 +135,7 @@ using Motate::OutputPin;
 typedef TimerChannel<3,0> dda_timer_type;	// stepper pulse generation in stepper.cpp
 typedef TimerChannel<4,0> exec_timer_type;	// request exec timer in stepper.cpp
 typedef TimerChannel<5,0> fwd_plan_timer_type;	// request exec timer in stepper.cpp
+typedef TimerChannel<6,0> csp_timer_type;	// CAN servo interpolation period in canopen.cpp
 
 // Pin assignments
 
@@ -0,0 +1,139 @@
+# ----------------------------------------------------------------------------
+# This file is part of the Synthetos g2core project
+#
+# Linux host simulation build. This does NOT use the Motate compile system - it
+# builds the application with the host compiler against the stub Motate headers
+# in ./board/sim/motate, and replaces xio.cpp and main.cpp with sim versions.
+#
+# To compile:
+#   make BOARD=sim
+# To replay every program in Resources/gcode and print the reports:
+#   make BOARD=sim sim-replay
+# To replay a single program (see board/sim/sim_main.cpp for options):
+#   ./build/sim/g2core-sim ../Resources/gcode/gcode_hacdc.h
+# Extra defines can be passed in, e.g. to build the fixed-point runtime next to the float one:
+#   make BOARD=sim SIM_BUILD_DIR=./build/sim-fixed SIM_DEFINES=-D__FIXED_POINT_RUNTIME
+# To run the motors as CiA-402 servo drives on an emulated CAN bus (see board/sim/board_can.h):
+#   make BOARD=sim SIM_BUILD_DIR=./build/sim-can SIM_DEFINES=-DSIM_CAN_SERVOS
+# To build with G1 line coalescing so {clt:} can be set with sim -i:
+#   make BOARD=sim SIM_BUILD_DIR=./build/sim-clt SIM_DEFINES=-D__COALESCE_LINES
+# To compare the variable interval DDA (__VARIABLE_INTERVAL_DDA) with the fixed rate DDA:
+#   make BOARD=sim sim-compare-dda
+# This replays every program through both builds with a step port trace (sim -t) and
+# prints the DDA interrupt counts, and how far apart and how many of the step edges are.
+# To time the xio line scanner (word-at-a-time vs per-character) over every program:
+#   make BOARD=sim sim-scan-bench
+# To check both scans and the in-place readline on lines that wrap the RX ring and on
+# lines too long for the line buffer (see board/sim/sim_scan.cpp):
+#   make BOARD=sim sim-check-scan
+# Each check prints ok or FAIL.
+# To compare the meet velocity solver (zoid exit 3c) with the Newton search it replaced:
+#   make BOARD=sim sim-zoid-bench
+# To round-trip every program through the binary motion stream (see binary_stream.h):
+#   make BOARD=sim sim-compare-binary
+# This encodes each program with Resources/bstream_encode.py and replays the text and the
+# stream. It prints the bytes and lines each took, the cycle times and whether the final
+# step counts match. Frames hand the planner many moves a pass, so it plans a little
+# differently and the counts can end a step apart. The stream is also replayed with one
+# record per frame, which reads the moves a line at a time as the text does, and its steps
+# and cycle time are compared. The text run gets the {bin:1} line too, so both take the same
+# passes. Cycle times can still be a little apart where the text parser rounds a value
+# differently.
+# To flush the queue (! then %) while a binary frame is still being queued:
+#   make BOARD=sim sim-flush-binary
+# The flush comes after the 8th frame of hacdc, when the planner is full, so it lands
+# mid-frame. The frame must be answered as it stands, with no record run after the flush,
+# and the replay must finish.
+
+SIM_BUILD_DIR  ?= ./build/sim
+SIM_TARGET     = $(SIM_BUILD_DIR)/g2core-sim
+SIM_GCODE_DIR  ?= ../Resources/gcode
+SIM_SETTINGS   ?= settings_geratech.h
+SIM_DEFINES    ?=
+SIM_VI_DIR     ?= ./build/sim-vi
+SIM_ENCODER    ?= ../Resources/bstream_encode.py
+
+HOST_CXX       ?= g++
+
+SIM_SOURCES    = $(filter-out ./main.cpp ./xio.cpp, $(sort $(wildcard ./*.cpp))) $(sort $(wildcard ./board/sim/*.cpp))
+SIM_OBJECTS    = $(patsubst ./%.cpp,$(SIM_BUILD_DIR)/%.o,$(SIM_SOURCES))
+
+SIM_CXXFLAGS   = -std=gnu++11 -O2 -g -Wall -Wno-unused-variable -Wno-unused-function -Wno-unused-but-set-variable \
+                 -fno-exceptions -fno-rtti -MMD -MP \
+                 -I. -I./board/sim -I./board/sim/motate \
+                 -DSETTINGS_FILE=$(SIM_SETTINGS) -DMOTATE_BOARD="sim" -DDEBUG=0 -DIN_DEBUGGER=0 \
+                 $(SIM_DEFINES)
+
+.PHONY: all sim-replay sim-compare-dda sim-scan-bench sim-check-scan sim-zoid-bench sim-compare-binary sim-flush-binary clean
+
+all: $(SIM_TARGET)
+
+$(SIM_TARGET): $(SIM_OBJECTS)
+	$(HOST_CXX) -o $@ $^ -lm
+
+$(SIM_BUILD_DIR)/%.o: ./%.cpp
+	@mkdir -p $(dir $@)
+	$(HOST_CXX) $(SIM_CXXFLAGS) -c $< -o $@
+
+sim-replay: $(SIM_TARGET)
+	@for f in $(sort $(wildcard $(SIM_GCODE_DIR)/*.h)); do $(SIM_TARGET) $$f; echo; done
+
+sim-compare-dda: $(SIM_TARGET)
+	@$(MAKE) --no-print-directory BOARD=sim SIM_BUILD_DIR=$(SIM_VI_DIR) SIM_DEFINES="$(SIM_DEFINES) -D__VARIABLE_INTERVAL_DDA" all
+	@printf "%-28s %12s %12s %10s %12s %10s\n" program "dda isrs" "vi isrs" edges "max shift" mismatched
+	@for f in $(sort $(wildcard $(SIM_GCODE_DIR)/*.h)); do \
+	    $(SIM_TARGET) -t $(SIM_BUILD_DIR)/dda.trace $$f 2>$(SIM_BUILD_DIR)/dda.report; \
+	    $(SIM_VI_DIR)/g2core-sim -t $(SIM_VI_DIR)/vi.trace $$f 2>$(SIM_VI_DIR)/vi.report; \
+	    a=`grep "isr dda" $(SIM_BUILD_DIR)/dda.report | awk '{print $$3}'`; \
+	    b=`grep "isr dda" $(SIM_VI_DIR)/vi.report | awk '{print $$3}'`; \
+	    paste -d' ' $(SIM_BUILD_DIR)/dda.trace $(SIM_VI_DIR)/vi.trace | \
+	        awk -v p=`basename $$f .h` -v a=$$a -v b=$$b \
+	        '{ d = $$1 - $$4; if (d < 0) d = -d; if (d > max) max = d; if (($$2 != $$5) || ($$3 != $$6)) bad++; n++ } \
+	         END { printf "%-28s %12d %12d %10d %9d ns %10d\n", p, a, b, n, max, bad }'; \
+	done
+	@rm -f $(SIM_BUILD_DIR)/dda.trace $(SIM_BUILD_DIR)/dda.report $(SIM_VI_DIR)/vi.trace $(SIM_VI_DIR)/vi.report
+
+sim-scan-bench: $(SIM_TARGET)
+	@printf "%-28s %10s %8s %9s %9s %9s %s\n" program bytes lines "char ns/B" "word ns/B" speedup same
+	@for f in $(sort $(wildcard $(SIM_GCODE_DIR)/*.h)); do $(SIM_TARGET) -b $$f 2>&1; done
+
+sim-check-scan: $(SIM_TARGET)
+	@$(SIM_TARGET) -k 2>&1
+
+sim-zoid-bench: $(SIM_TARGET)
+	@$(SIM_TARGET) -z 2>&1
+
+sim-compare-binary: $(SIM_TARGET)
+	@printf "%-28s %9s %9s %6s %7s %7s %11s %11s %6s %6s %9s\n" program "text B" "binary B" ratio "text ln" "bin ln" "text cycle" "bin cycle" steps "1 rec" "1 rec dt"
+	@for f in $(sort $(wildcard $(SIM_GCODE_DIR)/*.h)); do \
+	    python3 $(SIM_ENCODER) $$f -o $(SIM_BUILD_DIR)/bs.stream 2>/dev/null; \
+	    python3 $(SIM_ENCODER) -r 1 $$f -o $(SIM_BUILD_DIR)/bs1.stream 2>/dev/null; \
+	    $(SIM_TARGET) -i "{bin:1}" $$f 2>$(SIM_BUILD_DIR)/text.report; \
+	    $(SIM_TARGET) -r $(SIM_BUILD_DIR)/bs.stream 2>$(SIM_BUILD_DIR)/bs.report; \
+	    $(SIM_TARGET) -r $(SIM_BUILD_DIR)/bs1.stream 2>$(SIM_BUILD_DIR)/bs1.report; \
+	    for r in text bs bs1; do \
+	        grep -E "^(rx bytes|lines +[0-9]|cycle time|steps|finished)" $(SIM_BUILD_DIR)/$$r.report | cut -c20- > $(SIM_BUILD_DIR)/$$r.sum; \
+	    done; \
+	    paste -d'|' $(SIM_BUILD_DIR)/text.sum $(SIM_BUILD_DIR)/bs.sum $(SIM_BUILD_DIR)/bs1.sum | \
+	        awk -F'|' -v p=`basename $$f .h` \
+	        '{ t[NR] = $$1; b[NR] = $$2; e[NR] = $$3 } \
+	         END { ok = ((b[1] == "yes") && (t[5] == b[5])) ? "same" : "DIFF"; \
+	               ok1 = ((e[1] == "yes") && (t[5] == e[5])) ? "same" : "DIFF"; \
+	               printf "%-28s %9d %9d %5.2fx %7d %7d %11s %11s %6s %6s %6.1f ms\n", \
+	                   p, t[3], b[3], t[3]/b[3], t[2], b[2], t[4], b[4], ok, ok1, (e[4] - t[4]) * 1000 }'; \
+	done
+	@rm -f $(SIM_BUILD_DIR)/bs.stream $(SIM_BUILD_DIR)/bs1.stream $(SIM_BUILD_DIR)/*.report $(SIM_BUILD_DIR)/*.sum
+
+sim-flush-binary: $(SIM_TARGET)
+	@python3 $(SIM_ENCODER) $(SIM_GCODE_DIR)/gcode_hacdc.h 2>/dev/null | \
+	    awk '{ print } /^@/ && (++n == 8) { print "!"; print "%" }' > $(SIM_BUILD_DIR)/bs.stream
+	@$(SIM_TARGET) -v -r $(SIM_BUILD_DIR)/bs.stream 2>$(SIM_BUILD_DIR)/bs.report | grep '"bsq":8}' > $(SIM_BUILD_DIR)/bs.sum
+	@awk -F'[][,]' -v fin="`grep '^finished' $(SIM_BUILD_DIR)/bs.report | cut -c20-`" \
+	    '{ printf "frame 8 status %d, finished %s: %s\n", $$(NF-2), fin, (($$(NF-2) == 0) && (fin == "yes")) ? "ok" : "FAIL" }' \
+	    $(SIM_BUILD_DIR)/bs.sum
+	@rm -f $(SIM_BUILD_DIR)/bs.stream $(SIM_BUILD_DIR)/bs.report $(SIM_BUILD_DIR)/bs.sum
+
+clean:
+	rm -rf $(SIM_BUILD_DIR)
+
+-include $(SIM_OBJECTS:.o=.d)
@@ -0,0 +1,281 @@
+/*
+ * board_can.cpp - loopback CAN bus with emulated CiA-402 drives (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*  See board_can.h for a description of the emulated bus.
+ */
+
+#include "g2core.h"
+#include "hardware.h"
+#include "board_stepper.h"                  // sim_plant_scale
+#include "canopen.h"
+#include "can_bus.h"
+#include "stepper.h"                        // motion clock
+#include "sim_clock.h"
+
+#ifdef SIM_CAN_SERVOS
+
+SimCan Can0;
+simDrive_t sim_drive[MOTORS];
+
+// TX queue sizes - the board's SIZE_TX_xxx_BUFFERs, then the drives' replies
+static const uint8_t sim_can_tx_size[SIM_CAN_TX_QUEUES] = { 16, 8, 8, SIM_CAN_TX_BUFFER };
+#define SIM_CAN_REPLIES (SIM_CAN_TX_QUEUES-1)
+
+static void _drive_frame(const uint8_t node, const uint32_t function, const CAN_FRAME &frame);
+static void _drive_sync(const uint8_t node);
+static void _drive_reply(const uint32_t id, const uint8_t length, const uint8_t *data);
+
+/*
+ * hw_can_init() - power up the drives
+ */
+
+void hw_can_init()
+{
+    for (uint8_t i=0; i < MOTORS; i++) {
+        simDrive_t *d = &sim_drive[i];
+        d->operational = false;
+        d->mode = 0;
+        d->statusword = 0x40;               // switch on disabled
+        d->controlword = 0;
+        d->pending = d->applied = d->reached = (i+1) * SIM_CAN_NODE_BASE;
+        d->plant = d->reached;
+    }
+}
+
+bool hw_can_send_frame(uint32_t id, uint8_t length, uint8_t *data, uint8_t tx_class)
+{
+    CAN_FRAME f;
+    f.id = id;
+    f.fid = 0;
+    f.rtr = 0;
+    f.priority = tx_class;
+    f.extended = (id > 0x7FF);
+    f.time = 0;
+    f.length = length;
+    for (int i=0; i<length; i++) f.data.bytes[i] = data[i];
+
+    return (Can0.sendFrame(f));
+}
+
+/*
+ * SimCan::sendFrame() - queue a frame from the controller in its class. False if the queue is full.
+ * SimCan::sendReply() - queue a frame from a drive
+ * SimCan::readRx()    - take the oldest received frame
+ */
+
+bool SimCan::sendFrame(CAN_FRAME &frame)
+{
+    run();
+    if (!_queue(frame.priority, frame)) {
+        tx_refused++;
+        return (false);
+    }
+    tx_frames++;
+    if (!on_bus) {
+        _next(sim_now_ns());
+    }
+    return (true);
+}
+
+bool SimCan::sendReply(const CAN_FRAME &frame)       // only from _deliver(), which starts it
+{
+    return (_queue(SIM_CAN_REPLIES, frame));
+}
+
+bool SimCan::readRx(CAN_FRAME &frame)
+{
+    run();
+    if (rx_count == 0) {
+        return (false);
+    }
+    frame = rx[rx_head];
+    rx_head = (rx_head + 1) % SIM_CAN_RX_BUFFER;
+    rx_count--;
+    return (true);
+}
+
+/*
+ * SimCan::run()     - transmit the frames that finish by now
+ * SimCan::_queue()  - add a frame to a TX queue
+ * SimCan::_next()   - start the frame with the lowest ID at the head of a queue
+ */
+
+void SimCan::run()
+{
+    while (on_bus && (on_bus_end_ns <= sim_now_ns())) {
+        simCanQueue_t *q = &tx[on_bus_queue];
+        CAN_FRAME frame = q->frame[q->head];
+        q->head = (q->head + 1) % SIM_CAN_TX_BUFFER;
+        q->count--;
+        on_bus = false;
+        _deliver(on_bus_queue, frame);      // may queue replies
+        _next(on_bus_end_ns);
+    }
+}
+
+bool SimCan::_queue(const uint8_t q, const CAN_FRAME &frame)
+{
+    simCanQueue_t *tq = &tx[q];
+    if (tq->count >= sim_can_tx_size[q]) {
+        return (false);
+    }
+    tq->frame[(tq->head + tq->count) % SIM_CAN_TX_BUFFER] = frame;
+    tq->count++;
+    return (true);
+}
+
+void SimCan::_next(const uint64_t start_ns)
+{
+    const CAN_FRAME *next = NULL;
+    for (uint8_t q=0; q < SIM_CAN_TX_QUEUES; q++) {
+        const simCanQueue_t *tq = &tx[q];
+        if ((tq->count != 0) && ((next == NULL) || (tq->frame[tq->head].id < next->id))) {
+            next = &tq->frame[tq->head];
+            on_bus_queue = q;
+        }
+    }
+    if (next == NULL) {
+        return;
+    }
+    const uint64_t ns = (uint64_t)CAN_FRAME_BITS(next->length, next->extended) * 1000000000 / CAN_BITRATE;
+    on_bus = true;
+    on_bus_end_ns = start_ns + ns;
+    busy_ns += ns;
+}
+
+/*
+ * SimCan::_deliver() - a frame has been transmitted. Frames from the controller go to the
+ *                      drives, and frames from the drives to the RX ring.
+ * SimCan::_queueRx() - queue a frame for can_rx_callback()
+ */
+
+void SimCan::_deliver(const uint8_t q, const CAN_FRAME &frame)
+{
+    if (q == SIM_CAN_REPLIES) {
+        _queueRx(frame);
+        return;
+    }
+    if (frame.extended) {
+        return;
+    }
+    uint8_t node = frame.id & CANOPEN_NODE_MASK;
+    uint32_t function = frame.id & CANOPEN_FUNCTION_MASK;
+
+    if (frame.id == CANOPEN_SYNC) {
+        for (uint8_t n=1; n <= MOTORS; n++) {
+            _drive_sync(n);
+        }
+    } else if (frame.id == CANOPEN_NMT) {
+        for (uint8_t n=1; n <= MOTORS; n++) {
+            if ((frame.data.bytes[1] == 0) || (frame.data.bytes[1] == n)) {
+                _drive_frame(n, CANOPEN_NMT, frame);
+            }
+        }
+    } else if ((node >= 1) && (node <= MOTORS)) {
+        _drive_frame(node, function, frame);
+    }
+}
+
+bool SimCan::_queueRx(const CAN_FRAME &frame)
+{
+    if (rx_count >= SIM_CAN_RX_BUFFER) {
+        rx_dropped++;
+        return (false);
+    }
+    CAN_FRAME *f = &rx[(rx_head + rx_count) % SIM_CAN_RX_BUFFER];
+    *f = frame;
+    f->ticks = st_get_motion_ticks();
+    rx_count++;
+    rx_queued++;
+    return (true);
+}
+
+/*
+ * _drive_frame() - NMT, SDO and RPDO1 frames addressed to a drive
+ */
+
+static void _drive_frame(const uint8_t node, const uint32_t function, const CAN_FRAME &frame)
+{
+    simDrive_t *d = &sim_drive[node-1];
+    const uint8_t *data = frame.data.bytes;
+
+    if (function == CANOPEN_NMT) {
+        if (data[0] == CANOPEN_NMT_START) {
+            d->operational = true;
+        }
+    } else if (function == CANOPEN_SDO_RX) {            // expedited writes only
+        if ((data[1] == 0x60) && (data[2] == 0x60) && (data[3] == 0)) {
+            d->mode = data[4];
+        }
+        uint8_t reply[8] = { 0x60, data[1], data[2], data[3], 0, 0, 0, 0 };
+        _drive_reply(CANOPEN_SDO_TX + node, 8, reply);
+    } else if ((function == CANOPEN_RPDO1) && (frame.length >= 6)) {
+        d->controlword = data[0] | (data[1] << 8);
+        d->pending = (int32_t)(data[2] | (data[3] << 8) | (data[4] << 16) | ((uint32_t)data[5] << 24));
+    }
+}
+
+/*
+ * _drive_sync() - move, reply, then take the new controlword and target
+ */
+
+static void _drive_sync(const uint8_t node)
+{
+    simDrive_t *d = &sim_drive[node-1];
+    if (!d->operational) {
+        return;
+    }
+    d->plant += (d->applied - d->reached) * sim_plant_scale;
+    d->reached = d->applied;
+
+    int32_t actual = (int32_t)floor(d->plant + 0.5);
+    uint8_t tpdo[6] = { (uint8_t)(d->statusword & 0xFF), (uint8_t)(d->statusword >> 8),
+                        (uint8_t)(actual & 0xFF), (uint8_t)((actual >> 8) & 0xFF),
+                        (uint8_t)((actual >> 16) & 0xFF), (uint8_t)((actual >> 24) & 0xFF) };
+    _drive_reply(CANOPEN_TPDO1 + node, 6, tpdo);
+
+    switch (d->controlword) {
+        case CIA402_CW_SHUTDOWN:    { if (d->statusword != 0x08) { d->statusword = 0x21; } break; }
+        case CIA402_CW_SWITCH_ON:   { if (d->statusword == 0x21) { d->statusword = 0x23; } break; }
+        case CIA402_CW_ENABLE: {
+            if (d->statusword == 0x21) {
+                d->statusword = 0x23;
+            } else if ((d->statusword == 0x23) && (d->mode == CIA402_MODE_CSP)) {
+                d->statusword = 0x27;
+            }
+            break;
+        }
+        case CIA402_CW_FAULT_RESET: { if (d->statusword == 0x08) { d->statusword = 0x40; } break; }
+        default: { break; }
+    }
+    if (d->statusword == 0x27) {
+        d->applied = d->pending;
+    } else {                                // not following - it holds where it is
+        d->applied = d->reached;
+    }
+}
+
+static void _drive_reply(const uint32_t id, const uint8_t length, const uint8_t *data)
+{
+    CAN_FRAME f;
+    memset(&f, 0, sizeof(f));
+    f.id = id;
+    f.length = length;
+    memcpy(f.data.bytes, data, length);
+    Can0.sendReply(f);
+}
+
+#endif // SIM_CAN_SERVOS
@@ -0,0 +1,135 @@
+/*
+ * board_can.h - loopback CAN bus with emulated CiA-402 drives (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The sim has a CAN bus only in the servo build (SIM_CAN_SERVOS - see board/sim.mk), where
+ * the motors are GeratechServos. Frames sent by the controller go over the bus to a CiA-402
+ * drive emulated for each motor (nodes 1 - MOTORS), and the drives' replies come back over
+ * it to Can0's RX ring for can_rx_callback(), as the CAN interrupt does on the board.
+ *
+ *  The bus runs at CAN_BITRATE, and each frame takes CAN_FRAME_BITS() of it. Each TX class
+ *  (see can_bus.h) has a queue the size of the board's, and a frame is refused when its
+ *  queue is full. The drives' replies wait in a queue of their own. When the bus comes
+ *  free the lowest ID at the head of a queue goes next, as bus arbitration would have it.
+ *  The bus is caught up with the virtual clock whenever it is sent to or read, which the
+ *  controller does every pass, so a frame arrives within a pass of the end of its
+ *  transmission. Received frames are stamped with the motion clock then.
+ *
+ *  A drive is started by NMT, takes mode of operation 8 by SDO and follows the CiA-402
+ *  state machine from the controlword. At each SYNC it moves to the target applied at
+ *  the previous one, replies with its statusword and actual position (TPDO1), then
+ *  applies the latest target it was sent. Like the SimStepper plant it moves
+ *  sim_plant_scale steps for every step it is commanded (sim -m).
+ */
+
+#ifndef BOARD_CAN_H_ONCE
+#define BOARD_CAN_H_ONCE
+
+#ifdef SIM_CAN_SERVOS
+
+#define CAN_ENABLED
+
+#define CAN_BITRATE         250000          // same as geratech_proto
+
+#define SIM_CAN_RX_BUFFER   32              // frames - same as SIZE_RX_BUFFER on the board
+#define SIM_CAN_TX_BUFFER   16              // most frames in any TX queue (see sim_can_tx_size[])
+#define SIM_CAN_TX_QUEUES   4               // one per TX class (see can_bus.h), then the drives' replies
+#define SIM_CAN_NODE_BASE   1000000         // drive positions at power up are node * this
+
+typedef union {                             // the parts of the board's CAN_FRAME the application uses
+    uint32_t value[2];
+    uint8_t bytes[8];
+} BytesUnion;
+
+typedef struct {
+    uint32_t id;
+    uint32_t fid;
+    uint8_t rtr;
+    uint8_t priority;
+    uint8_t extended;
+    uint16_t time;
+    uint32_t ticks;                         // motion clock when it was received (see st_get_motion_ticks())
+    uint8_t length;
+    BytesUnion data;
+} CAN_FRAME;
+
+typedef struct simCanQueue {               // frames waiting for the bus
+    CAN_FRAME frame[SIM_CAN_TX_BUFFER];
+    uint8_t head;
+    uint8_t count;
+} simCanQueue_t;
+
+class SimCan {
+  public:
+    bool sendFrame(CAN_FRAME &frame);       // to the emulated drives
+    bool sendReply(const CAN_FRAME &frame); // from the emulated drives
+
+    bool readRx(CAN_FRAME &frame);
+    uint16_t rxCount() { run(); return (rx_count); }
+    void run();                             // transmit up to now
+    uint32_t getRxDropped() { return (rx_dropped); }
+    uint32_t getRxOverruns() { return (0); }
+
+    void pollStatus() {};                   // the emulated bus has no errors
+    uint32_t getBusErrors() { return (0); }
+    uint32_t getBusOffs() { return (0); }
+    uint8_t get_tx_error_cnt() { return (0); }
+    uint8_t get_rx_error_cnt() { return (0); }
+    uint16_t getTxMaxDepth() { return (0); }
+    void clearStatistics() { rx_dropped = 0; }
+
+    uint32_t tx_frames;
+    uint32_t tx_refused;                    // controller frames refused - TX queue full
+    uint32_t rx_queued;
+    uint64_t busy_ns;                       // time the bus has spent transmitting
+
+  private:
+    simCanQueue_t tx[SIM_CAN_TX_QUEUES];
+    bool on_bus;                            // a frame is being transmitted...
+    uint8_t on_bus_queue;                   // ...from this queue...
+    uint64_t on_bus_end_ns;                 // ...until then
+
+    bool _queue(const uint8_t q, const CAN_FRAME &frame);
+    void _next(const uint64_t start_ns);
+    void _deliver(const uint8_t q, const CAN_FRAME &frame);
+    bool _queueRx(const CAN_FRAME &frame);
+
+    CAN_FRAME rx[SIM_CAN_RX_BUFFER];
+    uint16_t rx_head;
+    uint16_t rx_count;
+    uint32_t rx_dropped;
+};
+
+extern SimCan Can0;
+
+typedef struct simDrive {                   // one emulated CiA-402 drive
+    bool operational;                       // NMT started
+    uint8_t mode;                           // modes of operation (0x6060)
+    uint16_t statusword;
+    uint16_t controlword;                   // latest controlword received
+    int32_t pending;                        // latest target received
+    int32_t applied;                        // target applied at the last SYNC
+    int32_t reached;                        // target the plant has moved to
+    double plant;                           // actual position in steps
+} simDrive_t;
+
+extern simDrive_t sim_drive[MOTORS];
+
+void hw_can_init();
+bool hw_can_send_frame(uint32_t, uint8_t, uint8_t*, uint8_t);
+
+#endif // SIM_CAN_SERVOS
+#endif // End of include guard: BOARD_CAN_H_ONCE
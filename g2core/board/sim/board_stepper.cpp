@@ -0,0 +1,170 @@
+/*
+ * board_stepper.cpp - board-specific code for stepper.cpp (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "board_stepper.h"
+#include "sim_clock.h"
+
+#ifdef SIM_CAN_SERVOS
+
+GeratechServo<1> motor_1{};
+GeratechServo<2> motor_2{};
+GeratechServo<3> motor_3{};
+GeratechServo<4> motor_4{};
+
+#else
+
+SimStepper<Motate::kSocket1_StepPinNumber> motor_1{};
+SimStepper<Motate::kSocket2_StepPinNumber> motor_2{};
+SimStepper<Motate::kSocket3_StepPinNumber> motor_3{};
+SimStepper<Motate::kSocket4_StepPinNumber> motor_4{};
+
+#endif
+
+Stepper* Motors[MOTORS] = {&motor_1, &motor_2, &motor_3, &motor_4};
+
+double sim_plant_scale = 1.0;
+
+void board_stepper_init() {
+    for (uint8_t motor = 0; motor < MOTORS; motor++) { Motors[motor]->init(); }
+}
+
+/*
+ * sim_motor_position() - where the motor was told to go, in steps from where it started
+ * sim_motor_plant()    - where the plant is, in steps from where it started
+ * sim_motors_settled() - true once the drives have reached their last targets
+ *
+ *  A drive's positions are taken relative to the origin the controller latched for it.
+ *  Drives trail the steps by a CSP period or two (see canopen.h), so the replay waits
+ *  for them before reporting. Step motors are always settled.
+ */
+
+#ifdef SIM_CAN_SERVOS
+
+static const canDrive_t *_drive(const uint8_t motor)
+{
+    switch (motor) {
+        case MOTOR_1: { return (&motor_1._drive); }
+        case MOTOR_2: { return (&motor_2._drive); }
+        case MOTOR_3: { return (&motor_3._drive); }
+        default:      { return (&motor_4._drive); }
+    }
+}
+
+int32_t sim_motor_position(const uint8_t motor)
+{
+    return (sim_drive[motor].applied - _drive(motor)->origin);
+}
+
+double sim_motor_plant(const uint8_t motor)
+{
+    return (sim_drive[motor].plant - _drive(motor)->origin);
+}
+
+bool sim_motors_settled()
+{
+    for (uint8_t m=0; m<MOTORS; m++) {
+        const canDrive_t *d = _drive(m);
+        if (d->tracking && (sim_drive[m].reached != d->origin + (int32_t)lround(d->target))) {
+            return (false);
+        }
+    }
+    return (true);
+}
+
+#else
+
+int32_t sim_motor_position(const uint8_t motor)
+{
+    switch (motor) {
+        case MOTOR_1: { return (motor_1.position); }
+        case MOTOR_2: { return (motor_2.position); }
+        case MOTOR_3: { return (motor_3.position); }
+        default:      { return (motor_4.position); }
+    }
+}
+
+double sim_motor_plant(const uint8_t motor)
+{
+    switch (motor) {
+        case MOTOR_1: { return (motor_1.plant); }
+        case MOTOR_2: { return (motor_2.plant); }
+        case MOTOR_3: { return (motor_3.plant); }
+        default:      { return (motor_4.plant); }
+    }
+}
+
+bool sim_motors_settled() { return (true); }
+
+#endif
+
+/*
+ * step_ports_clear() - CODR all step pins, one write per port that has any
+ * step_ports_set()   - SODR the DDA's port image, one write per port that has step pins
+ */
+
+simStepPorts_t sim_step_ports;
+
+template <typename motor_t>
+static void _step_edges(motor_t &motor, const uint32_t rising[])
+{
+    if (rising[motor_t::step_port] & motor_t::step_mask) {
+        motor.stepStart();
+    }
+}
+
+void step_ports_clear()
+{
+    for (uint8_t port = 0; port < STEP_PORTS; port++) {
+        if (step_port_mask(port)) {
+            sim_step_ports.level[port] &= ~step_port_mask(port);
+            sim_step_ports.clears++;
+        }
+    }
+    motor_1.stepEnd();
+    motor_2.stepEnd();
+    motor_3.stepEnd();
+    motor_4.stepEnd();
+}
+
+void step_ports_set(const uint32_t image[STEP_PORTS])
+{
+    uint32_t rising[STEP_PORTS];
+    for (uint8_t port = 0; port < STEP_PORTS; port++) {
+        rising[port] = 0;
+        if (step_port_mask(port)) {
+            rising[port] = image[port] & ~sim_step_ports.level[port];
+            sim_step_ports.level[port] |= image[port];
+            sim_step_ports.sets++;
+            if ((sim_step_ports.trace != NULL) && (rising[port] != 0)) {
+                fprintf(sim_step_ports.trace, "%llu %c %08lx\n", (unsigned long long)sim_now_ns(),
+                        'A' + port, (unsigned long)image[port]);
+            }
+        }
+    }
+    _step_edges(motor_1, rising);
+    _step_edges(motor_2, rising);
+    _step_edges(motor_3, rising);
+    _step_edges(motor_4, rising);
+}
@@ -0,0 +1,163 @@
+/*
+ * board_stepper.h - board-specific code for stepper.h (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BOARD_STEPPER_H_ONCE
+#define BOARD_STEPPER_H_ONCE
+
+#include "hardware.h"  // for MOTORS
+#include "stepper.h"
+
+/*
+ * SimStepper - a step/dir motor that just counts
+ *
+ *  Steps are counted on the rising edge (stepStart) and signed by the last direction
+ *  written. The replay report compares these counts to the runtime's idea of position.
+ *  The step pin is the geratech_proto one, so the motor sits on the same PIO port bit
+ *  and its rising edges come from the simulated port writes below.
+ *
+ *  Each motor also drives a simple plant - the load it is connected to - that moves
+ *  sim_plant_scale steps for every step (1.0 unless set by sim -m). A scale below 1 models
+ *  a motor that loses a little on every step, such as a servo with a steady following
+ *  error or a slipping belt. The plant position is what readEncoder() reports, so it is
+ *  the position closed loop step correction sees with encoder source 1 ({1es:1}).
+ */
+
+extern double sim_plant_scale;
+
+template <Motate::pin_number step_num>
+struct SimStepper final : Stepper {
+    static constexpr uint8_t  step_port = (step_num < 0) ? 0 : (Motate::OutputPin<step_num>::portLetter - 'A');
+    static constexpr uint32_t step_mask = (step_num < 0) ? 0 : Motate::OutputPin<step_num>::mask;
+
+    int32_t  position;                      // signed step count
+    double   plant;                         // plant position in steps
+    uint32_t steps;                         // total steps taken (unsigned)
+    uint32_t direction_changes;
+    uint8_t  direction;
+    bool     step_high;
+    bool     enabled;
+
+    SimStepper() : Stepper{} { reset(); };
+
+    void reset() {
+        position = 0;
+        plant = 0;
+        steps = 0;
+        direction_changes = 0;
+        direction = STEP_INITIAL_DIRECTION;
+        step_high = false;
+        enabled = false;
+    };
+
+    bool canStep() override { return true; };
+    void _enableImpl() override { enabled = true; };
+    void _disableImpl() override { enabled = false; };
+
+    void stepStart() override {
+        step_high = true;
+        steps++;
+        position += (direction == DIRECTION_CW) ? 1 : -1;
+        plant += (direction == DIRECTION_CW) ? sim_plant_scale : -sim_plant_scale;
+    };
+
+    bool readEncoder(int32_t &measured) override {
+        measured = (int32_t)floor(plant + 0.5);
+        return true;
+    };
+
+    void stepEnd() override { step_high = false; };
+
+    void setDirection(uint8_t new_direction) override {
+        if (new_direction != direction) {
+            direction_changes++;
+        }
+        direction = new_direction;
+    };
+
+    void setMicrosteps(const uint8_t microsteps) override {};
+    void setPowerLevel(float new_pl) override {};
+};
+
+#ifdef SIM_CAN_SERVOS                       // CiA-402 drives on the emulated CAN bus (see board_can.h)
+
+#include "device/step_dir_geratech_servo/step_dir_driver.h"
+
+extern GeratechServo<1> motor_1;
+extern GeratechServo<2> motor_2;
+extern GeratechServo<3> motor_3;
+extern GeratechServo<4> motor_4;
+
+#else
+
+extern SimStepper<Motate::kSocket1_StepPinNumber> motor_1;
+extern SimStepper<Motate::kSocket2_StepPinNumber> motor_2;
+extern SimStepper<Motate::kSocket3_StepPinNumber> motor_3;
+extern SimStepper<Motate::kSocket4_StepPinNumber> motor_4;
+
+#endif
+
+extern Stepper* Motors[MOTORS];
+
+int32_t sim_motor_position(const uint8_t motor);    // steps taken, or the drive's applied target
+double sim_motor_plant(const uint8_t motor);        // plant position in steps
+bool sim_motors_settled(void);                      // the drives have reached their last targets
+
+/*
+ * Port-batched step output - simulated PIO ports (see geratech_proto/board_stepper.h)
+ *
+ *  step_ports_set() and step_ports_clear() make the same writes the real board does, to
+ *  the same ports, and keep each port's output level. Motors step on the rising edges.
+ *  With a trace file open (sim -t) every set write that raises a pin is logged as
+ *
+ *      <virtual time ns> <port letter> <image in hex>
+ *
+ *  so the pulses can be checked against the pin assignments without the motor objects.
+ */
+
+#define STEP_PORT_BATCHING
+#define STEP_PORTS 4                        // PIOA - PIOD
+
+constexpr uint32_t step_port_mask(const uint8_t port)     // all step pins on a port
+{
+    return (((decltype(motor_1)::step_port == port) ? decltype(motor_1)::step_mask : 0) |
+            ((decltype(motor_2)::step_port == port) ? decltype(motor_2)::step_mask : 0) |
+            ((decltype(motor_3)::step_port == port) ? decltype(motor_3)::step_mask : 0) |
+            ((decltype(motor_4)::step_port == port) ? decltype(motor_4)::step_mask : 0));
+}
+
+typedef struct simStepPorts {
+    uint32_t level[STEP_PORTS];             // output level of each port (ODSR)
+    uint64_t sets;                          // SODR writes
+    uint64_t clears;                        // CODR writes
+    FILE *trace;                            // port image trace, or NULL
+} simStepPorts_t;
+
+extern simStepPorts_t sim_step_ports;
+
+void step_ports_clear();
+void step_ports_set(const uint32_t image[STEP_PORTS]);
+
+void board_stepper_init();
+
+#endif  // BOARD_STEPPER_H_ONCE
@@ -0,0 +1,80 @@
+/*
+ * MotateBuffer.h - host-side stand-in for the Motate RX buffer (sim board ONLY)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The sim replays programs through sim_xio.cpp, so nothing here is used by the replay.
+ * RXBuffer is only what LineRXBuffer (xio_line_buffer.h) needs of it, so the line scanner
+ * can be run on the host (see sim_scan.cpp).
+ *
+ *  The owner is a pointer to a device with the RX half of the xioDeviceWrapper interface:
+ *  startRXTransfer() and getRXTransferPosition(). _data is a ring. A transfer fills the
+ *  free space after the write offset up to the end of _data, and one entry is always kept
+ *  free so a full ring is not taken for an empty one. A new transfer is started whenever
+ *  LineRXBuffer asks (_restartTransfer()), so the device must finish each one at once.
+ */
+
+#ifndef MOTATEBUFFER_H_ONCE
+#define MOTATEBUFFER_H_ONCE
+
+#include <stdint.h>
+
+namespace Motate {
+
+    template <uint16_t _size, typename owner_type, typename base_type = char>
+    struct RXBuffer {
+        static_assert(((_size-1)&_size)==0, "_size must be 2^N");
+
+        owner_type _owner;
+        base_type _data[_size];
+        volatile uint16_t _read_offset = 0;
+        uint16_t _last_known_write_offset = 0;
+
+        RXBuffer(owner_type owner) : _owner{owner} {};
+
+        void init() {
+            base_type *start = &_data[0];
+            _owner->startRXTransfer(start, _size-1);
+        };
+
+        uint16_t _getWriteOffset() {
+            _last_known_write_offset = (_owner->getRXTransferPosition() - _data) & (_size-1);
+            return (_last_known_write_offset);
+        };
+
+        bool isEmpty() { return (_read_offset == _getWriteOffset()); };
+
+        bool _canBeRead(const uint16_t offset) {
+            return (((offset - _read_offset) & (_size-1)) < ((_getWriteOffset() - _read_offset) & (_size-1)));
+        };
+
+        void _restartTransfer() {
+            uint16_t write = _getWriteOffset();
+            uint16_t free = (_read_offset - write - 1) & (_size-1);
+            if (free > (_size - write)) {
+                free = _size - write;
+            }
+            if (free != 0) {
+                base_type *start = &_data[write];
+                _owner->startRXTransfer(start, free);
+            }
+        };
+
+        void flush() { _read_offset = _getWriteOffset(); };
+    };
+
+} // namespace Motate
+
+#endif // End of include guard: MOTATEBUFFER_H_ONCE
@@ -0,0 +1,189 @@
+/*
+ * MotatePins.h - host-side stand-in for the Motate pin classes (sim board ONLY)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The sim board compiles the g2core sources on a Linux host. This header (and the
+ * other Motate*.h files in this directory) provide just enough of the Motate API to
+ * satisfy the application code. Pins are plain memory - writes are remembered and
+ * reads return the last value written. Nothing here touches real hardware.
+ *
+ * Pin numbers come from the geratech_proto pinout so the simulated machine has the
+ * same set of null (-1) and non-null pins as the real board. The geratech_proto pin
+ * assignments are read too, so each pin knows its PIO port and bit (portLetter, mask)
+ * as it does under Motate. The sim uses these for port-batched step output.
+ */
+
+#ifndef MOTATEPINS_H_ONCE
+#define MOTATEPINS_H_ONCE
+
+#include <stdint.h>
+#include <functional>
+
+namespace Motate {
+
+    typedef const int16_t pin_number;
+
+    /**** Pin options, interrupt and priority flags ****/
+
+    enum PinMode {
+        kUnchanged      = 0,
+        kOutput         = 1,
+        kInput          = 2
+    };
+
+    enum PinOptions {
+        kNormal         = 0,
+        kTotem          = 0,
+        kStartHigh      = 1<<1,
+        kStartLow       = 1<<2,
+        kPullUp         = 1<<3,
+        kDebounce       = 1<<4,
+        kPWMPinInverted = 1<<5
+    };
+
+    enum PinInterruptOptions {
+        kPinInterruptsOff            = 0,
+        kPinInterruptOnChange        = 1<<0,
+        kPinInterruptOnRisingEdge    = 1<<1,
+        kPinInterruptOnFallingEdge   = 1<<2,
+        kPinInterruptPriorityHighest = 1<<5,
+        kPinInterruptPriorityHigh    = 1<<6,
+        kPinInterruptPriorityMedium  = 1<<7,
+        kPinInterruptPriorityLow     = 1<<8,
+        kPinInterruptPriorityLowest  = 1<<9
+    };
+
+    /**** PinPort - PIO port and bit of a pin, from _MAKE_MOTATE_PIN() ****/
+
+    template <int16_t pinNum>
+    struct PinPort {                        // unassigned and null pins are on no port
+        static const uint8_t portLetter = 0;
+        static const uint32_t mask = 0;
+    };
+
+    #define _MAKE_MOTATE_PIN(pinNum, registerChar, registerPin)                     \
+        template <>                                                                 \
+        struct PinPort<pinNum> {                                                    \
+            static const uint8_t portLetter = registerChar;                        \
+            static const uint32_t mask = (1u << registerPin);                      \
+        }
+
+    /**** Pin - generic digital pin ****/
+
+    template <int16_t pinNum>
+    struct Pin {
+        static const int16_t number = pinNum;
+        static const uint8_t portLetter = PinPort<pinNum>::portLetter;
+        static const uint32_t mask = PinPort<pinNum>::mask;
+        bool _value = false;
+
+        Pin() {};
+        Pin(const uint32_t options) { _value = (options & kStartHigh); };
+        Pin(const PinMode mode, const uint32_t options = kNormal) : Pin(options) {};
+
+        void init(const PinMode mode, const uint32_t options = kNormal) { _value = (options & kStartHigh); };
+        bool isNull() const { return (pinNum < 0); };
+
+        void set() { _value = true; };
+        void clear() { _value = false; };
+        void toggle() { _value = !_value; };
+        void write(const bool value) { _value = value; };
+        bool get() const { return (_value); };
+        operator bool() const { return (_value); };
+        Pin &operator=(const bool value) { write(value); return (*this); };
+    };
+
+    template <int16_t pinNum>
+    struct OutputPin : Pin<pinNum> {
+        OutputPin() : Pin<pinNum>() {};
+        OutputPin(const uint32_t options) : Pin<pinNum>(options) {};
+        OutputPin &operator=(const bool value) { this->write(value); return (*this); };
+    };
+
+    template <int16_t pinNum>
+    struct InputPin : Pin<pinNum> {
+        InputPin() : Pin<pinNum>() {};
+        InputPin(const uint32_t options) : Pin<pinNum>(options) {};
+    };
+
+    /**** IRQPin - input pin with a change interrupt (callback is never fired in sim) ****/
+
+    template <int16_t pinNum>
+    struct IRQPin : InputPin<pinNum> {
+        std::function<void(void)> _interrupt_handler;
+
+        IRQPin(const uint32_t options, const std::function<void(void)> &&handler,
+               const uint32_t interrupt_settings = kPinInterruptOnChange|kPinInterruptPriorityMedium)
+            : InputPin<pinNum>(options), _interrupt_handler{handler} {};
+
+        void setInterrupts(const uint32_t interrupts) {};
+        void setInterruptHandler(std::function<void(void)> &&handler) { _interrupt_handler = handler; };
+    };
+
+    /**** PWM pins - remember the duty cycle as a float ****/
+
+    template <int16_t pinNum>
+    struct PWMOutputPin {
+        float _duty = 0.0;
+        uint32_t _frequency = 0;
+
+        PWMOutputPin() {};
+        PWMOutputPin(const uint32_t options, const uint32_t freq = 0) : _frequency{freq} {};
+
+        bool isNull() const { return (pinNum < 0); };
+        void setFrequency(const uint32_t freq) { _frequency = freq; };
+        void setInterrupts(const uint32_t interrupts) {};
+        void write(const float duty) { _duty = duty; };
+        void set() { _duty = 1.0; };
+        void clear() { _duty = 0.0; };
+        void toggle() { _duty = (_duty > 0.5) ? 0.0 : 1.0; };
+        operator float() const { return (_duty); };
+        PWMOutputPin &operator=(const float duty) { write(duty); return (*this); };
+    };
+
+    template <int16_t pinNum>
+    struct PWMLikeOutputPin : PWMOutputPin<pinNum> {
+        PWMLikeOutputPin() : PWMOutputPin<pinNum>() {};
+        PWMLikeOutputPin(const uint32_t options, const uint32_t freq = 0) : PWMOutputPin<pinNum>(options, freq) {};
+        PWMLikeOutputPin &operator=(const float duty) { this->write(duty); return (*this); };
+    };
+
+    /**** ADC pins - always read zero ****/
+
+    struct ADC_Module {
+        static void startSampling() {};
+    };
+
+    template <int16_t pinNum>
+    struct ADCPin {
+        ADCPin() {};
+        ADCPin(const uint32_t options) {};
+
+        bool isNull() const { return (pinNum < 0); };
+        void setInterrupts(const uint32_t interrupts) {};
+        int32_t getRaw() const { return (0); };
+        int32_t getValue() const { return (0); };
+        int32_t getTop() const { return (4095); };
+        void startSampling() {};
+        static void interrupt();
+    };
+
+} // namespace Motate
+
+#include "../../geratech_proto/motate_pin_assignments.h"    // also pulls in the pinout (sim-pinout.h)
+#include "MotateTimers.h"       // Motate pulls the timers in with the pins
+
+#endif // End of include guard: MOTATEPINS_H_ONCE
@@ -0,0 +1,179 @@
+/*
+ * MotateTimers.h - host-side stand-in for the Motate timers (sim board ONLY)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * TimerChannel<>, SysTickTimer and Timeout are backed by the virtual clock in
+ * sim_clock.h. TimerChannel<>::interrupt() is declared here and defined by the
+ * application exactly as it is on the ARM build (see stepper.cpp).
+ */
+
+#ifndef MOTATETIMERS_H_ONCE
+#define MOTATETIMERS_H_ONCE
+
+#include <stdint.h>
+#include <functional>
+
+#include "MotatePins.h"
+#include "sim_clock.h"
+
+#define __NOP() do {} while (0)
+
+namespace Motate {
+
+    enum TimerMode {
+        kTimerUp            = 0,
+        kTimerUpToMatch     = 1,
+        kTimerUpDown        = 2,
+        kTimerUpDownToMatch = 3
+    };
+
+    enum TimerChannelInterruptOptions {
+        kInterruptsOff              = 0,
+        kInterruptOnMatch           = 1<<0,
+        kInterruptOnOverflow        = 1<<1,
+        kInterruptOnSoftwareTrigger = 1<<2,
+
+        kInterruptPriorityHighest   = 1<<5,
+        kInterruptPriorityHigh      = 1<<6,
+        kInterruptPriorityMedium    = 1<<7,
+        kInterruptPriorityLow       = 1<<8,
+        kInterruptPriorityLowest    = 1<<9
+    };
+
+    inline uint8_t _sim_priority(const uint32_t interrupts) {
+        if (interrupts == kInterruptsOff) { return (SIM_PRIORITY_THREAD); }   // masked - stays pending
+        if (interrupts & kInterruptPriorityHighest) { return (SIM_PRIORITY_HIGHEST); }
+        if (interrupts & kInterruptPriorityHigh)    { return (SIM_PRIORITY_HIGH); }
+        if (interrupts & kInterruptPriorityMedium)  { return (SIM_PRIORITY_MEDIUM); }
+        if (interrupts & kInterruptPriorityLow)     { return (SIM_PRIORITY_LOW); }
+        return (SIM_PRIORITY_LOWEST);
+    }
+
+    /**** TimerChannel - one virtual clock channel per template instance ****/
+
+    template <uint8_t timerNum, uint8_t channelNum>
+    struct TimerChannel {
+        static const uint8_t timer_num = timerNum;
+
+        TimerChannel() { simChannel(); };
+        TimerChannel(const TimerMode mode, const uint32_t freq) { setModeAndFrequency(mode, freq); };
+
+        static uint8_t simChannel() {
+            static uint8_t ch = sim_register_channel(timerNum, &TimerChannel::interrupt);
+            return (ch);
+        };
+
+        int32_t setModeAndFrequency(const TimerMode mode, const uint32_t freq) {
+            sim_set_frequency(simChannel(), freq);
+            return (freq);
+        };
+        void setInterrupts(const uint32_t interrupts) { sim_set_priority(simChannel(), _sim_priority(interrupts)); };
+        void setInterruptPending() { sim_set_pending(simChannel()); };
+        int32_t getInterruptCause() { return (kInterruptOnOverflow); };
+
+        // The sim timer counts once per period of the set frequency, so TOP starts at 1
+        void setTop(const uint32_t topValue) { sim_set_top(simChannel(), topValue); };
+        uint32_t getTopValue() const { return (sim.ch[simChannel()].top); };
+        uint32_t getValue() const { return (sim_get_count(simChannel())); };
+
+        void start() { sim_start(simChannel()); };
+        void stop() { sim_stop(simChannel()); };
+        bool isRunning() const { return (sim.ch[simChannel()].running); };
+
+        static void interrupt();
+    };
+
+    /**** SysTick - 1 ms virtual channel that runs the registered events ****/
+
+    struct SysTickEvent {
+        const std::function<void(void)> callback;
+        SysTickEvent *next;
+    };
+
+    struct SysTickTimer_t {
+        SysTickEvent *_first_event = nullptr;
+
+        static uint8_t simChannel();
+
+        uint32_t getValue() const { return (sim_now_ms()); };
+
+        void registerEvent(SysTickEvent *new_event) {
+            if (_first_event == nullptr) {
+                _first_event = new_event;
+            } else {
+                SysTickEvent *event = _first_event;
+                if (new_event == event) { return; }
+                while (event->next != nullptr) {
+                    event = event->next;
+                    if (new_event == event) { return; }
+                }
+                event->next = new_event;
+            }
+            new_event->next = nullptr;
+        };
+
+        void unregisterEvent(SysTickEvent *old_event) {
+            if (_first_event == old_event) {
+                _first_event = _first_event->next;
+                return;
+            }
+            SysTickEvent *event = _first_event;
+            while ((event != nullptr) && (event->next != nullptr)) {
+                if (event->next == old_event) {
+                    event->next = event->next->next;
+                    return;
+                }
+                event = event->next;
+            }
+        };
+
+        void _handleEvents() {
+            SysTickEvent *event = _first_event;
+            while (event != nullptr) {
+                SysTickEvent *next = event->next;   // the callback may unregister itself
+                event->callback();
+                event = next;
+            }
+        };
+    };
+
+    extern SysTickTimer_t SysTickTimer;
+
+    inline void delay(const uint32_t ms) { sim_charge((uint64_t)ms * 1000000); };
+
+    /**** Timeout - millisecond timeouts measured on the virtual clock ****/
+
+    struct Timeout {
+        uint32_t start_, delay_;
+        Timeout() : start_ {0}, delay_ {0} {};
+
+        // start_ is the virtual ms + 1, so a timeout set at 0 ms is still set - and is not
+        // past as soon as it is set, as it was when start_ was forced to 1 and the time wrapped
+        bool isSet() const { return (start_ > 0); };
+        bool isPast() const {
+            if (!isSet()) { return false; }
+            return ((SysTickTimer.getValue() + 1 - start_) > delay_);
+        };
+        void set(const uint32_t delay) {
+            start_ = SysTickTimer.getValue() + 1;
+            delay_ = delay;
+        };
+        void clear() { start_ = 0; delay_ = 0; };
+    };
+
+} // namespace Motate
+
+#endif // End of include guard: MOTATETIMERS_H_ONCE
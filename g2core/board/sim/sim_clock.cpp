@@ -0,0 +1,217 @@
+/*
+ * sim_clock.cpp - deterministic virtual clock and interrupt controller for the sim board
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sim_clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+simClock_t sim;     // zero initialized before any static constructors run
+
+/*
+ * _run_isr() - run one channel's ISR at its priority level
+ * _dispatch_pending() - run all pending channels above the current level, highest first
+ */
+
+static void _dispatch_pending(void);
+
+static void _run_isr(simChannel_t *c)
+{
+    uint8_t saved_level = sim.level;
+    c->pending = false;
+    sim.level = c->priority;
+    uint64_t cost_ns = c->cost_ns;
+    if ((c->spike_every != 0) && (((c->count+1) % c->spike_every) == 0)) {
+        cost_ns += c->spike_ns;
+    }
+    if (cost_ns) {
+        sim_charge(cost_ns);                // may run higher priority channels
+    }
+    c->count++;
+    c->isr();
+    sim.level = saved_level;
+}
+
+static void _dispatch_pending()
+{
+    while (true) {
+        simChannel_t *best = NULL;
+        for (uint8_t i=0; i<sim.channels; i++) {
+            simChannel_t *c = &sim.ch[i];
+            if (c->pending && (c->priority > sim.level) && ((best == NULL) || (c->priority > best->priority))) {
+                best = c;
+            }
+        }
+        if (best == NULL) {
+            return;
+        }
+        _run_isr(best);
+    }
+}
+
+/*
+ * sim_register_channel() - called (once) from each TimerChannel<> type
+ * sim_find_channel()     - return channel for a Motate timer number, or SIM_CHANNELS if none
+ */
+
+uint8_t sim_register_channel(const uint8_t timer_num, sim_isr_t isr)
+{
+    if (sim.channels >= SIM_CHANNELS) {
+        fprintf(stderr, "sim: too many timer channels\n");
+        exit(1);
+    }
+    simChannel_t *c = &sim.ch[sim.channels];
+    c->name = "";
+    c->isr = isr;
+    c->timer_num = timer_num;
+    c->priority = SIM_PRIORITY_LOWEST;
+    c->top = 1;
+    return (sim.channels++);
+}
+
+uint8_t sim_find_channel(const uint8_t timer_num)
+{
+    for (uint8_t i=0; i<sim.channels; i++) {
+        if (sim.ch[i].timer_num == timer_num) {
+            return (i);
+        }
+    }
+    return (SIM_CHANNELS);
+}
+
+/*
+ * sim_set_priority()  - set interrupt priority (SIM_PRIORITY_xxx)
+ * sim_set_frequency() - set periodic frequency (Hz)
+ * sim_set_top()       - fire every 'top' periods, counted from the start of the current one
+ * sim_set_cost()      - set virtual time charged per ISR invocation
+ * sim_start()         - start periodic interrupts - first fires one period from now
+ * sim_stop()          - stop periodic interrupts
+ * sim_set_pending()   - software trigger
+ * sim_get_count()     - periods counted since the current one started (the timer value)
+ */
+
+void sim_set_priority(const uint8_t ch, const uint8_t priority) { sim.ch[ch].priority = priority; }
+void sim_set_frequency(const uint8_t ch, const uint32_t frequency) { sim.ch[ch].frequency = frequency; }
+void sim_set_cost(const uint8_t ch, const uint32_t cost_ns) { sim.ch[ch].cost_ns = cost_ns; }
+void sim_set_spike(const uint8_t ch, const uint32_t spike_ns, const uint32_t spike_every)
+{
+    sim.ch[ch].spike_ns = spike_ns;
+    sim.ch[ch].spike_every = spike_every;
+}
+
+static void _schedule_next(simChannel_t *c)
+{
+    c->period_start_ns = c->next_fire_ns;
+    c->period_remainder = c->fire_remainder;
+    uint64_t ns = (uint64_t)c->top * 1000000000ULL + c->fire_remainder;
+    c->next_fire_ns += ns / c->frequency;
+    c->fire_remainder = ns % c->frequency;
+}
+
+void sim_set_top(const uint8_t ch, const uint32_t top)
+{
+    simChannel_t *c = &sim.ch[ch];
+    c->top = top;
+    if (c->running) {                       // re-time the current period
+        c->next_fire_ns = c->period_start_ns;
+        c->fire_remainder = c->period_remainder;
+        _schedule_next(c);
+        c->wrapping = (c->next_fire_ns < sim.now_ns);   // the count is already past it...
+        if (c->wrapping) {
+            c->next_fire_ns = c->period_start_ns + SIM_TIMER_WRAP_NS;  // ...so no match until it wraps
+        }
+    }
+}
+
+void sim_start(const uint8_t ch)
+{
+    simChannel_t *c = &sim.ch[ch];
+    if (c->running || (c->frequency == 0)) {
+        return;
+    }
+    c->running = true;
+    c->wrapping = false;
+    c->starts++;
+    c->next_fire_ns = sim.now_ns;
+    c->fire_remainder = 0;
+    _schedule_next(c);
+    sim_channel_started(ch);
+}
+
+void sim_stop(const uint8_t ch)
+{
+    simChannel_t *c = &sim.ch[ch];
+    if (c->running) {
+        c->running = false;
+        c->stops++;
+        sim_channel_stopped(ch);
+    }
+}
+
+void sim_set_pending(const uint8_t ch)
+{
+    sim.ch[ch].pending = true;
+    _dispatch_pending();
+}
+
+uint32_t sim_get_count(const uint8_t ch)
+{
+    simChannel_t *c = &sim.ch[ch];
+    if (!c->running) {
+        return (0);
+    }
+    return ((uint32_t)(((sim.now_ns - c->period_start_ns) * c->frequency) / 1000000000ULL));
+}
+
+/*
+ * sim_charge() - advance virtual time by ns at the current level
+ *
+ *  Periodic channels that come due in the interval are fired in time order. A channel
+ *  at or below the current level is marked pending and runs when the level drops.
+ *  Like the hardware, periods that elapse while a channel is still pending are lost.
+ */
+
+void sim_charge(const uint64_t ns)
+{
+    uint64_t end_ns = sim.now_ns + ns;
+
+    while (true) {
+        simChannel_t *next = NULL;
+        for (uint8_t i=0; i<sim.channels; i++) {
+            simChannel_t *c = &sim.ch[i];
+            if (c->running && (c->next_fire_ns <= end_ns) && ((next == NULL) || (c->next_fire_ns < next->next_fire_ns))) {
+                next = c;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        if (next->next_fire_ns > sim.now_ns) {
+            sim.now_ns = next->next_fire_ns;
+        }
+        if (next->wrapping) {
+            next->wrapping = false;
+            next->missed++;
+        }
+        _schedule_next(next);
+        next->pending = true;               // coalesces with an unserviced earlier period
+        _dispatch_pending();
+    }
+    if (end_ns > sim.now_ns) {
+        sim.now_ns = end_ns;
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * sim_clock.h - deterministic virtual clock and interrupt controller for the sim board
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The virtual clock replaces the SAM3X timer/counter blocks, the SysTick and the NVIC.
+ *
+ *  - Time only moves when somebody charges it with sim_charge(). Nothing depends on
+ *    the host's wall clock, so a replay gives the same answer every time it is run.
+ *
+ *  - Every Motate TimerChannel<> (and the SysTick) registers a channel. A channel has
+ *    a priority, an optional periodic frequency, a pending flag and an ISR.
+ *
+ *  - Preemption is emulated. Setting a channel pending, or a periodic channel coming
+ *    due, runs its ISR immediately if its priority is above the current level.
+ *    Otherwise it stays pending and runs when the current level drops below it.
+ *    This gives the same ordering as the NVIC: e.g. st_request_exec_move() called
+ *    from the DDA ISR runs the exec ISR after the DDA ISR returns.
+ *
+ *  - Each channel may be charged a fixed cost in virtual nanoseconds per invocation.
+ *    The cost is charged *before* the ISR runs so higher priority channels (i.e. the
+ *    DDA) keep ticking "during" a long exec or forward planning interrupt. A periodic
+ *    extra cost (a "spike") can be added to model interrupt latency from other sources.
+ *
+ *  - A periodic channel can fire every 'top' periods instead of every period. Like a
+ *    timer in up-to-match mode, a new top takes effect from the start of the current
+ *    period, so an ISR can set when it next runs. Also like the timer, a top the count
+ *    has already passed is missed: the channel doesn't fire again until the 32 bit
+ *    counter wraps, SIM_TIMER_WRAP_NS after the period started. These are counted.
+ */
+
+#ifndef SIM_CLOCK_H_ONCE
+#define SIM_CLOCK_H_ONCE
+
+#include <stdint.h>
+
+#define SIM_CHANNELS 8                  // max number of timer channels that can be registered
+#define SIM_TIMER_WRAP_NS 51130563000ULL    // 2^32 counts of a timer clocked at 84 MHz
+
+#define SIM_PRIORITY_THREAD 0           // main loop level
+#define SIM_PRIORITY_LOWEST 1
+#define SIM_PRIORITY_LOW 2
+#define SIM_PRIORITY_MEDIUM 3
+#define SIM_PRIORITY_HIGH 4
+#define SIM_PRIORITY_HIGHEST 5
+
+typedef void (*sim_isr_t)(void);
+
+typedef struct simChannel {
+    const char *name;                   // label used in the replay report
+    sim_isr_t isr;                      // interrupt service routine
+    uint8_t timer_num;                  // Motate timer number (for matching typedefs)
+    uint8_t priority;                   // SIM_PRIORITY_xxx
+    bool running;                       // periodic channel is running
+    bool pending;                       // interrupt is pending
+    bool wrapping;                      // top was set behind the count - the next fire is the wrap
+
+    uint32_t frequency;                 // periodic frequency in Hz - 0 for software-only channels
+    uint32_t top;                       // periods between interrupts (timer TOP, see MotateTimers.h)
+    uint64_t period_start_ns;           // virtual time the current period started
+    uint32_t period_remainder;          // fire_remainder at the start of the current period
+    uint64_t next_fire_ns;              // virtual time of the next periodic interrupt
+    uint32_t fire_remainder;            // fractional ns carried between periods (Bresenham)
+    uint32_t cost_ns;                   // virtual time charged per invocation
+    uint32_t spike_ns;                  // extra time charged to every spike_every'th invocation
+    uint32_t spike_every;               // 0 for no spikes
+
+    uint64_t count;                     // number of times the ISR has run
+    uint64_t starts;                    // number of times the channel was started
+    uint64_t stops;                     // number of times the channel was stopped
+    uint64_t missed;                    // number of interrupts that only came when the counter wrapped
+} simChannel_t;
+
+typedef struct simClock {
+    uint64_t now_ns;                    // current virtual time
+    uint8_t level;                      // priority level currently executing
+    uint8_t channels;                   // number of registered channels
+    simChannel_t ch[SIM_CHANNELS];
+} simClock_t;
+
+extern simClock_t sim;
+
+uint8_t sim_register_channel(const uint8_t timer_num, sim_isr_t isr);
+void sim_set_priority(const uint8_t ch, const uint8_t priority);
+void sim_set_frequency(const uint8_t ch, const uint32_t frequency);
+void sim_set_top(const uint8_t ch, const uint32_t top);
+void sim_set_cost(const uint8_t ch, const uint32_t cost_ns);
+void sim_set_spike(const uint8_t ch, const uint32_t spike_ns, const uint32_t spike_every);
+void sim_start(const uint8_t ch);
+void sim_stop(const uint8_t ch);
+void sim_set_pending(const uint8_t ch);
+uint32_t sim_get_count(const uint8_t ch);
+void sim_charge(const uint64_t ns);
+
+uint8_t sim_find_channel(const uint8_t timer_num);
+inline uint64_t sim_now_ns(void) { return (sim.now_ns); }
+inline uint32_t sim_now_ms(void) { return ((uint32_t)(sim.now_ns / 1000000)); }
+
+// hooks supplied by the board so starts and stops can be classified (see sim_main.cpp)
+void sim_channel_started(const uint8_t ch);
+void sim_channel_stopped(const uint8_t ch);
+
+#endif // End of include guard: SIM_CLOCK_H_ONCE
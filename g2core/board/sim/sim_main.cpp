@@ -0,0 +1,753 @@
+/*
+ * sim_main.cpp - Linux host simulation of the planner / runtime pipeline
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Usage: g2core-sim [options] <program.h>
+ *
+ *  Replays one of the Resources/gcode/gcode_xxx.h programs through the real canonical machine,
+ *  Gcode parser, planner, runtime and stepper code and reports:
+ *
+ *    - total cycle time (first step to last step, in virtual time)
+ *    - ISR invocation counts for the DDA, exec, forward planning and SysTick channels
+ *    - planner starvation events - times the DDA ran dry while the machine was in motion
+ *    - planner queue low water mark and final step counts per motor
+ *    - prep queue underruns and headroom - see stepper.h
+ *    - step port writes - set and clear writes made by the DDA interrupt
+ *    - with -m, the following error and where the plant ended up - see board/sim/board_stepper.h
+ *    - in the servo build (SIM_CAN_SERVOS), the CAN frames sent and received - see board/sim/board_can.h
+ *
+ *  Options (all times in microseconds of virtual time):
+ *    -p <us>    cost of one controller pass         (default SIM_PASS_NS)
+ *    -l <us>    cost of reading one Gcode line      (default SIM_LINE_NS)
+ *    -e <us>    cost of one exec interrupt          (default SIM_EXEC_NS)
+ *    -f <us>    cost of one forward plan interrupt  (default SIM_PLAN_NS)
+ *    -s <us>:<n> add this much latency to every n'th exec interrupt, e.g. -s 3000:50
+ *    -a <us>:<n> make every n'th DDA interrupt take this long, e.g. -a 20:1000. A DDA interrupt
+ *               that outlasts the next tick it schedules must not stall the timer - see
+ *               _dda_schedule() in stepper.cpp and "dda missed tops" in the report
+ *    -n <name>  replay the named string in the file (default is the first one)
+ *    -i <gcode> run this line ahead of the program, e.g. -i "G64P0.01" or (with __COALESCE_LINES)
+ *               -i "{clt:0.01}"
+ *    -d         report the largest distance of the runtime path from the programmed path
+ *    -o <ms>:<factor>  change the feed override (M50 P) this long after the first step and
+ *               report how long the runtime velocity took to respond, and the largest
+ *               segment to segment acceleration before and after
+ *    -m <scale> move the plant this many steps per motor step, e.g. -m 0.98, and report
+ *               the largest following error, the steps corrected and the final plant error
+ *               per motor. Use -i "{1es:1}" etc. to close the loop on the plant position.
+ *    -t <file>  write the step port images to a file (see board/sim/board_stepper.h)
+ *    -v         echo controller responses to stdout
+ *    -b         time the line scanner over the program instead of replaying it (see sim_scan.cpp)
+ *    -z         time the meet velocity solver over random moves and exit - no program is
+ *               needed (see sim_zoid.cpp)
+ *    -k         check the line scanner on too-long lines and lines that wrap the ring, and
+ *               exit - no program is needed (see sim_scan.cpp)
+ *    -r         the program file is plain lines, not a .h file - e.g. a binary stream from
+ *               Resources/bstream_encode.py (see binary_stream.h)
+ *
+ *  The exit code is 0 on completion, 1 on a usage or file error and 3 if the program
+ *  did not finish inside SIM_LIMIT_S of virtual time.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "hardware.h"
+#include "persistence.h"
+#include "controller.h"
+#include "canonical_machine.h"
+#include "binary_stream.h"
+#include "report.h"
+#include "planner.h"
+#include "stepper.h"
+#include "isr_timing.h"
+#include "encoder.h"
+#include "spindle.h"
+#include "temperature.h"
+#include "gpio.h"
+#include "pwm.h"
+#include "xio.h"
+#include "util.h"
+#include "plan_arc.h"
+#include "board_stepper.h"
+#include "canopen.h"
+#include "sim_main.h"
+
+#include <unistd.h>
+
+/******************** System Globals *************************/
+// These are allocated in main.cpp on the ARM build, which the sim does not compile
+
+stat_t status_code;                         // allocate a variable for the ritorno macro
+
+using namespace Motate;
+OutputPin<kDebug1_PinNumber> debug_pin1;
+OutputPin<kDebug2_PinNumber> debug_pin2;
+OutputPin<kDebug3_PinNumber> debug_pin3;
+
+SysTickTimer_t Motate::SysTickTimer;
+
+char *get_status_message(stat_t status)
+{
+    return ((char *)GET_TEXT_ITEM(stat_msg, status));
+}
+
+/******************** Sim Globals ****************************/
+
+simConfig_t sim_cfg = {
+    SIM_PASS_NS, SIM_LINE_NS, SIM_EXEC_NS, SIM_PLAN_NS,
+    (uint64_t)SIM_LIMIT_S * 1000000000ULL, false, false, NULL, 0, 0, 0, 0, false, SIM_START_MS
+};
+simStats_t sim_stats;
+
+static uint8_t dda_ch;                      // virtual clock channels, found after init
+static uint8_t exec_ch;
+static uint8_t plan_ch;
+static uint8_t systick_ch;
+
+/*
+ * SysTick channel - 1 KHz, same level as the DDA as it runs the dwell loader
+ */
+
+static void _systick_isr(void) { Motate::SysTickTimer._handleEvents(); }
+
+uint8_t SysTickTimer_t::simChannel()
+{
+    static uint8_t ch = sim_register_channel(0xFF, &_systick_isr);
+    return (ch);
+}
+
+/*
+ * sim_channel_started() - hooks from the virtual clock
+ * sim_channel_stopped()
+ *
+ *  A starvation is a DDA stop while the canonical machine still thinks it is moving,
+ *  no dwell is running and more than the running block is still queued - i.e.
+ *  _load_move() found nothing to load. It lasts until the DDA is started again.
+ */
+
+void sim_channel_started(const uint8_t ch)
+{
+    if (ch != dda_ch) {
+        return;
+    }
+    if (sim_stats.motion_start_ns == 0) {
+        sim_stats.motion_start_ns = sim_now_ns();
+    }
+    if (sim_stats.starve_start_ns != 0) {
+        sim_stats.starved_ns += sim_now_ns() - sim_stats.starve_start_ns;
+        sim_stats.starve_start_ns = 0;
+    }
+}
+
+void sim_channel_stopped(const uint8_t ch)
+{
+    if (ch != dda_ch) {
+        return;
+    }
+    sim_stats.motion_end_ns = sim_now_ns();
+    if ((cm.motion_state == MOTION_RUN) && (!st_runtime_isbusy()) &&
+        (mp_get_planner_buffers() < PLANNER_BUFFER_POOL_SIZE-1)) {
+        sim_stats.starvations++;
+        sim_stats.starve_start_ns = sim_now_ns();
+    }
+}
+
+/*
+ * _load_program() - extract a string constant from a Resources/gcode/gcode_xxx.h file
+ *
+ *  Skips C comments, finds the first string initializer (or the one for 'name') and
+ *  decodes escapes and adjacent literals. Returns a malloc'd NUL terminated string.
+ *  With 'raw' the file is plain lines, such as the output of Resources/bstream_encode.py,
+ *  and is returned as it is.
+ */
+
+static char *_load_program(const char *path, const char *name, bool raw)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return (NULL);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *src = (char *)malloc(size+1);
+    char *out = (char *)malloc(size+1);
+    size = fread(src, 1, size, f);
+    src[size] = NUL;
+    fclose(f);
+    if (raw) {
+        free(out);
+        return (src);
+    }
+
+    char *s = src, *o = out;
+    bool found = false;
+    while (*s != NUL) {
+        if ((s[0] == '/') && (s[1] == '*')) {                   // block comment
+            char *e = strstr(s+2, "*/");
+            s = (e == NULL) ? (s + strlen(s)) : (e + 2);
+            continue;
+        }
+        if ((s[0] == '/') && (s[1] == '/')) {                   // line comment
+            while ((*s != NUL) && (*s != LF)) { s++; }
+            continue;
+        }
+        if ((*s != '"') || found) {
+            s++;
+            continue;
+        }
+        if (name != NULL) {                                     // match 'name[] =' before the literal
+            char *decl = s;
+            while ((decl > src) && (*(decl-1) != ';')) { decl--; }
+            char *n = strstr(decl, name);
+            if ((n == NULL) || (n > s) || (n[strlen(name)] != '[')) {
+                s++;
+                while ((*s != NUL) && (*s != '"')) { s += (*s == '\\') ? 2 : 1; }
+                if (*s != NUL) { s++; }
+                continue;
+            }
+        }
+        found = true;
+        while (*s == '"') {                                     // decode adjacent literals
+            s++;
+            while ((*s != NUL) && (*s != '"')) {
+                if (*s != '\\') {
+                    *o++ = *s++;
+                    continue;
+                }
+                s++;
+                switch (*s) {
+                    case 'n':  { *o++ = LF; break; }
+                    case 'r':  { *o++ = CR; break; }
+                    case 't':  { *o++ = TAB; break; }
+                    case LF:   { break; }                       // line continuation
+                    case NUL:  { s--; break; }
+                    default:   { *o++ = *s; }
+                }
+                s++;
+            }
+            if (*s == '"') { s++; }
+            while ((*s == ' ') || (*s == TAB) || (*s == CR) || (*s == LF)) { s++; }
+        }
+    }
+    *o = NUL;
+    free(src);
+    if (!found) {
+        free(out);
+        return (NULL);
+    }
+    return (out);
+}
+
+/*
+ * _application_init() - mirrors setup() in main.cpp, without the USB wait
+ */
+
+static void _application_init(void)
+{
+    hardware_init();
+    persistence_init();
+    xio_init();
+
+    cm.machine_state = MACHINE_INITIALIZING;
+    isr_timing_init();
+    stepper_init();
+    encoder_init();
+    gpio_init();
+    pwm_init();
+    planner_init();
+    canonical_machine_init();
+
+    controller_init();
+    config_init();
+    canonical_machine_reset();
+    spindle_init();
+    spindle_reset();
+    temperature_init();
+    gpio_reset();
+#ifdef CAN_ENABLED
+    hw_can_init();
+    canopen_init();
+#endif
+}
+
+/*
+ * _trace_path() - measure the runtime path against the programmed path (-d)
+ *
+ *  The programmed path is the polyline through the model position after each line, with
+ *  arcs filled in from the arc setup (XYZ only). Each new runtime position is measured against the next few
+ *  programmed segments from where the last one matched. Ties go to the earliest segment,
+ *  so the search doesn't jump ahead to a later pass over the same spot.
+ */
+
+#define PATH_SEARCH_SEGMENTS 32
+#define PATH_SEARCH_SLOP ((float)0.001)     // mm - closeness treated as a tie between segments
+#define PATH_ARC_STEP ((float)0.005)        // radians between programmed points on an arc
+
+static float (*_path)[3] = NULL;            // programmed vertices (XYZ)
+static uint32_t _path_count = 0;
+static uint32_t _path_size = 0;
+static uint32_t _path_cursor = 0;           // segment the runtime was last nearest to
+static float _runtime_last[3];
+
+static float _segment_distance(const float p[], const float a[], const float b[])
+{
+    float ab[3], ap[3];
+    float ab_square = 0, t = 0;
+    for (uint8_t i=0; i<3; i++) {
+        ab[i] = b[i] - a[i];
+        ap[i] = p[i] - a[i];
+        ab_square += ab[i] * ab[i];
+        t += ab[i] * ap[i];
+    }
+    t = (ab_square > 0) ? std::min(std::max(t / ab_square, (float)0), (float)1) : 0;
+    float d_square = 0;
+    for (uint8_t i=0; i<3; i++) {
+        d_square += square(ap[i] - t * ab[i]);
+    }
+    return (sqrt(d_square));
+}
+
+static void _path_append(const float point[])
+{
+    if (_path_count == _path_size) {
+        _path_size = (_path_size == 0) ? 1024 : (_path_size * 2);
+        _path = (float (*)[3])realloc(_path, sizeof(float)*3 * _path_size);
+    }
+    memcpy(_path[_path_count++], point, sizeof(float)*3);
+}
+
+static void _trace_path()
+{
+    const float *model = cm.gmx.position;
+    if (_path_count == 0) {
+        _path_append(model);
+    } else if (memcmp(_path[_path_count-1], model, sizeof(float)*3) != 0) {
+        if ((cm.gm.motion_mode == MOTION_MODE_CW_ARC) || (cm.gm.motion_mode == MOTION_MODE_CCW_ARC)) {
+            float start[3], point[3];                       // fill in the arc from its setup in plan_arc.cpp
+            memcpy(start, _path[_path_count-1], sizeof(float)*3);
+            float end_radius = hypotf(model[arc.plane_axis_0] - arc.center_0, model[arc.plane_axis_1] - arc.center_1);
+            uint32_t steps = (uint32_t)ceil(fabs(arc.angular_travel) / PATH_ARC_STEP);
+            for (uint32_t k=1; k<steps; k++) {
+                float fraction = (float)k / steps;
+                float theta = arc.theta + fraction * arc.angular_travel;
+                float radius = arc.radius + fraction * (end_radius - arc.radius);
+                point[arc.linear_axis] = start[arc.linear_axis] + fraction * (model[arc.linear_axis] - start[arc.linear_axis]);
+                point[arc.plane_axis_0] = arc.center_0 + sin(theta) * radius;
+                point[arc.plane_axis_1] = arc.center_1 + cos(theta) * radius;
+                _path_append(point);
+            }
+        }
+        _path_append(model);
+    }
+    if ((_path_count < 2) || (memcmp(_runtime_last, mr.position, sizeof(float)*3) == 0)) {
+        return;
+    }
+    memcpy(_runtime_last, mr.position, sizeof(float)*3);
+
+    float distance[PATH_SEARCH_SEGMENTS];
+    float nearest = 1e30;
+    uint32_t count = std::min(_path_count-1 - _path_cursor, (uint32_t)PATH_SEARCH_SEGMENTS);
+    for (uint32_t i=0; i<count; i++) {
+        distance[i] = _segment_distance(mr.position, _path[_path_cursor+i], _path[_path_cursor+i+1]);
+        nearest = std::min(nearest, distance[i]);
+    }
+    for (uint32_t i=0; i<count; i++) {      // stay on the earliest segment that is (nearly) as close
+        if (distance[i] <= nearest + PATH_SEARCH_SLOP) {
+            _path_cursor += i;
+            break;
+        }
+    }
+    if (nearest > sim_stats.max_deviation) {
+        sim_stats.max_deviation = nearest;
+    }
+}
+
+/*
+ * _trace_override() - change the feed override and time the runtime's response (-o)
+ *
+ *  Velocity is measured between segment loads from the runtime's step history, which is
+ *  indexed by segment number (see mr.step_history), so it doesn't depend on how the
+ *  override is applied or on how far the exec interrupt has prepared ahead of the loader
+ *  (see the prep queue in stepper.h). Whole motor steps are too coarse for this - a short
+ *  segment only takes a few. Only motors 1-3 are counted, so the program should move in XYZ.
+ *
+ *  Latency is measured from the override command to the first segment to run that has
+ *  moved 10% of the way to the new velocity (response), and to the first that is within
+ *  10% of it (settle). The program should run at a steady feed rate around the command.
+ *
+ *  The largest change in velocity from one segment to the next, over the time between their
+ *  middles, is kept for before and after the command. Ramping the override must not
+ *  accelerate the path harder than the planned moves do. This uses the segments' own
+ *  lengths and motion clock times (st_get_segment_ticks()), not when the loads are seen.
+ */
+
+static float _history_steps(const uint32_t segment, const uint8_t motor)
+{
+#ifndef __FIXED_POINT_RUNTIME
+    return (mr.step_history[segment & (PREP_HISTORY_SIZE-1)][motor]);
+#else
+    return (q_to_float(mr.step_history_q[segment & (PREP_HISTORY_SIZE-1)][motor], Q32_BITS));
+#endif
+}
+
+static void _trace_accel(const uint32_t segment)
+{
+    static float last_velocity = 0;
+    static float last_seconds = 0;
+
+    float seconds = (float)(st_get_segment_ticks(segment) - st_get_segment_ticks(segment-1)) / FREQUENCY_DDA;
+    if (seconds <= 0) {
+        return;
+    }
+    float length = 0;
+    for (uint8_t m=0; m<3; m++) {
+        length += square((_history_steps(segment, m) - _history_steps(segment-1, m)) * st_cfg.mot[m].units_per_step);
+    }
+    float velocity = sqrt(length) / seconds;            // mm/s
+    float accel = fabs(velocity - last_velocity) / ((seconds + last_seconds) / 2);
+    float &accel_max = sim_stats.override_accel[(sim_stats.override_ns != 0) ? 1 : 0];
+    accel_max = max(accel_max, accel);
+    last_velocity = velocity;
+    last_seconds = seconds;
+}
+
+static void _trace_override()
+{
+    static uint32_t last_loaded = 0;
+    static float last_steps[3];
+    static uint64_t last_ns = 0;
+    static float velocity = 0;
+
+    if (sim_stats.motion_start_ns == 0) {
+        return;
+    }
+    uint32_t loaded = st_get_segments_loaded();
+    if (loaded != last_loaded) {            // the segment(s) loaded since last time have run
+        uint64_t now = sim_now_ns();
+        float steps[3];                     // where the segment now running started
+        for (uint8_t m=0; m<3; m++) {
+            steps[m] = _history_steps(loaded-1, m);
+        }
+        if (last_ns != 0) {
+            float length = 0;
+            for (uint8_t m=0; m<3; m++) {
+                length += square((steps[m] - last_steps[m]) * st_cfg.mot[m].units_per_step);
+            }
+            velocity = sqrt(length) * 60e9 / (now - last_ns);
+        }
+        for (uint32_t segment = last_loaded; segment != loaded; segment++) {
+            if (segment > 1) {
+                _trace_accel(segment);              // segment has finished
+            }
+        }
+        memcpy(last_steps, steps, sizeof(last_steps));
+        last_loaded = loaded;
+        last_ns = now;
+
+        if ((sim_stats.override_ns != 0) && (now > sim_stats.override_ns)) {
+            float change = sim_stats.override_velocity * (sim_cfg.override_factor / sim_stats.override_from - 1);
+            float moved = velocity - sim_stats.override_velocity;
+            if ((sim_stats.override_response_ns == 0) && (fabs(moved) >= fabs(change) * 0.1)) {
+                sim_stats.override_response_ns = now;
+            }
+            if ((sim_stats.override_settle_ns == 0) && (fabs(moved - change) <= fabs(change) * 0.1)) {
+                sim_stats.override_settle_ns = now;
+            }
+        }
+    }
+    if ((sim_stats.override_ns == 0) &&
+        (sim_now_ns() - sim_stats.motion_start_ns >= (uint64_t)sim_cfg.override_ms * 1000000)) {
+        sim_stats.override_from = mp.mfo_factor;
+        cm_mfo_control(sim_cfg.override_factor, true);      // as if M50 P had just been parsed
+        sim_stats.override_ns = sim_now_ns();
+        sim_stats.override_velocity = velocity;
+    }
+}
+
+/*
+ * _trace_following_error() - keep the largest measured following error per motor (-m)
+ */
+
+static void _trace_following_error()
+{
+    for (uint8_t m=0; m<MOTORS; m++) {
+        if (fabs(mr.following_error[m]) > sim_stats.max_following_error[m]) {
+            sim_stats.max_following_error[m] = fabs(mr.following_error[m]);
+        }
+    }
+}
+
+/*
+ * _report() - print the replay summary
+ */
+
+static void _report(const char *path, const bool finished)
+{
+    FILE *r = stderr;
+    uint64_t end_ns = sim_stats.motion_end_ns;
+    if (sim.ch[dda_ch].running || (end_ns < sim_stats.motion_start_ns)) {
+        end_ns = sim_now_ns();              // DDA still running when the program finished
+    }
+    double cycle_s = (end_ns - sim_stats.motion_start_ns) / 1e9;
+
+    fprintf(r, "program            %s\n", path);
+    fprintf(r, "finished           %s\n", finished ? "yes" : "NO - virtual time limit reached");
+    fprintf(r, "lines              %lu\n", (unsigned long)sim_stats.lines);
+    fprintf(r, "rx bytes           %lu\n", (unsigned long)sim_stats.rx_bytes);
+    fprintf(r, "tx writes          %lu lines in %lu writes (%lu by latency cap), %lu bytes\n", (unsigned long)xtx.lines,
+            (unsigned long)xtx.writes, (unsigned long)xtx.latency_writes, (unsigned long)sim_stats.tx_bytes);
+    fprintf(r, "virtual time       %.4f s\n", sim_now_ns() / 1e9);
+    fprintf(r, "cycle time         %.4f s\n", cycle_s);
+    fprintf(r, "controller passes  %llu\n", (unsigned long long)sim_stats.passes);
+    fprintf(r, "lines per pass     %.2f avg, %u max, %lu cut by budget\n",
+            (cs.ingest_passes == 0) ? 0.0 : (double)cs.ingest_lines / cs.ingest_passes,
+            (unsigned)cs.ingest_max, (unsigned long)cs.ingest_budget_cuts);
+    fprintf(r, "isr dda            %llu\n", (unsigned long long)sim.ch[dda_ch].count);
+    fprintf(r, "isr exec           %llu\n", (unsigned long long)sim.ch[exec_ch].count);
+    fprintf(r, "isr fwd_plan       %llu\n", (unsigned long long)sim.ch[plan_ch].count);
+    fprintf(r, "isr systick        %llu\n", (unsigned long long)sim.ch[systick_ch].count);
+    fprintf(r, "dda starts         %llu\n", (unsigned long long)sim.ch[dda_ch].starts);
+    fprintf(r, "dda missed tops    %llu\n", (unsigned long long)sim.ch[dda_ch].missed);
+#ifdef __VARIABLE_INTERVAL_DDA
+    fprintf(r, "dda late ticks     %lu\n", (unsigned long)st_pre.dda_late);
+#endif
+    fprintf(r, "starvations        %lu\n", (unsigned long)sim_stats.starvations);
+    fprintf(r, "starved time       %.4f s\n", sim_stats.starved_ns / 1e9);
+    fprintf(r, "planner low water  %d of %d buffers free\n", sim_stats.min_buffers_available, PLANNER_BUFFER_POOL_SIZE);
+    fprintf(r, "prep underruns     %lu\n", (unsigned long)st_pre.underruns);
+    fprintf(r, "prep headroom      %lu of %d segments\n", (unsigned long)st_pre.min_headroom, PREP_QUEUE_SIZE);
+    fprintf(r, "backplan passes    %lu (%lu converged)\n", (unsigned long)mp.bp_passes, (unsigned long)mp.bp_converged);
+    fprintf(r, "backplan visits    %.2f blocks per new block\n", (mp.bp_blocks == 0) ? 0.0 : (double)mp.bp_visits / mp.bp_blocks);
+    fprintf(r, "meet velocity      %lu solutions, %.2f iterations avg, %lu max\n", (unsigned long)mp.mv_calls,
+            (mp.mv_calls == 0) ? 0.0 : (double)mp.mv_iterations / mp.mv_calls, (unsigned long)mp.mv_max);
+#ifdef __COALESCE_LINES
+    fprintf(r, "coalesced lines    %lu\n", (unsigned long)cm.co.lines_merged);
+#endif
+    fprintf(r, "blended corners    %lu\n", (unsigned long)cm.co.corners_blended);
+    if (sim_cfg.deviation) {
+        fprintf(r, "path deviation     %.4f mm max\n", (double)sim_stats.max_deviation);
+    }
+    if (sim_stats.override_ns != 0) {
+        fprintf(r, "override           %.3f to %.3f at %.4f s, from %.1f mm/min\n", (double)sim_stats.override_from,
+                (double)sim_cfg.override_factor, (sim_stats.override_ns - sim_stats.motion_start_ns) / 1e9,
+                (double)sim_stats.override_velocity);
+        fprintf(r, "override response  %.2f ms\n", (sim_stats.override_response_ns == 0) ? -1.0 :
+                (sim_stats.override_response_ns - sim_stats.override_ns) / 1e6);
+        fprintf(r, "override settle    %.2f ms\n", (sim_stats.override_settle_ns == 0) ? -1.0 :
+                (sim_stats.override_settle_ns - sim_stats.override_ns) / 1e6);
+    }
+    if (sim_cfg.override_factor > 0) {
+        fprintf(r, "override accel     %.0f mm/s^2 max before, %.0f after\n",
+                (double)sim_stats.override_accel[0], (double)sim_stats.override_accel[1]);
+    }
+    if (sim_cfg.plant) {
+        fprintf(r, "plant scale        %.4f\n", sim_plant_scale);
+        fprintf(r, "following error    %.2f %.2f %.2f %.2f steps max\n",
+                (double)sim_stats.max_following_error[MOTOR_1], (double)sim_stats.max_following_error[MOTOR_2],
+                (double)sim_stats.max_following_error[MOTOR_3], (double)sim_stats.max_following_error[MOTOR_4]);
+        fprintf(r, "corrected steps    %.2f %.2f %.2f %.2f\n",
+                (double)st_pre.mot[MOTOR_1].corrected_steps, (double)st_pre.mot[MOTOR_2].corrected_steps,
+                (double)st_pre.mot[MOTOR_3].corrected_steps, (double)st_pre.mot[MOTOR_4].corrected_steps);
+        double plant[MOTORS];
+        for (uint8_t m=0; m<MOTORS; m++) {  // in the direction of the step count, as the encoder is
+            plant[m] = sim_motor_plant(m);
+            plant[m] = (st_cfg.mot[m].polarity ? -plant[m] : plant[m]) - mr.target_steps[m];
+        }
+        fprintf(r, "plant error        %.2f %.2f %.2f %.2f steps\n", plant[MOTOR_1], plant[MOTOR_2], plant[MOTOR_3], plant[MOTOR_4]);
+    }
+    fprintf(r, "step port writes   %llu set, %llu clear\n",
+            (unsigned long long)sim_step_ports.sets, (unsigned long long)sim_step_ports.clears);
+#ifdef CAN_ENABLED
+    fprintf(r, "can frames         %lu sent, %lu refused, %lu received, %lu syncs, %.1f%% of the bus\n",
+            (unsigned long)Can0.tx_frames, (unsigned long)Can0.tx_refused, (unsigned long)Can0.rx_queued,
+            (unsigned long)canopen.syncs, 100.0 * Can0.busy_ns / sim_now_ns());
+#endif
+    fprintf(r, "steps              %ld %ld %ld %ld\n", (long)sim_motor_position(MOTOR_1),
+            (long)sim_motor_position(MOTOR_2), (long)sim_motor_position(MOTOR_3), (long)sim_motor_position(MOTOR_4));
+}
+
+static const char *program_path;
+
+static bool _finished(void)
+{
+    return (xio_sim_exhausted() &&
+#ifdef __BINARY_STREAM
+            (!bs_is_busy()) &&
+#endif
+            (cm_get_machine_state() != MACHINE_CYCLE) &&
+            (!st_runtime_isbusy()) &&
+            sim_motors_settled() &&
+            (mp_get_planner_buffers() == PLANNER_BUFFER_POOL_SIZE));
+}
+
+/*
+ * sim_periodic() - called from hardware_periodic() once per controller pass
+ *
+ *  controller_run() never returns, so this is also where the replay ends.
+ */
+
+void sim_periodic()
+{
+    sim_stats.passes++;
+    sim_charge(sim_cfg.pass_ns);
+
+    uint8_t available = mp_get_planner_buffers();
+    if (available < sim_stats.min_buffers_available) {
+        sim_stats.min_buffers_available = available;
+    }
+    if (sim_cfg.deviation) {
+        _trace_path();
+    }
+    if (sim_cfg.override_factor > 0) {
+        _trace_override();
+    }
+    if (sim_cfg.plant) {
+        _trace_following_error();
+    }
+
+    if (_finished()) {
+        _report(program_path, true);
+        exit(0);
+    }
+    if (sim_now_ns() > sim_cfg.limit_ns) {
+        _report(program_path, false);
+        exit(3);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = NULL;
+    bool bench = false;
+    bool raw = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:l:e:f:s:a:n:i:do:m:t:vbzkr")) != -1) {
+        switch (opt) {
+            case 'p': { sim_cfg.pass_ns = atoi(optarg) * 1000; break; }
+            case 'l': { sim_cfg.line_ns = atoi(optarg) * 1000; break; }
+            case 'e': { sim_cfg.exec_ns = atoi(optarg) * 1000; break; }
+            case 'f': { sim_cfg.plan_ns = atoi(optarg) * 1000; break; }
+            case 's': {
+                char *every = strchr(optarg, ':');
+                sim_cfg.spike_ns = atoi(optarg) * 1000;
+                sim_cfg.spike_every = (every == NULL) ? 0 : atoi(every+1);
+                if (sim_cfg.spike_every == 0) {
+                    fprintf(stderr, "-s needs <us>:<n>, e.g. -s 3000:50\n");
+                    return (1);
+                }
+                break;
+            }
+            case 'a': {
+                char *every = strchr(optarg, ':');
+                sim_cfg.dda_spike_ns = atoi(optarg) * 1000;
+                sim_cfg.dda_spike_every = (every == NULL) ? 0 : atoi(every+1);
+                if (sim_cfg.dda_spike_every == 0) {
+                    fprintf(stderr, "-a needs <us>:<n>, e.g. -a 20:1000\n");
+                    return (1);
+                }
+                break;
+            }
+            case 'n': { name = optarg; break; }
+            case 'i': { sim_cfg.prefix = optarg; break; }
+            case 'd': { sim_cfg.deviation = true; break; }
+            case 'o': {
+                char *factor = strchr(optarg, ':');
+                sim_cfg.override_ms = atoi(optarg);
+                sim_cfg.override_factor = (factor == NULL) ? 0 : atof(factor+1);
+                if (sim_cfg.override_factor <= 0) {
+                    fprintf(stderr, "-o needs <ms>:<factor>, e.g. -o 2000:0.5\n");
+                    return (1);
+                }
+                break;
+            }
+            case 'm': {
+                sim_plant_scale = atof(optarg);
+                sim_cfg.plant = true;
+                if (sim_plant_scale <= 0) {
+                    fprintf(stderr, "-m needs a scale greater than 0, e.g. -m 0.98\n");
+                    return (1);
+                }
+                break;
+            }
+            case 't': {
+                if ((sim_step_ports.trace = fopen(optarg, "w")) == NULL) {
+                    fprintf(stderr, "%s: cannot write trace\n", optarg);
+                    return (1);
+                }
+                break;
+            }
+            case 'v': { sim_cfg.verbose = true; break; }
+            case 'b': { bench = true; break; }
+            case 'z': { return (sim_zoid_bench()); }
+            case 'k': { return (sim_scan_check()); }
+            case 'r': { raw = true; break; }
+            default:  {
+                fprintf(stderr, "usage: %s [-p us] [-l us] [-e us] [-f us] [-s us:n] [-a us:n] [-n name] [-i gcode] [-d] [-o ms:factor] [-m scale] [-t file] [-v] [-b] [-z] [-k] [-r] program.h\n", argv[0]);
+                return (1);
+            }
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-p us] [-l us] [-e us] [-f us] [-s us:n] [-a us:n] [-n name] [-i gcode] [-d] [-o ms:factor] [-m scale] [-t file] [-v] [-b] [-z] [-k] [-r] program.h\n", argv[0]);
+        return (1);
+    }
+    program_path = argv[optind];
+    char *program = _load_program(program_path, name, raw);
+    if (program == NULL) {
+        fprintf(stderr, "%s: no Gcode string found\n", program_path);
+        return (1);
+    }
+    if (sim_cfg.prefix != NULL) {
+        char *joined = (char *)malloc(strlen(sim_cfg.prefix) + strlen(program) + 2);
+        sprintf(joined, "%s\n%s", sim_cfg.prefix, program);
+        free(program);
+        program = joined;
+    }
+    if (bench) {
+        return (sim_scan_bench(program_path, program));
+    }
+
+    _application_init();
+
+    // bind the virtual clock channels and their cost model
+    dda_ch = dda_timer_type::simChannel();
+    exec_ch = exec_timer_type::simChannel();
+    plan_ch = fwd_plan_timer_type::simChannel();
+    systick_ch = SysTickTimer_t::simChannel();
+    sim_set_cost(exec_ch, sim_cfg.exec_ns);
+    sim_set_cost(plan_ch, sim_cfg.plan_ns);
+    sim_set_spike(exec_ch, sim_cfg.spike_ns, sim_cfg.spike_every);
+    sim_set_spike(dda_ch, sim_cfg.dda_spike_ns, sim_cfg.dda_spike_every);
+    sim_set_priority(systick_ch, SIM_PRIORITY_HIGHEST);
+    sim_set_frequency(systick_ch, 1000);
+    sim_start(systick_ch);
+
+    sim_stats.min_buffers_available = PLANNER_BUFFER_POOL_SIZE;
+    xio_sim_load(program);
+
+    controller_run();                       // exits from sim_periodic()
+    return (0);
+}
@@ -0,0 +1,110 @@
+/*
+ * sim_main.h - Linux host simulation of the planner / runtime pipeline
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SIM_MAIN_H_ONCE
+#define SIM_MAIN_H_ONCE
+
+#include <stdint.h>
+#include "sim_clock.h"
+
+/*
+ * Cost model - virtual nanoseconds charged for work done at each level.
+ *
+ *  The host runs the real planner code but its execution time says nothing about the
+ *  SAM3X, so the time each level "takes" is a model parameter. The defaults are rough
+ *  figures for the geratech_proto board; override them on the command line to see how
+ *  sensitive a program is to a slower or faster main loop or exec interrupt.
+ */
+
+#define SIM_PASS_NS     20000               // one pass through _controller_HSM()
+#define SIM_LINE_NS     150000              // reading, parsing and queuing one Gcode line
+#define SIM_EXEC_NS     40000               // one exec interrupt (mp_exec_move + st_prep_line)
+#define SIM_PLAN_NS     60000               // one forward planning interrupt
+#define SIM_LIMIT_S     (4*3600)            // give up after this much virtual time
+
+#ifdef SIM_CAN_SERVOS
+#define SIM_START_MS    100                 // hold the program back while the drives enable
+#else
+#define SIM_START_MS    0
+#endif
+
+typedef struct simConfig {
+    uint32_t pass_ns;
+    uint32_t line_ns;
+    uint32_t exec_ns;
+    uint32_t plan_ns;
+    uint64_t limit_ns;
+    bool verbose;                           // echo controller responses to stdout
+    bool deviation;                         // measure how far the runtime strays from the programmed path
+    const char *prefix;                     // line(s) to run ahead of the program, or NULL
+    uint32_t override_ms;                   // when to change the feed override, after the first step
+    float override_factor;                  // feed override to change to (M50 P), or 0 for none
+    uint32_t spike_ns;                      // extra exec interrupt latency...
+    uint32_t spike_every;                   // ...charged to every Nth exec interrupt, or 0 for none
+    uint32_t dda_spike_ns;                  // extra DDA interrupt time...
+    uint32_t dda_spike_every;               // ...charged to every Nth DDA interrupt, or 0 for none
+    bool plant;                             // the plant scale was set - report the following error
+    uint32_t start_ms;                      // virtual time before the first line is read
+} simConfig_t;
+
+typedef struct simStats {
+    uint64_t passes;                        // controller passes
+    uint32_t lines;                         // lines read from the replay channel
+    uint64_t rx_bytes;                      // bytes in those lines, with their terminators
+    uint64_t tx_bytes;                      // bytes written by the controller
+
+    uint64_t motion_start_ns;               // first DDA start
+    uint64_t motion_end_ns;                 // last DDA stop
+
+    uint32_t starvations;                   // DDA ran dry while the machine was in motion
+    uint64_t starved_ns;                    // total time spent starved
+    uint64_t starve_start_ns;               // start of the current starvation, or 0
+    uint8_t  min_buffers_available;         // planner queue low water mark
+
+    float max_deviation;                    // furthest runtime position from the programmed path (mm)
+
+    uint64_t override_ns;                   // when the feed override was changed, or 0
+    float override_from;                    // feed override before the change
+    float override_velocity;                // runtime velocity when it was changed (mm/min)
+    uint64_t override_response_ns;          // first segment that moved 10% of the way to the new velocity
+    uint64_t override_settle_ns;            // first segment within 10% of the new velocity
+    float override_accel[2];                // largest segment to segment acceleration before and after it (mm/s^2)
+
+    float max_following_error[MOTORS];      // largest measured following error (steps)
+} simStats_t;
+
+extern simConfig_t sim_cfg;
+extern simStats_t sim_stats;
+
+void sim_periodic(void);                    // called once per controller pass (hardware_periodic)
+
+void xio_sim_load(char *program);           // see sim_xio.cpp
+bool xio_sim_exhausted(void);
+
+int sim_scan_bench(const char *path, const char *program);    // see sim_scan.cpp
+int sim_scan_check(void);
+int sim_zoid_bench(void);                                    // see sim_zoid.cpp
+
+#endif // End of include guard: SIM_MAIN_H_ONCE
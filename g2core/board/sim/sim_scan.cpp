@@ -0,0 +1,292 @@
+/*
+ * sim_scan.cpp - LineRXBuffer scanner benchmark (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * sim -b runs this instead of the replay. The program is fed through the real LineRXBuffer
+ * (xio_line_buffer.h) over the stub RXBuffer (board/sim/motate/MotateBuffer.h), once with
+ * the word-at-a-time scan of line bodies and once with the per-character scan, and the
+ * host time per byte of each is printed. The lines each returns are hashed, and the run
+ * fails if they differ.
+ *
+ *  The device hands over SIM_SCAN_PACKET bytes per transfer, as a full speed USB packet
+ *  does, and the program is repeated until SIM_SCAN_BYTES have been read. These are host
+ *  times, so only the ratio says much about the board.
+ */
+
+#include "g2core.h"
+#include "xio_line_buffer.h"
+#include "sim_main.h"
+
+#include <time.h>
+#include <new>
+
+#define SIM_SCAN_PACKET     64              // bytes per transfer
+#define SIM_SCAN_BYTES      20000000        // read at least this much per scan
+
+/*
+ * simScanDevice - hands the program to the RXBuffer a packet at a time
+ */
+
+struct simScanDevice {
+    const char *program;
+    const char *next;                       // next byte of the program to hand over
+    const char *end;
+    uint32_t repeats;                       // times the program is still to be handed over after this
+    uint16_t packet;                        // most bytes per transfer
+    char *position;                         // end of the last transfer
+
+    bool exhausted() { return ((next == end) && (repeats == 0)); }
+
+    const char *getRXTransferPosition() { return (position); }
+
+    bool startRXTransfer(char *&buffer, const uint16_t length) {
+        uint16_t n = length;
+        if (n > packet) {
+            n = packet;
+        }
+        if (n > (end - next)) {
+            n = end - next;
+        }
+        memcpy(buffer, next, n);
+        next += n;
+        position = buffer + n;
+        if ((next == end) && (repeats != 0)) {
+            next = program;
+            repeats--;
+        }
+        return (true);
+    }
+};
+
+typedef struct simScanResult {
+    uint32_t lines;
+    uint32_t hash;                          // FNV-1a over the lines returned
+    double ns;
+} simScanResult_t;
+
+/*
+ * _scan() - read every line of the program, repeated, through one LineRXBuffer
+ */
+
+template <bool word_scan>
+static void _scan(const char *program, const size_t length, const uint32_t repeats, simScanResult_t &r)
+{
+    typedef LineRXBuffer<1024, simScanDevice *, 8, RX_BUFFER_SIZE, word_scan> rx_type;
+    alignas(rx_type) static char storage[sizeof(rx_type)];
+    simScanDevice dev;
+    struct timespec t0, t1;
+
+    r.lines = 0;
+    r.hash = 2166136261u;
+    dev.program = dev.next = program;
+    dev.end = program + length;
+    dev.repeats = repeats - 1;
+    dev.packet = SIM_SCAN_PACKET;
+    memset(storage, 0, sizeof(storage));    // the devices' buffers are zeroed statics
+    rx_type *rx = new (storage) rx_type(&dev);
+    rx->init();
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (true) {
+        uint16_t size;
+        char *line = rx->readline(false, size);
+        if (line == NULL) {
+            if (dev.exhausted() && rx->isEmpty()) {
+                break;
+            }
+            continue;
+        }
+        r.lines++;
+        for (uint16_t j=0; j < size; j++) {
+            r.hash = (r.hash ^ (uint8_t)line[j]) * 16777619u;
+        }
+        r.hash = (r.hash ^ '\n') * 16777619u;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    rx->~rx_type();
+    r.ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+/*
+ * sim_scan_bench() - time both scans over the program. Returns the exit code for main().
+ */
+
+int sim_scan_bench(const char *path, const char *program)
+{
+    size_t length = strlen(program);
+    char *text = (char *)malloc(length + 2);    // the last line must be ended to be read
+    memcpy(text, program, length);
+    if ((length == 0) || (text[length-1] != '\n')) {
+        text[length++] = '\n';
+    }
+    text[length] = 0;
+
+    uint32_t repeats = (SIM_SCAN_BYTES / length) + 1;
+    uint64_t bytes = (uint64_t)length * repeats;
+    simScanResult_t by_word, by_char;
+
+    _scan<false>(text, length, repeats, by_char);
+    _scan<true>(text, length, repeats, by_word);
+    free(text);
+
+    const char *name = strrchr(path, '/');
+    name = (name == NULL) ? path : name+1;
+    fprintf(stderr, "%-28s %10llu %8lu %9.2f %9.2f %8.2fx %s\n", name,
+            (unsigned long long)bytes, (unsigned long)(by_word.lines / repeats),
+            by_char.ns / bytes, by_word.ns / bytes, by_char.ns / by_word.ns,
+            ((by_word.lines == by_char.lines) && (by_word.hash == by_char.hash)) ? "yes" : "NO");
+
+    return ((by_word.hash == by_char.hash) ? 0 : 2);
+}
+
+/*
+ * sim -k runs these checks instead of the replay. Both scans are run over made-up lines,
+ * through the same ring and line buffer sizes as xio (LineRXBuffer<1024> and RX_BUFFER_SIZE),
+ * and every line returned must be the line sent:
+ *
+ *    wrap  lines of 1 to 300 characters, so the ring wraps in the middle of lines at many
+ *          offsets. Lines that don't wrap are returned in place and lines that do are
+ *          copied to the line buffer - both must be seen.
+ *    long  lines around and far over RX_BUFFER_SIZE, with short lines between them. A line
+ *          longer than RX_BUFFER_SIZE-1 characters is cut to its first RX_BUFFER_SIZE-1 and
+ *          the rest is dropped, and the line after it must come through whole.
+ *
+ *  Each check runs with transfers of 1, 7, 64 and 1023 bytes, so lines also arrive split
+ *  at every point. One line per check is printed, ending in ok or FAIL.
+ */
+
+#define SIM_CHECK_RING      1024            // as xio's LineRXBuffer
+#define SIM_CHECK_LINE_MAX  (RX_BUFFER_SIZE - 1)
+#define SIM_CHECK_LINES     4000            // lines per check
+#define SIM_CHECK_STALL     10000           // reads in a row without a line that end a check
+#define SIM_CHECK_LONGEST   3000            // longest line sent
+
+typedef struct simCheckResult {
+    uint32_t lines;                         // lines returned
+    uint32_t bad;                           // lines returned that were not the line sent, or missing
+    uint32_t in_place;                      // lines returned from the ring
+    uint32_t copied;                        // lines returned from the line buffer
+} simCheckResult_t;
+
+/*
+ * _check_line() - make up line n of a check. Returns its length, with the text in buf.
+ */
+
+static uint16_t _check_line(const bool long_lines, const uint32_t n, char *buf)
+{
+    static const uint16_t long_lengths[] = { 510, 511, 512, 513, 1000, 1022, 1023, 1024, 1025, SIM_CHECK_LONGEST };
+    uint16_t length;
+    if (!long_lines) {
+        length = 1 + (n * 37) % 300;
+    } else if (n & 1) {
+        length = long_lengths[(n >> 1) % (sizeof(long_lengths) / sizeof(long_lengths[0]))];
+    } else {
+        length = 1 + (n * 13) % 40;
+    }
+    buf[0] = 'G';                           // so no line starts with a control character
+    for (uint16_t i=1; i < length; i++) {
+        buf[i] = "0123456789XYZF. "[(n + i * 7) % 16];
+    }
+    return (length);
+}
+
+/*
+ * _check() - send the lines of one check through one LineRXBuffer and compare them
+ */
+
+template <bool word_scan>
+static void _check(const bool long_lines, const char *text, const size_t length, const uint16_t packet,
+                   simCheckResult_t &r)
+{
+    typedef LineRXBuffer<SIM_CHECK_RING, simScanDevice *, 8, RX_BUFFER_SIZE, word_scan> rx_type;
+    static char expected[SIM_CHECK_LONGEST];
+    simScanDevice dev;
+
+    dev.program = dev.next = text;
+    dev.end = text + length;
+    dev.repeats = 0;
+    dev.packet = packet;
+    void *storage = calloc(1, sizeof(rx_type));     // zeroed like the devices' buffers - a memset
+    rx_type *rx = new (storage) rx_type(&dev);      // just ahead of the constructor can be dropped
+    rx->init();
+
+    uint32_t n = 0;
+    uint32_t idle = 0;                      // reads in a row that returned no line
+    while (true) {
+        uint16_t size;
+        char *line = rx->readline(false, size);
+        if (line == NULL) {                 // the end of a dropped line can be left unread
+            if ((dev.exhausted() && rx->isEmpty()) || (++idle > SIM_CHECK_STALL)) {
+                break;
+            }
+            continue;
+        }
+        idle = 0;
+        uint16_t want = _check_line(long_lines, n++, expected);
+        if (want > SIM_CHECK_LINE_MAX) {
+            want = SIM_CHECK_LINE_MAX;
+        }
+        if ((size != want) || (memcmp(line, expected, want) != 0) || (strlen(line) < want)) {
+            r.bad++;
+        }
+        if ((line >= rx->_data) && (line < rx->_data + SIM_CHECK_RING)) {
+            r.in_place++;
+        } else {
+            r.copied++;
+        }
+    }
+    r.lines += n;
+    if (n != SIM_CHECK_LINES) {
+        r.bad += (n > SIM_CHECK_LINES) ? n - SIM_CHECK_LINES : SIM_CHECK_LINES - n;
+    }
+    rx->~rx_type();
+    free(storage);
+}
+
+/*
+ * sim_scan_check() - run the checks. Returns the exit code for main().
+ */
+
+int sim_scan_check()
+{
+    static const uint16_t packets[] = { 1, 7, 64, SIM_CHECK_RING-1 };
+    static const char *names[] = { "wrap", "long" };
+    char *text = (char *)malloc(SIM_CHECK_LINES * (SIM_CHECK_LONGEST + 1));
+    bool ok = true;
+
+    for (uint8_t c=0; c < 2; c++) {
+        const bool long_lines = (c == 1);
+        size_t length = 0;
+        for (uint32_t n=0; n < SIM_CHECK_LINES; n++) {
+            length += _check_line(long_lines, n, text + length);
+            text[length++] = '\n';
+        }
+        simCheckResult_t by_word = {}, by_char = {};
+        for (uint8_t p=0; p < sizeof(packets) / sizeof(packets[0]); p++) {
+            _check<true>(long_lines, text, length, packets[p], by_word);
+            _check<false>(long_lines, text, length, packets[p], by_char);
+        }
+        bool passed = (by_word.bad == 0) && (by_char.bad == 0) &&
+                      (by_word.in_place != 0) && (by_word.copied != 0);
+        fprintf(stderr, "scan check %s: %lu lines, %lu in place, %lu copied, %lu bad by word, %lu bad by char: %s\n",
+                names[c], (unsigned long)by_word.lines, (unsigned long)by_word.in_place,
+                (unsigned long)by_word.copied, (unsigned long)by_word.bad, (unsigned long)by_char.bad,
+                passed ? "ok" : "FAIL");
+        ok &= passed;
+    }
+    free(text);
+    return (ok ? 0 : 2);
+}
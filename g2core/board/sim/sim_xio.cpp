@@ -0,0 +1,152 @@
+/*
+ * sim_xio.cpp - xio replacement for the sim board - replays a Gcode file
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The sim board does not compile xio.cpp (it is built around Motate USB and UART
+ * devices). This file provides the same external interface (see xio.h) over an
+ * in-memory program loaded by sim_main.cpp:
+ *
+ *  - xio_readline() returns the program one line at a time. Control-only reads
+ *    (DEV_IS_CTRL without DEV_IS_DATA) only return a line if it parses as control.
+ *    Each line returned charges sim_cfg.line_ns to the virtual clock.
+ *    Nothing is returned before sim_cfg.start_ms of virtual time.
+ *
+ *  - xio_write_devices() counts the writes and bytes and only echoes them with -v.
+ *    xio_write() and xio_writeline() stage output in front of it as on the board
+ *    (see xio_tx.cpp).
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "controller.h"
+#include "text_parser.h"
+#include "xio.h"
+#include "sim_main.h"
+
+#include <unistd.h>
+
+/**** Structures ****/
+
+typedef struct xioSim {
+    magic_t magic_start;
+    char *program;                          // program text (NUL terminated, lines separated by LF)
+    char *next;                             // next line to read
+    char line[RX_BUFFER_SIZE];              // line returned by xio_readline()
+    magic_t magic_end;
+} xioSim_t;
+
+static xioSim_t xio;
+
+/**** CODE ****/
+
+void xio_init()
+{
+    xio.magic_start = MAGICNUM;
+    xio.magic_end = MAGICNUM;
+}
+
+stat_t xio_test_assertions()
+{
+    if ((BAD_MAGIC(xio.magic_start)) || (BAD_MAGIC(xio.magic_end))) {
+        return(cm_panic(STAT_XIO_ASSERTION_FAILURE, "xio_test_assertions()"));
+    }
+    return (STAT_OK);
+}
+
+/*
+ * xio_sim_load()      - attach a program to the replay channel (text is not copied)
+ * xio_sim_exhausted() - true once the last line has been read
+ */
+
+void xio_sim_load(char *program)
+{
+    xio.program = program;
+    xio.next = program;
+}
+
+bool xio_sim_exhausted()
+{
+    return ((xio.next == NULL) || (*xio.next == NUL));
+}
+
+/*
+ * xio_readline() - return the next replay line
+ */
+
+char *xio_readline(devflags_t &flags, uint16_t &size)
+{
+    if (xio_sim_exhausted() || (sim_now_ms() < sim_cfg.start_ms)) {
+        return (NULL);
+    }
+    char *end = strchr(xio.next, LF);
+    size_t len = (end == NULL) ? strlen(xio.next) : (size_t)(end - xio.next);
+    if (len >= RX_BUFFER_SIZE) {
+        len = RX_BUFFER_SIZE-1;
+    }
+    memcpy(xio.line, xio.next, len);
+    xio.line[len] = NUL;
+
+    if (((flags & DEV_IS_BOTH) == DEV_IS_CTRL) && !controller_parse_control(xio.line)) {
+        return (NULL);
+    }
+    xio.next = (end == NULL) ? (xio.next + strlen(xio.next)) : (end + 1);
+    flags = DEV_IS_BOTH;
+    size = len;
+
+    sim_stats.lines++;
+    sim_stats.rx_bytes += len+1;
+    sim_charge(sim_cfg.line_ns);
+    return (xio.line);
+}
+
+/*
+ * xio_write_devices() - responses go nowhere unless verbose
+ */
+
+size_t xio_write_devices(const char *buffer, size_t size, bool only_to_muted)
+{
+    sim_stats.tx_bytes += size;
+    if (sim_cfg.verbose) {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return (size);
+}
+
+bool xio_connected() { return (true); }
+void xio_flush_to_command() { xio.next = NULL; }
+
+#if MARLIN_COMPAT_ENABLED == true
+void xio_exit_fake_bootloader() {}
+#endif
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_spi[] = "[spi] SPI state%20d [0=disabled,1=enabled]\n";
+void xio_print_spi(nvObj_t *nv) { text_print(nv, fmt_spi);} // TYPE_INT
+
+#endif // __TEXT_MODE
@@ -0,0 +1,219 @@
+/*
+ * sim_zoid.cpp - meet velocity solver benchmark (sim board)
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * sim -z runs this instead of the replay. It draws SIM_ZOID_CASES random moves, keeps the
+ * ones that reach zoid exit 3c (an asymmetric head/tail with no cruise, the only case that
+ * iterates), and solves each with the Newton search in v_1 the planner used to run and with
+ * the bounded solver in plan_zoid.cpp (_get_meet_velocity(), via mp_meet_velocity()).
+ *
+ *  For each it prints the iterations taken, how many hit the iteration cap, the largest
+ *  head + tail length error against the move length, and the host time per call. The
+ *  inputs come from a fixed seed so runs are comparable. These are host times, so only
+ *  the ratio says much about the board.
+ */
+
+#include "g2core.h"
+#include "planner.h"
+#include "util.h"
+#include "sim_main.h"
+
+#include <time.h>
+
+#define SIM_ZOID_CASES      200000          // random moves drawn, before keeping case 3
+#define SIM_ZOID_REPEATS    500             // timed passes over the kept cases
+#define SIM_ZOID_SEED       0x2545f491u
+
+#define SIM_ZOID_V_MAX      15000.0         // velocities are drawn from [0, V_MAX) mm/min
+#define SIM_ZOID_L_MIN      0.005           // lengths are log-uniform over [L_MIN, L_MAX) mm
+#define SIM_ZOID_L_MAX      25.0
+#define SIM_ZOID_J_MIN      20.0            // jerks are log-uniform over [J_MIN, J_MAX) * JERK_MULTIPLIER
+#define SIM_ZOID_J_MAX      5000.0
+
+#define NEWTON_ITERATIONS_MAX 30            // the old search gave up after this many
+
+typedef struct simZoidCase {
+    float v_0;
+    float v_2;
+    float L;
+    mpBuf_t *bf;
+} simZoidCase_t;
+
+typedef struct simZoidResult {
+    uint32_t iterations;                    // total over the cases
+    uint32_t max;
+    uint32_t capped;                        // cases that stopped on the iteration cap
+    double error;                           // largest |head + tail - L| / L
+    double ns;                              // per call
+} simZoidResult_t;
+
+static uint32_t zoid_seed;
+
+static double _uniform()                    // [0, 1)
+{
+    zoid_seed ^= zoid_seed << 13;
+    zoid_seed ^= zoid_seed >> 17;
+    zoid_seed ^= zoid_seed << 5;
+    return (zoid_seed / 4294967296.0);
+}
+
+static double _log_uniform(const double lo, const double hi)
+{
+    return (lo * exp(log(hi / lo) * _uniform()));
+}
+
+/*
+ * _newton_meet_velocity() - the meet velocity search the planner ran before the bounded solver
+ *
+ *  Newton's method on v_1 from the symmetric estimate, with a 30 iteration limit. Only case 3
+ *  is passed in, so the symmetric and no-meet branches are left out. Returns the iterations.
+ */
+
+static uint32_t _newton_meet_velocity(const float v_0, const float v_2, const float L, const mpBuf_t *bf, float &v_1)
+{
+    const float q_recip_2_sqrt_j = bf->q_recip_2_sqrt_j;
+    const float min_v_1 = max(v_0, v_2);
+    uint32_t i = 0;
+
+    v_1 = mp_get_target_velocity(min_v_1, L / 2.0, bf);
+    while (i++ < NEWTON_ITERATIONS_MAX) {
+        if (v_1 < min_v_1) {
+            v_1 = min_v_1;
+            break;
+        }
+        const float sqrt_delta_v_0 = sqrt(fabs(v_1 - v_0));
+        const float sqrt_delta_v_2 = sqrt(fabs(v_1 - v_2));
+        const float l_h = q_recip_2_sqrt_j * (sqrt_delta_v_0 * (v_1 + v_0));
+        const float l_t = q_recip_2_sqrt_j * (sqrt_delta_v_2 * (v_1 + v_2));
+        const float l_c = (l_h + l_t) - L;
+
+        if ((l_c < 0.00001) && (l_c > -1.0)) {
+            break;
+        }
+        const float v_1x3     = 3 * v_1;
+        const float recip_l_d = (2 * sqrt_delta_v_0 * sqrt_delta_v_2) /
+                                ((sqrt_delta_v_0 * (v_1x3 - v_2) - (v_0 - v_1x3) * sqrt_delta_v_2) * q_recip_2_sqrt_j);
+        v_1 = v_1 - (l_c * recip_l_d);
+    }
+    return (i);
+}
+
+/*
+ * _length_error() - |head + tail - L| / L for a meet velocity, worked in double
+ */
+
+static double _length_error(const simZoidCase_t &c, const float v_1)
+{
+    const double q = c.bf->q_recip_2_sqrt_j;
+    const double v_h = max(c.v_0, c.v_2);
+    const double v = (v_1 < v_h) ? v_h : v_1;
+    const double l = q * (sqrt(v - c.v_0) * (v + c.v_0) + sqrt(v - c.v_2) * (v + c.v_2));
+    return (fabs(l - c.L) / c.L);
+}
+
+static double _elapsed_ns(const struct timespec &t0, const struct timespec &t1)
+{
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec));
+}
+
+static void _print(const char *name, const uint32_t cases, const simZoidResult_t &r)
+{
+    fprintf(stderr, "%-24s %8lu %9.2f %8lu %7lu %12.2e %8.1f\n", name, (unsigned long)cases,
+            (double)r.iterations / cases, (unsigned long)r.max, (unsigned long)r.capped, r.error, r.ns);
+}
+
+/*
+ * sim_zoid_bench() - time both solvers over the same moves. Returns the exit code for main().
+ */
+
+int sim_zoid_bench(void)
+{
+    simZoidCase_t *cases = (simZoidCase_t *)malloc(SIM_ZOID_CASES * sizeof(simZoidCase_t));
+    mpBuf_t *bufs = new mpBuf_t[SIM_ZOID_CASES];
+    mpBlockRuntimeBuf_t block;
+    simZoidResult_t newton = {}, bounded = {};
+    uint32_t n = 0;
+    volatile float sink = 0;
+    float v_1;
+    struct timespec t0, t1;
+
+    zoid_seed = SIM_ZOID_SEED;
+    for (uint32_t k=0; k < SIM_ZOID_CASES; k++) {
+        mpBuf_t *bf = &bufs[n];
+        bf->jerk = _log_uniform(SIM_ZOID_J_MIN, SIM_ZOID_J_MAX) * JERK_MULTIPLIER;
+        bf->q_recip_2_sqrt_j = 2.40281141413 / (2 * sqrt(bf->jerk));
+
+        simZoidCase_t &c = cases[n];
+        c.v_0 = _uniform() * SIM_ZOID_V_MAX;
+        c.v_2 = _uniform() * SIM_ZOID_V_MAX;
+        c.L = _log_uniform(SIM_ZOID_L_MIN, SIM_ZOID_L_MAX);
+        c.bf = bf;
+        if (fp_EQ(c.v_0, c.v_2) || (mp_get_target_length(min(c.v_0, c.v_2), max(c.v_0, c.v_2), bf) >= c.L)) {
+            continue;                       // case 1 or 2 - no search
+        }
+        n++;
+    }
+
+    // accuracy and iterations, one call each
+    const uint32_t mv_iterations = mp.mv_iterations;
+    for (uint32_t k=0; k < n; k++) {
+        const simZoidCase_t &c = cases[k];
+
+        uint32_t i = _newton_meet_velocity(c.v_0, c.v_2, c.L, c.bf, v_1);
+        newton.iterations += i;
+        newton.max = max(newton.max, i);
+        newton.capped += (i > NEWTON_ITERATIONS_MAX) ? 1 : 0;
+        newton.error = max(newton.error, _length_error(c, v_1));
+
+        i = mp.mv_iterations;
+        v_1 = mp_meet_velocity(c.v_0, c.v_2, c.L, c.bf, &block);
+        i = mp.mv_iterations - i;
+        bounded.max = max(bounded.max, i);
+        bounded.capped += (i >= MEET_ITERATIONS_MAX) ? 1 : 0;
+        bounded.error = max(bounded.error, _length_error(c, v_1));
+    }
+    bounded.iterations = mp.mv_iterations - mv_iterations;
+
+    // host time per call
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t r=0; r < SIM_ZOID_REPEATS; r++) {
+        for (uint32_t k=0; k < n; k++) {
+            _newton_meet_velocity(cases[k].v_0, cases[k].v_2, cases[k].L, cases[k].bf, v_1);
+            sink = v_1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    newton.ns = _elapsed_ns(t0, t1) / ((double)n * SIM_ZOID_REPEATS);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t r=0; r < SIM_ZOID_REPEATS; r++) {
+        for (uint32_t k=0; k < n; k++) {
+            sink = mp_meet_velocity(cases[k].v_0, cases[k].v_2, cases[k].L, cases[k].bf, &block);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bounded.ns = _elapsed_ns(t0, t1) / ((double)n * SIM_ZOID_REPEATS);
+    (void)sink;
+
+    fprintf(stderr, "%lu of %lu moves reach zoid exit 3c\n", (unsigned long)n, (unsigned long)SIM_ZOID_CASES);
+    fprintf(stderr, "%-24s %8s %9s %8s %7s %12s %8s\n", "solver", "cases", "iter avg", "iter max", "capped", "max len err", "ns/call");
+    _print("newton in v_1 (old)", n, newton);
+    _print("bounded in a", n, bounded);
+
+    delete[] bufs;
+    free(cases);
+    return ((bounded.capped == 0) ? 0 : 2);
+}
@@ -1,63 +1,390 @@
 
 #include "can_bus.h"
-// #define CAN_GPIO_INPUT_ADDRESS_1 0x42
+#include "canopen.h"
+#include "text_parser.h"
+#include "controller.h"
+#include "util.h"
 
 #ifdef CAN_ENABLED
 
-void can_send_message (uint32_t id, uint8_t length, uint8_t* data) {
-  hw_can_send_frame(id, length, data);
-}
-
-void can_message_received (uint32_t id, uint8_t length, uint8_t* data) {
-  switch (id) {
-    //Generated with: perl -e 'for($i=1;$i<13 { print "#ifdef CAN_GPIO_INPUT_ADDRESS_${i}\ncase CAN_GPIO_INPUT_ADDRESS_${i}: can_gpio_received(${i}, length, data); break;\n#endif\n";}'
-    #ifdef CAN_GPIO_INPUT_ADDRESS_1
-    case CAN_GPIO_INPUT_ADDRESS_1: can_gpio_received(0, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_2
-    case CAN_GPIO_INPUT_ADDRESS_2: can_gpio_received(1, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_3
-    case CAN_GPIO_INPUT_ADDRESS_3: can_gpio_received(2, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_4
-    case CAN_GPIO_INPUT_ADDRESS_4: can_gpio_received(3, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_5
-    case CAN_GPIO_INPUT_ADDRESS_5: can_gpio_received(4, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_6
-    case CAN_GPIO_INPUT_ADDRESS_6: can_gpio_received(5, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_7
-    case CAN_GPIO_INPUT_ADDRESS_7: can_gpio_received(6, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_8
-    case CAN_GPIO_INPUT_ADDRESS_8: can_gpio_received(7, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_9
-    case CAN_GPIO_INPUT_ADDRESS_9: can_gpio_received(8, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_10
-    case CAN_GPIO_INPUT_ADDRESS_10: can_gpio_received(9, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_11
-    case CAN_GPIO_INPUT_ADDRESS_11: can_gpio_received(10, 1, data); break;
-    #endif
-    #ifdef CAN_GPIO_INPUT_ADDRESS_12
-    case CAN_GPIO_INPUT_ADDRESS_12: can_gpio_received(11, 1, data); break;
-    #endif
-
-  }
-  
-  //can_gpio_received(100, 1, data);
+canSingleton_t can;
+
+static void _update_statistics(void);
+
+/*
+ * can_rx_callback() - dispatch received frames (see can_bus.h)
+ */
+
+stat_t can_rx_callback()
+{
+    uint16_t depth = Can0.rxCount();
+    can.rx_dropped = Can0.getRxDropped();
+    can.rx_overruns = Can0.getRxOverruns();
+    Can0.pollStatus();
+    if (SysTickTimer_getValue() - can.rate_ms >= CAN_RATE_MS) {
+        _update_statistics();
+    }
+    if (depth == 0) {
+        return (STAT_NOOP);
+    }
+    if (depth > can.rx_max_depth) {
+        can.rx_max_depth = depth;
+    }
+    CAN_FRAME frame;
+    for (uint8_t i=0; (i < CAN_RX_BATCH) && Can0.readRx(frame); i++) {
+        can.rx_frames++;
+        can_message_received(frame.id, frame.length, frame.data.bytes, frame.ticks);
+    }
+    return (STAT_OK);
+}
+
+/*
+ * can_send_message() - queue a frame in its class. Returns false if the class queue is full.
+ */
+
+bool can_send_message (uint32_t id, uint8_t length, uint8_t* data, canTxClass tx_class) {
+    if (!hw_can_send_frame(id, length, data, tx_class)) {
+        can.tx_full++;
+        return (false);
+    }
+    can.tx_frames[tx_class]++;
+    return (true);
+}
+
+/*
+ * _update_statistics() - work out the frame rates and take the driver's error counts
+ */
+
+static void _update_statistics()
+{
+    uint32_t now = SysTickTimer_getValue();
+    float seconds = (now - can.rate_ms) / 1000.0;
+    can.rate_ms = now;
+
+    uint32_t tx_frames = 0;
+    for (uint8_t c=0; c < CAN_TX_CLASSES; c++) {
+        tx_frames += can.tx_frames[c];
+    }
+    can.rx_rate = (can.rx_frames - can.rate_rx_frames) / seconds;
+    can.tx_queued_rate = (tx_frames - can.rate_tx_frames) / seconds;
+    can.rate_rx_frames = can.rx_frames;
+    can.rate_tx_frames = tx_frames;
+
+    for (uint8_t i=0; i < CAN_ROUTES; i++) {
+        canRoute_t *r = &can.route[i];
+        r->rate = (r->frames - r->rate_frames) / seconds;
+        r->rate_frames = r->frames;
+    }
+
+    can.bus_errors = Can0.getBusErrors();
+    can.bus_offs = Can0.getBusOffs();
+    can.tx_error_count = Can0.get_tx_error_cnt();
+    can.rx_error_count = Can0.get_rx_error_cnt();
+    can.tx_max_depth = Can0.getTxMaxDepth();
+}
+
+/*
+ * can_tx_callback() - send the output routes that changed since the last pass (see can_bus.h)
+ *
+ *  Outputs may be changed from the exec interrupt (M-codes), so the change flag is cleared
+ *  before the bits are read. A change made in between is sent on the next pass.
+ */
+
+stat_t can_tx_callback()
+{
+    if (!can.out_pending) {
+        return (STAT_NOOP);
+    }
+    can.out_pending = false;
+    for (uint8_t i=0; i < CAN_ROUTES; i++) {
+        canRoute_t *r = &can.route[i];
+        if ((r->type != CAN_ROUTE_OUTPUT) || !r->out_changed) {
+            continue;
+        }
+        r->out_changed = false;
+        uint32_t bits = r->out_bits;
+
+        uint8_t data[4];
+        uint8_t length = (r->count + 7) / 8;
+        for (uint8_t b=0; b < length; b++) {
+            data[b] = (uint8_t)(bits >> (b*8));
+        }
+        if (!can_send_message(r->id & CAN_ID_MASK, length, data, CAN_TX_IO)) {
+            r->out_changed = true;          // try again next pass
+            can.out_pending = true;
+            continue;
+        }
+        r->frames++;
+    }
+    return (STAT_OK);
+}
+
+/*
+ * _route_mask()  - ID bits compared by a route
+ * _route_hash()  - hash slot of a masked ID (multiplicative hash, top bits)
+ * _route_match() - return the lowest numbered input route for a frame ID, or NULL
+ *
+ *  Each mask has its own entries in the hash, and within a mask the lowest numbered
+ *  route is the one entered (see can_route_rebuild()). Routes with different masks can
+ *  match the same ID, so every mask is probed and the lowest route number is kept.
+ */
+
+static uint32_t _route_mask(const canRoute_t *r)
+{
+    return ((r->mask == 0) ? CAN_ID_MASK : (r->mask & CAN_ID_MASK));
+}
+
+static uint8_t _route_hash(const uint32_t key)
+{
+    return ((uint8_t)((key * 2654435761UL) >> (32 - CAN_ROUTE_HASH_BITS)));
+}
+
+static canRoute_t *_route_match(const uint32_t id)
+{
+    canRoute_t *match = NULL;
+
+    for (uint8_t m=0; m < can.mask_count; m++) {
+        uint32_t mask = can.masks[m];
+        uint32_t key = id & mask;
+        for (uint8_t h = _route_hash(key); can.hash[h] >= 0; h = (h+1) & (CAN_ROUTE_HASH_SIZE-1)) {
+            canRoute_t *r = &can.route[can.hash[h]];
+            if ((_route_mask(r) == mask) && ((r->id & mask) == key)) {
+                if ((match == NULL) || (r < match)) {
+                    match = r;
+                }
+                break;
+            }
+        }
+    }
+    return (match);
+}
+
+/*
+ * can_route_rebuild() - rebuild the input route hash from the route table
+ *
+ *  Called whenever a route is changed. Routes are entered in order, so the lowest
+ *  numbered route of any that share a mask and masked ID is the one entered.
+ */
+
+void can_route_rebuild()
+{
+    memset(can.hash, -1, sizeof(can.hash));
+    can.mask_count = 0;
+
+    for (uint8_t i=0; i < CAN_ROUTES; i++) {
+        canRoute_t *r = &can.route[i];
+        if (r->type != CAN_ROUTE_INPUT) {
+            continue;
+        }
+        uint32_t mask = _route_mask(r);
+        uint32_t key = r->id & mask;
+        uint8_t m;
+        for (m=0; (m < can.mask_count) && (can.masks[m] != mask); m++);
+        if (m == can.mask_count) {
+            can.masks[can.mask_count++] = mask;
+        }
+        uint8_t h = _route_hash(key);
+        bool duplicate = false;
+        for (; can.hash[h] >= 0; h = (h+1) & (CAN_ROUTE_HASH_SIZE-1)) {
+            canRoute_t *o = &can.route[can.hash[h]];
+            if ((_route_mask(o) == mask) && ((o->id & mask) == key)) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            can.hash[h] = i;
+        }
+    }
 }
 
+/*
+ * can_message_received() - set the inputs of the route a frame matches
+ *
+ *  Frames from CAN servo drives are taken first (see canopen.h).
+ *  Channels are di numbers. The CAN inputs follow the board's own, so di(D_IN_CHANNELS+1)
+ *  is the first virtual input. Channels outside the virtual inputs are ignored.
+ *  ticks is when the frame was received, on the motion clock.
+ */
+
+void can_message_received (uint32_t id, uint8_t length, uint8_t* data, uint32_t ticks) {
+    if (canopen_message_received(id, length, data)) {   // CAN servo drives
+        return;
+    }
+    canRoute_t *r = _route_match(id & CAN_ID_MASK);
+    if (r == NULL) {
+        can.rx_unrouted++;
+        return;
+    }
+    r->frames++;
+    if (length == 0) {
+        return;
+    }
+    int first = r->channel - D_IN_CHANNELS - 1;     // index of the first virtual input
+    if (r->count == 1) {
+        can_gpio_received(first, data[0] > 0, ticks);
+        return;
+    }
+    for (uint8_t i=0; (i < r->count) && (i < length*8); i++) {
+        can_gpio_received(first + i, (data[i >> 3] >> (i & 7)) & 1, ticks);
+    }
+}
+
+/*
+ * can_digital_output() - record an output change on the route that carries the output
+ *
+ *  The route is sent by can_tx_callback(). A single channel route sends one byte (0 or 1).
+ *  A bitmap route sends the state of all its channels, as many bytes as the channel count
+ *  needs.
+ */
+
 void can_digital_output (uint8_t pin_num, bool value) {
-  uint8_t data = (uint8_t)value;
-  switch (pin_num) {
-    case 1: can_send_message(0x201, 1, &data); break;
-  }
+    for (uint8_t i=0; i < CAN_ROUTES; i++) {
+        canRoute_t *r = &can.route[i];
+        if ((r->type != CAN_ROUTE_OUTPUT) || (pin_num < r->channel) || (pin_num >= r->channel + r->count)) {
+            continue;
+        }
+        uint32_t bit = 1UL << (pin_num - r->channel);
+        r->out_bits = value ? (r->out_bits | bit) : (r->out_bits & ~bit);
+        r->out_changed = true;
+        can.out_changes++;
+        can.out_pending = true;
+        return;
+    }
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * can_set_ty() - set route type
+ * can_get_id() - get an ID or mask as a "0x..." data value
+ * can_set_id() - set an ID or mask from a data value or a number
+ * can_set_ch() - set first channel
+ * can_set_cn() - set channel count
+ *
+ *  IDs are 29 bits and do not fit a float, so they are returned as data - including the
+ *  echo from a set. A number is also accepted when setting, as the defaults are. The type
+ *  entry precedes the ID entry in each group so the defaults are never read as data.
+ */
+
+stat_t can_set_ty(nvObj_t *nv)
+{
+    if ((nv->value < CAN_ROUTE_NONE) || (nv->value >= CAN_ROUTE_MAX)) {
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    set_ui8(nv);
+    can_route_rebuild();
+    return (STAT_OK);
+}
+
+stat_t can_get_id(nvObj_t *nv)
+{
+    return (get_data(nv));
+}
+
+stat_t can_set_id(nvObj_t *nv)
+{
+    uint32_t id;
+    if (nv->valuetype == TYPE_DATA) {
+        memcpy(&id, &nv->value, sizeof(id));        // TYPE_DATA carries the bits, not a float
+    } else {
+        if (nv->value < 0) {
+            return (STAT_INPUT_VALUE_RANGE_ERROR);
+        }
+        id = (uint32_t)nv->value;
+    }
+    if (id > CAN_ID_MASK) {
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    *((uint32_t *)GET_TABLE_WORD(target)) = id;
+    memcpy(&nv->value, &id, sizeof(id));            // echo the exact ID, as can_get_id() reads it
+    nv->valuetype = TYPE_DATA;
+    can_route_rebuild();
+    return (STAT_OK);
+}
+
+stat_t can_set_ch(nvObj_t *nv)
+{
+    if ((nv->value < 1) || (nv->value > 255)) {
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    set_ui8(nv);
+    can_route_rebuild();
+    return (STAT_OK);
 }
 
+stat_t can_set_cn(nvObj_t *nv)
+{
+    if ((nv->value < 1) || (nv->value > CAN_ROUTE_CHANNELS)) {
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+    }
+    set_ui8(nv);
+    can_route_rebuild();
+    return (STAT_OK);
+}
+
+/*
+ * can_clcan() - clear the CAN bus statistics
+ *
+ *  Like cli this is a command - reading or writing "clcan" clears the counts of frames
+ *  lost, unrouted frames, errors and bus off events, and the high water marks. Frame
+ *  counts and rates are kept.
+ */
+
+stat_t can_clcan(nvObj_t *nv)
+{
+    Can0.clearStatistics();
+    can.rx_dropped = 0;
+    can.rx_overruns = 0;
+    can.rx_unrouted = 0;
+    can.rx_max_depth = 0;
+    can.tx_full = 0;
+    can.tx_max_depth = 0;
+    can.bus_errors = 0;
+    can.bus_offs = 0;
+    return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+    static const char fmt_can_ty[] = "[%sty] route type%17d [0=none,1=input,2=output]\n";
+    static const char fmt_can_id[] = "[%sid] route ID%19s0x%lX\n";
+    static const char fmt_can_mk[] = "[%smk] route ID mask%14s0x%lX [0=all bits]\n";
+    static const char fmt_can_ch[] = "[%sch] route first channel%8d\n";
+    static const char fmt_can_cn[] = "[%scn] route channels%13d\n";
+    static const char fmt_can_rt[] = "[%srt] route rate%17.1f frames/s\n";
+
+    static void _print_route(nvObj_t *nv, const char *format)
+    {
+        sprintf(cs.out_buf, format, nv->group, (int)nv->value);
+        xio_writeline(cs.out_buf);
+    }
+    static void _print_route_id(nvObj_t *nv, const char *format)
+    {
+        uint32_t id;
+        memcpy(&id, &nv->value, sizeof(id));
+        sprintf(cs.out_buf, format, nv->group, "", (unsigned long)id);
+        xio_writeline(cs.out_buf);
+    }
+    void can_print_ty(nvObj_t *nv) {_print_route(nv, fmt_can_ty);}
+    void can_print_id(nvObj_t *nv) {_print_route_id(nv, fmt_can_id);}
+    void can_print_mk(nvObj_t *nv) {_print_route_id(nv, fmt_can_mk);}
+    void can_print_ch(nvObj_t *nv) {_print_route(nv, fmt_can_ch);}
+    void can_print_cn(nvObj_t *nv) {_print_route(nv, fmt_can_cn);}
+    void can_print_rt(nvObj_t *nv)
+    {
+        sprintf(cs.out_buf, fmt_can_rt, nv->group, (double)nv->value);
+        xio_writeline(cs.out_buf);
+    }
+
+#endif // __TEXT_MODE
+
 #endif
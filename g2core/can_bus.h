@@ -3,17 +3,191 @@
 #define CAN_H_ONCE
 
 #include "g2core.h"
+#include "config.h"
 #include "hardware.h"
 #include "gpio.h"
 #include "xio.h"
 
 #ifdef CAN_ENABLED
 
+/*
+ * Received frames
+ *
+ *  The CAN interrupt only reads the mailbox and queues the frame in the driver's RX ring
+ *  (see CANRaw::mailbox_int_handler()). can_rx_callback() drains the ring from the main
+ *  loop, up to CAN_RX_BATCH frames per pass, and hands each frame to can_message_received().
+ *  So GPIO and other handlers run at main loop level and never preempt step preparation.
+ *
+ *  Frames are lost if the ring fills between passes (dropped) or if a mailbox receives a
+ *  second frame before the interrupt reads the first (overrun). Both are counted.
+ *
+ *  As inputs are handled a pass or more after they change, each frame carries the time
+ *  it was received on the motion clock (CAN_FRAME::ticks - see st_get_motion_ticks()).
+ *  The interrupt works it out from the controller's timestamp of the frame, so the wait
+ *  for the interrupt doesn't count either (see st_get_motion_ticks_ago()). Homing, probing and limit inputs take their
+ *  position snapshot for that time, back-interpolated from the runtime's step history
+ *  (see mp_get_runtime_steps_at()), so a CAN probe is as accurate at speed as a board one.
+ *  That holds while the input is handled within the history (about 15 ms at 1.5 ms
+ *  segments). Later than that it gets the oldest position kept.
+ */
+
+#define CAN_RX_BATCH 8                  // most frames handled per controller pass
+
+/*
+ * Sent frames
+ *
+ *  Frames are sent in one of three classes, each with its own TX mailbox and queue in the
+ *  driver (see hw_can_init()). When more than one mailbox is ready the controller sends
+ *  the higher class first, so a burst of output frames never holds up the servo targets,
+ *  and diagnostics wait for both. The bus itself still arbitrates by ID.
+ *
+ *  The motion class is only sent from the CSP interrupt (see canopen.h), and the others
+ *  only from the main loop, so no queue is written from two interrupt levels. The driver's
+ *  IRQ lock nests, so the CSP interrupt may still send while the main loop holds it.
+ *
+ *  CAN_FRAME_BITS() is the most bits a frame can take on the bus, with worst case bit
+ *  stuffing and the interframe space. It is used to budget the bus (see canopen_set_period()).
+ *
+ *  Output changes are not sent as they happen. can_digital_output() only records the new
+ *  state on its route, and can_tx_callback() sends each changed route once per controller
+ *  pass. So a run of M-codes switching outputs on one node goes out as one bitmap frame.
+ *  A route whose frame could not be queued is sent again on the next pass.
+ */
+
+#define CAN_FRAME_BITS(length, extended) ((extended) ? (67 + 8*(length) + (53 + 8*(length))/4) \
+                                                     : (47 + 8*(length) + (33 + 8*(length))/4))
+
+typedef enum {
+    CAN_TX_MOTION = 0,                  // servo targets and SYNC - CSP interrupt only
+    CAN_TX_IO,                          // digital outputs and drive start-up
+    CAN_TX_DIAGNOSTIC,                  // anything that can wait
+    CAN_TX_CLASSES
+} canTxClass;
+
+/*
+ * Routes
+ *
+ *  Frames are tied to GPIO channels by a table of routes, configured as groups cr1 - crN:
+ *
+ *    crNty - route type: 0=none, 1=input, 2=output
+ *    crNid - 29 bit CAN ID, read and written as a "0x..." data string (or a number)
+ *    crNmk - ID bits to compare. 0 compares them all. Use it to take a block of IDs
+ *    crNch - first channel: the di number for inputs, the do number for outputs
+ *    crNcn - number of channels. 1 is a single point in the first data byte (non-zero = on).
+ *            More than 1 is a bitmap - channel ch+i is bit i of the data, byte 0 first
+ *
+ *  e.g. {cr1:{ty:1,id:"0x180",mk:0,ch:9,cn:16}} takes 16 inputs, di9 - di24, from ID 0x180.
+ *
+ *  Input routes are found through a hash of the masked ID (can_route_rebuild()). Each
+ *  distinct mask in use costs one probe per frame, so a receive is O(1) in the number of
+ *  routes. Output routes are looked up by channel when an output changes. Where routes
+ *  overlap the lower numbered route wins.
+ */
+
+#define CAN_ROUTES              16      // number of configurable routes (cr1 - cr16)
+#define CAN_ROUTE_CHANNELS      32      // most channels in one route (a 4 byte bitmap)
+#define CAN_ROUTE_HASH_BITS     6       // hash has 2^bits slots - keep it at least twice CAN_ROUTES
+#define CAN_ROUTE_HASH_SIZE     (1 << CAN_ROUTE_HASH_BITS)
+#define CAN_ID_MASK             0x1FFFFFFF  // extended (29 bit) IDs
+
+typedef enum {
+    CAN_ROUTE_NONE = 0,                 // route is unused
+    CAN_ROUTE_INPUT,                    // frames with this ID set inputs
+    CAN_ROUTE_OUTPUT,                   // outputs are sent as frames with this ID
+    CAN_ROUTE_MAX
+} canRouteType;
+
+/*
+ * Statistics
+ *
+ *  The can group reports the bus health: frames received and queued per second, the RX
+ *  and TX ring high water marks, frames lost, error counts and bus off events. Each route
+ *  reports its own frame rate as crNrt. Rates are worked out every CAN_RATE_MS by
+ *  can_rx_callback(), so reading any of these (e.g. in a filtered status report) only
+ *  copies a value.
+ *  clcan clears the counts and high water marks.
+ */
+
+#define CAN_RATE_MS             1000    // rate update period
+
+typedef struct canRoute {
+    uint8_t type;                       // canRouteType
+    uint32_t id;                        // CAN ID
+    uint32_t mask;                      // ID bits compared - 0 means all of them
+    uint8_t channel;                    // first di or do number (1 based)
+    uint8_t count;                      // number of channels, 1 - CAN_ROUTE_CHANNELS
+    uint32_t out_bits;                  // output routes: last value of each channel...
+    bool out_changed;                   // ...and it has not been sent yet
+    uint32_t frames;                    // frames received or sent on the route...
+    uint32_t rate_frames;               // ...at the last rate update...
+    float rate;                         // ...and frames per second
+} canRoute_t;
+
+typedef struct canSingleton {
+    uint32_t rx_frames;                 // frames dispatched to can_message_received()
+    uint32_t rx_dropped;                // frames lost because the RX ring was full
+    uint32_t rx_overruns;               // frames lost in a mailbox
+    uint32_t rx_unrouted;               // frames that matched no input route
+    uint16_t rx_max_depth;              // most frames waiting at the start of a pass
+
+    uint32_t tx_frames[CAN_TX_CLASSES]; // frames queued in each class
+    uint32_t tx_full;                   // frames refused because their class queue was full
+    uint32_t out_changes;               // output changes recorded (see tx_frames[CAN_TX_IO])
+    volatile bool out_pending;          // an output route has changed since the last pass
+    uint16_t tx_max_depth;              // most frames waiting in a class queue
+
+    uint32_t bus_errors;                // CRC, stuffing, ack, form and bit errors
+    uint32_t bus_offs;                  // times the controller went bus off
+    uint8_t tx_error_count;             // transmit error counter (TEC)
+    uint8_t rx_error_count;             // receive error counter (REC)
+
+    float rx_rate;                      // frames received per second
+    float tx_queued_rate;               // frames queued per second - not all of them are sent yet
+    uint32_t rate_ms;                   // time of the last rate update
+    uint32_t rate_rx_frames;            // frame counts at the last rate update
+    uint32_t rate_tx_frames;
+
+    canRoute_t route[CAN_ROUTES];       // route table - written by the cr groups
+    int8_t hash[CAN_ROUTE_HASH_SIZE];   // input route index by masked ID, -1 = empty slot
+    uint32_t masks[CAN_ROUTES];         // distinct masks of the input routes...
+    uint8_t mask_count;                 // ...and how many there are
+} canSingleton_t;
+
+extern canSingleton_t can;
+
 typedef void(*ccb_t)(uint8_t*) ; // Can Callback Type
 
-void can_send_message (uint32_t id, uint8_t length, uint8_t *data);
+stat_t can_rx_callback(void);
+stat_t can_tx_callback(void);
+void can_route_rebuild(void);
+
+bool can_send_message (uint32_t id, uint8_t length, uint8_t *data, canTxClass tx_class);
+void can_message_received (uint32_t id, uint8_t length, uint8_t *data, uint32_t ticks);
 
 void can_digital_output(uint8_t, bool);
 
+stat_t can_set_ty(nvObj_t *nv);
+stat_t can_get_id(nvObj_t *nv);
+stat_t can_set_id(nvObj_t *nv);
+stat_t can_set_ch(nvObj_t *nv);
+stat_t can_set_cn(nvObj_t *nv);
+stat_t can_clcan(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void can_print_ty(nvObj_t *nv);
+    void can_print_id(nvObj_t *nv);
+    void can_print_mk(nvObj_t *nv);
+    void can_print_ch(nvObj_t *nv);
+    void can_print_cn(nvObj_t *nv);
+    void can_print_rt(nvObj_t *nv);
+#else
+    #define can_print_ty tx_print_stub
+    #define can_print_id tx_print_stub
+    #define can_print_mk tx_print_stub
+    #define can_print_ch tx_print_stub
+    #define can_print_cn tx_print_stub
+    #define can_print_rt tx_print_stub
+#endif
+
 #endif
 #endif
@@ -69,7 +69,8 @@
  *    - Call the cm_xxx_xxx() function which will do any input validation and return an
  *      error if it detects one.
  *
- *    - The cm_ function calls mp_queue_command(). Arguments are a callback to the _exec_...()
+ *    - The cm_ function calls cm_queue_command(), which queues any pending merged G1 ahead
+ *      of it and calls mp_queue_command(). Arguments are a callback to the _exec_...()
  *      function, which is the runtime execution routine, and any arguments that are needed
  *      by the runtime. See typedef for *exec in planner.h for details
  *
@@ -125,6 +126,13 @@ static void _exec_change_tool(float *value, bool *flag);
 static void _exec_select_tool(float *value, bool *flag);
 static void _exec_absolute_origin(float *value, bool *flag);
 static void _exec_program_finalize(float *value, bool *flag);
+#ifdef __COALESCE_LINES
+static bool _coalesce_fits(void);
+#endif
+static stat_t _coalesce_move(void);
+#ifdef __NATIVE_ARCS
+static stat_t _blend_corner(void);
+#endif
 
 static int8_t _get_axis(const index_t index);
 
@@ -220,11 +228,17 @@ cmCombinedState cm_get_combined_state()
 
 /*  These getters and setters will work on any gm model with inputs:
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
-uint32_t cm_get_linenum(const GCodeState_t *gcode_state) { return gcode_state->linenum;}
+uint32_t cm_get_linenum(const GCodeState_t *gcode_state)
+{
+    if (gcode_state == RUNTIME) {
+        return (mp_get_runtime_linenum());          // may be partway through a coalesced block
+    }
+    return (gcode_state->linenum);
+}
 cmMotionMode cm_get_motion_mode(const GCodeState_t *gcode_state) { return gcode_state->motion_mode;}
 uint8_t cm_get_coord_system(const GCodeState_t *gcode_state) { return gcode_state->coord_system;}
 uint8_t cm_get_units_mode(const GCodeState_t *gcode_state) { return gcode_state->units_mode;}
@@ -320,7 +334,7 @@ float cm_get_active_coord_offset(const uint8_t axis)
  * cm_get_work_offset() - return a coord offset from the gcode_state
  *
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
@@ -334,7 +348,7 @@ float cm_get_work_offset(const GCodeState_t *gcode_state, const uint8_t axis)
  * cm_set_work_offsets() - capture coord offsets from the model into absolute values in the gcode_state
  *
  *    MODEL         (GCodeState_t *)&cm.gm          // absolute pointer from canonical machine gm model
- *    PLANNER       (GCodeState_t *)&bf->gm         // relative to buffer *bf is currently pointing to
+ *    PLANNER       (GCodeState_t *)bf->gm          // relative to buffer *bf is currently pointing to
  *    RUNTIME       (GCodeState_t *)&mr.gm          // absolute pointer from runtime mm struct
  *    ACTIVE_MODEL   cm.am                          // active model pointer is maintained by state management
  */
@@ -451,6 +465,7 @@ stat_t cm_deferred_write_callback()
 /*
  * cm_set_tram() - JSON command to trigger computing the rotation matrix
  * cm_get_tram() - JSON query to determine if the rotation matrix is set (non-identity)
+ * cm_is_rotated() - true if the rotation matrix is set (non-identity)
  *
  * There MUST be three valid probes stored.
  */
@@ -555,9 +570,14 @@ stat_t cm_set_tram(nvObj_t *nv)
 
 stat_t cm_get_tram(nvObj_t *nv)
 {
-    nv->value = true;
+    nv->value = !cm_is_rotated();
+    nv->valuetype = TYPE_BOOL;
+    return (STAT_OK);
+}
 
-    if (fp_NOT_ZERO(cm.rotation_z_offset) ||
+bool cm_is_rotated()
+{
+    return (fp_NOT_ZERO(cm.rotation_z_offset) ||
         fp_NOT_ZERO(cm.rotation_matrix[0][1]) ||
         fp_NOT_ZERO(cm.rotation_matrix[0][2]) ||
         fp_NOT_ZERO(cm.rotation_matrix[1][0]) ||
@@ -566,12 +586,7 @@ stat_t cm_get_tram(nvObj_t *nv)
         fp_NOT_ZERO(cm.rotation_matrix[2][1]) ||
         fp_NE(1.0,  cm.rotation_matrix[0][0]) ||
         fp_NE(1.0,  cm.rotation_matrix[1][1]) ||
-        fp_NE(1.0,  cm.rotation_matrix[2][2]))
-    {
-        nv->value = false;
-    }
-    nv->valuetype = TYPE_BOOL;
-    return (STAT_OK);
+        fp_NE(1.0,  cm.rotation_matrix[2][2]));
 }
 
 
@@ -777,6 +792,7 @@ void canonical_machine_reset()
     cm_set_coord_system(cm.default_coord_system);   // NB: queues a block to the planner with the coordinates
     cm_select_plane(cm.default_select_plane);
     cm_set_path_control(MODEL, cm.default_path_control);
+    cm_set_path_tolerance(0, false);
     cm_set_distance_mode(cm.default_distance_mode);
     cm_set_arc_distance_mode(INCREMENTAL_DISTANCE_MODE);// always the default
     cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);       // always the default
@@ -1016,6 +1032,7 @@ stat_t cm_shutdown(const stat_t status, const char *msg)
 
     cm.machine_state = MACHINE_SHUTDOWN;        // do this after all other activity
     rpt_exception(status, msg);                 // send exception report
+    xio_tx_flush();                             // ...now, not at the end of the pass
     return (status);
 }
 
@@ -1044,6 +1061,7 @@ stat_t cm_panic(const stat_t status, const char *msg)
 
     cm.machine_state = MACHINE_PANIC;           // don't reset anything. Panics are not recoverable
     rpt_exception(status, msg);                 // send panic report
+    xio_tx_flush();                             // ...now, not at the end of the pass
     return (status);
 }
 
@@ -1191,7 +1209,7 @@ stat_t cm_set_tl_offset(const uint8_t H_word, const bool H_flag, const bool appl
     }
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };// pass coordinate system in value[0] element
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
+    cm_queue_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
     return (STAT_OK);
 }
 
@@ -1202,7 +1220,7 @@ stat_t cm_cancel_tl_offset()
     }
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };// pass coordinate system in value[0] element
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
+    cm_queue_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
     return (STAT_OK);
 }
 
@@ -1212,7 +1230,7 @@ stat_t cm_set_coord_system(const uint8_t coord_system)      // set coordinate sy
 
     float value[] = { (float)coord_system,0,0,0,0,0 };      // pass coordinate system in value[0] element
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);           // second vector (flags) is not used, so fake it
+    cm_queue_command(_exec_offset, value, flags);           // second vector (flags) is not used, so fake it
     return (STAT_OK);
 }
 
@@ -1285,7 +1303,7 @@ stat_t cm_set_absolute_origin(const float origin[], bool flag[])
             mp_set_planner_position(axis, value[axis]); // set mm position
         }
     }
-    mp_queue_command(_exec_absolute_origin, value, flag);
+    cm_queue_command(_exec_absolute_origin, value, flag);
     return (STAT_OK);
 }
 
@@ -1325,7 +1343,7 @@ stat_t cm_set_origin_offsets(const float offset[], const bool flag[])
     // now pass the offset to the callback - setting the coordinate system also applies the offsets
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 }; // pass coordinate system in value[0] element
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);
+    cm_queue_command(_exec_offset, value, flags);
     return (STAT_OK);
 }
 
@@ -1337,7 +1355,7 @@ stat_t cm_reset_origin_offsets()
     }
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);
+    cm_queue_command(_exec_offset, value, flags);
     return (STAT_OK);
 }
 
@@ -1346,7 +1364,7 @@ stat_t cm_suspend_origin_offsets()
     cm.gmx.origin_offset_enable = false;
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);
+    cm_queue_command(_exec_offset, value, flags);
     return (STAT_OK);
 }
 
@@ -1355,7 +1373,7 @@ stat_t cm_resume_origin_offsets()
     cm.gmx.origin_offset_enable = true;
     float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_offset, value, flags);
+    cm_queue_command(_exec_offset, value, flags);
     return (STAT_OK);
 }
 
@@ -1379,6 +1397,7 @@ stat_t cm_straight_traverse(const float target[], const bool flags[])
     ritorno (cm_test_soft_limits(cm.gm.target));    // test soft limits; exit if thrown
     cm_set_work_offsets(&cm.gm);                    // capture the fully resolved offsets to the state
     cm_cycle_start();                               // required for homing & other cycles
+    cm_flush_coalesced_move();                      // a pending G1 must be queued ahead of this
     stat_t status = mp_aline(&cm.gm);               // send the move to the planner
     cm_finalize_move();
 
@@ -1498,6 +1517,27 @@ stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode)
     return (STAT_OK);
 }
 
+/*
+ * cm_set_path_tolerance() - G64 P (affects MODEL only)
+ *
+ *  P is the largest distance a blended corner may stray from the programmed corner, in
+ *  the prevailing units. G64 without P (or P0) turns corner blending off again.
+ *  See _blend_corner() for how it is used.
+ */
+
+stat_t cm_set_path_tolerance(const float P_word, const bool P_flag)
+{
+    if (!P_flag) {
+        cm.gmx.path_tolerance = 0;
+        return (STAT_OK);
+    }
+    if (P_word < 0) {
+        return (STAT_P_WORD_IS_NEGATIVE);
+    }
+    cm.gmx.path_tolerance = _to_millimeters(P_word);
+    return (STAT_OK);
+}
+
 
 /*******************************
  * Machining Functions (4.3.6) *
@@ -1513,6 +1553,7 @@ stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode)
 stat_t cm_dwell(const float seconds)
 {
     cm.gm.parameter = seconds;
+    cm_flush_coalesced_move();
     mp_dwell(seconds);
     return (STAT_OK);
 }
@@ -1536,6 +1577,17 @@ stat_t cm_straight_feed(const float target[], const bool flags[])
     ritorno (cm_test_soft_limits(cm.gm.target));    // test soft limits; exit if thrown
     cm_set_work_offsets(&cm.gm);                    // capture the fully resolved offsets to the state
     cm_cycle_start();                               // required for homing & other cycles
+
+    bool blending = (cm.gm.path_control == PATH_CONTINUOUS) && fp_NOT_ZERO(cm.gmx.path_tolerance);
+#ifdef __COALESCE_LINES
+    blending = blending || fp_NOT_ZERO(cm.coalesce_tolerance);
+#endif
+    if (blending && (cm.cycle_state == CYCLE_MACHINING)) {
+        stat_t status = _coalesce_move();           // merge or blend the move, or hold it for either
+        cm_finalize_move();
+        return (status);
+    }
+    cm_flush_coalesced_move();                      // a pending G1 must be queued ahead of this
     stat_t status = mp_aline(&cm.gm);               // send the move to the planner
 
     cm_finalize_move(); // <-- ONLY safe because we don't care about status...
@@ -1549,6 +1601,329 @@ stat_t cm_straight_feed(const float target[], const bool flags[])
     return (status);
 }
 
+/*
+ * Collinear move coalescing
+ *
+ * cm_flush_coalesced_move()  - queue the pending merged move to the planner
+ * cm_abort_coalesced_move()  - discard the pending merged move (queue flush)
+ * cm_queue_command()         - queue a synchronous command behind the pending merged move
+ * cm_coalesce_callback()     - main-loop callback to flush a pending move that has waited long enough
+ * _coalesce_move()           - merge the G1 in cm.gm into the pending move, or start a new one
+ * _coalesce_fits()           - test if the pending points lie within tolerance of a new chord
+ * _blend_corner()            - replace the corner between the pending move and cm.gm with an arc
+ *
+ *  CAM output often has long runs of sub-millimeter, nearly collinear G1s. Each of these
+ *  costs a full planner block, and enough of them fill the planner horizon with a few
+ *  millimeters of motion. When the coalescing tolerance ({clt:}) is non-zero G1 feeds in
+ *  a machining cycle are not queued directly. Instead, consecutive feeds with the same
+ *  feed rate and modes are merged into a single pending move for as long as every
+ *  intermediate endpoint lies within the tolerance of the straight chord from the start
+ *  of the first line to the end of the last, and no more than COALESCE_LINES_MAX lines
+ *  have been merged. The pending move is queued when a line doesn't fit, before any other
+ *  block enters the planner (the cm_ functions that queue moves, dwells and waits flush it
+ *  first, and cm_queue_command() does for the many M code callers), and from the main loop
+ *  once the runtime has nothing else to run or no line has arrived for COALESCE_TIMEOUT_MS.
+ *  A queue flush discards it along with the rest of the planner.
+ *
+ *  Merging is compiled in with __COALESCE_LINES, as the line number marks enlarge every
+ *  GCodeState_t. Without it {clt:} doesn't exist and only G64 P blending holds moves back.
+ *
+ *  Line numbers: the merged block carries the line number of its last line in gm.linenum
+ *  and a mark for each earlier line - its offset back from linenum and the length left in
+ *  the move when that line ends. mp_get_runtime_linenum() compares the length left in the
+ *  running block to the marks so status reports step through the original line numbers.
+ *  Marks are measured from the end of the move so they remain valid if a feedhold trims
+ *  the front of the block.
+ *
+ *  Model position (gmx.position) is updated for every line as it is merged, so the model
+ *  does not know or care that the planner is behind by one pending move.
+ *
+ *  The same pending move is used for G64 P corner blending, which holds G1 feeds back even
+ *  if coalescing is off. See _blend_corner().
+ */
+
+#ifdef __COALESCE_LINES
+static bool _coalesce_fits()
+{
+    cmCoalesce_t *co = &cm.co;
+    float chord[AXES];
+    float length_square = 0;
+
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        chord[axis] = cm.gm.target[axis] - co->start[axis];
+        length_square += square(chord[axis]);
+    }
+    if (length_square < EPSILON) {
+        return (false);
+    }
+    float length = sqrt(length_square);
+    float tolerance_square = square(cm.coalesce_tolerance);
+    float last_travel = 0;
+
+    // the old endpoint (gm.target) becomes the last of the intermediate points
+    for (uint8_t i=0; i<co->lines; i++) {
+        const float *point = (i < co->lines-1) ? co->point[i] : co->gm.target;
+        float travel = 0;           // distance along the chord
+        float offset_square = 0;    // distance from the start, squared
+        for (uint8_t axis=0; axis<AXES; axis++) {
+            float d = point[axis] - co->start[axis];
+            travel += d * chord[axis];
+            offset_square += square(d);
+        }
+        travel /= length;
+        if ((travel < last_travel) || (travel > length)) {  // must progress along the chord
+            return (false);
+        }
+        if ((offset_square - square(travel)) > tolerance_square) {
+            return (false);
+        }
+        last_travel = travel;
+    }
+    return (true);
+}
+#endif
+
+static stat_t _coalesce_move()
+{
+    cmCoalesce_t *co = &cm.co;
+
+    if (co->pending) {
+#ifdef __COALESCE_LINES
+        uint32_t first_linenum = (co->lines > 1) ? co->linenum[0] : co->gm.linenum;
+        bool same_state = (co->lines < COALESCE_LINES_MAX) &&
+                          (cm.gm.feed_rate_mode != INVERSE_TIME_MODE) &&
+                          (cm.gm.path_control != PATH_EXACT_STOP) &&
+                          (cm.gm.feed_rate == co->gm.feed_rate) &&
+                          (cm.gm.feed_rate_mode == co->gm.feed_rate_mode) &&
+                          (cm.gm.path_control == co->gm.path_control) &&
+                          (cm.gm.tool == co->gm.tool) &&
+                          (cm.gm.linenum >= co->gm.linenum) &&
+                          (cm.gm.linenum - first_linenum < 0xFFFF) &&   // must fit the 16 bit line deltas
+                          (memcmp(cm.gm.work_offset, co->gm.work_offset, sizeof(co->gm.work_offset)) == 0);
+
+        if (same_state && fp_NOT_ZERO(cm.coalesce_tolerance) && _coalesce_fits()) {
+            copy_vector(co->point[co->lines-1], co->gm.target);
+            co->linenum[co->lines-1] = co->gm.linenum;
+            co->lines++;
+            co->gm = cm.gm;
+            co->timeout.set(COALESCE_TIMEOUT_MS);
+            co->lines_merged++;
+            return (STAT_OK);
+        }
+#endif
+#ifdef __NATIVE_ARCS
+        stat_t status = _blend_corner();
+        if (status != STAT_NOOP) {
+            return (status);
+        }
+#endif
+        ritorno(cm_flush_coalesced_move());
+    }
+    copy_vector(co->start, cm.gmx.position);        // the previous line ended at the model position
+    co->gm = cm.gm;
+    co->lines = 1;
+    co->trimmed = 0;
+    co->pending = true;
+    co->timeout.set(COALESCE_TIMEOUT_MS);
+    return (STAT_OK);
+}
+
+#ifdef __NATIVE_ARCS
+/*
+ * _blend_corner() - G64 P corner blending
+ *
+ *  The planner can only slow down for a corner (see _calculate_junction_vmax()). With
+ *  G64 P<tolerance> in effect the corner between the pending move and the new G1 in cm.gm
+ *  is cut instead: the end of the pending move and the start of the new line are trimmed
+ *  back and an arc block tangent to both is queued between them. The arc is sized so it
+ *  stays within the tolerance of the programmed corner, and mp_arc() limits its velocity
+ *  with the same jerk and junction integration time terms used for junctions and arcs.
+ *  Both ends of the arc are tangent, so the junctions on either side don't slow down.
+ *
+ *  The arc lies in the selected plane (G17/G18/G19). Motion on other axes is carried
+ *  through the arc linearly, and its deviation from the corner is counted against the
+ *  tolerance too. A line gives up at most half its length to each of its corners, so
+ *  short CAM segments get proportionally smaller blends.
+ *
+ *  Returns STAT_NOOP if the corner can't be blended (the caller then queues the pending
+ *  move as-is), otherwise the status of queuing the trimmed move and the arc. On success
+ *  the rest of the new line becomes the pending move.
+ */
+
+static stat_t _blend_corner()
+{
+    cmCoalesce_t *co = &cm.co;
+    uint8_t axis_0, axis_1;
+
+    if ((co->gm.path_control != PATH_CONTINUOUS) || (cm.gm.path_control != PATH_CONTINUOUS) ||
+        fp_ZERO(cm.gmx.path_tolerance) || (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) ||
+        (co->gm.feed_rate_mode == INVERSE_TIME_MODE) || cm_is_rotated()) {
+        return (STAT_NOOP);
+    }
+    if (cm.gm.select_plane == CANON_PLANE_XY) {
+        axis_0 = AXIS_X; axis_1 = AXIS_Y;
+    } else if (cm.gm.select_plane == CANON_PLANE_XZ) {
+        axis_0 = AXIS_X; axis_1 = AXIS_Z;
+    } else {
+        axis_0 = AXIS_Y; axis_1 = AXIS_Z;
+    }
+
+    // unit vectors of the two moves and their in-plane parts
+    const float *corner = co->gm.target;
+    float u1[AXES], u2[AXES];
+    float length_1 = get_axis_vector_length(corner, co->start);
+    float length_2 = get_axis_vector_length(cm.gm.target, corner);
+    if ((length_1 < EPSILON) || (length_2 < EPSILON)) {
+        return (STAT_NOOP);
+    }
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        u1[axis] = (corner[axis] - co->start[axis]) / length_1;
+        u2[axis] = (cm.gm.target[axis] - corner[axis]) / length_2;
+    }
+    float planar_1 = hypotf(u1[axis_0], u1[axis_1]);
+    float planar_2 = hypotf(u2[axis_0], u2[axis_1]);
+    if ((planar_1 < 0.5) || (planar_2 < 0.5)) {     // mostly out of plane - leave it as a junction
+        return (STAT_NOOP);
+    }
+    float p1_0 = u1[axis_0] / planar_1, p1_1 = u1[axis_1] / planar_1;
+    float p2_0 = u2[axis_0] / planar_2, p2_1 = u2[axis_1] / planar_2;
+    float cos_turn = p1_0 * p2_0 + p1_1 * p2_1;
+    float cross = p1_0 * p2_1 - p1_1 * p2_0;
+    if ((cos_turn > 0.9999995) || (cos_turn < -0.999)) {   // straight on, or a reversal
+        return (STAT_NOOP);
+    }
+    float turn = acos(cos_turn);                    // angle between the moves in the plane
+    float tan_half = tan(turn/2);
+
+    // Deviation per unit of in-plane trim: the arc's distance from the corner, plus how far
+    // out-of-plane motion carried linearly through the arc misses the corner.
+    float arc_deviation = (1/cos(turn/2) - 1) / tan_half;
+    float linear_deviation = 0;
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        if ((axis != axis_0) && (axis != axis_1)) {
+            linear_deviation += square(u2[axis]/planar_2 - u1[axis]/planar_1);
+        }
+    }
+    linear_deviation = sqrt(linear_deviation) / 2;
+
+    // in-plane trim - limited by the tolerance and by half of each line
+    float trim = cm.gmx.path_tolerance / (arc_deviation + linear_deviation);
+    trim = min3(trim, planar_1 * (length_1 + co->trimmed) / 2, planar_2 * length_2 / 2);
+    if (trim < EPSILON3) {
+        return (STAT_NOOP);
+    }
+    float trim_1 = trim / planar_1;                 // trim along each line
+    float trim_2 = trim / planar_2;
+
+    mpArcBuf_t arc_block;
+    float arc_start[AXES];                          // the pending move is trimmed to here
+    GCodeState_t blend_gm = co->gm;
+#ifdef __COALESCE_LINES
+    blend_gm.line_marks = 0;
+#endif
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        blend_gm.target[axis] = corner[axis] + u2[axis] * trim_2;
+        arc_start[axis] = corner[axis] - u1[axis] * trim_1;
+    }
+    arc_block.plane_axis_0 = axis_0;
+    arc_block.plane_axis_1 = axis_1;
+    arc_block.linear_axis = 3 - axis_0 - axis_1;
+    arc_block.blend = true;
+    arc_block.radius = trim / tan_half;
+    arc_block.radius_travel = 0;
+    if (cross > 0) {                                // counterclockwise - center is to the left
+        arc_block.center_0 = arc_start[axis_0] - p1_1 * arc_block.radius;
+        arc_block.center_1 = arc_start[axis_1] + p1_0 * arc_block.radius;
+        arc_block.angular_travel = -turn;
+    } else {
+        arc_block.center_0 = arc_start[axis_0] + p1_1 * arc_block.radius;
+        arc_block.center_1 = arc_start[axis_1] - p1_0 * arc_block.radius;
+        arc_block.angular_travel = turn;
+    }
+    arc_block.theta = atan2(arc_start[axis_0] - arc_block.center_0, arc_start[axis_1] - arc_block.center_1);
+
+    copy_vector(co->gm.target, arc_start);          // nothing can reject the blend past here
+    ritorno(cm_flush_coalesced_move());             // the trimmed pending move
+    stat_t status = mp_arc(&blend_gm, &arc_block);
+    if ((status != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+        return (status);
+    }
+    co->corners_blended++;
+
+    copy_vector(co->start, blend_gm.target);        // the rest of the new line is pending
+    co->gm = cm.gm;
+    co->lines = 1;
+    co->trimmed = trim_2;
+    co->pending = true;
+    co->timeout.set(COALESCE_TIMEOUT_MS);
+    return (STAT_OK);
+}
+#endif
+
+stat_t cm_flush_coalesced_move()
+{
+    cmCoalesce_t *co = &cm.co;
+
+    if (!co->pending) {
+        return (STAT_NOOP);
+    }
+    co->pending = false;
+    co->timeout.clear();
+
+#ifdef __COALESCE_LINES
+    // mark where each line ends, measured as length left in the move
+    float length_square = 0;
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        length_square += square(co->gm.target[axis] - co->start[axis]);
+    }
+    float length = sqrt(length_square);
+    co->gm.line_marks = co->lines - 1;
+    for (uint8_t i=0; i<co->gm.line_marks; i++) {
+        float travel = 0;
+        for (uint8_t axis=0; axis<AXES; axis++) {
+            travel += (co->point[i][axis] - co->start[axis]) * (co->gm.target[axis] - co->start[axis]);
+        }
+        co->gm.line_remaining[i] = length - (travel / length);
+        co->gm.line_delta[i] = (uint16_t)(co->gm.linenum - co->linenum[i]);
+    }
+#endif
+
+    stat_t status = mp_aline(&co->gm);
+    if (status == STAT_MINIMUM_LENGTH_MOVE) {
+        if (!mp_has_runnable_buffer()) {            // handle condition where zero-length move is last or only move
+            cm_cycle_end();                         // ...otherwise cycle will not end properly
+        }
+        status = STAT_OK;
+    }
+    return (status);
+}
+
+void cm_abort_coalesced_move()
+{
+    cm.co.pending = false;
+    cm.co.timeout.clear();
+}
+
+void cm_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
+{
+    cm_flush_coalesced_move();                      // a pending merged G1 must be queued ahead of this
+    mp_queue_command(cm_exec, value, flag);
+}
+
+stat_t cm_coalesce_callback()
+{
+    if (!cm.co.pending) {
+        return (STAT_NOOP);
+    }
+    if (!mp_has_runnable_buffer() || cm.co.timeout.isPast()) {
+        if (mp_planner_is_full()) {
+            return (STAT_EAGAIN);
+        }
+        return (cm_flush_coalesced_move());
+    }
+    return (STAT_OK);
+}
+
 /*****************************
  * Spindle Functions (4.3.7) *
  *****************************/
@@ -1574,7 +1949,7 @@ stat_t cm_select_tool(const uint8_t tool_select)
     }
     float value[] = { (float)tool_select, 0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_select_tool, value, flags);
+    cm_queue_command(_exec_select_tool, value, flags);
     return (STAT_OK);
 }
 
@@ -1587,7 +1962,7 @@ stat_t cm_change_tool(const uint8_t tool_change)
 {
     float value[] = { (float)cm.gm.tool_select,0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_change_tool, value, flags);
+    cm_queue_command(_exec_change_tool, value, flags);
     return (STAT_OK);
 }
 
@@ -2062,21 +2437,21 @@ void cm_program_stop()
 {
     float value[] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_program_finalize, value, flags);
+    cm_queue_command(_exec_program_finalize, value, flags);
 }
 
 void cm_optional_program_stop()
 {
     float value[] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_program_finalize, value, flags);
+    cm_queue_command(_exec_program_finalize, value, flags);
 }
 
 void cm_program_end()
 {
     float value[] = { (float)MACHINE_PROGRAM_END, 0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_program_finalize, value, flags);
+    cm_queue_command(_exec_program_finalize, value, flags);
 }
 
 
@@ -2085,6 +2460,7 @@ void cm_program_end()
  */
 stat_t cm_json_command(char *json_string)
 {
+    cm_flush_coalesced_move();
     return mp_json_command(json_string);
 }
 
@@ -2101,6 +2477,7 @@ stat_t cm_json_command_immediate(char *json_string)
  */
 stat_t cm_json_wait(char *json_string)
 {
+    cm_flush_coalesced_move();
     return mp_json_wait(json_string);
 }
 
@@ -2416,7 +2793,7 @@ stat_t cm_get_vel(nvObj_t *nv)
     if (cm_get_motion_state() == MOTION_STOP) {
         nv->value = 0;
     } else {
-        nv->value = mp_get_runtime_velocity();
+        nv->value = mp_get_runtime_velocity() * mp_get_runtime_time_scale();
         if (cm_get_units_mode(RUNTIME) == INCHES) {
             nv->value *= INCHES_PER_MM;
         }
@@ -2648,6 +3025,9 @@ stat_t cm_set_mfo(nvObj_t *nv)
         return (STAT_INPUT_EXCEEDS_MAX_VALUE);
     }
     set_flt(nv);
+    if (cm.gmx.m48_enable && cm.gmx.mfo_enable) {  // apply it now if the override is on (the knob)
+        mp_start_feed_override(FEED_OVERRIDE_RAMP_TIME, cm.gmx.mfo_factor);
+    }
     return(STAT_OK);
 }
 
@@ -2820,12 +3200,14 @@ void cm_print_gdi(nvObj_t *nv) { text_print(nv, fmt_gdi);}  // TYPE_INT
 
 static const char fmt_jt[] = "[jt]  junction integrgation time%6.2f\n";
 static const char fmt_ct[] = "[ct]  chordal tolerance%17.4f%s\n";
+static const char fmt_clt[] ="[clt] line coalescing tolerance%9.4f%s\n";
 static const char fmt_sl[] = "[sl]  soft limit enable%12d [0=disable,1=enable]\n";
 static const char fmt_lim[] ="[lim] limit switch enable%10d [0=disable,1=enable]\n";
 static const char fmt_saf[] ="[saf] safety interlock enable%6d [0=disable,1=enable]\n";
 
 void cm_print_jt(nvObj_t *nv) { text_print(nv, fmt_jt);}        // TYPE FLOAT
 void cm_print_ct(nvObj_t *nv) { text_print_flt_units(nv, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_clt(nvObj_t *nv){ text_print_flt_units(nv, fmt_clt, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_sl(nvObj_t *nv) { text_print(nv, fmt_sl);}        // TYPE_INT
 void cm_print_lim(nvObj_t *nv){ text_print(nv, fmt_lim);}       // TYPE_INT
 void cm_print_saf(nvObj_t *nv){ text_print(nv, fmt_saf);}       // TYPE_INT
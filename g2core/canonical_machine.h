@@ -43,7 +43,7 @@
 /* Defines, Macros, and Assorted Parameters */
 
 #define MODEL   (GCodeState_t *)&cm.gm      // absolute pointer from canonical machine gm model
-#define PLANNER (GCodeState_t *)&bf->gm     // relative to buffer *bf is currently pointing to
+#define PLANNER (GCodeState_t *)bf->gm      // relative to buffer *bf is currently pointing to
 #define RUNTIME (GCodeState_t *)&mr.gm      // absolute pointer from runtime mm struct
 #define ACTIVE_MODEL cm.am                  // active model pointer is maintained by state management
 
@@ -55,6 +55,10 @@
 #define JERK_INPUT_MAX (1000000)            // maximum allowable jerk setting in millions mm/min^3
 #define PROBES_STORED 3                     // we store three probes for coordinate rotation computation
 
+#define COALESCE_LINES_MAX 8                // max G1 lines merged into a single planner block
+#define COALESCE_MARKS (COALESCE_LINES_MAX-1)   // line number marks carried by a merged block
+#define COALESCE_TIMEOUT_MS ((float)10.0)   // MS to hold a pending merged move waiting for more lines
+
 
 /*****************************************************************************
  * MACHINE STATE MODEL
@@ -288,7 +292,6 @@ typedef struct GCodeState {             // Gcode model state - used by model, pl
                                         // G82, G83 G84, G85, G86, G87, G88, G89
 
     float target[AXES];                 // XYZABC where the move should go
-    float target_comp[AXES];            // summation compensation (Kahan) overflow value
     float work_offset[AXES];            // offset from the work coordinate system (for reporting only)
 
     float feed_rate;                    // F - normalized to millimeters/minute or in inverse time mode
@@ -305,6 +308,12 @@ typedef struct GCodeState {             // Gcode model state - used by model, pl
     uint8_t tool;               // G    // M6 tool change - moves "tool_select" to "tool"
     uint8_t tool_select;        // G    // T value - T sets this value
 
+#ifdef __COALESCE_LINES
+    uint8_t line_marks;                 // number of coalesced lines ahead of linenum (0 = none)
+    uint16_t line_delta[COALESCE_MARKS];    // linenum minus the line number of each coalesced line
+    float line_remaining[COALESCE_MARKS];   // length left in the move when that line ends
+#endif
+
     void reset() {
         linenum = 0;
         motion_mode = MOTION_MODE_STRAIGHT_TRAVERSE;
@@ -327,6 +336,9 @@ typedef struct GCodeState {             // Gcode model state - used by model, pl
         coord_system = ABSOLUTE_COORDS;
         tool = 1;
         tool_select = 1;
+#ifdef __COALESCE_LINES
+        line_marks = 0;
+#endif
     };
 } GCodeState_t;
 
@@ -347,6 +359,7 @@ typedef struct GCodeStateExtended {     // Gcode dynamic state extensions - used
     float mto_factor;                   // valid from 0.05 to 1.00
 
     bool origin_offset_enable;          // G92 offsets enabled/disabled.  0=disabled, 1=enabled
+    float path_tolerance;               // G64 P - max corner blending deviation in mm (0 = no blending)
     bool block_delete_switch;           // set true to enable block deletes (true is default)
 
 // unimplemented gcode parameters
@@ -359,6 +372,24 @@ typedef struct GCodeStateExtended {     // Gcode dynamic state extensions - used
 
 } GCodeStateX_t;
 
+typedef struct cmCoalesce {             // collinear G1 move coalescing (see cm_straight_feed())
+    bool pending;                       // true if a merged move is waiting to be queued
+    uint8_t lines;                      // number of G1 lines in the pending move
+    GCodeState_t gm;                    // Gcode state of the pending move (target is the latest endpoint)
+    float start[AXES];                  // start position of the pending move
+#ifdef __COALESCE_LINES
+    float point[COALESCE_MARKS][AXES];  // endpoints of the lines ahead of gm.target
+    uint32_t linenum[COALESCE_MARKS];   // line numbers of the lines ahead of gm.target
+#endif
+    float trimmed;                      // length taken off the start of the first line by a corner blend
+    Motate::Timeout timeout;            // flush the pending move if no more lines arrive
+
+#ifdef __COALESCE_LINES
+    uint32_t lines_merged;              // diagnostic: G1 lines that did not need their own block
+#endif
+    uint32_t corners_blended;           // diagnostic: G64 P corners replaced by blend arcs
+} cmCoalesce_t;
+
 /*****************************************************************************
  * CANONICAL MACHINE STRUCTURES
  */
@@ -394,6 +425,9 @@ typedef struct cmSingleton {                // struct to manage cm globals and c
     // system group settings
     float junction_integration_time;        // how aggressively will the machine corner? 1.6 or so is about the upper limit
     float chordal_tolerance;                // arc chordal accuracy setting in mm
+#ifdef __COALESCE_LINES
+    float coalesce_tolerance;               // max deviation for merging G1 lines in mm (0 = off)
+#endif
     bool soft_limit_enable;                 // true to enable soft limit testing on Gcode inputs
     bool limit_enable;                      // true to enable limit switches (disabled is same as override)
     bool safety_interlock_enable;           // true to enable safety interlock system
@@ -450,6 +484,8 @@ typedef struct cmSingleton {                // struct to manage cm globals and c
     uint8_t limit_requested;                // set non-zero to request limit switch processing (value is input number)
     uint8_t shutdown_requested;             // set non-zero to request shutdown in support of external estop (value is input number)
 
+    cmCoalesce_t co;                        // G1 move coalescing stage ahead of the planner
+
   /**** Model states ****/
     GCodeState_t *am;                       // active Gcode model is maintained by state management
     GCodeState_t  gm;                       // core gcode model state
@@ -575,9 +611,14 @@ stat_t cm_goto_g30_position(const float target[], const bool flags[]);      // G
 stat_t cm_set_feed_rate(const float feed_rate);                             // F parameter
 stat_t cm_set_feed_rate_mode(const uint8_t mode);                           // G93, G94, (G95 unimplemented)
 stat_t cm_set_path_control(GCodeState_t *gcode_state, const uint8_t mode);  // G61, G61.1, G64
+stat_t cm_set_path_tolerance(const float P_word, const bool P_flag);        // G64 P
 
 // Machining Functions (4.3.6)
 stat_t cm_straight_feed(const float target[], const bool flags[]);          // G1
+stat_t cm_flush_coalesced_move(void);                                       // queue any pending merged G1
+void cm_abort_coalesced_move(void);                                         // discard any pending merged G1
+void cm_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag);   // queue a command behind it
+stat_t cm_coalesce_callback(void);                                          // main loop flush of merged G1s
 stat_t cm_dwell(const float seconds);                                       // G4, P parameter
 
 stat_t cm_arc_feed(const float target[], const bool target_f[],             // G2/G3 - target endpoint
@@ -706,6 +747,7 @@ stat_t cm_set_mto(nvObj_t *nv);         // set manual traverse override factor
 
 stat_t cm_set_tram(nvObj_t *nv);        // attempt setting the rotation matrix
 stat_t cm_get_tram(nvObj_t *nv);        // return if the rotation matrix is non-identity
+bool cm_is_rotated(void);                // true if the rotation matrix is non-identity
 
 stat_t cm_set_nxln(nvObj_t *nv);    // set what value we expect the next line number to have
 stat_t cm_get_nxln(nvObj_t *nv);    // return what value we expect the next line number to have
@@ -749,6 +791,7 @@ stat_t cm_get_nxln(nvObj_t *nv);    // return what value we expect the next line
 
     void cm_print_jt(nvObj_t *nv);          // global CM settings
     void cm_print_ct(nvObj_t *nv);
+    void cm_print_clt(nvObj_t *nv);
     void cm_print_sl(nvObj_t *nv);
     void cm_print_lim(nvObj_t *nv);
     void cm_print_saf(nvObj_t *nv);
@@ -816,6 +859,7 @@ stat_t cm_get_nxln(nvObj_t *nv);    // return what value we expect the next line
 
     #define cm_print_jt tx_print_stub       // global CM settings
     #define cm_print_ct tx_print_stub
+    #define cm_print_clt tx_print_stub
     #define cm_print_sl tx_print_stub
     #define cm_print_lim tx_print_stub
     #define cm_print_saf tx_print_stub
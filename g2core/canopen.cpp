@@ -0,0 +1,420 @@
+/*
+ * canopen.cpp - CANopen CiA-402 servo drives in cyclic synchronous position mode
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*  See canopen.h for a description of this module.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "canopen.h"
+#include "can_bus.h"
+#include "canonical_machine.h"
+#include "stepper.h"
+#include "report.h"
+#include "text_parser.h"
+#include "util.h"
+
+#ifdef CAN_ENABLED
+
+/**** Allocate Structures ****/
+
+canopenSingleton_t canopen;
+
+using namespace Motate;
+
+csp_timer_type csp_timer;               // CSP interpolation period
+#define CSP_INTERRUPTS (kInterruptOnOverflow | kInterruptPriorityHigh)
+
+/**** Local Functions ****/
+
+static uint32_t _shortest_period_us(void);
+static void _start(canDrive_t *d);
+static bool _send_target(canDrive_t *d, const double target);
+static void _drive_status(canDrive_t *d, const uint16_t statusword, const int32_t actual);
+static uint16_t _next_controlword(const canDrive_t *d);
+static void _csp_lock(void);
+static void _csp_release(void);
+
+/************************************************************************************
+ **** CODE **************************************************************************
+ ************************************************************************************/
+
+/*
+ * canopen_register() - add a drive to the bus. Called by the GeratechServo constructor.
+ *
+ *  Drives are registered during static construction, so this must not depend on any
+ *  other initialization. canopen is zeroed before any constructor runs.
+ */
+
+void canopen_register(canDrive_t *d)
+{
+    if (canopen.drives >= CANOPEN_DRIVES) {
+        return;
+    }
+    d->start_ms = (uint32_t)-CANOPEN_START_MS;  // so the first start attempt is not delayed
+    d->controlword = CIA402_CW_SHUTDOWN;
+    canopen.drive[canopen.drives++] = d;
+}
+
+/*
+ * canopen_init() - start the CSP interrupt. Called once the CAN driver is up.
+ *
+ *  If the configured period was refused (see canopen_set_period()) the shortest period
+ *  that fits is used instead, and reported.
+ */
+
+void canopen_init()
+{
+    if (canopen.drives == 0) {
+        return;
+    }
+    if (canopen.period_us == 0) {
+        canopen.period_us = _shortest_period_us();
+        char msg[40];
+        sprintf(msg, "CSP period set to %lu us", (unsigned long)canopen.period_us);
+        rpt_exception(STAT_CAN_BUS_OVERLOAD, msg);
+    }
+    csp_timer.setModeAndFrequency(kTimerUpToMatch, 1000000 / canopen.period_us);
+    csp_timer.setInterrupts(CSP_INTERRUPTS);
+    csp_timer.start();
+    canopen.running = true;
+}
+
+/*
+ * canopen_enable() - power the drive up or down. Called from the motor enable/disable.
+ *
+ *  Only sets the request. It is cheap as the loader enables the motors every segment.
+ *  The drive is taken through its state machine as its statuswords arrive.
+ */
+
+void canopen_enable(canDrive_t *d, const bool enable)
+{
+    if (d->enable != enable) {
+        d->enable = enable;
+        d->controlword = _next_controlword(d);
+    }
+}
+
+/*
+ * canopen_load() - take the drive's travel for the segment being loaded
+ *
+ *  Called by the loader for every line segment, including those the motor does not
+ *  move in, with the travel in steps (CW positive). Nothing is sent - the CSP interrupt
+ *  interpolates in the segment from its start to its end.
+ */
+
+void canopen_load(canDrive_t *d, const float travel_steps)
+{
+    d->segment_start = d->target;
+    d->target += travel_steps;
+}
+
+/*
+ * canopen_read_position() - return the drive position in steps, if it has reported one
+ */
+
+bool canopen_read_position(canDrive_t *d, int32_t &steps)
+{
+    if (!d->measured_valid) {
+        return (false);
+    }
+    steps = (int32_t)lround(d->segment_start) + d->following;
+    return (true);
+}
+
+/*
+ * csp_timer interrupt - send every drive its target, then a SYNC, once a period
+ *
+ *  The targets are the drives' positions on the motion clock now. The loader may load a
+ *  segment while they are worked out, so they are worked out again if it did (as in
+ *  st_get_motion_ticks()). Between segments, and while no segment runs, the motion clock
+ *  stands at the end of the last one and the drives hold there.
+ *
+ *  If a frame is refused no SYNC is sent. Targets only take effect at a SYNC, so each
+ *  drive holds the last target it applied, and the next period sends them all again.
+ */
+
+namespace Motate {    // Define timer inside Motate namespace
+    template<>
+    void csp_timer_type::interrupt()
+    {
+        csp_timer.getInterruptCause();                  // clears the interrupt condition
+
+        double target[CANOPEN_DRIVES];
+        uint32_t loaded;
+        do {
+            loaded = st_get_segments_loaded();
+            const uint32_t end = st_get_segment_ticks(loaded);
+            const uint32_t length = end - st_get_segment_ticks(loaded-1);
+            const uint32_t remaining = end - st_get_motion_ticks();
+            const double fraction = ((length == 0) || (remaining > length)) ? 1.0 : 1.0 - (double)remaining / length;
+            for (uint8_t i=0; i < canopen.drives; i++) {
+                canDrive_t *d = canopen.drive[i];
+                target[i] = d->segment_start + (d->target - d->segment_start) * fraction;
+            }
+        } while (loaded != st_get_segments_loaded());
+
+        bool sent = true;
+        for (uint8_t i=0; i < canopen.drives; i++) {
+            sent &= _send_target(canopen.drive[i], target[i]);
+        }
+        if (!sent || !can_send_message(CANOPEN_SYNC, 0, NULL, CAN_TX_MOTION)) {
+            canopen.tx_refused++;
+            return;
+        }
+        for (uint8_t i=0; i < canopen.drives; i++) {
+            canDrive_t *d = canopen.drive[i];
+            d->synced[0] = d->synced[1];
+            d->synced[1] = d->sent;
+        }
+        canopen.syncs++;
+    }
+} // namespace Motate
+
+/*
+ * canopen_message_received() - take the frames from the registered drives
+ *
+ *  Returns true if the frame was from one of the drives. Only TPDO1 is used. SDO and
+ *  EMCY replies are taken so they are not passed on, but faults are read from the
+ *  statusword.
+ */
+
+bool canopen_message_received(uint32_t id, uint8_t length, uint8_t *data)
+{
+    if (id > 0x7FF) {                               // CANopen uses 11 bit IDs
+        return (false);
+    }
+    uint8_t node = id & CANOPEN_NODE_MASK;
+    uint32_t function = id & CANOPEN_FUNCTION_MASK;
+    if ((node == 0) || ((function != CANOPEN_TPDO1) && (function != CANOPEN_SDO_TX) && (function != CANOPEN_EMCY))) {
+        return (false);
+    }
+    for (uint8_t i=0; i < canopen.drives; i++) {
+        canDrive_t *d = canopen.drive[i];
+        if (d->node != node) {
+            continue;
+        }
+        if ((function == CANOPEN_TPDO1) && (length >= 6)) {
+            uint16_t statusword = data[0] | (data[1] << 8);
+            int32_t actual = (int32_t)(data[2] | (data[3] << 8) | (data[4] << 16) | ((uint32_t)data[5] << 24));
+            _drive_status(d, statusword, actual);
+        }
+        return (true);
+    }
+    return (false);
+}
+
+/*
+ * canopen_callback() - start drives, report faults and refused CSP frames
+ */
+
+stat_t canopen_callback()
+{
+    if (canopen.drives == 0) {
+        return (STAT_NOOP);
+    }
+    uint32_t now = SysTickTimer_getValue();
+
+    for (uint8_t i=0; i < canopen.drives; i++) {
+        canDrive_t *d = canopen.drive[i];
+        if (!d->started && (now - d->start_ms >= CANOPEN_START_MS)) {
+            d->start_ms = now;
+            _start(d);
+        }
+        if (d->fault && !d->fault_reported) {
+            d->fault_reported = true;
+            if (cm_get_cycle_state() != CYCLE_OFF) {
+                cm_request_feedhold();
+            }
+            char msg[40];
+            sprintf(msg, "node %d statusword 0x%04X", (int)d->node, (unsigned int)d->statusword);
+            rpt_exception(STAT_CAN_DRIVE_FAULT, msg);
+        }
+    }
+
+    uint32_t refused = canopen.tx_refused;
+    if (refused != canopen.tx_refused_reported) {
+        if (cm_get_cycle_state() != CYCLE_OFF) {
+            cm_request_feedhold();
+        }
+        char msg[40];
+        sprintf(msg, "%lu CSP periods without SYNC", (unsigned long)(refused - canopen.tx_refused_reported));
+        canopen.tx_refused_reported = refused;
+        rpt_exception(STAT_CAN_BUS_OVERLOAD, msg);
+    }
+    return (STAT_OK);
+}
+
+/*
+ * canopen_set_period() - set the CSP interpolation period in microseconds
+ *
+ *  A period too short for the registered drives' frames to fit in CANOPEN_BUS_LOAD
+ *  percent of the bus is refused (see canopen.h).
+ */
+
+stat_t canopen_set_period(nvObj_t *nv)
+{
+    if (nv->value > CANOPEN_PERIOD_MAX_US) {
+        return (STAT_INPUT_EXCEEDS_MAX_VALUE);
+    }
+    if (nv->value < _shortest_period_us()) {
+        return (STAT_INPUT_LESS_THAN_MIN_VALUE);
+    }
+    set_int(nv);
+    if (canopen.running) {
+        csp_timer.setModeAndFrequency(kTimerUpToMatch, 1000000 / canopen.period_us);
+    }
+    return (STAT_OK);
+}
+
+/*
+ * _shortest_period_us() - shortest CSP period the bus can carry
+ *
+ *  Each drive takes an RPDO1 and a TPDO1 a period, and the bus a SYNC.
+ */
+
+static uint32_t _shortest_period_us()
+{
+    const uint32_t bits = canopen.drives * 2 * CAN_FRAME_BITS(6, false) + CAN_FRAME_BITS(0, false);
+    return ((uint32_t)(((uint64_t)bits * 1000000 * 100 + (uint64_t)CAN_BITRATE * CANOPEN_BUS_LOAD - 1) /
+                       ((uint64_t)CAN_BITRATE * CANOPEN_BUS_LOAD)));
+}
+
+/*
+ * _start() - put the drive in operational and select CSP mode
+ *
+ *  Called from the main loop, so the NMT and SDO frames go in the IO class. The motion
+ *  class queue is only written by the CSP interrupt (see can_bus.h).
+ */
+
+static void _start(canDrive_t *d)
+{
+    uint8_t nmt[2] = { CANOPEN_NMT_START, d->node };
+    can_send_message(CANOPEN_NMT, 2, nmt, CAN_TX_IO);     // a refused start is tried again
+
+    uint8_t sdo[8] = { 0x2F, 0x60, 0x60, 0x00, CIA402_MODE_CSP, 0, 0, 0 };    // expedited write of 1 byte to 0x6060:00
+    can_send_message(CANOPEN_SDO_RX + d->node, 8, sdo, CAN_TX_IO);
+}
+
+/*
+ * _send_target() - send the controlword and target position (RPDO1). Returns false if
+ *                  the frame was refused.
+ */
+
+static bool _send_target(canDrive_t *d, const double target)
+{
+    const int32_t sent = d->origin + (int32_t)lround(target);
+
+    uint8_t data[6];
+    data[0] = d->controlword & 0xFF;
+    data[1] = d->controlword >> 8;
+    data[2] = sent & 0xFF;
+    data[3] = (sent >> 8) & 0xFF;
+    data[4] = (sent >> 16) & 0xFF;
+    data[5] = (sent >> 24) & 0xFF;
+    if (!can_send_message(CANOPEN_RPDO1 + d->node, 6, data, CAN_TX_MOTION)) {
+        return (false);
+    }
+    d->sent = sent;
+    return (true);
+}
+
+/*
+ * _drive_status() - take a statusword and actual position from the drive
+ *
+ *  Until the drive is in operation enabled its origin follows it, so the targets sent
+ *  hold it where it is and the controller's position is kept.
+ */
+
+static void _drive_status(canDrive_t *d, const uint16_t statusword, const int32_t actual)
+{
+    d->started = true;
+    d->statusword = statusword;
+    d->actual = actual;
+    d->fault = ((statusword & 0x4F) == 0x08);
+    if (!d->fault) {
+        d->fault_reported = false;
+    }
+    d->tracking = d->enable && ((statusword & 0x6F) == 0x27);
+
+    _csp_lock();                                    // the CSP interrupt reads and writes these
+    if (d->tracking) {
+        d->following = actual - d->synced[0];
+    } else {
+        d->origin = actual - (int32_t)lround(d->target);
+        d->synced[0] = d->synced[1] = d->sent = actual;
+        d->following = 0;
+    }
+    _csp_release();
+    d->measured_valid = true;
+    d->controlword = _next_controlword(d);
+}
+
+/*
+ * _csp_lock()    - mask the CSP interrupt while the main loop changes what it uses
+ * _csp_release() - and unmask it. A period that falls due meanwhile runs on release.
+ *
+ *  As CANRaw::irqLock() does for the CAN interrupt. The main loop takes the drive status
+ *  frames, so it must not update a drive's origin and targets halfway through a period.
+ */
+
+static void _csp_lock()
+{
+    csp_timer.setInterrupts(kInterruptsOff);
+}
+
+static void _csp_release()
+{
+    csp_timer.setInterrupts(CSP_INTERRUPTS);
+}
+
+/*
+ * _next_controlword() - CiA-402 state machine. Returns the controlword that takes the
+ *                       drive from the state in its statusword towards the one wanted.
+ *
+ *  A fault is reset when the drive is enabled again. Fault reset acts on the rising
+ *  edge, so it alternates with shutdown.
+ */
+
+static uint16_t _next_controlword(const canDrive_t *d)
+{
+    if (!d->enable) {
+        return (CIA402_CW_SHUTDOWN);
+    }
+    if ((d->statusword & 0x4F) == 0x08) {                   // fault
+        return ((d->controlword == CIA402_CW_FAULT_RESET) ? CIA402_CW_SHUTDOWN : CIA402_CW_FAULT_RESET);
+    }
+    switch (d->statusword & 0x6F) {
+        case 0x21: { return (CIA402_CW_SWITCH_ON); }        // ready to switch on
+        case 0x23:                                          // switched on
+        case 0x27: { return (CIA402_CW_ENABLE); }           // operation enabled
+        default:   { return (CIA402_CW_SHUTDOWN); }         // switch on disabled and the rest
+    }
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+    static const char fmt_cansp[] = "[cansp] CSP period%20d microseconds\n";
+    void canopen_print_sp(nvObj_t *nv) { text_print(nv, fmt_cansp);}
+
+#endif // __TEXT_MODE
+
+#endif // CAN_ENABLED
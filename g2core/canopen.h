@@ -0,0 +1,145 @@
+/*
+ * canopen.h - CANopen CiA-402 servo drives in cyclic synchronous position mode
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Servo drives on the CAN bus are run in CiA-402 cyclic synchronous position (CSP) mode.
+ * Instead of step pulses each drive is sent the position it must reach at every SYNC,
+ * and interpolates to it itself. See GeratechServo for the motor side.
+ *
+ *  The SYNCs come on a fixed interpolation period ({cansp}, in microseconds) from their
+ *  own timer interrupt, not from the loader, so they are evenly spaced however long the
+ *  segments are. Each period the CSP interrupt works out where every drive should be on
+ *  the motion clock now, by interpolating in the segment running (canopen_load() keeps
+ *  its start and end), sends each drive an RPDO1 with that target, then one SYNC for the
+ *  bus. The drive applies the target at the SYNC and reaches it at the next one, so the
+ *  servos trail the step/dir motors by one period. Set the drive's interpolation time
+ *  period (0x60C2) to match. It replies to each SYNC with a TPDO1 carrying its actual
+ *  position. PDOs use the predefined connection set, and the drives must be mapped to match:
+ *
+ *    RPDO1 0x200+node  controlword (0x6040, u16), target position (0x607A, i32)  - synchronous
+ *    TPDO1 0x180+node  statusword (0x6041, u16), position actual value (0x6064, i32) - on SYNC
+ *
+ *  Positions are in steps - set the drive's position factor so one unit is one step.
+ *  Drive positions are offset by an origin latched when the drive enables, so enabling
+ *  never moves the axis. The timer runs from start-up, so idle drives stay synchronized.
+ *
+ *  Every period takes an RPDO1 and a TPDO1 per drive and a SYNC on the bus. A period that
+ *  would take more than CANOPEN_BUS_LOAD percent of the bus at CAN_BITRATE, counted at
+ *  worst case bit stuffing (CAN_FRAME_BITS()), is refused. The rest is left for outputs,
+ *  start-up and diagnostics. If a frame is still refused by the driver the period sends
+ *  no SYNC, so the drives hold their last targets, and canopen_callback() reports it and
+ *  requests a feedhold if a cycle is running.
+ *
+ *  Actual positions are handled in the main loop (can_rx_callback()). The position read
+ *  back for the following error (GeratechServo::readEncoder()) is the commanded position
+ *  at the start of the segment being loaded plus the drive's error against the target it
+ *  was given at the latest SYNC, so it lines up in time with the encoder readings of step
+ *  motors and leaves out the period the drive trails by. This assumes each reply is handled
+ *  before the next SYNC, which it is unless the main loop blocks for a period.
+ *
+ *  canopen_callback() runs in the main loop. It starts the drives (NMT start and mode of
+ *  operation 8 by SDO) until they answer. A drive fault is reported once, and requests a
+ *  feedhold if a cycle is running.
+ */
+
+#ifndef CANOPEN_H_ONCE
+#define CANOPEN_H_ONCE
+
+#include "g2core.h"
+#include "config.h"
+#include "hardware.h"
+
+#ifdef CAN_ENABLED
+
+#define CANOPEN_DRIVES          8       // most drives on the bus
+#define CANOPEN_START_MS        1000    // start retry period until a drive answers
+#define CANOPEN_BUS_LOAD        80      // most of the bus the CSP frames may take, in percent
+#define CANOPEN_PERIOD_MAX_US   100000  // longest CSP period
+
+// CiA-301 predefined connection set (function code + node ID)
+#define CANOPEN_NMT             0x000
+#define CANOPEN_SYNC            0x080
+#define CANOPEN_EMCY            0x080   // EMCY is 0x080 + node, SYNC is node 0
+#define CANOPEN_TPDO1           0x180
+#define CANOPEN_RPDO1           0x200
+#define CANOPEN_SDO_TX          0x580   // SDO replies from a drive
+#define CANOPEN_SDO_RX          0x600   // SDO requests to a drive
+#define CANOPEN_FUNCTION_MASK   0x780
+#define CANOPEN_NODE_MASK       0x07F
+
+#define CANOPEN_NMT_START       0x01    // NMT start remote node
+
+// CiA-402 controlwords and mode
+#define CIA402_CW_SHUTDOWN      0x0006
+#define CIA402_CW_SWITCH_ON     0x0007
+#define CIA402_CW_ENABLE        0x000F  // enable operation
+#define CIA402_CW_FAULT_RESET   0x0080
+#define CIA402_MODE_CSP         8       // modes of operation (0x6060)
+
+typedef struct canDrive {               // one per CiA-402 drive - owned by its GeratechServo
+    uint8_t node;                       // CANopen node ID, 1 - 127
+    bool enable;                        // motor wants the drive powered
+    bool started;                       // drive has answered
+    bool tracking;                      // drive is in operation enabled and follows the targets
+    bool fault;                         // drive is in fault...
+    bool fault_reported;                // ...and it has been reported
+    uint16_t statusword;                // last statusword
+    uint16_t controlword;               // controlword sent with the targets
+    uint32_t start_ms;                  // time of the last start attempt
+
+    double target;                      // commanded position in steps since reset, at the end of the segment loaded...
+    double segment_start;               // ...and at its start
+    int32_t origin;                     // drive position of step 0
+    int32_t sent;                       // last target sent, in drive units
+    int32_t synced[2];                  // targets applied at the previous and the latest SYNC
+    int32_t actual;                     // last position actual value, in drive units
+    int32_t following;                  // actual position less the target it was given
+    bool measured_valid;                // actual and following have been read from the drive
+} canDrive_t;
+
+typedef struct canopenSingleton {
+    canDrive_t *drive[CANOPEN_DRIVES];  // registered drives
+    uint8_t drives;                     // number of registered drives
+    uint32_t period_us;                 // CSP interpolation period - 0 until a period that fits is set
+    bool running;                       // CSP timer is running
+    uint32_t syncs;                     // SYNC frames sent
+    volatile uint32_t tx_refused;       // periods that sent no SYNC as a frame was refused...
+    uint32_t tx_refused_reported;       // ...and how many of them have been reported
+} canopenSingleton_t;
+
+extern canopenSingleton_t canopen;
+
+/**** Function Prototypes ****/
+
+void canopen_register(canDrive_t *d);
+void canopen_init(void);
+void canopen_enable(canDrive_t *d, const bool enable);
+void canopen_load(canDrive_t *d, const float travel_steps);
+bool canopen_read_position(canDrive_t *d, int32_t &steps);
+
+bool canopen_message_received(uint32_t id, uint8_t length, uint8_t *data);
+stat_t canopen_callback(void);
+
+stat_t canopen_set_period(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void canopen_print_sp(nvObj_t *nv);
+#else
+    #define canopen_print_sp tx_print_stub
+#endif
+
+#endif // CAN_ENABLED
+#endif // End of include guard: CANOPEN_H_ONCE
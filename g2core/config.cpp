@@ -189,6 +189,7 @@ stat_t config_test_assertions()
 /* Generic gets()
  *  get_nul()  - get nothing (returns STAT_NOOP)
  *  get_ui8()  - get value as 8 bit uint8_t (use uint8 for booleans)
+ *  get_ui16() - get value as 16 bit uint16_t
  *  get_int8() - get value as 8 bit int8_t
  *  get_int()  - get value as 32 bit integer
  *  get_data() - get value as 32 bit integer blind cast
@@ -207,6 +208,13 @@ stat_t get_ui8(nvObj_t *nv)
     return (STAT_OK);
 }
 
+stat_t get_ui16(nvObj_t *nv)
+{
+    nv->value = (float)*((uint16_t *)GET_TABLE_WORD(target));
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
 stat_t get_int8(nvObj_t *nv)
 {
     nv->value = (float)*((int8_t *)GET_TABLE_WORD(target));
@@ -333,6 +333,7 @@ stat_t set_flt(nvObj_t *nv);            // set floating point value
 stat_t get_nul(nvObj_t *nv);            // get null value type
 stat_t get_bool(nvObj_t *nv);           // get boolean value
 stat_t get_ui8(nvObj_t *nv);            // get uint8_t value
+stat_t get_ui16(nvObj_t *nv);           // get uint16_t value
 stat_t get_int8(nvObj_t *nv);           // get signed 8 bit integer
 stat_t get_int(nvObj_t *nv);            // get uint32_t integer value
 stat_t get_data(nvObj_t *nv);           // get uint32_t integer value blind cast
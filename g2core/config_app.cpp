@@ -31,13 +31,17 @@
 #include "controller.h"
 #include "canonical_machine.h"
 #include "gcode_parser.h"
+#include "binary_stream.h"
 #include "json_parser.h"
 #include "text_parser.h"
 #include "settings.h"
 #include "planner.h"
 #include "plan_arc.h"
 #include "stepper.h"
+#include "isr_timing.h"
 #include "gpio.h"
+#include "can_bus.h"
+#include "canopen.h"
 #include "spindle.h"
 #include "temperature.h"
 #include "coolant.h"
@@ -205,6 +209,12 @@ const cfgItem_t cfgArray[] = {
     { "1","1po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_1].polarity,       M1_POLARITY },
     { "1","1pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M1_POWER_MODE },
     { "1","1pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_1].power_level,    M1_POWER_LEVEL },
+    { "1","1es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_1].encoder_source,        M1_ENCODER_SOURCE },
+    { "1","1cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_1].correction_p,          M1_CORRECTION_P },
+    { "1","1ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_1].correction_i,          M1_CORRECTION_I },
+    { "1","1cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_1].correction_d,          M1_CORRECTION_D },
+    { "1","1cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_1].correction_max,        M1_CORRECTION_MAX },
+    { "1","1fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_1].following_error_limit, M1_FOLLOWING_ERROR_LIMIT },
 //  { "1","1pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_1].power_idle,     M1_POWER_IDLE },
 //  { "1","1mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_1].motor_timeout,  M1_MOTOR_TIMEOUT },
 #if (MOTORS >= 2)
@@ -216,6 +226,12 @@ const cfgItem_t cfgArray[] = {
     { "2","2po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_2].polarity,       M2_POLARITY },
     { "2","2pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M2_POWER_MODE },
     { "2","2pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_2].power_level,    M2_POWER_LEVEL},
+    { "2","2es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_2].encoder_source,        M2_ENCODER_SOURCE },
+    { "2","2cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_2].correction_p,          M2_CORRECTION_P },
+    { "2","2ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_2].correction_i,          M2_CORRECTION_I },
+    { "2","2cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_2].correction_d,          M2_CORRECTION_D },
+    { "2","2cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_2].correction_max,        M2_CORRECTION_MAX },
+    { "2","2fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_2].following_error_limit, M2_FOLLOWING_ERROR_LIMIT },
 //  { "2","2pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_2].power_idle,     M2_POWER_IDLE },
 //  { "2","2mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_2].motor_timeout,  M2_MOTOR_TIMEOUT },
 #endif
@@ -228,6 +244,12 @@ const cfgItem_t cfgArray[] = {
     { "3","3po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_3].polarity,       M3_POLARITY },
     { "3","3pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M3_POWER_MODE },
     { "3","3pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_3].power_level,    M3_POWER_LEVEL },
+    { "3","3es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_3].encoder_source,        M3_ENCODER_SOURCE },
+    { "3","3cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_3].correction_p,          M3_CORRECTION_P },
+    { "3","3ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_3].correction_i,          M3_CORRECTION_I },
+    { "3","3cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_3].correction_d,          M3_CORRECTION_D },
+    { "3","3cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_3].correction_max,        M3_CORRECTION_MAX },
+    { "3","3fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_3].following_error_limit, M3_FOLLOWING_ERROR_LIMIT },
 //  { "3","3pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_3].power_idle,     M3_POWER_IDLE },
 //  { "3","3mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_3].motor_timeout,  M3_MOTOR_TIMEOUT },
 #endif
@@ -240,6 +262,12 @@ const cfgItem_t cfgArray[] = {
     { "4","4po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_4].polarity,       M4_POLARITY },
     { "4","4pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M4_POWER_MODE },
     { "4","4pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_4].power_level,    M4_POWER_LEVEL },
+    { "4","4es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_4].encoder_source,        M4_ENCODER_SOURCE },
+    { "4","4cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_4].correction_p,          M4_CORRECTION_P },
+    { "4","4ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_4].correction_i,          M4_CORRECTION_I },
+    { "4","4cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_4].correction_d,          M4_CORRECTION_D },
+    { "4","4cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_4].correction_max,        M4_CORRECTION_MAX },
+    { "4","4fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_4].following_error_limit, M4_FOLLOWING_ERROR_LIMIT },
 //  { "4","4pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_4].power_idle,     M4_POWER_IDLE },
 //  { "4","4mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_4].motor_timeout,  M4_MOTOR_TIMEOUT },
 #endif
@@ -252,6 +280,12 @@ const cfgItem_t cfgArray[] = {
     { "5","5po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_5].polarity,       M5_POLARITY },
     { "5","5pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M5_POWER_MODE },
     { "5","5pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_5].power_level,    M5_POWER_LEVEL },
+    { "5","5es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_5].encoder_source,        M5_ENCODER_SOURCE },
+    { "5","5cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_5].correction_p,          M5_CORRECTION_P },
+    { "5","5ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_5].correction_i,          M5_CORRECTION_I },
+    { "5","5cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_5].correction_d,          M5_CORRECTION_D },
+    { "5","5cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_5].correction_max,        M5_CORRECTION_MAX },
+    { "5","5fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_5].following_error_limit, M5_FOLLOWING_ERROR_LIMIT },
 //  { "5","5pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_5].power_idle,     M5_POWER_IDLE },
 //  { "5","5mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_5].motor_timeout,  M5_MOTOR_TIMEOUT },
 #endif
@@ -264,6 +298,12 @@ const cfgItem_t cfgArray[] = {
     { "6","6po",_fip, 0, st_print_po, get_ui8, set_01,     (float *)&st_cfg.mot[MOTOR_6].polarity,       M6_POLARITY },
     { "6","6pm",_fip, 0, st_print_pm, st_get_pm,st_set_pm, (float *)&cs.null,                            M6_POWER_MODE },
     { "6","6pl",_fip, 3, st_print_pl, get_flt, st_set_pl,  (float *)&st_cfg.mot[MOTOR_6].power_level,    M6_POWER_LEVEL },
+    { "6","6es",_fip, 0, st_print_es, get_ui8, st_set_es,  (float *)&st_cfg.mot[MOTOR_6].encoder_source,        M6_ENCODER_SOURCE },
+    { "6","6cp",_fip, 3, st_print_cp, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_6].correction_p,          M6_CORRECTION_P },
+    { "6","6ci",_fip, 3, st_print_ci, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_6].correction_i,          M6_CORRECTION_I },
+    { "6","6cd",_fip, 3, st_print_cd, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_6].correction_d,          M6_CORRECTION_D },
+    { "6","6cm",_fip, 3, st_print_cm, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_6].correction_max,        M6_CORRECTION_MAX },
+    { "6","6fl",_fip, 3, st_print_fl, get_flt, st_set_correction, (float *)&st_cfg.mot[MOTOR_6].following_error_limit, M6_FOLLOWING_ERROR_LIMIT },
 //  { "6","6pi",_fip, 3, st_print_pi, get_flt, st_set_pi,  (float *)&st_cfg.mot[MOTOR_6].power_idle,     M6_POWER_IDLE },
 //  { "6","6mt",_fip, 2, st_print_mt, get_flt, st_set_mt,  (float *)&st_cfg.mot[MOTOR_6].motor_timeout,  M6_MOTOR_TIMEOUT },
 #endif
@@ -459,6 +499,140 @@ const cfgItem_t cfgArray[] = {
     { "out","out11", _f0, 2, io_print_out, io_get_output, io_set_output, (float *)&cs.null, 0 },
     { "out","out12", _f0, 2, io_print_out, io_get_output, io_set_output, (float *)&cs.null, 0 },
 
+#ifdef CAN_ENABLED
+    // CAN routes - the type must come before the ID (see can_set_id())
+    { "cr1","cr1ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[0].type,    CR1_TYPE },
+    { "cr1","cr1id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[0].id,      CR1_ID },
+    { "cr1","cr1mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[0].mask,    CR1_MASK },
+    { "cr1","cr1ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[0].channel, CR1_CHANNEL },
+    { "cr1","cr1cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[0].count,   CR1_COUNT },
+    { "cr1","cr1rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[0].rate,    0 },
+
+    { "cr2","cr2ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[1].type,    CR2_TYPE },
+    { "cr2","cr2id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[1].id,      CR2_ID },
+    { "cr2","cr2mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[1].mask,    CR2_MASK },
+    { "cr2","cr2ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[1].channel, CR2_CHANNEL },
+    { "cr2","cr2cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[1].count,   CR2_COUNT },
+    { "cr2","cr2rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[1].rate,    0 },
+
+    { "cr3","cr3ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[2].type,    CR3_TYPE },
+    { "cr3","cr3id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[2].id,      CR3_ID },
+    { "cr3","cr3mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[2].mask,    CR3_MASK },
+    { "cr3","cr3ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[2].channel, CR3_CHANNEL },
+    { "cr3","cr3cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[2].count,   CR3_COUNT },
+    { "cr3","cr3rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[2].rate,    0 },
+
+    { "cr4","cr4ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[3].type,    CR4_TYPE },
+    { "cr4","cr4id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[3].id,      CR4_ID },
+    { "cr4","cr4mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[3].mask,    CR4_MASK },
+    { "cr4","cr4ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[3].channel, CR4_CHANNEL },
+    { "cr4","cr4cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[3].count,   CR4_COUNT },
+    { "cr4","cr4rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[3].rate,    0 },
+
+    { "cr5","cr5ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[4].type,    CR5_TYPE },
+    { "cr5","cr5id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[4].id,      CR5_ID },
+    { "cr5","cr5mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[4].mask,    CR5_MASK },
+    { "cr5","cr5ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[4].channel, CR5_CHANNEL },
+    { "cr5","cr5cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[4].count,   CR5_COUNT },
+    { "cr5","cr5rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[4].rate,    0 },
+
+    { "cr6","cr6ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[5].type,    CR6_TYPE },
+    { "cr6","cr6id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[5].id,      CR6_ID },
+    { "cr6","cr6mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[5].mask,    CR6_MASK },
+    { "cr6","cr6ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[5].channel, CR6_CHANNEL },
+    { "cr6","cr6cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[5].count,   CR6_COUNT },
+    { "cr6","cr6rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[5].rate,    0 },
+
+    { "cr7","cr7ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[6].type,    CR7_TYPE },
+    { "cr7","cr7id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[6].id,      CR7_ID },
+    { "cr7","cr7mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[6].mask,    CR7_MASK },
+    { "cr7","cr7ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[6].channel, CR7_CHANNEL },
+    { "cr7","cr7cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[6].count,   CR7_COUNT },
+    { "cr7","cr7rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[6].rate,    0 },
+
+    { "cr8","cr8ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[7].type,    CR8_TYPE },
+    { "cr8","cr8id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[7].id,      CR8_ID },
+    { "cr8","cr8mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[7].mask,    CR8_MASK },
+    { "cr8","cr8ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[7].channel, CR8_CHANNEL },
+    { "cr8","cr8cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[7].count,   CR8_COUNT },
+    { "cr8","cr8rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[7].rate,    0 },
+
+    { "cr9","cr9ty", _fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[8].type,    CR9_TYPE },
+    { "cr9","cr9id", _fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[8].id,      CR9_ID },
+    { "cr9","cr9mk", _fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[8].mask,    CR9_MASK },
+    { "cr9","cr9ch", _fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[8].channel, CR9_CHANNEL },
+    { "cr9","cr9cn", _fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[8].count,   CR9_COUNT },
+    { "cr9","cr9rt", _f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[8].rate,    0 },
+
+    { "cr10","cr10ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[9].type,    CR10_TYPE },
+    { "cr10","cr10id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[9].id,      CR10_ID },
+    { "cr10","cr10mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[9].mask,    CR10_MASK },
+    { "cr10","cr10ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[9].channel, CR10_CHANNEL },
+    { "cr10","cr10cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[9].count,   CR10_COUNT },
+    { "cr10","cr10rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[9].rate,    0 },
+
+    { "cr11","cr11ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[10].type,    CR11_TYPE },
+    { "cr11","cr11id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[10].id,      CR11_ID },
+    { "cr11","cr11mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[10].mask,    CR11_MASK },
+    { "cr11","cr11ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[10].channel, CR11_CHANNEL },
+    { "cr11","cr11cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[10].count,   CR11_COUNT },
+    { "cr11","cr11rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[10].rate,    0 },
+
+    { "cr12","cr12ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[11].type,    CR12_TYPE },
+    { "cr12","cr12id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[11].id,      CR12_ID },
+    { "cr12","cr12mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[11].mask,    CR12_MASK },
+    { "cr12","cr12ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[11].channel, CR12_CHANNEL },
+    { "cr12","cr12cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[11].count,   CR12_COUNT },
+    { "cr12","cr12rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[11].rate,    0 },
+
+    { "cr13","cr13ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[12].type,    CR13_TYPE },
+    { "cr13","cr13id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[12].id,      CR13_ID },
+    { "cr13","cr13mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[12].mask,    CR13_MASK },
+    { "cr13","cr13ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[12].channel, CR13_CHANNEL },
+    { "cr13","cr13cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[12].count,   CR13_COUNT },
+    { "cr13","cr13rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[12].rate,    0 },
+
+    { "cr14","cr14ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[13].type,    CR14_TYPE },
+    { "cr14","cr14id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[13].id,      CR14_ID },
+    { "cr14","cr14mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[13].mask,    CR14_MASK },
+    { "cr14","cr14ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[13].channel, CR14_CHANNEL },
+    { "cr14","cr14cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[13].count,   CR14_COUNT },
+    { "cr14","cr14rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[13].rate,    0 },
+
+    { "cr15","cr15ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[14].type,    CR15_TYPE },
+    { "cr15","cr15id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[14].id,      CR15_ID },
+    { "cr15","cr15mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[14].mask,    CR15_MASK },
+    { "cr15","cr15ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[14].channel, CR15_CHANNEL },
+    { "cr15","cr15cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[14].count,   CR15_COUNT },
+    { "cr15","cr15rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[14].rate,    0 },
+
+    { "cr16","cr16ty",_fip, 0, can_print_ty, get_ui8, can_set_ty,(float *)&can.route[15].type,    CR16_TYPE },
+    { "cr16","cr16id",_fip, 0, can_print_id, can_get_id,can_set_id,(float *)&can.route[15].id,      CR16_ID },
+    { "cr16","cr16mk",_fip, 0, can_print_mk, can_get_id,can_set_id,(float *)&can.route[15].mask,    CR16_MASK },
+    { "cr16","cr16ch",_fip, 0, can_print_ch, get_ui8, can_set_ch,(float *)&can.route[15].channel, CR16_CHANNEL },
+    { "cr16","cr16cn",_fip, 0, can_print_cn, get_ui8, can_set_cn,(float *)&can.route[15].count,   CR16_COUNT },
+    { "cr16","cr16rt",_f0,  1, can_print_rt, get_flt, set_nul,   (float *)&can.route[15].rate,    0 },
+
+    // CAN servo interpolation period (see canopen.h)
+    { "can","cansp",_fip, 0, canopen_print_sp, get_int, canopen_set_period,(float *)&canopen.period_us, CANOPEN_PERIOD_US },
+
+    // CAN bus statistics (see can_bus.h)
+    { "",  "clcan",_f0, 0, tx_print_nul, can_clcan, can_clcan, (float *)&cs.null, 0 },  // clear CAN bus statistics
+    { "can","canfi",_f0, 1, tx_print_flt, get_flt, set_nul,(float *)&can.rx_rate, 0 },          // frames received per second
+    { "can","canfo",_f0, 1, tx_print_flt, get_flt, set_nul,(float *)&can.tx_queued_rate, 0 },   // frames queued per second
+    { "can","canri",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.rx_frames, 0 },        // frames received
+    { "can","canrh",_f0, 0, tx_print_int, get_ui16, set_nul,(float *)&can.rx_max_depth, 0 },    // RX ring high water mark
+    { "can","canth",_f0, 0, tx_print_int, get_ui16, set_nul,(float *)&can.tx_max_depth, 0 },    // TX queue high water mark
+    { "can","canrd",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.rx_dropped, 0 },       // frames lost - RX ring full
+    { "can","canro",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.rx_overruns, 0 },      // frames lost - mailbox overrun
+    { "can","cantf",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.tx_full, 0 },          // frames refused - TX queue full
+    { "can","canun",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.rx_unrouted, 0 },      // frames that matched no route
+    { "can","canbe",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.bus_errors, 0 },       // bus errors
+    { "can","canbo",_f0, 0, tx_print_int, get_int, set_nul,(float *)&can.bus_offs, 0 },         // bus off events
+    { "can","cante",_f0, 0, tx_print_int, get_ui8, set_nul,(float *)&can.tx_error_count, 0 },   // transmit error counter
+    { "can","canre",_f0, 0, tx_print_int, get_ui8, set_nul,(float *)&can.rx_error_count, 0 },   // receive error counter
+#endif
+
     // PWM settings
     { "p1","p1frq",_fip, 0, pwm_print_p1frq, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].frequency,     P1_PWM_FREQUENCY },
     { "p1","p1csl",_fip, 0, pwm_print_p1csl, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].cw_speed_lo,   P1_CW_SPEED_LO },
@@ -839,6 +1013,9 @@ const cfgItem_t cfgArray[] = {
     // General system parameters
     { "sys","jt", _fipn, 2, cm_print_jt,  get_flt, cm_set_jt,(float *)&cm.junction_integration_time,JUNCTION_INTEGRATION_TIME },
     { "sys","ct", _fipnc,4, cm_print_ct,  get_flt, set_flup, (float *)&cm.chordal_tolerance,        CHORDAL_TOLERANCE },
+#ifdef __COALESCE_LINES
+    { "sys","clt",_fipnc,4, cm_print_clt, get_flt, set_flup, (float *)&cm.coalesce_tolerance,       COALESCE_TOLERANCE },
+#endif
     { "sys","sl", _fipn, 0, cm_print_sl,  get_ui8, set_01,   (float *)&cm.soft_limit_enable,        SOFT_LIMIT_ENABLE },
     { "sys","lim", _fipn,0, cm_print_lim, get_ui8, set_01,   (float *)&cm.limit_enable,             HARD_LIMIT_ENABLE },
     { "sys","saf", _fipn,0, cm_print_saf, get_ui8, set_01,   (float *)&cm.safety_interlock_enable,  SAFETY_INTERLOCK_ENABLE },
@@ -876,10 +1053,15 @@ const cfgItem_t cfgArray[] = {
     { "sys","tv", _fipn, 0, tx_print_tv,  get_ui8, set_01,     (float *)&txt.text_verbosity,        TEXT_VERBOSITY },
 #endif
     { "sys","ej", _fipn, 0, js_print_ej,  get_ui8, json_set_ej,(float *)&cs.comm_mode,              COMM_MODE },
+    { "sys","txb",_fipn, 0, xio_print_txb,get_ui8, set_01,     (float *)&xtx.enable,                TX_BATCHING },
+    { "sys","txl",_fipn, 0, xio_print_txl,get_ui8, set_ui8,    (float *)&xtx.latency_ms,            TX_LATENCY_MS },
     { "sys","jv", _fipn, 0, js_print_jv,  get_ui8, json_set_jv,(float *)&js.json_verbosity,         JSON_VERBOSITY },
     { "sys","qv", _fipn, 0, qr_print_qv,  get_ui8, set_012,    (float *)&qr.queue_report_verbosity,  QR_OFF}, // default to OFF, set to QUEUE_REPORT_VERBOSITY after connected
     { "sys","sv", _fipn, 0, sr_print_sv,  get_ui8, set_012,    (float *)&sr.status_report_verbosity, SR_OFF}, // default to OFF, set to STATUS_REPORT_VERBOSITY after connectied
     { "sys","si", _fipn, 0, sr_print_si,  get_int, sr_set_si,  (float *)&sr.status_report_interval, STATUS_REPORT_INTERVAL_MS },
+    { "sys","ilm",_fipn, 0, controller_print_ilm, get_ui8, set_ui8, (float *)&cs.ingest_lines_max,  INGEST_LINES_MAX },
+    { "sys","ilh",_fipn, 0, controller_print_ilh, get_ui8, set_ui8, (float *)&cs.ingest_margin,     INGEST_HEADROOM_MARGIN },
+    { "sys","ilt",_fipn, 0, controller_print_ilt, get_int, set_int, (float *)&cs.ingest_budget,     INGEST_TIME_BUDGET },
     { "", "nxln", _f0,   0, cm_print_nxln,cm_get_nxln,cm_set_nxln,(float *)&cs.null,                0 },
 
     // Gcode defaults
@@ -899,6 +1081,10 @@ const cfgItem_t cfgArray[] = {
     { "", "er",  _f0, 0, tx_print_nul, rpt_er,    set_nul,   (float *)&cs.null, 0 },    // get bogus exception report for testing
     { "", "qf",  _f0, 0, tx_print_nul, get_nul,   cm_run_qf, (float *)&cs.null, 0 },    // SET to invoke queue flush
     { "", "rx",  _f0, 0, tx_print_int, get_rx,    set_ro,    (float *)&cs.null, 0 },    // get RX buffer bytes or packets
+#ifdef __BINARY_STREAM
+    { "", "bin", _f0, 0, bs_print_bin, get_ui8,   bs_set_bin,(float *)&bs.enable, 0 },  // enable binary motion frames
+    { "", "bsq", _f0, 0, bs_print_bsq, get_ui8,   set_ro,    (float *)&bs.next_seq, 0 },// get next binary frame sequence
+#endif
     { "", "msg", _f0, 0, tx_print_str, get_nul,   set_nul,   (float *)&cs.null, 0 },    // string for generic messages
     { "", "alarm",_f0,0, tx_print_nul, cm_alrm,   cm_alrm,   (float *)&cs.null, 0 },    // trigger alarm
     { "", "panic",_f0,0, tx_print_nul, cm_pnic,   cm_pnic,   (float *)&cs.null, 0 },    // trigger panic
@@ -942,6 +1128,66 @@ const cfgItem_t cfgArray[] = {
 #ifdef __DIAGNOSTIC_PARAMETERS
     { "",    "clc",_f0, 0, tx_print_nul, st_clc,  st_clc, (float *)&cs.null, 0 },  // clear diagnostic step counters
     { "",   "_dam",_f0, 0, tx_print_nul, cm_dam,  cm_dam, (float *)&cs.null, 0 },  // dump active model
+    { "",    "clp",_f0, 0, tx_print_nul, mp_clp,  mp_clp, (float *)&cs.null, 0 },  // clear back-planning counters
+
+    { "_pl","_plb",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&mp.bp_blocks, 0 },     // new blocks primed
+    { "_pl","_plc",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&mp.bp_converged, 0 },  // passes stopped by convergence
+    { "_pl","_plp",_f0, 1, tx_print_flt, mp_get_plp, set_nul,(float *)&cs.null, 0 },         // back-planning passes per second
+    { "_pl","_plv",_f0, 2, tx_print_flt, mp_get_plv, set_nul,(float *)&cs.null, 0 },         // blocks visited per new block
+    { "_pl","_plm",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&mp.mv_max, 0 },        // max meet velocity iterations
+#ifdef __COALESCE_LINES
+    { "_pl","_pll",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&cm.co.lines_merged, 0 },// G1 lines merged into other blocks
+#endif
+    { "_pl","_plk",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&cm.co.corners_blended, 0 },// G64 P corners blended
+
+    { "",   "clin",_f0, 0, tx_print_nul, controller_clin, controller_clin, (float *)&cs.null, 0 }, // clear ingest counters
+    { "_il","_ilp",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&cs.ingest_passes, 0 },      // passes that read Gcode lines
+    { "_il","_ill",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&cs.ingest_lines, 0 },       // Gcode lines read by those passes
+    { "_il","_ila",_f0, 2, tx_print_flt, controller_get_ila, set_nul,(float *)&cs.null, 0 },       // average lines per pass
+    { "_il","_ilm",_f0, 0, tx_print_int, get_ui8,    set_nul,(float *)&cs.ingest_max, 0 },         // most lines in one pass
+    { "_il","_ilt",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&cs.ingest_budget_cuts, 0 }, // passes cut short by {ilt:}
+
+    { "",   "cltx",_f0, 0, tx_print_nul, xio_cltx, xio_cltx, (float *)&cs.null, 0 },             // clear TX write counters
+    { "_tx","_txa",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&xtx.lines, 0 },            // lines written to the control devices
+    { "_tx","_txw",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&xtx.writes, 0 },           // device writes they took
+    { "_tx","_txc",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&xtx.latency_writes, 0 },   // writes forced by the latency cap
+
+    { "_st","_stu",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&st_pre.underruns, 0 },    // prep queue underruns
+    { "_st","_sth",_f0, 0, tx_print_int, get_int,    set_nul,(float *)&st_pre.min_headroom, 0 }, // prep queue low water mark
+
+#ifdef __ISR_TIMING
+    { "",    "cli",_f0, 0, tx_print_nul, isr_cli, isr_cli, (float *)&cs.null, 0 },  // clear ISR timing statistics
+    { "isr","isrdn",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_DDA].count, 0 },       // DDA interrupt runs
+    { "isr","isrdl",_f0, 0, tx_print_int, isr_get_min, set_nul,(float *)&cs.null, 0 },                        // shortest run in cycles
+    { "isr","isrda",_f0, 1, tx_print_flt, isr_get_avg, set_nul,(float *)&cs.null, 0 },                        // average run
+    { "isr","isrdh",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_DDA].max_cycles, 0 },  // longest run
+    { "isr","isrdt",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_DDA].max_latency, 0 }, // worst latency
+    { "isr","isrdd",_f0, 0, tx_print_int, get_ui8,     set_nul,(float *)&isrt.isr[ISR_DDA].max_depth, 0 },   // deepest nesting
+    { "isr","isren",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_EXEC].count, 0 },
+    { "isr","isrel",_f0, 0, tx_print_int, isr_get_min, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrea",_f0, 1, tx_print_flt, isr_get_avg, set_nul,(float *)&cs.null, 0 },
+    { "isr","isreh",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_EXEC].max_cycles, 0 },
+    { "isr","isret",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_EXEC].max_latency, 0 },
+    { "isr","isred",_f0, 0, tx_print_int, get_ui8,     set_nul,(float *)&isrt.isr[ISR_EXEC].max_depth, 0 },
+    { "isr","isrfn",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_FWD_PLAN].count, 0 },
+    { "isr","isrfl",_f0, 0, tx_print_int, isr_get_min, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrfa",_f0, 1, tx_print_flt, isr_get_avg, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrfh",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_FWD_PLAN].max_cycles, 0 },
+    { "isr","isrft",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_FWD_PLAN].max_latency, 0 },
+    { "isr","isrfd",_f0, 0, tx_print_int, get_ui8,     set_nul,(float *)&isrt.isr[ISR_FWD_PLAN].max_depth, 0 },
+    { "isr","isrln",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_LOAD].count, 0 },
+    { "isr","isrll",_f0, 0, tx_print_int, isr_get_min, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrla",_f0, 1, tx_print_flt, isr_get_avg, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrlh",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_LOAD].max_cycles, 0 },
+    { "isr","isrlt",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_LOAD].max_latency, 0 },
+    { "isr","isrld",_f0, 0, tx_print_int, get_ui8,     set_nul,(float *)&isrt.isr[ISR_LOAD].max_depth, 0 },
+    { "isr","isrcn",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_CAN].count, 0 },
+    { "isr","isrcl",_f0, 0, tx_print_int, isr_get_min, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrca",_f0, 1, tx_print_flt, isr_get_avg, set_nul,(float *)&cs.null, 0 },
+    { "isr","isrch",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_CAN].max_cycles, 0 },
+    { "isr","isrct",_f0, 0, tx_print_int, get_int,     set_nul,(float *)&isrt.isr[ISR_CAN].max_latency, 0 },
+    { "isr","isrcd",_f0, 0, tx_print_int, get_ui8,     set_nul,(float *)&isrt.isr[ISR_CAN].max_depth, 0 },
+#endif
 
     { "_te","_tex",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_X], 0 }, // X target endpoint
     { "_te","_tey",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_Y], 0 },
@@ -1152,6 +1398,26 @@ const cfgItem_t cfgArray[] = {
     { "","pid3",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },   // PID 3 group
     // +6 = 76
 
+#ifdef CAN_ENABLED
+    { "","cr1",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 1 group
+    { "","cr2",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 2 group
+    { "","cr3",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 3 group
+    { "","cr4",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 4 group
+    { "","cr5",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 5 group
+    { "","cr6",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 6 group
+    { "","cr7",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 7 group
+    { "","cr8",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 8 group
+    { "","cr9",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 9 group
+    { "","cr10",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 10 group
+    { "","cr11",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 11 group
+    { "","cr12",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 12 group
+    { "","cr13",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 13 group
+    { "","cr14",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 14 group
+    { "","cr15",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 15 group
+    { "","cr16",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN route 16 group
+    { "","can", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // CAN bus statistics group
+#endif
+
 #ifdef __USER_DATA
     { "","uda", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // user data group
     { "","udb", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // user data group
@@ -1167,6 +1433,13 @@ const cfgItem_t cfgArray[] = {
     { "","_es",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // encoder steps group
     { "","_xs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // correction steps group
     { "","_fe",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // following error group
+    { "","_pl",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // back-planning counters group
+    { "","_st",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // prep queue counters group
+    { "","_il",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // multi-line ingest counters group
+    { "","_tx",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // TX write counters group
+#ifdef __ISR_TIMING
+    { "","isr",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },  // ISR timing group
+#endif
 #endif
 
     // Uber-group (groups of groups, for text-mode displays only)
@@ -1203,13 +1476,23 @@ const cfgItem_t cfgArray[] = {
 #endif
 
 #ifdef __DIAGNOSTIC_PARAMETERS
-#define DIAGNOSTIC_GROUPS       8    // count of diagnostic groups only
+#ifdef __ISR_TIMING
+#define DIAGNOSTIC_GROUPS       13   // count of diagnostic groups only
+#else
+#define DIAGNOSTIC_GROUPS       12   // ...less the isr group
+#endif
 #else
 #define DIAGNOSTIC_GROUPS       0
 #endif
 
 #define TEMPERATURE_GROUPS      6
-#define NV_COUNT_GROUPS (FIXED_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + USER_DATA_GROUPS + DIAGNOSTIC_GROUPS + TEMPERATURE_GROUPS)
+
+#ifdef CAN_ENABLED
+#define CAN_GROUPS              (CAN_ROUTES + 1)    // count of CAN groups (cr1 - crN and can)
+#else
+#define CAN_GROUPS              0
+#endif
+#define NV_COUNT_GROUPS (FIXED_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + USER_DATA_GROUPS + DIAGNOSTIC_GROUPS + TEMPERATURE_GROUPS + CAN_GROUPS)
 
 /* <DO NOT MESS WITH THESE DEFINES> */
 #define NV_INDEX_MAX (sizeof(cfgArray) / sizeof(cfgItem_t))
@@ -32,19 +32,24 @@
 #include "json_parser.h"
 #include "text_parser.h"
 #include "gcode_parser.h"
+#include "binary_stream.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
 #include "planner.h"
 #include "stepper.h"
 #include "temperature.h"
 #include "encoder.h"
+#include "kinematics.h"
 #include "hardware.h"
 #include "gpio.h"
+#include "can_bus.h"
+#include "canopen.h"
 #include "report.h"
 #include "help.h"
 #include "util.h"
 #include "xio.h"
 #include "settings.h"
+#include "isr_timing.h"
 
 #include "MotatePower.h"
 
@@ -76,7 +81,8 @@ static stat_t _sync_to_planner(void);
 static stat_t _sync_to_tx_buffer(void);
 static stat_t _dispatch_command(void);
 static stat_t _dispatch_control(void);
-static void _dispatch_kernel(const devflags_t flags);
+static bool _dispatch_kernel(const devflags_t flags);
+static bool _ingest_more(uint8_t lines, uint32_t start);
 static stat_t _controller_state(void);          // manage controller state transitions
 
 static Motate::OutputPin<Motate::kOutputSAFE_PinNumber> safe_pin;
@@ -130,12 +136,15 @@ void controller_request_enquiry()
  * and runs the next routine in the list.
  *
  * A routine that had no action (i.e. is OFF or idle) should return STAT_NOOP
+ *
+ * Output written during a pass is sent once the pass is over (see xio_tx.cpp).
  */
 
 void controller_run()
 {
     while (true) {
         _controller_HSM();
+        xio_tx_flush();                         // send this pass's responses and reports
     }
 }
 
@@ -148,6 +157,11 @@ static void _controller_HSM()
 //----- kernel level ISR handlers ----(flags are set in ISRs)------------------------//
                                                 // Order is important:
     DISPATCH(hardware_periodic());              // give the hardware a chance to do stuff
+#ifdef CAN_ENABLED
+    DISPATCH(can_rx_callback());                // dispatch received CAN frames
+    DISPATCH(can_tx_callback());                // send the CAN outputs changed since the last pass
+    DISPATCH(canopen_callback());               // start CAN servo drives, report faults and overloads
+#endif
     DISPATCH(_led_indicator());                 // blink LEDs at the current rate
     DISPATCH(_shutdown_handler());              // invoke shutdown
     DISPATCH(_interlock_handler());             // invoke / remove safety interlock
@@ -160,12 +174,17 @@ static void _controller_HSM()
 //----- planner hierarchy for gcode and cycles ---------------------------------------//
 
     DISPATCH(st_motor_power_callback());        // stepper motor power sequencing
+    DISPATCH(st_following_error_callback());    // report a following error limit trip
     DISPATCH(sr_status_report_callback());      // conditionally send status report
     DISPATCH(qr_queue_report_callback());       // conditionally send queue report
 
     DISPATCH(cm_feedhold_sequencing_callback());// feedhold state machine runner
     DISPATCH(mp_planner_callback());            // motion planner
     DISPATCH(cm_arc_callback());                // arc generation runs as a cycle above lines
+    DISPATCH(cm_coalesce_callback());           // queue a merged G1 move once no more lines are coming
+#ifdef __BINARY_STREAM
+    DISPATCH(bs_callback());                    // queue the records of a binary frame - before reading more lines
+#endif
     DISPATCH(cm_homing_cycle_callback());       // homing cycle operation (G28.2)
     DISPATCH(cm_probing_cycle_callback());      // probing cycle operation (G38.2)
     DISPATCH(cm_jogging_cycle_callback());      // jog cycle operation
@@ -191,7 +210,16 @@ static void _controller_HSM()
  *  Reads next command line and dispatches to relevant parser or action
  *
  *  Note: The dispatchers must only read and process a single line from the
- *        RX queue before returning control to the main loop.
+ *        RX queue before returning control to the main loop. The exception is a
+ *        run of Gcode lines read by _dispatch_command() while the planner has
+ *        room for them - see _ingest_more().
+ *
+ *  The line may be in place in the device's RX buffer (see LineRXBuffer::readline()). It is
+ *  valid until the next xio_readline(), so everything done with it is done here. Gcode
+ *  lines are not modified by gcode_parser(), so they are echoed from cs.bufp and only
+ *  copied for the "gc" echo when that is enabled. JSON and text mode lines are modified
+ *  by their parsers, so they are saved to cs.saved_buf first. Binary frames ('@') are decoded
+ *  into the stream's own buffer and run from bs_callback() (see binary_stream.h).
  */
 
 static stat_t _dispatch_control()
@@ -200,6 +228,7 @@ static stat_t _dispatch_control()
         devflags_t flags = DEV_IS_CTRL;
         if ((cs.bufp = xio_readline(flags, cs.linelen)) != NULL) {
             _dispatch_kernel(flags);
+            xio_tx_flush();                     // don't hold the response to a control line
         }
     }
     return (STAT_OK);
@@ -208,15 +237,76 @@ static stat_t _dispatch_control()
 static stat_t _dispatch_command()
 {
     if (cs.controller_state != CONTROLLER_PAUSED) {
-        devflags_t flags = DEV_IS_BOTH | DEV_IS_MUTED; // expressly state we'll handle muted devices
-        if ((!mp_planner_is_full()) && (cs.bufp = xio_readline(flags, cs.linelen)) != NULL) {
-            _dispatch_kernel(flags);
+        uint32_t start = isr_cycles();
+        uint8_t lines = 0;
+        while (!mp_planner_is_full()) {
+            devflags_t flags = DEV_IS_BOTH | DEV_IS_MUTED; // expressly state we'll handle muted devices
+            if ((cs.bufp = xio_readline(flags, cs.linelen)) == NULL) {
+                break;
+            }
+            if (!_dispatch_kernel(flags)) {
+                break;                              // not Gcode - let the rest of the pass run
+            }
+            if (!_ingest_more(++lines, start)) {
+                break;
+            }
+        }
+        if (lines) {
+            cs.ingest_passes++;
+            cs.ingest_lines += lines;
+            if (lines > cs.ingest_max) {
+                cs.ingest_max = lines;
+            }
         }
     }
     return (STAT_OK);
 }
 
-static void _dispatch_kernel(const devflags_t flags)
+/*
+ * _ingest_more() - return true if another Gcode line may be read in this pass
+ *
+ *  When the planner is running down - a run of short lines, say - reading one line per pass
+ *  can't keep up, as every line waits for the whole pass. So while the planner has more than
+ *  PLANNER_BUFFER_HEADROOM + {ilh:} free buffers, up to {ilm:} Gcode lines are read in one
+ *  pass. Another line is read only if the one just run left nothing for the rest of the pass
+ *  to do first (an arc, a homing, probing or jogging cycle, a feedhold or an alarm), and the
+ *  lines have taken less than {ilt:} microseconds, so control lines, status reports and the
+ *  other callbacks are still run every so often. Control lines are read at the start of the
+ *  next pass, as before. A line that is not Gcode always ends the pass.
+ */
+
+#ifdef __GLIBC__
+#define INGEST_CYCLES_PER_US    1000                        // isr_cycles() counts nanoseconds on host builds
+#else
+#define INGEST_CYCLES_PER_US    (SystemCoreClock / 1000000)
+#endif
+
+static bool _ingest_more(uint8_t lines, uint32_t start)
+{
+    if (lines >= cs.ingest_lines_max) {
+        return (false);
+    }
+    if ((arc.run_state != BLOCK_INACTIVE) ||
+        (cm.cycle_state > CYCLE_MACHINING) ||
+        (cm.hold_state != FEEDHOLD_OFF) ||
+        (cm_is_alarmed() != STAT_OK)) {
+        return (false);
+    }
+    if (mp_get_planner_buffers() <= PLANNER_BUFFER_HEADROOM + cs.ingest_margin) {
+        return (false);
+    }
+    if ((isr_cycles() - start) >= cs.ingest_budget * INGEST_CYCLES_PER_US) {
+        cs.ingest_budget_cuts++;
+        return (false);
+    }
+    return (true);
+}
+
+/*
+ * _dispatch_kernel() - returns true if the line was Gcode
+ */
+
+static bool _dispatch_kernel(const devflags_t flags)
 {
     stat_t status;
 
@@ -227,7 +317,7 @@ static void _dispatch_kernel(const devflags_t flags)
         nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_TO_MUTED_FORMAT);
 
         // It's possible to let some stuff through, but that's not happening yet.
-        return;
+        return (false);
     }
 
 #if MARLIN_COMPAT_ENABLED == true
@@ -236,41 +326,50 @@ static void _dispatch_kernel(const devflags_t flags)
         js.json_mode = MARLIN_COMM_MODE;
         sr.status_report_verbosity = SR_OFF;
         qr.queue_report_verbosity = QR_OFF;
-        return;
+        return (false);
     }
 #endif
 
     while ((*cs.bufp == SPC) || (*cs.bufp == TAB)) {        // position past any leading whitespace
         cs.bufp++;
     }
-    strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);     // save input buffer for reporting
 
     if (*cs.bufp == NUL) {                                  // blank line - just a CR or the 2nd termination in a CRLF
         if (js.json_mode == TEXT_MODE) {
-            text_response(STAT_OK, cs.saved_buf);
-            return;
+            text_response(STAT_OK, cs.bufp);
+            return (false);
         }
     }
 
     // trap single character commands
     if      (*cs.bufp == '!') { cm_request_feedhold(); }
-    else if (*cs.bufp == '%') { cm_request_queue_flush(); xio_flush_to_command(); }
+    else if (*cs.bufp == '%') { cm_request_queue_flush(); xio_flush_to_command(); bs_abort(); }
     else if (*cs.bufp == '~') { cm_request_end_hold(); }
     else if (*cs.bufp == EOT) { cm_alarm(STAT_KILL_JOB, "EOT Received"); }
     else if (*cs.bufp == ENQ) { controller_request_enquiry(); }
-    else if (*cs.bufp == CAN) { hw_hard_reset(); }          // reset immediately
+    else if (*cs.bufp == CAN) { xio_tx_flush(); hw_hard_reset(); }  // reset immediately
 
     else if (*cs.bufp == '{') {                             // process as JSON mode
         if (cs.comm_mode == AUTO_MODE) {
             js.json_mode = JSON_MODE;                       // switch to JSON mode
         }
         cs.comm_request_mode = JSON_MODE;                   // mode of this command
+        strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1); // save input buffer for reporting
         json_parser(cs.bufp);
     }
+#ifdef __BINARY_STREAM
+    else if (*cs.bufp == '@') {                             // binary motion frame
+        cs.comm_request_mode = js.json_mode;                // mode of this command
+        if (bs_frame(cs.bufp, cs.linelen) == STAT_OK) {     // responds to a bad frame itself
+            bs_callback();                                  // queue what fits now - responds when done
+        }
+    }
+#endif
 #ifdef __TEXT_MODE
     else if (strchr("$?Hh", *cs.bufp) != NULL) {            // process as text mode
         if (cs.comm_mode == AUTO_MODE) { js.json_mode = TEXT_MODE; } // switch to text mode
         cs.comm_request_mode = TEXT_MODE;                   // mode of this command
+        strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1); // save input buffer for reporting
         status = text_parser(cs.bufp);
         if (js.json_mode == TEXT_MODE) {                    // needed in case mode was changed by $EJ=1
             text_response(status, cs.saved_buf);
@@ -278,14 +377,15 @@ static void _dispatch_kernel(const devflags_t flags)
     }
     else if (js.json_mode == TEXT_MODE) {                   // anything else is interpreted as Gcode
         cs.comm_request_mode = TEXT_MODE;                   // mode of this command
-        text_response(gcode_parser(cs.bufp), cs.saved_buf);
+        text_response(gcode_parser(cs.bufp), cs.bufp);
+        return (true);
     }
 #endif
 
 #if MARLIN_COMPAT_ENABLED == true
     else if (js.json_mode == MARLIN_COMM_MODE) {                   // handle marlin-specific protocol gcode
         cs.comm_request_mode = MARLIN_COMM_MODE;                   // mode of this command
-        marlin_response(gcode_parser(cs.bufp), cs.saved_buf);
+        marlin_response(gcode_parser(cs.bufp), cs.bufp);
     }
 #endif
     else {  // anything else is interpreted as Gcode
@@ -294,9 +394,16 @@ static void _dispatch_kernel(const devflags_t flags)
         // this optimization bypasses the standard JSON parser and does what it needs directly
         nvObj_t *nv = nv_reset_nv_list();                   // get a fresh nvObj list
         strcpy(nv->token, "gc");                            // label is as a Gcode block (do not get an index - not necessary)
-        nv_copy_string(nv, cs.bufp);                        // copy the Gcode line
+        static char no_line[1];                             // writable empty string, not a literal
+        nv->stringp = (char (*)[])no_line;                  // hold the slot - the line is copied below if it's echoed
         nv->valuetype = TYPE_STRING;
         status = gcode_parser(cs.bufp);
+        if (js.echo_json_gcode_block && (strcmp(nv->token, "gc") == 0)) {
+            nv_copy_string(nv, cs.bufp);                    // copy the Gcode line, as it was received
+        }
+        if ((status != STAT_OK) && (status != STAT_EAGAIN) && (status != STAT_NOOP)) {
+            strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1); // save input buffer for reporting the error
+        }
         
 #if MARLIN_COMPAT_ENABLED == true
         if (js.json_mode == MARLIN_COMM_MODE) {             // in case a marlin-specific M-code was found
@@ -304,14 +411,16 @@ static void _dispatch_kernel(const devflags_t flags)
             // We are switching to marlin_comm_mode, kill status reports and queue reports
             sr.status_report_verbosity = SR_OFF;
             qr.queue_report_verbosity = QR_OFF;
-            marlin_response(status, cs.saved_buf);
-            return;
+            marlin_response(status, cs.bufp);
+            return (false);
         }
 #endif
 
         nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
         sr_request_status_report(SR_REQUEST_TIMED);         // generate incremental status report to show any changes
+        return (true);
     }
+    return (false);
 }
 
 /**** Local Functions ********************************************************/
@@ -375,6 +484,10 @@ void controller_set_connected(bool is_connected) {
         cs.controller_state = CONTROLLER_CONNECTED; // we JUST connected
     } else {  // we just disconnected from the last device, we'll expect a banner again
         _reset_comms_mode();
+#ifdef __BINARY_STREAM
+        bs.enable = false;                          // the next host has to ask for binary frames
+        bs_reset();
+#endif
         cs.controller_state = CONTROLLER_NOT_CONNECTED;
     }
 }
@@ -459,7 +572,7 @@ static stat_t _sync_to_planner()
 /* ALARM STATE HANDLERS
  *
  * _shutdown_handler() - put system into shutdown state
- * _limit_switch_handler() - shut down system if limit switch fired
+ * _limit_switch_handler() - shut down system if limit switch fired. Reports where it tripped
  * _interlock_handler() - feedhold and resume depending on edge
  *
  *    Some handlers return EAGAIN causing the control loop to never advance beyond that point.
@@ -490,8 +603,11 @@ static stat_t _limit_switch_handler(void)
 //    safe_pin = 1;
 
     if ((cm.limit_enable == true) && (cm.limit_requested != 0)) {
-        char msg[10];
-        sprintf(msg, "input %d", (int)cm.limit_requested);
+        float position[AXES];                   // where it tripped - the input took a snapshot
+        kn_forward_kinematics(en_get_encoder_snapshot_vector(), position);
+        char msg[64];
+        sprintf(msg, "input %d at x%0.3f y%0.3f z%0.3f", (int)cm.limit_requested,
+                position[AXIS_X], position[AXIS_Y], position[AXIS_Z]);
         cm.limit_requested = false; // clear limit request used here ^
         cm_alarm(STAT_LIMIT_SWITCH_HIT, msg);
     }
@@ -557,3 +673,47 @@ stat_t _test_system_assertions()
 }
 
     
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * controller_clin()    - clear the multi-line ingest counters
+ * controller_get_ila() - get the average Gcode lines read per pass that read any
+ */
+
+stat_t controller_clin(nvObj_t *nv)
+{
+    cs.ingest_passes = 0;
+    cs.ingest_lines = 0;
+    cs.ingest_budget_cuts = 0;
+    cs.ingest_max = 0;
+    return (STAT_OK);
+}
+
+stat_t controller_get_ila(nvObj_t *nv)
+{
+    nv->value = (cs.ingest_passes == 0) ? 0 : (float)cs.ingest_lines / cs.ingest_passes;
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_ilm[] = "[ilm] ingest lines per pass%8d\n";
+static const char fmt_ilh[] = "[ilh] ingest buffer margin%9d buffers\n";
+static const char fmt_ilt[] = "[ilt] ingest time budget%11d us\n";
+
+void controller_print_ilm(nvObj_t *nv) { text_print(nv, fmt_ilm);}
+void controller_print_ilh(nvObj_t *nv) { text_print(nv, fmt_ilh);}
+void controller_print_ilt(nvObj_t *nv) { text_print(nv, fmt_ilt);}
+
+#endif // __TEXT_MODE
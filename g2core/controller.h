@@ -77,6 +77,15 @@ typedef struct controllerSingleton {    // main TG controller struct
     char out_buf[OUTPUT_BUFFER_LEN];    // output buffer
     char saved_buf[SAVED_BUFFER_LEN];   // save the input buffer
 
+    // multi-line ingest (see _dispatch_command())
+    uint8_t ingest_lines_max;           // ilm: most Gcode lines read in one pass (0 or 1 = one line per pass)
+    uint8_t ingest_margin;              // ilh: free planner buffers needed above PLANNER_BUFFER_HEADROOM to read another
+    uint32_t ingest_budget;             // ilt: time budget for the lines read in one pass, in microseconds
+    uint32_t ingest_passes;             // passes that read at least one Gcode line
+    uint32_t ingest_lines;              // Gcode lines read by those passes
+    uint32_t ingest_budget_cuts;        // batches ended by the time budget
+    uint8_t ingest_max;                 // most lines read in one pass
+
     magic_t magic_end;
 } controller_t;
 
@@ -90,4 +99,17 @@ void controller_set_connected(bool is_connected);
 void controller_set_muted(bool is_muted);
 bool controller_parse_control(char *p);
 
+stat_t controller_clin(nvObj_t *nv);
+stat_t controller_get_ila(nvObj_t *nv);
+
+#ifdef __TEXT_MODE
+    void controller_print_ilm(nvObj_t *nv);
+    void controller_print_ilh(nvObj_t *nv);
+    void controller_print_ilt(nvObj_t *nv);
+#else
+    #define controller_print_ilm tx_print_stub
+    #define controller_print_ilh tx_print_stub
+    #define controller_print_ilt tx_print_stub
+#endif
+
 #endif // End of include guard: CONTROLLER_H_ONCE
@@ -117,14 +117,14 @@ void cm_coolant_resume() {
 stat_t cm_flood_coolant_control(uint8_t flood_enable) {
     float value[] = {(float)flood_enable, 0, 0, 0, 0, 0};
     bool  flags[] = {1, 0, 0, 0, 0, 0};
-    mp_queue_command(_exec_coolant_control, value, flags);
+    cm_queue_command(_exec_coolant_control, value, flags);
     return (STAT_OK);
 }
 
 stat_t cm_mist_coolant_control(uint8_t mist_enable) {
     float value[] = {0, (float)mist_enable, 0, 0, 0, 0};
     bool  flags[] = {0, 1, 0, 0, 0, 0};
-    mp_queue_command(_exec_coolant_control, value, flags);
+    cm_queue_command(_exec_coolant_control, value, flags);
     return (STAT_OK);
 }
 
@@ -349,7 +349,7 @@ static stat_t _homing_axis_move(int8_t axis, float target, float velocity) {
     }
 
     // the last two arguments are ignored anyway
-    mp_queue_command(_homing_axis_move_callback, nullptr, nullptr);
+    cm_queue_command(_homing_axis_move_callback, nullptr, nullptr);
 
     return (STAT_EAGAIN);
 }
@@ -99,6 +99,8 @@ static void _motion_end_callback(float* vect, bool* flag)
  *  encoders, then requests a "high speed" feedhold. We then run forward kinematics
  *  on the encoder snapshot to get the reported position. We also execute a move
  *  from the final position (after the feedhold) back to the point we report.
+ *  A probe on CAN is handled after it trips, so its snapshot is taken for the time
+ *  the frame arrived instead (see can_bus.h).
  *
  *  Additionally, we record the last PROBES_STORED (at least 3) probe points that
  *  succeeded. The current or most recent probe (be it success, failure, or
@@ -176,7 +178,7 @@ uint8_t cm_straight_probe(float target[], bool flags[], bool trip_sense, bool al
     // queue a function to let us know when we can start probing
     cm.probe_state[0] = PROBE_WAITING;      // wait until planner queue empties before starting movement
     pb.wait_for_motion_end = true;
-    mp_queue_command(_motion_end_callback, nullptr, nullptr);  // note: these args are ignored
+    cm_queue_command(_motion_end_callback, nullptr, nullptr);  // note: these args are ignored
     return (STAT_OK);
 }
 
@@ -286,7 +288,7 @@ static stat_t _probe_move(const float target[], const bool flags[])
     cm_set_absolute_override(MODEL, ABSOLUTE_OVERRIDE_ON);
     pb.wait_for_motion_end = true;          // set this BEFORE the motion starts
     cm_straight_feed(target, flags);
-    mp_queue_command(_motion_end_callback, nullptr, nullptr);      // the last two arguments are ignored anyway
+    cm_queue_command(_motion_end_callback, nullptr, nullptr);      // the last two arguments are ignored anyway
     return (STAT_EAGAIN);
 }
 
@@ -54,6 +54,11 @@ struct StepDirStepper final : Stepper  {
 
     OutputPin<step_num>    _step;
     uint8_t                _step_downcount;
+
+    // PIO port (0 is port A) and bit of the step pin, for port-batched stepping (see board_stepper.h)
+    static constexpr uint8_t  step_port = (step_num < 0) ? 0 : (OutputPin<step_num>::portLetter - 'A');
+    static constexpr uint32_t step_mask = (step_num < 0) ? 0 : OutputPin<step_num>::mask;
+
     OutputPin<dir_num>     _dir;
     OutputPin<enable_num>  _enable{kStartHigh};
     OutputPin<ms0_num>     _ms0;
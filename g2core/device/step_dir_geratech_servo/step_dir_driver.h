@@ -29,38 +29,53 @@
 #define STEPP_DIR_GERATECH_DRIVER_H_ONCE
 
 #include "MotatePins.h"
-#include "MotateTimers.h"
-#include "MotateSPI.h"
-
-#include "board_xio.h"
-#include "encoder.h"
 
 #include "stepper.h"
+#include "canopen.h"
 
-using Motate::pin_number;
-using Motate::OutputPin;
-using Motate::PWMOutputPin;
-using Motate::kStartHigh;
-using Motate::kNormal;
-using Motate::Timeout;
+/*
+ * GeratechServo - a CiA-402 servo drive on the CAN bus, in cyclic synchronous position mode
+ *
+ *  The drive is not stepped. The loader hands over the travel of every segment
+ *  (loadSegment()), the CSP interrupt sends the drive its target once a period, and its
+ *  actual position is read back as the motor's encoder (readEncoder()). See canopen.h for
+ *  the protocol and the drive's PDO mapping.
+ *
+ *  Declare the motor with the drive's node ID in the board's board_stepper files, e.g.
+ *  GeratechServo<1> motor_5, including this header by its path as the step/dir driver's
+ *  has the same name. The board must have CAN_ENABLED. Set its encoder source to the motor ({5es:1}) for following
+ *  error reporting, and leave its power mode at always powered so the drive is enabled
+ *  before motion starts. Enabling latches the drive's position, so a drive enabled
+ *  during a move misses the travel up to that point.
+ */
 
-template <uint8_t t>
+template <uint8_t node_id>
 struct GeratechServo final : Stepper  {
+    static constexpr uint8_t  step_port = 0;        // no step pin (see step_port_mask())
+    static constexpr uint32_t step_mask = 0;
+
+    canDrive_t _drive;
+
+    GeratechServo() : Stepper{}, _drive{}
+    {
+        _drive.node = node_id;
+        canopen_register(&_drive);
+    };
 
     bool canStep() override {
       return true;
     };
 
     void setMicrosteps(const uint8_t microsteps) override {
-
+      // resolution is set in the drive
     };
 
     void _enableImpl() override {
-
+      canopen_enable(&_drive, true);
     };
 
     void _disableImpl() override {
-
+      canopen_enable(&_drive, false);
     };
 
     void stepStart() override {
@@ -78,6 +93,14 @@ struct GeratechServo final : Stepper  {
     void setPowerLevel(float new_pl) override {
 
     };
+
+    void loadSegment(const float travel_steps) override {
+      canopen_load(&_drive, travel_steps);
+    };
+
+    bool readEncoder(int32_t &steps) override {
+      return (canopen_read_position(&_drive, steps));
+    };
 };
 
-#endif  // STEPP_DIR_DRIVER_H_ONCE
+#endif  // STEPP_DIR_GERATECH_DRIVER_H_ONCE
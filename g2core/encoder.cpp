@@ -29,6 +29,7 @@
 #include "config.h"
 #include "encoder.h"
 #include "canonical_machine.h"  // needed for cm_panic() in assertions
+#include "planner.h"            // mp_get_runtime_steps_at()
 
 /**** Allocate Structures ****/
 
@@ -72,12 +73,19 @@ stat_t encoder_test_assertions() {
  *	Sets the encoder_position steps. Takes floating point steps as input,
  *	writes integer steps. So it's not an exact representation of machine
  *	position except if the machine is at zero.
+ *
+ *	For motors that report their position (encoder source 1) this sets the offset from
+ *	the last position read, so later readings are relative to the new step count.
  */
 
-void en_set_encoder_steps(uint8_t motor, float steps) { en.en[motor].encoder_steps = (int32_t)round(steps); }
+void en_set_encoder_steps(uint8_t motor, float steps) {
+    en.en[motor].encoder_steps = (int32_t)round(steps);
+    en.en[motor].measured_offset = en.en[motor].encoder_steps - en.en[motor].measured_steps;
+}
 
 /*
- * en_read_encoder()
+ * en_read_encoder()       - return encoder position in steps as a float
+ * en_read_encoder_steps() - return encoder position in steps as an integer (fixed-point runtime)
  *
  *	The stepper ISR count steps into steps_run(). These values are accumulated to
  *	encoder_position during LOAD (HI interrupt level). The encoder position is
@@ -87,9 +95,11 @@ void en_set_encoder_steps(uint8_t motor, float steps) { en.en[motor].encoder_ste
  */
 
 float en_read_encoder(uint8_t motor) { return ((float)en.en[motor].encoder_steps); }
+int32_t en_read_encoder_steps(uint8_t motor) { return (en.en[motor].encoder_steps); }
 
 /*
  * en_take_encoder_snapshot()
+ * en_take_encoder_snapshot_at()
  * en_get_encoder_snapshot_position()
  * en_get_encoder_snapshot_vector()
  *
@@ -100,6 +110,9 @@ float en_read_encoder(uint8_t motor) { return ((float)en.en[motor].encoder_steps
  *
  *  The results are in STEPS, which may need to be converted back to position using
  *  forward kinematics, depending on your use. See probe cycle for example.
+ *
+ *  en_take_encoder_snapshot_at() takes the snapshot for an earlier time on the motion
+ *  clock, for inputs that are handled after they tripped (see mp_get_runtime_steps_at()).
  */
 void en_take_encoder_snapshot() {
     for (uint8_t m = 0; m < MOTORS; m++) { en.snapshot[m] = en.en[m].encoder_steps + en.en[m].steps_run; }
@@ -114,6 +127,8 @@ void en_take_encoder_snapshot() {
     */
 }
 
+void en_take_encoder_snapshot_at(const uint32_t ticks) { mp_get_runtime_steps_at(ticks, en.snapshot); }
+
 float en_get_encoder_snapshot_steps(uint8_t motor) { return (en.snapshot[motor]); }
 
 float* en_get_encoder_snapshot_vector() { return (en.snapshot); }
@@ -32,6 +32,10 @@
  *	future when we have real encoders we'll stop counting steps and actually measure the
  *	position. Which should be a lot easier than how this module currently works.
  *
+ *	Motors whose driver reports a position (e.g. servos) can be read instead of counted.
+ *	Set the motor's encoder source to 1 ({1es:1}) and the loader reads the driver once per
+ *	segment (see Stepper::readEncoder() and step correction in stepper.h).
+ *
  *	*** Measuring position ***
  *
  *	The challenge is that you can't just measure the position at any arbitrary point
@@ -101,6 +105,9 @@
 #define ACCUMULATE_ENCODER(m)                     \
     en.en[m].encoder_steps += en.en[m].steps_run; \
     en.en[m].steps_run = 0;
+#define SET_ENCODER_MEASURED(m, s)                \
+    en.en[m].measured_steps = s;                  \
+    en.en[m].encoder_steps = s + en.en[m].measured_offset;
 
 /**** Structures ****/
 
@@ -108,6 +115,8 @@ typedef struct enEncoder {          // one real or virtual encoder per controlle
     int8_t  step_sign;              // set to +1 or -1
     int16_t steps_run;              // + or - steps counted during stepper interrupt
     int32_t encoder_steps;          // counted encoder position	in steps
+    int32_t measured_steps;         // last position read from the motor (encoder source 1)
+    int32_t measured_offset;        // encoder_steps - measured_steps, set by en_set_encoder_steps()
 } enEncoder_t;
 
 typedef struct enEncoders {
@@ -129,8 +138,10 @@ stat_t encoder_test_assertions(void);
 
 void en_set_encoder_steps(uint8_t motor, float steps);
 float en_read_encoder(uint8_t motor);
+int32_t en_read_encoder_steps(uint8_t motor);
 
 void en_take_encoder_snapshot();
+void en_take_encoder_snapshot_at(const uint32_t ticks);
 float en_get_encoder_snapshot_steps(uint8_t motor);
 float* en_get_encoder_snapshot_vector();
 
@@ -314,15 +314,15 @@ char *get_status_message(stat_t status);
 #define STAT_TEMPERATURE_CONTROL_ERROR 209      // temperature controls err'd out
 
 #define STAT_G29_NOT_CONFIGURED 210
-#define STAT_ERROR_211 211
-#define STAT_ERROR_212 212
-#define STAT_ERROR_213 213
-#define STAT_ERROR_214 214
-#define STAT_ERROR_215 215
-#define STAT_ERROR_216 216
-#define STAT_ERROR_217 217
-#define STAT_ERROR_218 218
-#define STAT_ERROR_219 219
+#define STAT_FOLLOWING_ERROR_EXCEEDED 211       // a motor's following error went over its limit
+#define STAT_NO_ENCODER 212                     // motor does not report its position
+#define STAT_CAN_DRIVE_FAULT 213                // a CAN servo drive reported a fault
+#define STAT_BINARY_STREAM_DISABLED 214         // binary frame received before {bin:1}
+#define STAT_BINARY_FRAME_MALFORMED 215         // binary frame or record could not be decoded
+#define STAT_BINARY_FRAME_CRC_ERROR 216         // binary frame failed its CRC
+#define STAT_BINARY_FRAME_SEQUENCE_ERROR 217    // binary frame out of sequence
+#define STAT_BINARY_FRAME_UNKNOWN_POSITION 218  // binary record has a delta for an axis with no position
+#define STAT_CAN_BUS_OVERLOAD 219               // CAN servo frames were refused, or do not fit the bus
 
 #define STAT_SOFT_LIMIT_EXCEEDED 220            // soft limit error - axis unspecified
 #define STAT_SOFT_LIMIT_EXCEEDED_XMIN 221       // soft limit error - X minimum
@@ -605,15 +605,15 @@ static const char stat_208[] = "No GPIO for this value";
 static const char stat_209[] = "209";
 
 static const char stat_210[] = "Marlin G29 command was not configured at compile-time";
-static const char stat_211[] = "211";
-static const char stat_212[] = "212";
-static const char stat_213[] = "213";
-static const char stat_214[] = "214";
-static const char stat_215[] = "215";
-static const char stat_216[] = "216";
-static const char stat_217[] = "217";
-static const char stat_218[] = "218";
-static const char stat_219[] = "219";
+static const char stat_211[] = "Following error limit exceeded";
+static const char stat_212[] = "Motor does not report its position";
+static const char stat_213[] = "CAN drive fault";
+static const char stat_214[] = "Binary stream is not enabled";
+static const char stat_215[] = "Binary frame malformed";
+static const char stat_216[] = "Binary frame CRC error";
+static const char stat_217[] = "Binary frame out of sequence";
+static const char stat_218[] = "Binary record delta for an axis with no position";
+static const char stat_219[] = "CAN bus overloaded";
 
 static const char stat_220[] = "Soft limit";
 static const char stat_221[] = "Soft limit - X min";
@@ -44,11 +44,17 @@
 #define __HELP_SCREENS              // enable help screens      (~3.5Kb)
 #define __USER_DATA                 // enable user defined data groups
 #define __STEP_CORRECTION           // enable virtual encoder step correction
+//#define __FIXED_POINT_RUNTIME     // integer segment interpolation and step math; override and timing stay float (see plan_exec.cpp)
+#define __NATIVE_ARCS               // queue arcs as single planner blocks instead of chords (see plan_arc.cpp)
+//#define __COALESCE_LINES          // merge collinear G1s within {clt:} into single blocks (+44 bytes per GCodeState_t)
+//#define __VARIABLE_INTERVAL_DDA   // run the DDA interrupt only on ticks that step (see stepper.cpp)
+#define __BINARY_STREAM             // accept binary motion frames once enabled by {bin:1} (see binary_stream.h)
 
 /****** DEVELOPMENT SETTINGS ******/
 
 #define __DIAGNOSTICS               // enables various debug functions
 #define __DIAGNOSTIC_PARAMETERS     // enables system diagnostic parameters (_xx) in config_app
+//#define __ISR_TIMING              // time the motion and CAN interrupts (see isr_timing.h)
 
 /******************************************************************************
  ***** APPLICATION DEFINITIONS ************************************************
@@ -21,6 +21,7 @@
 #include "config.h"  // #2
 #include "controller.h"
 #include "gcode_parser.h"
+#include "binary_stream.h"
 #include "canonical_machine.h"
 #include "settings.h"
 #include "spindle.h"
@@ -214,10 +215,10 @@ GCodeValue_t gv;    // gcode input values
 GCodeFlag_t gf;     // gcode input flags
 
 // local helper functions and macros
-void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_delete_flag);
+char *_normalize_gcode_block(const char *str, const char *end, char **active_comment, uint8_t *block_delete_flag);
 stat_t _get_next_gcode_word(char **pstr, char *letter, float *value);
 stat_t _point(float value);
-stat_t _verify_checksum(char *str);
+stat_t _verify_checksum(const char *str, const char **end);
 stat_t _validate_gcode_block(char *active_comment);
 stat_t _parse_gcode_block(char *line, char *active_comment); // Parse the block into the GN/GF structs
 stat_t _execute_gcode_block(char *active_comment);           // Execute the gcode block
@@ -240,27 +241,32 @@ void gcode_parser_init()
  * gcode_parser() - parse a block (line) of gcode
  *
  *  Top level of gcode parser. Normalizes block and looks for special cases
+ *
+ *  The block is not modified - it is normalized into _normalize_scratch and parsed from
+ *  there - so the caller can still echo the line as it was received.
  */
 
 stat_t gcode_parser(char *block)
 {
-    char *str = block;                      // gcode command or NUL string
+    char *str;                              // normalized gcode command or NUL string
+    const char *end;                        // checksum that ends the block, or NULL
     char none = NUL;
     char *active_comment = &none;           // gcode comment or NUL string
     uint8_t block_delete_flag;
 
-    stat_t check_ret = _verify_checksum(str);
+    stat_t check_ret = _verify_checksum(block, &end);
     if (check_ret != STAT_OK) {
         return check_ret;
     }
 
-    _normalize_gcode_block(str, &active_comment, &block_delete_flag);
+    str = _normalize_gcode_block(block, end, &active_comment, &block_delete_flag);
 
     // TODO, now MSG is put in the active comment, handle that.
 
     if (str[0] == NUL) {                    // normalization returned null string
         return (STAT_OK);                   // most likely a comment line
     }
+    bs_invalidate();                        // binary records that follow start from absolute values
 
     // Trap M30 and M2 as $clear conditions. This has no effect if not in ALARM or SHUTDOWN
     cm_parse_clear(str);                    // parse Gcode and clear alarms if M30 or M2 is found
@@ -272,7 +278,7 @@ stat_t gcode_parser(char *block)
     if (block_delete_flag == true) {
         return (STAT_NOOP);
     }
-    return(_parse_gcode_block(block, active_comment));
+    return(_parse_gcode_block(str, active_comment));
 }
 
 /*
@@ -280,8 +286,9 @@ stat_t gcode_parser(char *block)
  *
  * Returns STAT_OK is it's valid.
  * Returns STAT_CHECKSUM_MATCH_FAILED if the checksum doesn't match.
+ * end is set to the '*' that starts the checksum (the end of the block), or NULL if there is none.
  */
-stat_t _verify_checksum(char *str)
+stat_t _verify_checksum(const char *str, const char **end)
 {
     bool has_line_number = false; // -1 means we don't have one
     if (*str == 'N') {
@@ -297,8 +304,9 @@ stat_t _verify_checksum(char *str)
 
     // c might be 0 here, in which case we didn't get a checksum and we return STAT_OK
 
+    *end = NULL;
     if (c == '*') {
-        *(str-1) = 0; // null terminate, the parser won't like this * here!
+        *end = str-1; // normalization stops here, the parser won't like this * here!
         gf.checksum = true;
         if (strtol(str, NULL, 10) != checksum) {
             _debug_trap("checksum failure");
@@ -313,7 +321,7 @@ stat_t _verify_checksum(char *str)
 }
 
 /*
- * _normalize_gcode_block() - normalize a block (line) of gcode in place
+ * _normalize_gcode_block() - normalize a block (line) of gcode into _normalize_scratch
  *
  *  Normalization functions:
  *   - Isolate "active comments"
@@ -340,7 +348,10 @@ stat_t _verify_checksum(char *str)
  *   - Multiple active comments will be merged.
  *   - Only ONE MSG comment will be accepted.
  *
+ *  The block ends at a NUL, a ';' or '%' comment, or at end (the checksum) if not NULL.
+ *
  *  Returns:
+ *   - the normalized block, in _normalize_scratch. str is not modified.
  *   - com points to comment string or to NUL if no comment
  *   - msg points to message string or to NUL if no comment
  *   - block_delete_flag is set true if block delete encountered, false otherwise
@@ -348,14 +359,19 @@ stat_t _verify_checksum(char *str)
 
 char _normalize_scratch[RX_BUFFER_SIZE];
 
-void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_delete_flag)
+static inline bool _in_block(const char *p, const char *end)
+{
+    return ((p != end) && (*p != 0));
+}
+
+char *_normalize_gcode_block(const char *str, const char *end, char **active_comment, uint8_t *block_delete_flag)
 {
     _normalize_scratch[0] = 0;
 
-    char *gc_rd = str;                  // read pointer
+    const char *gc_rd = str;            // read pointer
     char *gc_wr = _normalize_scratch;   // write pointer
 
-    char *ac_rd = str;                  // read pointer
+    const char *ac_rd = str;            // read pointer
     char *ac_wr = _normalize_scratch;   // Active Comment write pointer
 
     bool last_char_was_digit = false;   // used for octal stripping
@@ -384,11 +400,11 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
         *block_delete_flag = false;
     }
 
-    while (*gc_rd != 0) {
+    while (_in_block(gc_rd, end)) {
         // check for ';' or '%' comments that end the line.
         if ((*gc_rd == ';') || (*gc_rd == '%')) {
-            // go ahead and snap the string off cleanly here
-            *gc_rd = 0;
+            // the block ends here
+            end = gc_rd;
             break;
         }
 
@@ -406,11 +422,11 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
 
                 // skip the comment, handling strings carefully
                 bool in_string = false;
-                while (*(++gc_rd) != 0) {
+                while (_in_block(++gc_rd, end)) {
                     if (*gc_rd=='"') {
                         in_string = true;
                     } else if (in_string) {
-                        if ((*gc_rd == '\\') && (*(gc_rd+1) != 0)) {
+                        if ((*gc_rd == '\\') && _in_block(gc_rd+1, end)) {
                             gc_rd++; // Skip it, it's escaped.
                         }
 
@@ -418,16 +434,17 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
                         break;
                     }
                 }
-                if (*gc_rd == 0) {      // We don't want the rd++ later to skip the NULL if we're at one
+                if (!_in_block(gc_rd, end)) {   // We don't want the rd++ later to skip the end if we're at it
                     break;
                 }
             } else {
-                *(gc_rd-1) = ' ';       // Change the '(' to a space to simplify the comment copy later
-
-                // skip ahead until we find a ')' (or NULL)
-                while ((*gc_rd != 0) && (*gc_rd != ')')) {
+                // skip ahead until we find a ')' (or the end)
+                while (_in_block(gc_rd, end) && (*gc_rd != ')')) {
                     gc_rd++;
                 }
+                if (!_in_block(gc_rd, end)) {
+                    break;
+                }
             }
         } else if (!isspace(*gc_rd)) {
             bool do_copy = false;
@@ -463,7 +480,7 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
     if (ac_rd != nullptr) {
 
         // Now we'll copy the comments to the scratch
-        while (*ac_rd != 0) {
+        while (_in_block(ac_rd, end)) {
             // check for comment '('
             // Remember: we're only "counting characters" at this point, no more.
             if (*ac_rd == '(') {
@@ -517,7 +534,7 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
                     // skip the comment, handling strings carefully
                     bool in_string = false;
                     bool escaped = false;
-                    while (*ac_rd != 0) {
+                    while (_in_block(ac_rd, end)) {
                         if (in_string && (*ac_rd == '\\')) {
                             escaped = true;
                         } else if (!escaped && (*ac_rd == '"')) {
@@ -548,8 +565,8 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
                     }
                 }
 
-                // We don't want the rd++ later to skip the NULL if we're at one
-                if (*ac_rd == 0) {
+                // We don't want the rd++ later to skip the end if we're at it
+                if (!_in_block(ac_rd, end)) {
                     break;
                 }
             }
@@ -561,10 +578,8 @@ void _normalize_gcode_block(char *str, char **active_comment, uint8_t *block_del
     // Enforce null termination
     *ac_wr = 0;
 
-    // Now copy it all back
-    memcpy(str, _normalize_scratch, (ac_wr-_normalize_scratch)+1);
-
-    *active_comment = str + (comment_start - _normalize_scratch);
+    *active_comment = comment_start;
+    return (_normalize_scratch);
 }
 
 
@@ -996,6 +1011,9 @@ stat_t _execute_gcode_block(char *active_comment)
 
     if (gf.path_control) {                                  // G61, G61.1, G64
         status = cm_set_path_control(MODEL, gv.path_control);
+        if (gv.path_control == PATH_CONTINUOUS) {
+            ritorno(cm_set_path_tolerance(gv.P_word, gf.P_word));   // G64 P
+        }
     }
 
     EXEC_FUNC(cm_set_distance_mode, distance_mode);         // G90, G91
@@ -187,6 +187,7 @@ struct ioDigitalInputExt {
                 cm_panic(STAT_PANIC, msg);
             }
             if (in->action == INPUT_ACTION_RESET) {
+                xio_tx_flush();                         // send what is staged before it is lost
                 hw_hard_reset();
             }
         }
@@ -194,6 +195,7 @@ struct ioDigitalInputExt {
         // these functions trigger on the leading edge
         if (in->edge == INPUT_EDGE_LEADING) {
             if (in->function == INPUT_FUNCTION_LIMIT) {
+                en_take_encoder_snapshot();             // where it tripped, for the alarm
                 cm.limit_requested = ext_pin_number;
 
             } else if (in->function == INPUT_FUNCTION_SHUTDOWN) {
@@ -241,7 +243,9 @@ struct ioDigitalInputVirtual {
       in->state = (ioState)pin_value_corrected;
     }
 
-    void pin_changed(bool pin_value) {
+    // ticks is the motion clock when the input changed (see st_get_motion_ticks()), as
+    // it is handled later. Homing, probing and limit snapshots are taken for that time.
+    void pin_changed(bool pin_value, uint32_t ticks) {
         // xio_writeline("pin_changed\n");
         if (D_IN_CAN_CHANNELS+D_IN_CHANNELS < ext_pin_number) { return; }
         // xio_writeline("in_range\n");
@@ -281,7 +285,7 @@ struct ioDigitalInputVirtual {
         // perform homing operations if in homing mode
         if (in->homing_mode) {
             if (in->edge == INPUT_EDGE_LEADING) {   // we only want the leading edge to fire
-                en_take_encoder_snapshot();
+                en_take_encoder_snapshot_at(ticks);
                 cm_start_hold();
             }
             return;
@@ -292,7 +296,7 @@ struct ioDigitalInputVirtual {
             // We want to capture either way.
             // Probing tests the start condition for the correct direction ahead of time.
             // If we see any edge, it's the right one.
-            en_take_encoder_snapshot();
+            en_take_encoder_snapshot_at(ticks);
             cm_start_hold();
             return;
         }
@@ -326,6 +330,7 @@ struct ioDigitalInputVirtual {
                 cm_panic(STAT_PANIC, msg);
             }
             if (in->action == INPUT_ACTION_RESET) {
+                xio_tx_flush();                         // send what is staged before it is lost
                 hw_hard_reset();
             }
         }
@@ -333,6 +338,7 @@ struct ioDigitalInputVirtual {
         // these functions trigger on the leading edge
         if (in->edge == INPUT_EDGE_LEADING) {
             if (in->function == INPUT_FUNCTION_LIMIT) {
+                en_take_encoder_snapshot_at(ticks);     // where it tripped, for the alarm
                 cm.limit_requested = ext_pin_number;
 
             } else if (in->function == INPUT_FUNCTION_SHUTDOWN) {
@@ -375,16 +381,10 @@ ioDigitalInputExt<kInput12_PinNumber , 12> _din12;
 
 ioDigitalInputVirtual _vdin[D_IN_CAN_CHANNELS];
 
-void can_gpio_received (int pin_num, uint8_t length, uint8_t* data) {
-  //printf("pin: %i\n value: %i\n", pin_num, data[0]);
-
-  if (pin_num >= D_IN_CAN_CHANNELS) return;
-
-  bool pin_value=false;
+void can_gpio_received (int pin_num, bool pin_value, uint32_t ticks) {
+  if ((pin_num < 0) || (pin_num >= D_IN_CAN_CHANNELS)) return;
 
-  if (data[0] > 0) pin_value=true;
-  printf("%i/n", pin_num);
-  _vdin[pin_num].pin_changed(pin_value);
+  _vdin[pin_num].pin_changed(pin_value, ticks);
 }
 
 #endif
@@ -489,9 +489,11 @@ void gpio_init(void)
     output_13_pin.setFrequency(200000);
     // END generated
 
+#ifdef CAN_ENABLED
     for (int i=0;i<D_IN_CAN_CHANNELS;i++) {
       _vdin[i].ext_pin_number=D_IN_CHANNELS+i+1;
     }
+#endif
 
     return(gpio_reset());
 }
@@ -540,9 +542,9 @@ void outputs_reset(void) {
 
   //Can reset
 #ifdef CAN_ENABLED
-  for (int i=D_OUT_CHANNELS; i< D_OUT_CHANNELS+D_OUT_CAN_CHANNELS-1; i++){
+  for (int i=D_OUT_CHANNELS; i< D_OUT_CHANNELS+D_OUT_CAN_CHANNELS; i++){
     if (d_out[i].mode != IO_MODE_DISABLED) {
-      can_digital_output(i, ((d_out[13-1].mode == IO_ACTIVE_LOW) ? true : false));
+      can_digital_output(i+1, ((d_out[i].mode == IO_ACTIVE_LOW) ? true : false));
     }
   }
 #endif
@@ -574,7 +576,9 @@ void inputs_reset(void) {
   _din11.reset();
   _din12.reset();
 
+#ifdef CAN_ENABLED
   for (int i=0;i<D_IN_CAN_CHANNELS;i++) _vdin[i].reset();
+#endif
 }
 
 void gpio_reset(void)
@@ -862,9 +866,7 @@ stat_t io_set_output(nvObj_t *nv)
         } else {
 
           #ifdef CAN_ENABLED
-            bool op = true;
-            if (op <= 0.1) op=false;
-            can_digital_output(output_num, op);
+            can_digital_output(output_num, value > 0.5);
           #endif
         }
     }
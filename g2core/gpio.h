@@ -136,7 +136,7 @@ extern a_out_t  a_out[A_OUT_CHANNELS + A_OUT_CAN_CHANNELS];
  * GPIO function prototypes
  */
 
- void can_gpio_received (int, uint8_t, uint8_t*);
+void can_gpio_received (int pin_num, bool pin_value, uint32_t ticks);  // pin_num is the CAN input, from 0. ticks: see st_get_motion_ticks()
 
 void gpio_init(void);
 void gpio_reset(void);
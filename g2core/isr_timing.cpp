@@ -0,0 +1,103 @@
+/*
+ * isr_timing.cpp - interrupt level cycle accounting
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*  See isr_timing.h for a description of this module.
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "isr_timing.h"
+#include "hardware.h"               // FREQUENCY_DDA
+
+/**** Allocate Structures ****/
+
+isrTiming_t isrt;
+
+/************************************************************************************
+ **** CODE **************************************************************************
+ ************************************************************************************/
+
+/*
+ * isr_timing_init() - start the cycle counter and clear the statistics
+ *
+ *  Call before the interrupts it times are enabled, i.e. ahead of stepper_init().
+ */
+
+void isr_timing_init()
+{
+#ifndef __GLIBC__
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // enable the DWT...
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;                // ...and its cycle counter
+    isrt.dda_tick_cycles = SystemCoreClock / FREQUENCY_DDA;
+#endif
+    isr_cli(NULL);
+}
+
+/*
+ * isr_cli() - clear the ISR timing statistics
+ *
+ *  Like st_clc() this is a command - reading or writing "cli" clears them.
+ *  A run that is in progress when the statistics are cleared is counted afterwards.
+ */
+
+stat_t isr_cli(nvObj_t *nv)
+{
+    for (uint8_t i=0; i<ISR_COUNT; i++) {
+        isrStats_t *s = &isrt.isr[i];
+        s->count = 0;
+        s->min_cycles = 0xFFFFFFFF;
+        s->max_cycles = 0;
+        s->total_cycles = 0;
+        s->max_latency = 0;
+        s->max_depth = 0;
+    }
+    return (STAT_OK);
+}
+
+/*
+ * _get_isr() - helper to return the interrupt named by the token, e.g. "isrda" is ISR_DDA
+ * isr_get_min() - get the shortest run, or 0 if it has not run
+ * isr_get_avg() - get the average run
+ */
+
+static isrStats_t *_get_isr(const index_t index)
+{
+    char *ptr;
+    char isrs[] = {"deflc"};                    // in isrId order
+
+    if ((ptr = strchr(isrs, cfgArray[index].token[3])) == NULL) {
+        return (&isrt.isr[ISR_DDA]);
+    }
+    return (&isrt.isr[ptr - isrs]);
+}
+
+stat_t isr_get_min(nvObj_t *nv)
+{
+    isrStats_t *s = _get_isr(nv->index);
+    nv->value = (s->count == 0) ? 0 : (float)s->min_cycles;
+    nv->valuetype = TYPE_INT;
+    return (STAT_OK);
+}
+
+stat_t isr_get_avg(nvObj_t *nv)
+{
+    isrStats_t *s = _get_isr(nv->index);
+    nv->value = (s->count == 0) ? 0 : (float)s->total_cycles / s->count;
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
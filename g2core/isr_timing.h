@@ -0,0 +1,247 @@
+/*
+ * isr_timing.h - interrupt level cycle accounting
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * ISR timing keeps execution time statistics for the motion and CAN interrupts:
+ *
+ *    - the DDA timer interrupt                 (dda_timer_type::interrupt())
+ *    - the exec software interrupt             (exec_timer_type::interrupt())
+ *    - the forward planning software interrupt (fwd_plan_timer_type::interrupt())
+ *    - the loader                              (_load_move())
+ *    - the CAN controller interrupt            (CANRaw::interruptHandler())
+ *
+ *  For each one it records the number of runs, the min, average and max execution
+ *  time, the deepest interrupt nesting it ran at and the worst latency seen:
+ *
+ *    - DDA:  how late the interrupt ran against the DDA tick grid. The grid starts at
+ *            the first interrupt after the timer is started, so the latency of that
+ *            interrupt is not counted.
+ *    - exec and forward planning: time from st_request_exec_move() or
+ *            st_request_forward_plan() pending the interrupt to the interrupt running.
+ *    - CAN:  time from the controller timestamping a received frame to the mailbox
+ *            being read.
+ *
+ *  The loader is not an interrupt of its own. It runs in the DDA, exec or SysTick
+ *  interrupt, or from the main loop, so its depth shows the level it was called at.
+ *  It also calls itself to load the entry behind a command. A run that starts while
+ *  the same id is already being timed in the same interrupt context is part of the
+ *  outer run and is not counted. A load that preempts another load from a higher
+ *  priority interrupt is timed as a run of its own, and the outer run includes it.
+ *  The context is the Cortex-M exception number. Host builds have none, so there the
+ *  nesting depth stands in for it and only preemption by a timed interrupt is seen.
+ *
+ *  Times are in CPU cycles from the Cortex-M cycle counter (DWT CYCCNT). The sim and
+ *  other host builds use the host's monotonic clock instead, so times are in host
+ *  nanoseconds and the DDA and CAN latencies are not measured.
+ *
+ *  The statistics are read as the "isr" group (e.g. {"isr":n}) and cleared by {"cli":n}.
+ *  Timing is compiled in by __ISR_TIMING (see g2core.h), which is off by default. Without
+ *  it IsrTimer is empty, the hooks compile away and the "isr" group and "cli" are left out.
+ */
+
+#ifndef ISR_TIMING_H_ONCE
+#define ISR_TIMING_H_ONCE
+
+#include "g2core.h"
+#include "config.h"
+
+#ifdef __GLIBC__
+#include <time.h>
+#else
+#include "sam.h"                    // CMSIS - DWT, CoreDebug and SystemCoreClock
+#endif
+
+typedef enum {
+    ISR_DDA = 0,                    // DDA timer interrupt
+    ISR_EXEC,                       // exec software interrupt
+    ISR_FWD_PLAN,                   // forward planning software interrupt
+    ISR_LOAD,                       // loader - runs at the level of its caller
+    ISR_CAN,                        // CAN controller interrupt
+    ISR_COUNT                       // number of timed interrupts
+} isrId;
+
+typedef struct isrStats {           // one per timed interrupt - only written by that interrupt
+    uint32_t count;                 // number of runs since the last clear
+    uint32_t min_cycles;            // shortest run
+    uint32_t max_cycles;            // longest run
+    uint64_t total_cycles;          // for the average
+    uint32_t max_latency;           // worst latency (see above)
+    uint8_t max_depth;              // deepest nesting level it ran at (1 = not nested)
+    bool running;                   // being timed...
+    uint32_t context;               // ...in this context - a nested run in the same context is not counted
+
+    volatile bool requested;        // software interrupt has been pended...
+    uint32_t request_cycles;        // ...at this time
+} isrStats_t;
+
+typedef struct isrTiming {
+    volatile uint8_t depth;         // number of timed interrupts currently running
+    uint32_t dda_tick_cycles;       // cycles per DDA tick
+    bool dda_expecting;             // DDA grid is running...
+    uint32_t dda_expected;          // ...and the interrupt is due at this time
+    isrStats_t isr[ISR_COUNT];
+} isrTiming_t;
+
+extern isrTiming_t isrt;
+
+/*
+ * isr_cycles() - read the cycle counter (host nanoseconds on host builds)
+ */
+
+inline uint32_t isr_cycles()
+{
+#ifdef __GLIBC__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec));
+#else
+    return (DWT->CYCCNT);
+#endif
+}
+
+/*
+ * isr_context() - the interrupt context the caller runs in (see above)
+ */
+
+inline uint32_t isr_context()
+{
+#ifdef __GLIBC__
+    return (isrt.depth);
+#else
+    return (__get_IPSR());          // exception number, 0 in thread mode
+#endif
+}
+
+#ifdef __ISR_TIMING
+
+/*
+ * isr_request()     - note the time a software interrupt was pended
+ * isr_dda_ticks()   - advance the DDA grid and record the DDA latency. Call on entry.
+ * isr_dda_stopped() - the DDA timer has stopped, so the grid must restart
+ * isr_can_latency() - record a CAN latency in cycles
+ */
+
+inline void isr_request(const uint8_t id)
+{
+    isrStats_t *s = &isrt.isr[id];
+    if (!s->requested) {                        // the first request starts the wait
+        s->request_cycles = isr_cycles();
+        s->requested = true;
+    }
+}
+
+inline void isr_dda_ticks(const uint32_t ticks, const uint32_t start)
+{
+#ifndef __GLIBC__
+    if (isrt.dda_expecting) {
+        isrt.dda_expected += isrt.dda_tick_cycles * ticks;
+        int32_t late = (int32_t)(start - isrt.dda_expected);
+        if ((late > 0) && ((uint32_t)late > isrt.isr[ISR_DDA].max_latency)) {
+            isrt.isr[ISR_DDA].max_latency = late;
+        }
+    } else {
+        isrt.dda_expected = start;
+        isrt.dda_expecting = true;
+    }
+#endif
+}
+
+inline void isr_dda_stopped() { isrt.dda_expecting = false; }
+
+inline void isr_can_latency(const uint32_t cycles)
+{
+    if (cycles > isrt.isr[ISR_CAN].max_latency) {
+        isrt.isr[ISR_CAN].max_latency = cycles;
+    }
+}
+
+/*
+ * IsrTimer - times the enclosing scope as interrupt 'id'
+ *
+ *  Declare one at the top of the handler. It is stopped by its destructor so early
+ *  returns are timed too.
+ */
+
+struct IsrTimer {
+    const uint8_t id;
+    const uint32_t start;
+    const bool nested;
+    bool outer_running;             // the run this one preempted, restored when it ends
+    uint32_t outer_context;
+
+    IsrTimer(const uint8_t isr_id) : id{isr_id}, start{isr_cycles()},
+        nested{isrt.isr[isr_id].running && (isrt.isr[isr_id].context == isr_context())}
+    {
+        isrStats_t *s = &isrt.isr[id];
+        if (nested) {
+            return;
+        }
+        outer_running = s->running;
+        outer_context = s->context;
+        s->running = true;
+        if (s->requested) {
+            s->requested = false;
+            uint32_t latency = start - s->request_cycles;
+            if (latency > s->max_latency) {
+                s->max_latency = latency;
+            }
+        }
+        if (++isrt.depth > s->max_depth) {
+            s->max_depth = isrt.depth;
+        }
+        s->context = isr_context();             // after the depth - host builds compare depths
+    };
+
+    ~IsrTimer()
+    {
+        if (nested) {
+            return;
+        }
+        uint32_t cycles = isr_cycles() - start;
+        isrStats_t *s = &isrt.isr[id];
+        s->running = outer_running;
+        s->context = outer_context;
+        isrt.depth--;
+        s->count++;
+        s->total_cycles += cycles;
+        if (cycles < s->min_cycles) { s->min_cycles = cycles; }
+        if (cycles > s->max_cycles) { s->max_cycles = cycles; }
+    };
+};
+
+#else // __ISR_TIMING
+
+inline void isr_request(const uint8_t id) {}
+inline void isr_dda_ticks(const uint32_t ticks, const uint32_t start) {}
+inline void isr_dda_stopped() {}
+inline void isr_can_latency(const uint32_t cycles) {}
+
+struct IsrTimer {
+    const uint32_t start = 0;
+    IsrTimer(const uint8_t isr_id) {};
+};
+
+#endif // __ISR_TIMING
+
+/**** Function Prototypes ****/
+
+void isr_timing_init(void);
+
+stat_t isr_cli(nvObj_t *nv);
+stat_t isr_get_min(nvObj_t *nv);
+stat_t isr_get_avg(nvObj_t *nv);
+
+#endif // End of include guard: ISR_TIMING_H_ONCE
@@ -540,7 +540,7 @@ void json_print_response(uint8_t status, const bool only_to_muted /*= false*/)
     nvObj_t *nv = nv_body;
     if (status == STAT_JSON_SYNTAX_ERROR) {
         nv_reset_nv_list();
-        nv_add_string((const char *)"err", escape_string(cs.bufp, cs.saved_buf));
+        nv_add_string((const char *)"err", escape_string(cs.out_buf, cs.saved_buf)); // not cs.bufp - it may be in the RX buffer
 
     } else if ((cm.machine_state != MACHINE_INITIALIZING) || (status == STAT_INITIALIZING)) { // always do full echo during startup
         uint8_t nv_type;
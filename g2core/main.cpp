@@ -30,12 +30,14 @@
 #include "report.h"
 #include "planner.h"
 #include "stepper.h"
+#include "isr_timing.h"
 #include "encoder.h"
 #include "spindle.h"
 #include "temperature.h"
 #include "gpio.h"
 #include "pwm.h"
 #include "xio.h"
+#include "canopen.h"
 
 #include "util.h"
 #include "MotateUniqueID.h"
@@ -102,6 +104,7 @@ void application_init_machine(void)
 {
     cm.machine_state = MACHINE_INITIALIZING;
 
+    isr_timing_init();              // interrupt timing - ahead of the interrupts it times
     stepper_init();                 // stepper subsystem
     encoder_init();                 // virtual encoders
     gpio_init();                    // inputs and outputs
@@ -145,6 +148,7 @@ void setup(void)
     application_init_startup();
 #ifdef CAN_ENABLED
     hw_can_init();
+    canopen_init();                 // CAN servo CSP interrupt - after the driver is up
 #endif
 }
 
@@ -296,7 +296,7 @@ bool _queue_next_temperature_commands()
         }
 
         if (MarlinSetTempState::StartingUpdates == set_temp_state) {
-            mp_queue_command(_marlin_start_temperature_updates, nullptr, nullptr);
+            cm_queue_command(_marlin_start_temperature_updates, nullptr, nullptr);
 
             set_temp_state = MarlinSetTempState::StartingWait;
             if (mp_planner_is_full()) {
@@ -318,7 +318,7 @@ bool _queue_next_temperature_commands()
         }
 
         if (MarlinSetTempState::StoppingUpdates == set_temp_state) {
-            mp_queue_command(_marlin_end_temperature_updates, nullptr, nullptr);
+            cm_queue_command(_marlin_end_temperature_updates, nullptr, nullptr);
 
             set_temp_state = MarlinSetTempState::Idle;
         }
@@ -34,6 +34,9 @@ static stat_t _compute_arc(const bool radius_f);
 static void _compute_arc_offsets_from_radius(void);
 static float _estimate_arc_time (float arc_time);
 static stat_t _test_arc_soft_limits(void);
+#ifdef __NATIVE_ARCS
+static stat_t _queue_arc(void);
+#endif
 
 /*****************************************************************************
  * Canonical Machining arc functions (arc prep for planning and runtime)
@@ -99,8 +102,9 @@ stat_t cm_arc_callback()
 /*
  * cm_arc_feed() - canonical machine entry point for arcs
  *
- * Generates an arc by queuing line segments to the move buffer. The arc is
- * approximated by generating a large number of tiny, linear segments.
+ * Queues the arc to the planner as a single arc block that the runtime interpolates
+ * (see mp_arc()). If native arcs are compiled out or the coordinates are rotated the
+ * arc is approximated by queuing a large number of tiny, linear segments instead.
  */
 
 stat_t cm_arc_feed(const float target[], const bool target_f[],     // target endpoint
@@ -255,13 +259,57 @@ stat_t cm_arc_feed(const float target[], const bool target_f[],     // target en
         copy_vector(cm.gm.target, arc.position);        // reset model position
         return (cm_alarm(status, "arc soft_limits"));   // throw an alarm
     }
+    cm_flush_coalesced_move();                          // a pending G1 must be queued ahead of the arc
 
+#ifdef __NATIVE_ARCS
+    if (!cm_is_rotated()) {                             // arc geometry can't follow a rotated plane
+        return (_queue_arc());
+    }
+#endif
     cm_cycle_start();                                   // if not already started
     arc.run_state = BLOCK_ACTIVE;                       // enable arc to be run from the callback
     cm_finalize_move();
     return (STAT_OK);
 }
 
+#ifdef __NATIVE_ARCS
+/*
+ * _queue_arc() - queue the arc as a single planner block
+ *
+ *  Uses the Gcode model state (cm.gm) and not arc.gm, which is set up for segments.
+ *  The end radius is measured so the runtime can land exactly on the target.
+ */
+
+static stat_t _queue_arc()
+{
+    mpArcBuf_t arc_block;
+
+    arc_block.plane_axis_0 = arc.plane_axis_0;
+    arc_block.plane_axis_1 = arc.plane_axis_1;
+    arc_block.linear_axis = arc.linear_axis;
+    arc_block.blend = false;
+    arc_block.center_0 = arc.center_0;
+    arc_block.center_1 = arc.center_1;
+    arc_block.radius = arc.radius;
+    arc_block.radius_travel = hypotf(cm.gm.target[arc.plane_axis_0] - arc.center_0,
+                                     cm.gm.target[arc.plane_axis_1] - arc.center_1) - arc.radius;
+    arc_block.theta = arc.theta;
+    arc_block.angular_travel = arc.angular_travel;
+
+    cm_cycle_start();                                   // if not already started
+    stat_t status = mp_arc(&cm.gm, &arc_block);
+    cm_finalize_move();
+
+    if (status == STAT_MINIMUM_LENGTH_MOVE) {
+        if (!mp_has_runnable_buffer()) {                // handle condition where zero-length move is last or only move
+            cm_cycle_end();                             // ...otherwise cycle will not end properly
+        }
+        status = STAT_OK;
+    }
+    return (status);
+}
+#endif
+
 /*
  * _compute_arc() - compute arc from I and J (arc center point)
  *
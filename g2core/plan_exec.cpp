@@ -43,8 +43,24 @@ static stat_t _exec_aline_head(mpBuf_t *bf); // passing bf because body might ne
 static stat_t _exec_aline_body(mpBuf_t *bf); // passing bf so that body can extend itself if the exit velocity rises.
 static stat_t _exec_aline_tail(mpBuf_t *bf);
 static stat_t _exec_aline_segment(void);
+static uint32_t _read_encoders(int32_t encoder_steps[]);
 
 static void _init_forward_diffs(float v_0, float v_1);
+static void _init_section_length(float length);
+static void _next_segment_velocity(void);
+static void _update_forward_diffs(void);
+static float _time_scale_target(void);
+static float _init_time_scale(void);
+static bool _time_scale_is_held(void);
+static float _scale_segment_time(void);
+static void _get_arc_position(const float travel, float position[]);
+static float _get_arc_travel(void);
+static void _trim_arc_block(mpBuf_t *bf);
+#ifdef __FIXED_POINT_RUNTIME
+static void _init_fixed_point_block(void);
+static void _turn_arc_phasor(void);
+static void _get_arc_position_q(void);
+#endif
 
 /*******************************************************************************
  * mp_forward_plan() - plan commands and moves ahead of exec; call ramping for moves
@@ -216,17 +232,18 @@ stat_t mp_forward_plan()
     }
 
     // bf points to command; start cases 1f, 1g, 1h, 1i, 1j, 1k, 2c, 2d, 2e, 2h, 2i, 2j
-    if (bf->block_type != BLOCK_TYPE_ALINE) {       // meaning it's a COMMAND
+    if (bf->block_type >= BLOCK_TYPE_COMMAND) {     // meaning it's a COMMAND
         bf = _plan_commands(bf);                    // plan commands or skip past already planned commands
         // bf now points to the first non-command buffer past the command(s)
-        if ((bf->block_type == BLOCK_TYPE_ALINE) && (bf->buffer_state > MP_BUFFER_PREPPED )) { // case 1i
+        if (((bf->block_type == BLOCK_TYPE_ALINE) || (bf->block_type == BLOCK_TYPE_ARC)) &&
+            (bf->buffer_state > MP_BUFFER_PREPPED )) { // case 1i
             entry_velocity = mr.r->exit_velocity;   // set entry_velocity for Note 1a
         }        
     } 
     // bf will always be on a non-command at this point - either a move or empty buffer
 
     // process move                           
-    if (bf->block_type == BLOCK_TYPE_ALINE) {       // do cases 1a - 1e; finish cases 1f - 1k
+    if ((bf->block_type == BLOCK_TYPE_ALINE) || (bf->block_type == BLOCK_TYPE_ARC)) { // do cases 1a - 1e; finish cases 1f - 1k
         if (bf->buffer_state == MP_BUFFER_PREPPED) {// do 1a; finish 1f, 1j, 2d, 2i
             return (_plan_move(bf, entry_velocity));
         } else {
@@ -253,7 +270,7 @@ stat_t mp_exec_move()
         return (STAT_NOOP);
     }
 
-    if (bf->block_type == BLOCK_TYPE_ALINE) {             // cycle auto-start for lines only
+    if ((bf->block_type == BLOCK_TYPE_ALINE) || (bf->block_type == BLOCK_TYPE_ARC)) { // cycle auto-start for moves only
 
         // first-time operations
         if (bf->buffer_state != MP_BUFFER_RUNNING) {
@@ -415,7 +432,10 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         }
 
         // Start a new move by setting up the runtime singleton (mr)
-        memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t)); // copy in the gcode model state
+        memcpy(&mr.gm, bf->gm, sizeof(GCodeState_t));   // copy in the gcode model state
+        for (uint8_t a=0; a<AXES; a++) {                 // start the block with no summation carry
+            mr.target_comp[a] = 0;
+        }
         bf->block_state = BLOCK_ACTIVE;                  // note that this buffer is running
                                                          // note the planner doesn't look at block_state
         mr.block_state = BLOCK_INITIAL_ACTION;
@@ -426,6 +446,10 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         mr.r = mr.p;        // we are now going to run the planning block
         mr.p = mr.p->nx;    // re-use the old running block as the new planning block
 
+        // feed override - see _time_scale_target()
+        mr.override_factor = fp_ZERO(bf->override_factor) ? 1 : bf->override_factor;
+        mr.time_scale_max = fp_ZERO(mr.r->cruise_velocity) ? 1 : (bf->absolute_vmax / mr.r->cruise_velocity);
+
         // Assumptions that are required for this to work:
         // entry velocity <= cruise velocity && cruise velocity >= exit velocity
         // Even if the move is head or tail only, cruise velocity needs to be valid.
@@ -497,15 +521,29 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         }
 
         copy_vector(mr.unit, bf->unit);
-        copy_vector(mr.target, bf->gm.target);          // save the final target of the move
+        copy_vector(mr.target, bf->gm->target);          // save the final target of the move
         copy_vector(mr.axis_flags, bf->axis_flags);
 
         // generate the way points for position correction at section ends
-        for (uint8_t axis=0; axis<AXES; axis++) {
-            mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.r->head_length;
-            mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length);
-            mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length + mr.r->tail_length);
+        mr.block_type = bf->block_type;
+        if (mr.block_type == BLOCK_TYPE_ARC) {
+            memcpy(&mr.arc, bf->arc, sizeof(mpArcBuf_t));
+            copy_vector(mr.arc_start, mr.position);
+            mr.arc_length = bf->length;
+            mr.arc_travel = 0;
+            _get_arc_position(mr.r->head_length, mr.waypoint[SECTION_HEAD]);
+            _get_arc_position(mr.r->head_length + mr.r->body_length, mr.waypoint[SECTION_BODY]);
+            copy_vector(mr.waypoint[SECTION_TAIL], mr.target);
+        } else {
+            for (uint8_t axis=0; axis<AXES; axis++) {
+                mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.r->head_length;
+                mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length);
+                mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.r->head_length + mr.r->body_length + mr.r->tail_length);
+            }
         }
+#ifdef __FIXED_POINT_RUNTIME
+        _init_fixed_point_block();
+#endif
     }
 
     // Feed Override Processing - We need to handle the following cases (listed in rough sequence order):
@@ -554,7 +592,11 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         if (cm.hold_state == FEEDHOLD_DECEL_END) {
             mr.block_state = BLOCK_INACTIVE;                                    // invalidate mr buffer to reset the new move
             bf->block_state = BLOCK_INITIAL_ACTION;                             // tell _exec to re-use the bf buffer
-            bf->length = get_axis_vector_length(mr.target, mr.position);// reset length
+            if (mr.block_type == BLOCK_TYPE_ARC) {
+                _trim_arc_block(bf);                                    // reset length and arc geometry
+            } else {
+                bf->length = get_axis_vector_length(mr.target, mr.position);// reset length
+            }
             //bf->entry_vmax = 0;                                         // set bp+0 as hold point
 
             cm.hold_state = FEEDHOLD_PENDING;
@@ -585,7 +627,9 @@ stat_t mp_exec_aline(mpBuf_t *bf)
             // Case (3b) - currently accelerating - is simply skipped and waited for
             // Small exception, if we *just started* the head, then we're not actually accelerating yet.
             } else if ((mr.section != SECTION_HEAD) || (mr.section_state == SECTION_NEW)) {
-                mr.entry_velocity = mr.segment_velocity;
+                mr.entry_velocity = mp_get_runtime_velocity() * mr.time_scale;
+                mr.r->cruise_velocity *= mr.time_scale;                 // decelerate from the feed override velocity...
+                mr.time_scale = 1;                                      // ...and run the deceleration as planned
 
                 mr.section = SECTION_TAIL;
                 mr.section_state = SECTION_NEW;
@@ -593,7 +637,8 @@ stat_t mp_exec_aline(mpBuf_t *bf)
                 mr.r->head_length = 0;
                 mr.r->body_length = 0;
 
-                float available_length = get_axis_vector_length(mr.target, mr.position);
+                float available_length = (mr.block_type == BLOCK_TYPE_ARC) ? (mr.arc_length - _get_arc_travel()) :
+                                                                              get_axis_vector_length(mr.target, mr.position);
                 mr.r->tail_length = mp_get_target_length(0, mr.r->cruise_velocity, bf);  // braking length
 
                 if (fp_ZERO(available_length - mr.r->tail_length)) {    // (1c) the deceleration time is almost exactly the remaining of the current move
@@ -863,6 +908,183 @@ static void _init_forward_diffs(const float v_0, const float v_1)
     const float half_Ah_5 = A * half_h_5;
 
     mr.segment_velocity = half_Ah_5 + half_Bh_4 + half_Ch_3 + v_0;
+
+#ifdef __FIXED_POINT_RUNTIME
+    // Scale the differences by segment time so the integer chain steps segment length directly
+    mr.forward_diff_q5 = q_from_float(mr.forward_diff_5 * mr.segment_time, LENGTH_Q_BITS);
+    mr.forward_diff_q4 = q_from_float(mr.forward_diff_4 * mr.segment_time, LENGTH_Q_BITS);
+    mr.forward_diff_q3 = q_from_float(mr.forward_diff_3 * mr.segment_time, LENGTH_Q_BITS);
+    mr.forward_diff_q2 = q_from_float(mr.forward_diff_2 * mr.segment_time, LENGTH_Q_BITS);
+    mr.forward_diff_q1 = q_from_float(mr.forward_diff_1 * mr.segment_time, LENGTH_Q_BITS);
+#endif
+}
+
+/*
+ * _init_section_length()   - set up fixed-point segment length and section length (no-op for float)
+ * _next_segment_velocity() - step the segment velocity by the top forward difference
+ * _update_forward_diffs()  - step the rest of the forward difference chain
+ *
+ *  Segment velocity must be set before calling _init_section_length(). The fixed-point
+ *  runtime carries velocity as segment length (velocity * segment_time) to save a multiply.
+ */
+
+static void _init_section_length(const float length)
+{
+#ifdef __FIXED_POINT_RUNTIME
+    mr.segment_length_q = q_from_float(mr.segment_velocity * mr.segment_time, LENGTH_Q_BITS);
+    mr.section_remaining_q = q_from_float(length, LENGTH_Q_BITS);
+#endif
+}
+
+static void _next_segment_velocity()
+{
+#ifdef __FIXED_POINT_RUNTIME
+    mr.segment_length_q += mr.forward_diff_q5;
+#else
+    mr.segment_velocity += mr.forward_diff_5;
+#endif
+}
+
+static void _update_forward_diffs()
+{
+#ifdef __FIXED_POINT_RUNTIME
+    mr.forward_diff_q5 += mr.forward_diff_q4;
+    mr.forward_diff_q4 += mr.forward_diff_q3;
+    mr.forward_diff_q3 += mr.forward_diff_q2;
+    mr.forward_diff_q2 += mr.forward_diff_q1;
+#else
+    mr.forward_diff_5 += mr.forward_diff_4;
+    mr.forward_diff_4 += mr.forward_diff_3;
+    mr.forward_diff_3 += mr.forward_diff_2;
+    mr.forward_diff_2 += mr.forward_diff_1;
+#endif
+}
+
+/*
+ * _time_scale_target()   - the time_scale the runtime is ramping to
+ * _init_time_scale()     - set the lowest time_scale a new section is segmented for
+ * _time_scale_is_held()  - true if the segmentation keeps time_scale from reaching its target
+ * _scale_segment_time()  - ramp time_scale toward its target and return the segment run time
+ *
+ *  time_scale is the runtime part of the feed override (see mp_start_feed_override()). Its
+ *  target is the current override over the override the block was planned with, and it
+ *  moves toward it by at most time_scale_rate per minute of run time, so velocity changes
+ *  smoothly, even across blocks planned with different overrides.
+ *
+ *  Running a planned profile faster would scale its acceleration and jerk by the square
+ *  and cube of time_scale, so only bodies run faster than planned. A body may not run
+ *  faster than it can ramp back down to 1 by its end (ramping from k to 1 takes
+ *  (k^2-1) / (2*rate) of planned time), so heads, tails and junctions are never faster
+ *  than planned. Feedhold decelerations run as planned as well.
+ *
+ *  time_scale only ramps in bodies. Ramping it in a head or tail would add velocity times
+ *  its rate of change to an acceleration the planner has already taken to the limit. So
+ *  heads and tails run at the time_scale they start with (at most 1), and a change that
+ *  arrives during one waits for the next body.
+ *
+ *  A segment runs in segment_time / time_scale, which st_prep_line() needs to be between
+ *  MIN_SEGMENT_TIME and NOM_SEGMENT_TIME (see DDA_SUBSTEPS). So a section is cut into
+ *  segments for the lowest of time_scale, its target and 1, and within the section
+ *  time_scale stays between that floor and the scale that runs a segment in
+ *  MIN_SEGMENT_TIME - about twice the floor. Bodies are cut again when the ramp is held
+ *  by the floor (see _exec_aline_body()). This also limits a body to twice its planned
+ *  velocity.
+ *
+ *  With no override change in progress time_scale and its target are both 1 and the
+ *  segments are exactly as they were without the feed override.
+ *
+ *  This is float in both runtimes. In the fixed-point runtime it is soft-float on parts
+ *  without an FPU, every segment (see _exec_aline_segment()).
+ */
+
+static float _time_scale_target()
+{
+    float target = mp.mfo_factor / mr.override_factor;
+    if (cm.hold_state != FEEDHOLD_OFF) {
+        return (1);
+    }
+    if (target <= 1) {
+        return (target);
+    }
+    if (mr.section != SECTION_BODY) {
+        return (1);
+    }
+    float remaining_time = mr.segment_count * mr.segment_time;     // planned time left in the body
+    return (min3(target, mr.time_scale_max, sqrt(1 + 2 * mr.time_scale_rate * remaining_time)));
+}
+
+static float _init_time_scale()
+{
+    mr.time_scale_floor = min3(mr.time_scale, _time_scale_target(), (float)1.0);
+    return (mr.time_scale_floor);
+}
+
+static bool _time_scale_is_held()
+{
+    float target = _time_scale_target();
+    return ((target < mr.time_scale_floor) ||
+            ((target > mr.time_scale) && (mr.time_scale < 1) && (mr.time_scale * MIN_SEGMENT_TIME >= mr.segment_time)));
+}
+
+static float _scale_segment_time()
+{
+    if (mr.section != SECTION_BODY) {           // heads and tails run at the scale they start with
+        return (mr.segment_time / mr.time_scale);
+    }
+    float target = _time_scale_target();
+    if (mr.time_scale != target) {
+        float step = mr.time_scale_rate * mr.segment_time / mr.time_scale;     // ramp over this segment's run time
+        if (mr.time_scale < target) {
+            mr.time_scale = min3(mr.time_scale + step, target, max(mr.segment_time / MIN_SEGMENT_TIME, mr.time_scale));
+        } else {
+            mr.time_scale = max3(mr.time_scale - step, target, mr.time_scale_floor);
+        }
+    }
+    return (mr.segment_time / mr.time_scale);
+}
+
+/*
+ * _get_arc_position() - position on the running arc block after 'travel' mm along it
+ * _get_arc_travel()   - length travelled so far in the running arc block
+ * _trim_arc_block()   - cut an arc block back to what's left of it after a feedhold
+ *
+ *  Axes other than the plane axes (the linear axis of a helix, and rotaries) move in
+ *  proportion to the length travelled. The radius moves from the start to the end radius
+ *  the same way, so the last segment lands on the target even if the Gcode endpoint was a
+ *  little off the circle.
+ */
+
+static void _get_arc_position(const float travel, float position[])
+{
+    float fraction = travel / mr.arc_length;
+    float theta    = mr.arc.theta + fraction * mr.arc.angular_travel;
+    float radius   = mr.arc.radius + fraction * mr.arc.radius_travel;
+
+    for (uint8_t a=0; a<AXES; a++) {
+        position[a] = mr.arc_start[a] + fraction * (mr.target[a] - mr.arc_start[a]);
+    }
+    position[mr.arc.plane_axis_0] = mr.arc.center_0 + sin(theta) * radius;
+    position[mr.arc.plane_axis_1] = mr.arc.center_1 + cos(theta) * radius;
+}
+
+static float _get_arc_travel()
+{
+#ifdef __FIXED_POINT_RUNTIME
+    mr.arc_travel = q_to_float(mr.arc_travel_q, LENGTH_Q_BITS);    // the fixed-point runtime keeps only arc_travel_q current
+#endif
+    return (mr.arc_travel);
+}
+
+static void _trim_arc_block(mpBuf_t *bf)
+{
+    float fraction = _get_arc_travel() / mr.arc_length;
+
+    bf->arc->theta = mr.arc.theta + fraction * mr.arc.angular_travel;
+    bf->arc->radius = mr.arc.radius + fraction * mr.arc.radius_travel;
+    bf->arc->angular_travel = mr.arc.angular_travel * (1 - fraction);
+    bf->arc->radius_travel = mr.arc.radius_travel * (1 - fraction);
+    bf->length = mr.arc_length - mr.arc_travel;
+    mp_get_arc_unit(bf, 0, bf->unit);                       // entry tangent of what's left
 }
 
 /*********************************************************************************************
@@ -878,7 +1100,7 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
             mr.section = SECTION_BODY;
             return(_exec_aline_body(bf));                            // skip ahead to the body generator
         }
-        mr.segments = ceil(uSec(mr.r->head_time) / NOM_SEGMENT_USEC);// # of segments for the section
+        mr.segments = ceil(uSec(mr.r->head_time) / (NOM_SEGMENT_USEC * _init_time_scale()));// # of segments for the section
         mr.segment_count = (uint32_t)mr.segments;
         mr.segment_time = mr.r->head_time / mr.segments;             // time to advance for each segment
 
@@ -888,14 +1110,15 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
         } else {
             _init_forward_diffs(mr.entry_velocity, mr.r->cruise_velocity); // <-- sets inital segment_velocity
         }
-        if (mr.segment_time < MIN_SEGMENT_TIME) {
+        _init_section_length(mr.r->head_length);
+        if (mr.segment_time < MIN_SEGMENT_TIME * mr.time_scale_floor) {
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                        // exit without advancing position, say we're done
         }
         mr.section = SECTION_HEAD;
         mr.section_state = SECTION_RUNNING;
     } else {
-        mr.segment_velocity += mr.forward_diff_5;
+        _next_segment_velocity();
     }
 
     if (_exec_aline_segment() == STAT_OK) {                     // set up for second half
@@ -906,10 +1129,7 @@ static stat_t _exec_aline_head(mpBuf_t *bf)
         mr.section = SECTION_BODY;
         mr.section_state = SECTION_NEW;
     } else if (!first_pass) {
-        mr.forward_diff_5 += mr.forward_diff_4;
-        mr.forward_diff_4 += mr.forward_diff_3;
-        mr.forward_diff_3 += mr.forward_diff_2;
-        mr.forward_diff_2 += mr.forward_diff_1;
+        _update_forward_diffs();
     }
     return(STAT_EAGAIN);
 }
@@ -929,17 +1149,31 @@ static stat_t _exec_aline_body(mpBuf_t *bf)
         }
 
         float body_time = mr.r->body_time;
-        mr.segments = ceil(uSec(body_time) / NOM_SEGMENT_USEC);
+        mr.segments = ceil(uSec(body_time) / (NOM_SEGMENT_USEC * _init_time_scale()));
         mr.segment_time = body_time / mr.segments;
         mr.segment_velocity = mr.r->cruise_velocity;
         mr.segment_count = (uint32_t)mr.segments;
-        if (mr.segment_time < MIN_SEGMENT_TIME) {
+        _init_section_length(mr.r->body_length);
+        if (mr.segment_time < MIN_SEGMENT_TIME * mr.time_scale_floor) {
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                // exit without advancing position, say we're done
         }
 
         mr.section = SECTION_BODY;
         mr.section_state = SECTION_RUNNING;                 // uses PERIOD_2 so last segment detection works
+
+    } else if ((mr.segment_count > 1) && _time_scale_is_held()) {
+        // Re-cut the rest of the body so a feed override change isn't held up to its end
+        float remaining_time = mr.segment_count * mr.segment_time;
+        float segments = ceil(uSec(remaining_time) / (NOM_SEGMENT_USEC * _init_time_scale()));
+        if (remaining_time / segments >= MIN_SEGMENT_TIME * mr.time_scale_floor) {
+            mr.segments = segments;
+            mr.segment_count = (uint32_t)segments;
+            mr.segment_time = remaining_time / segments;
+#ifdef __FIXED_POINT_RUNTIME
+            mr.segment_length_q = q_from_float(mr.segment_velocity * mr.segment_time, LENGTH_Q_BITS);
+#endif
+        }
     }
     if (_exec_aline_segment() == STAT_OK) {                 // OK means this section is done
         if (fp_ZERO(mr.r->tail_length)) {
@@ -965,7 +1199,7 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
         bf->plannable = false;
 
         if (fp_ZERO(mr.r->tail_length)) { return(STAT_OK);}         // end the move
-        mr.segments = ceil(uSec(mr.r->tail_time) / NOM_SEGMENT_USEC);// # of segments for the section
+        mr.segments = ceil(uSec(mr.r->tail_time) / (NOM_SEGMENT_USEC * _init_time_scale()));// # of segments for the section
         mr.segment_count = (uint32_t)mr.segments;
         mr.segment_time = mr.r->tail_time / mr.segments;             // time to advance for each segment
 
@@ -974,7 +1208,8 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
         } else {
             _init_forward_diffs(mr.r->cruise_velocity, mr.r->exit_velocity); // <-- sets inital segment_velocity
         }
-        if (mr.segment_time < MIN_SEGMENT_TIME) {
+        _init_section_length(mr.r->tail_length);
+        if (mr.segment_time < MIN_SEGMENT_TIME * mr.time_scale_floor) {
             _debug_trap("mr.segment_time < MIN_SEGMENT_TIME");
             return(STAT_OK);                                        // exit without advancing position, say we're done
          // return(STAT_MINIMUM_TIME_MOVE);                         // exit without advancing position
@@ -982,16 +1217,13 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
         mr.section = SECTION_TAIL;
         mr.section_state = SECTION_RUNNING;
     } else {
-        mr.segment_velocity += mr.forward_diff_5;
+        _next_segment_velocity();
     }
 
     if (_exec_aline_segment() == STAT_OK) {
         return(STAT_OK);                                        // STAT_OK completes the move
     } else if (!first_pass) {
-        mr.forward_diff_5 += mr.forward_diff_4;
-        mr.forward_diff_4 += mr.forward_diff_3;
-        mr.forward_diff_3 += mr.forward_diff_2;
-        mr.forward_diff_2 += mr.forward_diff_1;
+        _update_forward_diffs();
     }
     return(STAT_EAGAIN);
 }
@@ -1001,8 +1233,11 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
  *
  * NOTES ON STEP ERROR CORRECTION:
  *
- *  The commanded_steps are the target_steps delayed by one more segment.
- *  This lines them up in time with the encoder readings so a following error can be generated
+ *  The encoders are accumulated when a segment is loaded, so they hold every segment
+ *  loaded before the last one. The commanded_steps are the target_steps of that segment,
+ *  taken from the step history. How far back that is depends on how many segments are
+ *  waiting in the prep queue. This lines them up in time with the encoder readings so a
+ *  following error can be generated
  *
  *  The following_error term is positive if the encoder reading is greater than (ahead of)
  *  the commanded steps, and negative (behind) if the encoder reading is less than the
@@ -1016,6 +1251,8 @@ static stat_t _exec_aline_tail(mpBuf_t *bf)
  *         -100        -90           -10        encoder is 10 steps behind commanded steps
  */
 
+#ifndef __FIXED_POINT_RUNTIME
+
 static stat_t _exec_aline_segment()
 {
     float travel_steps[MOTORS];
@@ -1027,15 +1264,23 @@ static stat_t _exec_aline_segment()
 
     if ((--mr.segment_count == 0) && (cm.motion_state != MOTION_HOLD)) {
         copy_vector(mr.gm.target, mr.waypoint[mr.section]);
+        if (mr.block_type == BLOCK_TYPE_ARC) {                  // synchronize arc travel to the waypoint
+            mr.arc_travel = mr.r->head_length;
+            if (mr.section != SECTION_HEAD) { mr.arc_travel += mr.r->body_length; }
+            if (mr.section == SECTION_TAIL) { mr.arc_travel += mr.r->tail_length; }
+        }
+    } else if (mr.block_type == BLOCK_TYPE_ARC) {
+        mr.arc_travel += mr.segment_velocity * mr.segment_time;
+        _get_arc_position(mr.arc_travel, mr.gm.target);
     } else {
         float segment_length = mr.segment_velocity * mr.segment_time;
         // see https://en.wikipedia.org/wiki/Kahan_summation_algorithm
         //   for the summation compensation description
         for (uint8_t a=0; a<AXES; a++) {
 #if 1
-            float to_add = (mr.unit[a] * segment_length) - mr.gm.target_comp[a];
+            float to_add = (mr.unit[a] * segment_length) - mr.target_comp[a];
             float target = mr.position[a] + to_add;
-            mr.gm.target_comp[a] = (target - mr.position[a]) - to_add;
+            mr.target_comp[a] = (target - mr.position[a]) - to_add;
             mr.gm.target[a] = target;
 #else
             mr.gm.target[a] = mr.position[a] + (mr.unit[a] * segment_length);
@@ -1050,11 +1295,20 @@ static stat_t _exec_aline_segment()
     //       Other kinematics may require transforming travel distance as opposed to simply subtracting steps.
 
 
+    // The following error is measured against the segment the encoder sample lines up with.
+    // Corrections made since that segment are still in flight and are taken off the error
+    // given to st_prep_line() (see Step correction in stepper.h).
+
+    int32_t encoder_steps[MOTORS];
+    float predicted_error[MOTORS];
+    uint8_t aligned = (_read_encoders(encoder_steps)-1) & (PREP_HISTORY_SIZE-1);
+    float *commanded = mr.step_history[aligned];
     for (uint8_t m=0; m<MOTORS; m++) {
-        mr.commanded_steps[m] = mr.position_steps[m];       // previous segment's position, delayed by 1 segment
+        mr.commanded_steps[m] = commanded[m];               // target of the segment before the last one loaded
         mr.position_steps[m] = mr.target_steps[m];          // previous segment's target becomes position
-        mr.encoder_steps[m] = en_read_encoder(m);           // get current encoder position (time aligns to commanded_steps)
+        mr.encoder_steps[m] = encoder_steps[m];             // encoder position (time aligns to commanded_steps)
         mr.following_error[m] = mr.encoder_steps[m] - mr.commanded_steps[m];
+        predicted_error[m] = mr.following_error[m] - (mr.correction_total[m] - mr.correction_history[aligned][m]);
     }
     kn_inverse_kinematics(mr.gm.target, mr.target_steps);   // now determine the target steps...
     for (uint8_t m=0; m<MOTORS; m++) {                      // and compute the distances to be traveled
@@ -1062,16 +1316,293 @@ static stat_t _exec_aline_segment()
     }
 
     // Update the mb->run_time_remaining -- we know it's missing the current segment's time before it's loaded, that's ok.
-    mp.run_time_remaining -= mr.segment_time;
+    float segment_time = _scale_segment_time();             // feed override
+    mp.run_time_remaining -= segment_time;
     if (mp.run_time_remaining < 0) {
         mp.run_time_remaining = 0.0;
     }
 
-    // Call the stepper prep function
-    ritorno(st_prep_line(travel_steps, mr.following_error, mr.segment_time));
+    // Call the stepper prep function. It takes any correction off travel_steps.
+    ritorno(st_prep_line(travel_steps, predicted_error, segment_time));
+    for (uint8_t m=0; m<MOTORS; m++) {
+        mr.correction_total[m] += (mr.target_steps[m] - mr.position_steps[m]) - travel_steps[m];
+    }
+    copy_vector(mr.step_history[++mr.segments_prepped & (PREP_HISTORY_SIZE-1)], mr.target_steps);
+    copy_vector(mr.correction_history[mr.segments_prepped & (PREP_HISTORY_SIZE-1)], mr.correction_total);
     copy_vector(mr.position, mr.gm.target);                 // update position from target
     if (mr.segment_count == 0) {
         return (STAT_OK);                                   // this section has run all its segments
     }
     return (STAT_EAGAIN);                                   // this section still has more segments to run
 }
+
+#else // __FIXED_POINT_RUNTIME
+
+/*********************************************************************************************
+ * _exec_aline_segment() - segment runner helper - fixed-point version
+ * _init_fixed_point_block() - load the per-block fixed-point constants
+ *
+ *  Same job as the float version above, but the interpolation and step math is done in
+ *  64 bit integers for processors without an FPU (SAM3X). It is not float-free. These
+ *  still run in float, so in soft-float on the SAM3X, every segment:
+ *
+ *    - the feed override: _scale_segment_time() works out the time_scale target (a divide,
+ *      and a sqrt in bodies running faster than planned), ramps time_scale toward it and
+ *      divides the segment time by it. run_time_remaining is counted down in float
+ *    - st_prep_line() turns the segment time into DDA ticks and compares it per motor to
+ *      the last one for the accumulator correction, dividing only when it changes
+ *    - position[] and gm.target[] are converted from position_q[] (one per axis), for
+ *      reports and feedholds, and the segment's travel_steps per moving motor, which
+ *      motor.loadSegment() takes as a float
+ *
+ *  Floats are also converted at block and section setup and at section ends.
+ *
+ *    - Velocity is carried as segment length in Q16.48 and stepped by forward differences
+ *      that have been pre-multiplied by segment time in _init_forward_diffs()
+ *    - The last segment of a section runs whatever length is left in the section. This
+ *      replaces the waypoint correction of the float version and keeps position exact
+ *    - position_q[] (Q31.32) is the master position. Target steps are position_q times
+ *      steps per unit (Q16.15) for the axis the motor is mapped to. This is the Cartesian
+ *      case of kn_inverse_kinematics(); other kinematics need the float version.
+ *    - Arcs turn a Q1.30 sin/cos phasor by each segment's angle (see _turn_arc_phasor()).
+ *      The plane axes are the center plus the phasor times the radius, and the other axes
+ *      move in proportion to arc_travel_q, all in Q31.32
+ *    - Following error is the encoder count minus commanded steps, also in Q31.32, as
+ *      are the corrections in flight (correction_total_q) and the correction PID in
+ *      st_prep_line()
+ *    - The float step vectors (target_steps[] etc.) are refreshed at the end of each
+ *      section for the _ts/_ps/_cs/_es/_fe diagnostics
+ *
+ *  This matches the float version to within a small fraction of a step but is not bit-exact.
+ */
+
+static void _init_fixed_point_block()
+{
+    mr.arc_travel_q = 0;
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        mr.unit_q[axis] = (int32_t)q_from_float(mr.unit[axis], UNIT_Q_BITS);
+    }
+    if (mr.block_type == BLOCK_TYPE_ARC) {
+        mr.arc_angle_q = 0;
+        mr.arc_phasor_q[0] = (int32_t)q_from_float(sin(mr.arc.theta), UNIT_Q_BITS);
+        mr.arc_phasor_q[1] = (int32_t)q_from_float(cos(mr.arc.theta), UNIT_Q_BITS);
+        mr.arc_angle_scale = q_scale_from_float(mr.arc.angular_travel / mr.arc_length, 0);
+        mr.arc_radius_scale = q_scale_from_float(mr.arc.radius_travel / mr.arc_length, LENGTH_Q_BITS - Q32_BITS);
+        mr.arc_radius_q = q_from_float(mr.arc.radius, Q32_BITS);
+        mr.arc_center_q[0] = q_from_float(mr.arc.center_0, Q32_BITS);
+        mr.arc_center_q[1] = q_from_float(mr.arc.center_1, Q32_BITS);
+        for (uint8_t axis=0; axis<AXES; axis++) {
+            mr.arc_start_q[axis] = q_from_float(mr.arc_start[axis], Q32_BITS);
+            mr.arc_axis_scale[axis] = q_scale_from_float((mr.target[axis] - mr.arc_start[axis]) / mr.arc_length,
+                                                         LENGTH_Q_BITS - Q32_BITS);
+        }
+    }
+    for (uint8_t motor=0; motor<MOTORS; motor++) {
+        uint8_t axis = st_cfg.mot[motor].motor_map;
+        if ((axis >= AXES) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
+            mr.steps_per_unit_q[motor] = 0;
+        } else {
+            mr.steps_per_unit_q[motor] = (int32_t)q_from_float(st_cfg.mot[motor].steps_per_unit, SPU_Q_BITS);
+        }
+    }
+}
+
+static stat_t _exec_aline_segment()
+{
+    q32_t travel_steps[MOTORS];
+
+    // Set the length of the segment. The last segment in a section runs the remainder.
+    // Don't do end-of-section correction if you are going into a hold.
+    int64_t segment_length = mr.segment_length_q;
+    if ((--mr.segment_count == 0) && (cm.motion_state != MOTION_HOLD)) {
+        segment_length = mr.section_remaining_q;
+    }
+    mr.section_remaining_q -= segment_length;
+
+    // Advance the position of the axes in the move (Q16.48 * Q1.30 -> Q16.48 -> Q31.32)
+    if (mr.block_type == BLOCK_TYPE_ARC) {
+        mr.arc_travel_q += segment_length;
+        _turn_arc_phasor();
+        if ((mr.segment_count == 0) && (cm.motion_state != MOTION_HOLD)) {
+            copy_vector(mr.gm.target, mr.waypoint[mr.section]);    // land exactly on the section end
+            for (uint8_t a=0; a<AXES; a++) {
+                mr.position_q[a] = q_from_float(mr.gm.target[a], Q32_BITS);
+            }
+        } else {
+            _get_arc_position_q();
+        }
+    } else {
+        for (uint8_t a=0; a<AXES; a++) {
+            if (mr.unit_q[a] == 0) {
+                mr.gm.target[a] = mr.position[a];
+                continue;
+            }
+            int64_t travel = q_mul(segment_length, mr.unit_q[a], UNIT_Q_BITS);
+            mr.position_q[a] += (travel + ((int64_t)1 << (LENGTH_Q_BITS - Q32_BITS - 1))) >> (LENGTH_Q_BITS - Q32_BITS);
+            mr.gm.target[a] = q_to_float(mr.position_q[a], Q32_BITS);
+        }
+    }
+
+    // Bucket-brigade the steps and compute travel - see the float version for notes
+    int32_t encoder_steps[MOTORS];
+    q32_t predicted_error[MOTORS];
+    uint8_t aligned = (_read_encoders(encoder_steps)-1) & (PREP_HISTORY_SIZE-1);
+    int64_t *commanded = mr.step_history_q[aligned];
+    for (uint8_t m=0; m<MOTORS; m++) {
+        mr.commanded_steps_q[m] = commanded[m];
+        mr.position_steps_q[m] = mr.target_steps_q[m];
+        mr.following_error_q[m] = ((int64_t)encoder_steps[m] << Q32_BITS) - mr.commanded_steps_q[m];
+        predicted_error[m] = mr.following_error_q[m] - (mr.correction_total_q[m] - mr.correction_history_q[aligned][m]);
+        if (mr.steps_per_unit_q[m] != 0) {
+            mr.target_steps_q[m] = q_mul(mr.position_q[st_cfg.mot[m].motor_map], mr.steps_per_unit_q[m], SPU_Q_BITS);
+        }
+        travel_steps[m] = mr.target_steps_q[m] - mr.position_steps_q[m];
+    }
+
+    float segment_time = _scale_segment_time();             // feed override
+    mp.run_time_remaining -= segment_time;
+    if (mp.run_time_remaining < 0) {
+        mp.run_time_remaining = 0.0;
+    }
+
+    ritorno(st_prep_line(travel_steps, predicted_error, segment_time));
+    for (uint8_t m=0; m<MOTORS; m++) {
+        mr.correction_total_q[m] += (mr.target_steps_q[m] - mr.position_steps_q[m]) - travel_steps[m];
+    }
+    copy_vector(mr.step_history_q[++mr.segments_prepped & (PREP_HISTORY_SIZE-1)], mr.target_steps_q);
+    copy_vector(mr.correction_history_q[mr.segments_prepped & (PREP_HISTORY_SIZE-1)], mr.correction_total_q);
+    copy_vector(mr.position, mr.gm.target);                 // update position from target
+    if (mr.segment_count == 0) {
+        for (uint8_t m=0; m<MOTORS; m++) {                  // refresh the float step vectors
+            st_pre.mot[m].corrected_steps = q_to_float(st_pre.mot[m].corrected_steps_q, Q32_BITS);
+            mr.target_steps[m] = q_to_float(mr.target_steps_q[m], Q32_BITS);
+            mr.position_steps[m] = q_to_float(mr.position_steps_q[m], Q32_BITS);
+            mr.commanded_steps[m] = q_to_float(mr.commanded_steps_q[m], Q32_BITS);
+            mr.encoder_steps[m] = en_read_encoder(m);
+            mr.following_error[m] = q_to_float(mr.following_error_q[m], Q32_BITS);
+        }
+        return (STAT_OK);                                   // this section has run all its segments
+    }
+    return (STAT_EAGAIN);                                   // this section still has more segments to run
+}
+
+/*
+ * _turn_arc_phasor()   - turn the arc phasor to the angle at arc_travel_q
+ * _get_arc_position_q() - position on the running arc block at arc_travel_q - see _get_arc_position()
+ *
+ *  The phasor is the sin and cos of the arc angle in Q1.30. Each segment turns it by the
+ *  angle the segment covers, using the series for sin and cos of that (small) angle, so
+ *  the runtime never calls sin() or cos(). The angle itself is worked out from the travel
+ *  every segment, so only the phasor's round-off carries from segment to segment. A
+ *  segment that turns more than ARC_TURN_MAX (a very small radius) recomputes the phasor
+ *  in float instead, where the series would lose accuracy.
+ */
+
+static void _turn_arc_phasor()
+{
+    int64_t angle = q_scale(mr.arc_travel_q, mr.arc_angle_scale);
+    int64_t turn = angle - mr.arc_angle_q;
+    mr.arc_angle_q = angle;
+
+    const int64_t turn_max = (int64_t)(ARC_TURN_MAX * ((int64_t)1 << LENGTH_Q_BITS));
+    if ((turn > turn_max) || (turn < -turn_max)) {
+        float theta = mr.arc.theta + q_to_float(angle, LENGTH_Q_BITS);
+        mr.arc_phasor_q[0] = (int32_t)q_from_float(sin(theta), UNIT_Q_BITS);
+        mr.arc_phasor_q[1] = (int32_t)q_from_float(cos(theta), UNIT_Q_BITS);
+        return;
+    }
+    const int32_t one = (int32_t)1 << UNIT_Q_BITS;
+    int32_t d = (int32_t)((turn + ((int64_t)1 << (LENGTH_Q_BITS - UNIT_Q_BITS - 1))) >> (LENGTH_Q_BITS - UNIT_Q_BITS));
+    int32_t d_2 = q_mul(d, d, UNIT_Q_BITS);
+    int32_t d_3 = q_mul(d_2, d, UNIT_Q_BITS);
+    int32_t d_4 = q_mul(d_2, d_2, UNIT_Q_BITS);
+    int32_t d_5 = q_mul(d_4, d, UNIT_Q_BITS);
+    int32_t d_6 = q_mul(d_4, d_2, UNIT_Q_BITS);
+    int32_t d_7 = q_mul(d_6, d, UNIT_Q_BITS);
+    int32_t sin_d = d - d_3 / 6 + d_5 / 120 - d_7 / 5040;  // error under 1e-11 at ARC_TURN_MAX
+    int32_t cos_d = one - d_2 / 2 + d_4 / 24 - d_6 / 720;  // error under 4e-10
+
+    int32_t s = mr.arc_phasor_q[0];
+    int32_t c = mr.arc_phasor_q[1];
+    mr.arc_phasor_q[0] = (int32_t)(q_mul(s, cos_d, UNIT_Q_BITS) + q_mul(c, sin_d, UNIT_Q_BITS));
+    mr.arc_phasor_q[1] = (int32_t)(q_mul(c, cos_d, UNIT_Q_BITS) - q_mul(s, sin_d, UNIT_Q_BITS));
+}
+
+static void _get_arc_position_q()
+{
+    for (uint8_t a=0; a<AXES; a++) {
+        mr.position_q[a] = mr.arc_start_q[a] + q_scale(mr.arc_travel_q, mr.arc_axis_scale[a]);
+    }
+    int64_t radius = mr.arc_radius_q + q_scale(mr.arc_travel_q, mr.arc_radius_scale);
+    mr.position_q[mr.arc.plane_axis_0] = mr.arc_center_q[0] + q_mul(radius, mr.arc_phasor_q[0], UNIT_Q_BITS);
+    mr.position_q[mr.arc.plane_axis_1] = mr.arc_center_q[1] + q_mul(radius, mr.arc_phasor_q[1], UNIT_Q_BITS);
+    for (uint8_t a=0; a<AXES; a++) {
+        mr.gm.target[a] = q_to_float(mr.position_q[a], Q32_BITS);
+    }
+}
+
+#endif // __FIXED_POINT_RUNTIME
+
+/*
+ * _read_encoders() - read the encoder positions for the following error
+ *
+ *  Returns the number of line segments loaded when they were read. The loader can
+ *  start a segment (and accumulate the encoders) while the exec is running, so read
+ *  again if it did.
+ */
+
+static uint32_t _read_encoders(int32_t encoder_steps[])
+{
+    uint32_t loaded;
+    do {
+        loaded = st_get_segments_loaded();
+        for (uint8_t m=0; m<MOTORS; m++) {
+            encoder_steps[m] = en_read_encoder_steps(m);
+        }
+    } while (loaded != st_get_segments_loaded());
+    return (loaded);
+}
+
+/*
+ * mp_get_runtime_steps_at() - motor positions in steps at a time on the motion clock
+ *
+ *  Finds the segment the loader was running at 'ticks' (see st_get_motion_ticks()) and
+ *  interpolates between the targets either side of it in the step history, less the
+ *  corrections st_prep_line() took off, i.e. the steps the motors had been given by then.
+ *  Inputs that are handled late (CAN inputs) use this to find where the machine was
+ *  when they tripped.
+ *
+ *  The exec may be PREP_QUEUE_SIZE segments ahead of the loader, so only the segments
+ *  whose start it can't have overwritten are looked at. An earlier time gives the start
+ *  of the oldest of them. Call from the main loop.
+ */
+
+void mp_get_runtime_steps_at(const uint32_t ticks, float steps[])
+{
+    uint32_t n = st_get_segments_loaded();                  // the segment running, or the last one run
+    uint32_t oldest = n - (PREP_HISTORY_SIZE - PREP_QUEUE_SIZE - 2);
+    while ((n != oldest) && ((int32_t)(ticks - st_get_segment_ticks(n-1)) < 0)) {
+        n--;
+    }
+    uint32_t elapsed = ticks - st_get_segment_ticks(n-1);
+    uint32_t length = st_get_segment_ticks(n) - st_get_segment_ticks(n-1);
+    float fraction = 1;
+    if ((int32_t)elapsed < 0) {
+        fraction = 0;
+    } else if (elapsed < length) {
+        fraction = (float)elapsed / (float)length;
+    }
+    uint8_t from = (n-1) & (PREP_HISTORY_SIZE-1);
+    uint8_t to = n & (PREP_HISTORY_SIZE-1);
+    for (uint8_t m=0; m<MOTORS; m++) {
+#ifndef __FIXED_POINT_RUNTIME
+        float start = mr.step_history[from][m] - mr.correction_history[from][m];
+        float travel = (mr.step_history[to][m] - mr.correction_history[to][m]) - start;
+#else
+        float start = q_to_float(mr.step_history_q[from][m] - mr.correction_history_q[from][m], Q32_BITS);
+        float travel = q_to_float((mr.step_history_q[to][m] - mr.correction_history_q[to][m]) -
+                                  (mr.step_history_q[from][m] - mr.correction_history_q[from][m]), Q32_BITS);
+#endif
+        steps[m] = start + travel * fraction;
+    }
+}
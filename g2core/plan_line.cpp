@@ -54,12 +54,15 @@ static void _calculate_override(mpBuf_t* bf);
 static void _calculate_jerk(mpBuf_t* bf);
 static void _calculate_vmaxes(mpBuf_t* bf, const float axis_length[], const float axis_square[]);
 static void _calculate_junction_vmax(mpBuf_t* bf);
+static void _calculate_arc_vmax(mpBuf_t* bf, const float planar_length);
 
 //+++++DIAGNOSTICS
 #pragma GCC optimize("O0")  // this pragma is required to force the planner to actually set these unused values
 //#pragma GCC reset_options
 static void _set_bf_diagnostics(mpBuf_t* bf) {
-    bf->linenum = bf->gm.linenum;
+#ifdef __PLANNER_DIAGNOSTICS
+    bf->linenum = bf->gm->linenum;
+#endif
 //  UPDATE_BF_DIAGNOSTICS(bf);   //+++++
 }
 #pragma GCC reset_options
@@ -67,16 +70,46 @@ static void _set_bf_diagnostics(mpBuf_t* bf) {
 /* Runtime-specific setters and getters
  *
  * mp_zero_segment_velocity()         - correct velocity in last segment for reporting purposes
- * mp_get_runtime_velocity()          - returns current velocity (aggregate)
+ * mp_get_runtime_velocity()          - returns current velocity (aggregate) as planned
+ * mp_get_runtime_time_scale()        - returns the runtime feed override (see mp_start_feed_override())
  * mp_get_runtime_machine_position()  - returns current axis position in machine coordinates
  * mp_set_runtime_work_offset()       - set offsets in the MR struct
  * mp_get_runtime_work_position()     - returns current axis position in work coordinates
  *                                      that were in effect at move planning time
+ * mp_get_runtime_linenum()           - returns the line number of the running move, stepping
+ *                                      through the lines of a coalesced block (see cm_straight_feed())
  */
 
+#ifndef __FIXED_POINT_RUNTIME
 void  mp_zero_segment_velocity() { mr.segment_velocity = 0; }
 float mp_get_runtime_velocity(void) { return (mr.segment_velocity); }
+#else
+void  mp_zero_segment_velocity() { mr.segment_velocity = 0; mr.segment_length_q = 0; }
+float mp_get_runtime_velocity(void)
+{
+    if (fp_ZERO(mr.segment_time)) {
+        return (0);
+    }
+    return (q_to_float(mr.segment_length_q, LENGTH_Q_BITS) / mr.segment_time);
+}
+#endif
+float mp_get_runtime_time_scale(void) { return (mr.time_scale); }
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]); }
+uint32_t mp_get_runtime_linenum(void)
+{
+#ifdef __COALESCE_LINES
+    if (mr.gm.line_marks == 0) {
+        return (mr.gm.linenum);
+    }
+    float remaining = get_axis_vector_length(mr.target, mr.position);
+    for (uint8_t i=0; i<mr.gm.line_marks; i++) {
+        if (remaining > mr.gm.line_remaining[i]) {
+            return (mr.gm.linenum - mr.gm.line_delta[i]);
+        }
+    }
+#endif
+    return (mr.gm.linenum);
+}
 void mp_set_runtime_work_offset(float offset[]) { copy_vector(mr.gm.work_offset, offset); }
 
 // We have to handle rotation - "rotate" by the transverse of the matrix to got "normal" coordinates
@@ -205,9 +238,9 @@ stat_t mp_aline(GCodeState_t* gm_in)
     if ((bf = mp_get_write_buffer()) == NULL) {         // never supposed to fail
         return (cm_panic(STAT_FAILED_GET_PLANNER_BUFFER, "aline()"));
     }
-    memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));
-    // Since bf->gm.target is being used all over the place, we'll make it the rotated target
-    copy_vector(bf->gm.target, target_rotated);  // copy the rotated taget in place
+    memcpy(bf->gm, gm_in, sizeof(GCodeState_t));
+    // Since bf->gm->target is being used all over the place, we'll make it the rotated target
+    copy_vector(bf->gm->target, target_rotated);  // copy the rotated taget in place
 
     // setup the buffer
     bf->bf_func = mp_exec_aline;                        // register the callback to the exec function
@@ -222,11 +255,111 @@ stat_t mp_aline(GCodeState_t* gm_in)
     _set_bf_diagnostics(bf);                          //+++++DIAGNOSTIC
 
     // Note: these next lines must remain in exact order. Position must update before committing the buffer.
-    copy_vector(mp.position, bf->gm.target);   // set the planner position
+    copy_vector(mp.position, bf->gm->target);   // set the planner position
     mp_commit_write_buffer(BLOCK_TYPE_ALINE);  // commit current block (must follow the position update)
     return (STAT_OK);
 }
 
+/*
+ * mp_arc() - plan an arc or helix as a single block
+ *
+ *  The arc is carried by one planner buffer with its geometry in bf->arc, and is planned
+ *  like a line of the same length with these differences:
+ *
+ *    - Jerk and axis velocity limits take each plane axis at the largest share of the path
+ *      velocity it can have anywhere on the arc (planar length / length), not at the share
+ *      it has on entry.
+ *
+ *    - bf->unit is the tangent at the start of the arc. The tangent at the end is computed
+ *      by mp_get_arc_unit() when the junction with the next block is planned.
+ *
+ *    - Cruise and absolute velocity are limited by the curvature. See _calculate_arc_vmax().
+ *
+ *  The runtime computes the segment targets on the arc (see _exec_aline_segment()). The
+ *  geometry is in absolute machine coordinates, so the caller must not use mp_arc() while
+ *  a coordinate rotation (cm.rotation_matrix) is in effect. Arcs are spooled as lines then.
+ */
+
+stat_t mp_arc(GCodeState_t* gm_in, const mpArcBuf_t* arc_in)
+{
+    mpBuf_t* bf;
+    float axis_square[AXES] = {0, 0, 0, 0, 0, 0};
+    float axis_length[AXES];
+    bool  flags[AXES];
+    float planar_length = fabs(arc_in->angular_travel) * (arc_in->radius + arc_in->radius_travel/2);
+    float length_square = square(planar_length);
+    float length;
+
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        if ((axis == arc_in->plane_axis_0) || (axis == arc_in->plane_axis_1)) {
+            axis_length[axis] = planar_length;          // the most this axis can travel for the length of the arc
+            flags[axis] = true;
+            continue;
+        }
+        axis_length[axis] = gm_in->target[axis] - mp.position[axis];
+        if ((flags[axis] = fp_NOT_ZERO(axis_length[axis]))) {  // yes, this supposed to be = not ==
+            axis_square[axis] = square(axis_length[axis]);
+            length_square += axis_square[axis];
+        } else {
+            axis_length[axis] = 0;
+        }
+    }
+    axis_square[arc_in->plane_axis_0] = square(planar_length);  // the feed time takes the planar length once
+    length = sqrt(length_square);
+
+    if (fp_ZERO(length)) {
+        sr_request_status_report(SR_REQUEST_TIMED_FULL);
+        return (STAT_MINIMUM_LENGTH_MOVE);
+    }
+
+    if ((bf = mp_get_write_buffer()) == NULL) {         // never supposed to fail
+        return (cm_panic(STAT_FAILED_GET_PLANNER_BUFFER, "arc()"));
+    }
+    memcpy(bf->gm, gm_in, sizeof(GCodeState_t));
+    memcpy(bf->arc, arc_in, sizeof(mpArcBuf_t));
+
+    bf->bf_func = mp_exec_aline;                        // arcs run through the aline runtime
+    bf->length  = length;
+    for (uint8_t axis = 0; axis < AXES; axis++) {       // largest unit vector components - for jerk
+        if ((bf->axis_flags[axis] = flags[axis])) {
+            bf->unit[axis] = axis_length[axis] / length;
+        }
+    }
+    _calculate_jerk(bf);
+    _calculate_vmaxes(bf, axis_length, axis_square);
+    _calculate_arc_vmax(bf, planar_length);
+    mp_get_arc_unit(bf, 0, bf->unit);                   // now make the unit vector the entry tangent
+    _set_bf_diagnostics(bf);                            //+++++DIAGNOSTIC
+
+    // Note: these next lines must remain in exact order. Position must update before committing the buffer.
+    copy_vector(mp.position, bf->gm->target);
+    mp_commit_write_buffer(BLOCK_TYPE_ARC);
+    return (STAT_OK);
+}
+
+/*
+ * mp_get_arc_unit() - return the unit vector tangent to an arc block
+ *
+ *  fraction is how far along the block the tangent is taken - 0 is the start, 1 the end.
+ *  The components for the non-plane axes are constant along the arc and are taken from
+ *  bf->unit. OK for unit to be bf->unit.
+ */
+
+void mp_get_arc_unit(const mpBuf_t* bf, const float fraction, float unit[])
+{
+    const mpArcBuf_t* arc = bf->arc;
+    float theta  = arc->theta + fraction * arc->angular_travel;
+    float radius = arc->radius + fraction * arc->radius_travel;
+    float sin_theta = sin(theta);
+    float cos_theta = cos(theta);
+
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        unit[axis] = bf->unit[axis];
+    }
+    unit[arc->plane_axis_0] = (cos_theta * radius * arc->angular_travel + sin_theta * arc->radius_travel) / bf->length;
+    unit[arc->plane_axis_1] = (cos_theta * arc->radius_travel - sin_theta * radius * arc->angular_travel) / bf->length;
+}
+
 /*
  * mp_plan_block_list() - plan all the blocks in the list
  *
@@ -281,15 +414,20 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
     if (mp.planner_state == PLANNER_PRIMING) {
         // Timings from *here*
 
+        if (bf->buffer_state < MP_BUFFER_IN_PROCESS) {
+            mp.bp_blocks++;                    // first time this block has been primed
+        }
+        bf->replan = true;                     // priming may change vmaxes for this block...
+        _calculate_override(bf);               // adjust cruise_vmax for feed/traverse override
         if (bf->pv->plannable) {
+            bf->pv->replan = true;             // ...and the exit_vmax of the previous block
             _calculate_junction_vmax(bf->pv);  // compute maximum junction velocity constraint
-            if (bf->pv->gm.path_control == PATH_EXACT_STOP) {
+            if (bf->pv->gm->path_control == PATH_EXACT_STOP) {
                 bf->pv->exit_vmax = 0;
             } else {
                 bf->pv->exit_vmax = min3(bf->pv->junction_vmax, bf->pv->cruise_vmax, bf->cruise_vmax);
             }
         }
-        _calculate_override(bf);  // adjust cruise_vmax for feed/traverse override
  //     bf->plannable_time = bf->pv->plannable_time;    // set plannable time - excluding current move
         bf->buffer_state = MP_BUFFER_IN_PROCESS;
 
@@ -303,6 +441,7 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
         }
         mp.planning_return = bf->nx;                 // where to return after planning is complete
         mp.planner_state   = PLANNER_BACK_PLANNING;  // start backplanning
+        mp.bp_passes++;
     }
 
     // Backward Planning Pass
@@ -310,6 +449,13 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
     // If it reaches cruise_vmax generate perfect cruises instead
     // Note: Vmax's are already set by the time you get here
     // Hint options from back-planning: COMMAND_BLOCK, PERFECT_DECELERATION, PERFECT_CRUISE, MIXED_DECELERATION
+    //
+    // Convergence: The blocks primed in this pass (and their predecessors) are marked 'replan'.
+    // Behind those marks every input to a block's plan is the same as on the last pass, so once
+    // a previously planned block gets the same exit velocity it got last time its plan - and
+    // the plan of every block behind it - is unchanged and the pass can stop. The test is
+    // VELOCITY_EQ, not a fraction of the exit velocity: the block behind may already be hinted
+    // (and running) against this exit velocity, so it must not be left short of braking_velocity.
 
     if (mp.planner_state == PLANNER_BACK_PLANNING) {
         // NOTE: We stop when the previous block is no longer plannable.
@@ -321,11 +467,22 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
         for (; bf->plannable || (braking_velocity < bf->exit_velocity); bf = bf->pv) {
             // Timings from *here*
 
+#ifdef __PLANNER_DIAGNOSTICS
             bf->iterations++;
+#endif
             bf->plannable = bf->plannable && !optimal;  // Don't accidentally enable plannable!
 
             // Let's be mindful that forward planning may change exit_vmax, and our exit velocity may be lowered
             braking_velocity = min(braking_velocity, bf->exit_vmax);
+            mp.bp_visits++;
+
+            if (bf->replan) {
+                bf->replan = false;
+            } else if (bf->plannable && (bf->hint != NO_HINT) && (bf->buffer_state == MP_BUFFER_PREPPED) &&
+                       VELOCITY_EQ(braking_velocity, bf->exit_velocity)) {
+                mp.bp_converged++;
+                break;                                  // plan has converged - nothing behind here will change
+            }
 
             // We *must* set cruise before exit, and keep it at least as high as exit.
             bf->cruise_velocity = max(braking_velocity, bf->cruise_velocity);
@@ -440,54 +597,18 @@ static mpBuf_t* _plan_block(mpBuf_t* bf)
  * _calculate_jerk()
  * _calculate_vmaxes()
  * _calculate_junction_vmax()
+ * _calculate_arc_vmax()
  * _calculate_decel_time()
  */
 
-static void _calculate_override(mpBuf_t* bf)  // execute ramp to adjust cruise velocity
+static void _calculate_override(mpBuf_t* bf)
 {
     // TODO: Account for rapid overrides as well as feed overrides
 
-    // pull in override factor from previous block or seed initial value from the system setting
-    bf->override_factor = fp_ZERO(bf->pv->override_factor) ? cm.gmx.mfo_factor : bf->pv->override_factor;
-    bf->cruise_vmax     = bf->override_factor * bf->cruise_vset;
-
-    // generate ramp term is a ramp is active
-    if (mp.ramp_active) {
-        bf->override_factor += mp.ramp_dvdt * bf->block_time;
-        if (mp.ramp_dvdt > 0) {  // positive is an acceleration ramp
-            if (bf->override_factor > mp.ramp_target) {
-                bf->override_factor = mp.ramp_target;
-                mp.ramp_active      = false;  // detect end of ramp
-            }
-            bf->cruise_velocity *= bf->override_factor;
-            if (bf->cruise_velocity > bf->absolute_vmax) {  // test max cruise_velocity
-                bf->cruise_velocity = bf->absolute_vmax;
-                mp.ramp_active      = false;  // don't allow exceeding absolute_vmax
-            }
-        } else {  // negative is deceleration ramp
-            if (bf->override_factor < mp.ramp_target) {
-                bf->override_factor = mp.ramp_target;
-                mp.ramp_active      = false;
-            }
-            bf->cruise_velocity *= bf->override_factor;  // +++++ this is probably wrong
-            //  bf->exit_velocity *= bf->mfo_factor;        //...but I'm not sure this is right,
-            //  bf->cruise_velocity = bf->pv->exit_velocity;   //...either
-        }
-    } else {
-        bf->cruise_velocity *= bf->override_factor;  // apply original or changed factor
-    }
-    // Correction for velocity constraints
-    // In the case of a acceleration these conditions must hold:
-    //      Ve < Vc = Vx
-    // In the case of a deceleration:
-    //      Ve = Vc > Vx
-    // in the case of "lump":
-    //      Ve < Vc > Vx
-    // if (bf->cruise_velocity < bf->pv->exit_velocity) { // deceleration case
-    //     bf->cruise_velocity = bf->pv->exit_velocity;
-    // } else {                                        // acceleration case
-    //     ...
-    // }
+    // Blocks take the override in effect when they are primed. Changes are applied to the
+    // blocks already in the queue by the runtime. See mp_start_feed_override().
+    bf->override_factor = mp.mfo_factor;
+    bf->cruise_vmax = min(bf->override_factor * bf->cruise_vset, bf->absolute_vmax);
 }
 
 /*
@@ -511,7 +632,7 @@ static void _calculate_jerk(mpBuf_t* bf)
             float axis_jerk = 0;
 #ifdef TRAVERSE_AT_HIGH_JERK
 #warning using experimental feature TRAVERSE_AT_HIGH_JERK!
-            switch (bf->gm.motion_mode) {
+            switch (bf->gm->motion_mode) {
                 case MOTION_MODE_STRAIGHT_TRAVERSE:
                 //case MOTION_MODE_STRAIGHT_PROBE: // <-- not sure on this one
                     axis_jerk = cm.a[axis].jerk_high;
@@ -608,24 +729,24 @@ static void _calculate_vmaxes(mpBuf_t* bf, const float axis_length[], const floa
     float block_time;           // resulting move time
 
     // compute feed time for feeds and probe motion
-    if (bf->gm.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
-        if (bf->gm.feed_rate_mode == INVERSE_TIME_MODE) {
-            feed_time             = bf->gm.feed_rate;  // NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
-            bf->gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
+    if (bf->gm->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
+        if (bf->gm->feed_rate_mode == INVERSE_TIME_MODE) {
+            feed_time             = bf->gm->feed_rate;  // NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
+            bf->gm->feed_rate_mode = UNITS_PER_MINUTE_MODE;
         } else {
             // compute length of linear move in millimeters. Feed rate is provided as mm/min
-            feed_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / bf->gm.feed_rate;
+            feed_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / bf->gm->feed_rate;
             // if no linear axes, compute length of multi-axis rotary move in degrees. Feed rate is provided as
             // degrees/min
             if (fp_ZERO(feed_time)) {
-                feed_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / bf->gm.feed_rate;
+                feed_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / bf->gm->feed_rate;
             }
         }
     }
     // compute rate limits and absolute maximum limit
     for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
         if (bf->axis_flags[axis]) {
-            if (bf->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+            if (bf->gm->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
                 tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
             } else {  // gm.motion_mode == MOTION_MODE_STRAIGHT_FEED
                 tmp_time = fabs(axis_length[axis]) / cm.a[axis].feedrate_max;
@@ -698,13 +819,20 @@ static void _calculate_junction_vmax(mpBuf_t* bf)
 {
     // ++++ RG If we change cruise_vmax, we'll need to recompute junction_vmax, if we do this:
     float velocity = min(bf->cruise_vmax, bf->nx->cruise_vmax);  // start with our maximum possible velocity
+    const float* unit = bf->unit;                                   // direction this block exits in
+    float arc_unit[AXES];
+
+    if (bf->block_type == BLOCK_TYPE_ARC) {                         // arcs exit along the tangent at their end
+        mp_get_arc_unit(bf, 1.0, arc_unit);
+        unit = arc_unit;
+    }
 
     // uint8_t jerk_axis = AXIS_X;
     // cmAxes jerk_axis = AXIS_X;
 
     for (uint8_t axis = 0; axis < AXES; axis++) {
         if (bf->axis_flags[axis] || bf->nx->axis_flags[axis]) {       // skip axes with no movement
-            float delta = fabs(bf->unit[axis] - bf->nx->unit[axis]);  // formula (1)
+            float delta = fabs(unit[axis] - bf->nx->unit[axis]);      // formula (1)
 
             // Corner case: If an axis has zero delta, we might have a straight line.
             // Corner case: An axis doesn't change (and it's not a straight line).
@@ -722,3 +850,65 @@ static void _calculate_junction_vmax(mpBuf_t* bf)
     }
     bf->junction_vmax = velocity;
 }
+
+/*
+ * _calculate_arc_vmax() - limit cruise_vmax and absolute_vmax for the curvature of an arc
+ *
+ *  When arcs were spooled as chords the speed was limited by the junction velocity of each
+ *  chord: a direction change of delta per chord allowed max_junction_accel / delta. Taking
+ *  the same change in velocity over ARC_CORNERING_TIME gives a centripetal acceleration of
+ *  max_junction_accel / T, so for the tightest radius r:
+ *
+ *      v <= sqrt(max_junction_accel * r / T)
+ *
+ *  The centripetal jerk of constant speed on a circle is v^3 / r^2, so the jerk limit gives:
+ *
+ *      v <= cbrt(jerk_max * r^2)
+ *
+ *  These are velocities in the arc plane. The path velocity of a helix is higher by the
+ *  ratio of the length to the planar length.
+ *
+ *  A G64 P blend arc (arc->blend, set by _blend_corner()) is never held below the junction
+ *  velocity of the sharp corner it rounds off (the same per-axis max_junction_accel / delta,
+ *  taken between the entry and exit tangents). It makes the same change in direction spread
+ *  over a longer time, so it shouldn't be slower than the corner it replaces. Programmed
+ *  G2/G3 arcs replace no corner and keep the curvature limit.
+ */
+
+static void _calculate_arc_vmax(mpBuf_t* bf, const float planar_length)
+{
+    const mpArcBuf_t* arc = bf->arc;
+    float radius = min(arc->radius, arc->radius + arc->radius_travel);
+    float vmax   = 8675309;  // a ridiculously large number
+
+    for (uint8_t axis = 0; axis < AXES; axis++) {
+        if ((axis != arc->plane_axis_0) && (axis != arc->plane_axis_1)) {
+            continue;
+        }
+        vmax = min3(vmax, sqrt(cm.a[axis].max_junction_accel * radius / ARC_CORNERING_TIME),
+                          cbrt(cm.a[axis].jerk_max * JERK_MULTIPLIER * square(radius)));
+    }
+    vmax *= bf->length / planar_length;
+
+    if (arc->blend) {                       // blends always turn less than half a circle
+        float entry[AXES];
+        float exit[AXES];
+        float corner_vmax = 8675309;
+        mp_get_arc_unit(bf, 0, entry);
+        mp_get_arc_unit(bf, 1, exit);
+        for (uint8_t axis = 0; axis < AXES; axis++) {
+            float delta = fabs(exit[axis] - entry[axis]);
+            if (delta > EPSILON) {
+                corner_vmax = min(corner_vmax, cm.a[axis].max_junction_accel / delta);
+            }
+        }
+        vmax = max(vmax, corner_vmax);
+    }
+
+    if (bf->cruise_vset > vmax) {
+        bf->cruise_vset = vmax;
+        bf->cruise_vmax = vmax;
+        bf->block_time  = bf->length / vmax;
+    }
+    bf->absolute_vmax = min(bf->absolute_vmax, vmax);
+}
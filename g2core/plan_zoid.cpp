@@ -118,10 +118,12 @@ void _zoid_exit(mpBuf_t* bf, zoidExitPoint exit_point)
 {
     //+++++ DIAGNOSTIC
     //    bf->zoid_exit = exit_point;
+#ifdef __PLANNER_DIAGNOSTICS
     if (mp_runtime_is_idle()) {  // normally the runtime keeps this value fresh
                                  //        bf->time_in_plan_ms += bf->block_time_ms;
         bf->plannable_time_ms += bf->block_time_ms;
     }
+#endif
 }
 
 
@@ -474,120 +476,159 @@ float mp_get_decel_velocity(const float v_0, const float L, const mpBuf_t* bf)
  * and jerk (J), will locate the velocity v_1 that will allow acceleration from v_0
  * at jerk J to v_1 and then deceleration at jerk J to v_2, all over total length L.
  *
+ *  The ramp length from v to v_1 is Q * sqrt(v_1 - v) * (v_1 + v), where Q is the
+ *  bf->q_recip_2_sqrt_j constant. Let v_h be the higher and v_l the lower of v_0 and v_2,
+ *  d = v_h - v_l, and solve in a = sqrt(v_1 - v_h) instead of v_1:
+ *
+ *      f(a) = a(a^2 + 2v_h) + s(s^2 + 2v_l) - L/Q      where s = sqrt(a^2 + d)
+ *
+ *  In a the two ramp lengths have no square root singularity, and f is increasing
+ *  and convex for a >= 0. Newton's method started above the root therefore walks down
+ *  onto it without ever overshooting, so every iterate is a velocity that is at most
+ *  a little too fast and the loop can be capped at a fixed count (MEET_ITERATIONS_MAX).
+ *
+ *  The start point is the smallest of three upper bounds. f(a) - f(0) is at least each
+ *  of 2a^3, 2v_h*a and (3d + 2v_l)a^2 / (2sqrt(d) + a), so a root of any one of these
+ *  with the remaining length lies above the answer. The root is within ~3x of the
+ *  smallest bound, which makes the count small and nearly constant (4 or 5 typically).
+ *
+ *  Per iteration: 1 sqrt, 2 /, ~14 * (was 2 sqrt, 3 / and up to 30 iterations)
+ *
+ *  Case (1) is the symmetric move. Case (2) is a move too short to even ramp between
+ *  v_0 and v_2 (f(0) >= 0) - there is no meet velocity, so we ramp as far as we can.
  */
 
 static float _get_meet_velocity(const float          v_0,
                                 const float          v_2,
                                 const float          L,
                                 mpBuf_t*             bf,
-                                mpBlockRuntimeBuf_t* block) 
+                                mpBlockRuntimeBuf_t* block)
 {
     const float q_recip_2_sqrt_j = bf->q_recip_2_sqrt_j;
 
-    // v_1 can never be smaller than v_0 or v_2, so we keep track of this value
-    const float min_v_1 = max(v_0, v_2);
-
-    // v_1 is our estimated return value.
-    // We estimate with the speed obtained by L/2 traveled from the highest speed of v_0 or v_2.
-    float v_1 = mp_get_target_velocity(min_v_1, L / 2.0, bf);
-    // var v_1 = min_v_1 + 100;
-
     if (fp_EQ(v_0, v_2)) {
         // Case (1)
         // We can catch a symmetric case early and return now
-
         // We'll have a head roughly equal to the tail, and no body
         block->head_length = L / 2.0;
         block->body_length = 0;
         block->tail_length = L - block->head_length;
 
+#ifdef __PLANNER_DIAGNOSTICS
         bf->meet_iterations = -1;
-
-        return v_1;
+#endif
+        return (mp_get_target_velocity(max(v_0, v_2), L / 2.0, bf));
     }
 
-    // Per iteration: 2 sqrt, 2 abs, 6 -, 4 +, 12 *, 3 /
-    int i = 0;          // limit the iterations // 466us - 644us
-    while (i++ < 30) {  // If it fails after 30, something's wrong
-        if (v_1 < min_v_1) {
-            // Case (2)
-            // We have caught a rather nasty problem. There is no meet velocity.
-            // This is due to an inversion in the velocities of very short moves.
-            // We need to compute the head OR tail length, and the body will be the rest.
-            // Yes, that means we're computing a cruise in here.
-
-            v_1 = min_v_1;
-
-            if (v_0 < v_2) {
-                // acceleration - it'll be a head/body
-                block->head_length = mp_get_target_length(v_0, v_2, bf);
-                if (block->head_length > L) {
-                    block->head_length = L;
-                    block->body_length = 0;
-                    v_1                = mp_get_target_velocity(v_0, L, bf);
-                } else {
-                    block->body_length = L - block->head_length;
-                }
-                block->tail_length = 0;
-
+    const float v_h = max(v_0, v_2);
+    const float v_l = min(v_0, v_2);
+    const float d = v_h - v_l;
+    const float sqrt_d = sqrt(d);
+    const float l_0 = q_recip_2_sqrt_j * sqrt_d * (v_h + v_l);     // length of the ramp from v_l to v_h
+
+    if (l_0 >= L) {
+        // Case (2)
+        // We have caught a rather nasty problem. There is no meet velocity.
+        // This is due to an inversion in the velocities of very short moves.
+        // We need to compute the head OR tail length, and the body will be the rest.
+        // Yes, that means we're computing a cruise in here.
+
+        float v_1 = v_h;
+
+        if (v_0 < v_2) {
+            // acceleration - it'll be a head/body
+            block->head_length = l_0;
+            if (block->head_length > L) {
+                block->head_length = L;
+                block->body_length = 0;
+                v_1                = mp_get_target_velocity(v_0, L, bf);
             } else {
-                // deceleration - it'll be tail/body
-                block->tail_length = mp_get_target_length(v_2, v_0, bf);
-                if (block->tail_length > L) {
-                    block->tail_length = L;
-                    block->body_length = 0;
-                    v_1                = mp_get_target_velocity(v_2, L, bf);
-                } else {
-                    block->body_length = L - block->tail_length;
-                }
-                block->head_length = 0;
+                block->body_length = L - block->head_length;
             }
+            block->tail_length = 0;
 
-            break;
+        } else {
+            // deceleration - it'll be tail/body
+            block->tail_length = l_0;
+            if (block->tail_length > L) {
+                block->tail_length = L;
+                block->body_length = 0;
+                v_1                = mp_get_target_velocity(v_2, L, bf);
+            } else {
+                block->body_length = L - block->tail_length;
+            }
+            block->head_length = 0;
         }
+#ifdef __PLANNER_DIAGNOSTICS
+        bf->meet_iterations = 0;
+#endif
+        mp.mv_calls++;
+        return (v_1);
+    }
 
-        // Precompute some common chunks -- note that some attempts may have v_1 < v_0 or v_1 < v_2
-        const float sqrt_delta_v_0 = sqrt(fabs(v_1 - v_0));
-        const float sqrt_delta_v_2 = sqrt(fabs(v_1 - v_2));  // 849us
-
-        // l_c is our total-length calculation with the current v_1 estimate, minus the expected length.
-        // This makes l_c == 0 when v_1 is the correct value.
-
-        // GAMBLE: At the cost of one more multiply per iteration, we will keep the two length calculations seperate.
-        // This allows us to store the resulting head/tail lengths.
-        const float l_h = q_recip_2_sqrt_j * (sqrt_delta_v_0 * (v_1 + v_0));
-        const float l_t = q_recip_2_sqrt_j * (sqrt_delta_v_2 * (v_1 + v_2));
-        const float l_c = (l_h + l_t) - L;
+    // Case (3) - start from the smallest upper bound and run Newton down to the root
+    const float r = (L - l_0) / q_recip_2_sqrt_j;                  // length still to be covered, over Q
+    const float c = 3 * d + 2 * v_l;
+    float a = (r + sqrt(r * r + 8 * c * sqrt_d * r)) / (2 * c);
+    if (v_h > 0) {
+        a = min(a, r / (2 * v_h));
+    }
+    if (2 * a * a * a > r) {                                        // only take the cube root if it is lower
+        a = cbrtf(r / 2);
+    }
 
-        block->head_length = l_h;
-        block->tail_length = l_t;
-        block->body_length = 0;
+    float l_h, l_l, l_c;
+    uint8_t i = 0;
+    while (true) {
+        const float a_2 = a * a;
+        const float s_2 = a_2 + d;
+        const float s = sqrt(s_2);
 
-        // We need this level of precision, or our length computations fail to match the block length.
-        // What we really want to ensure is that the two lengths down add up to be too much.
-        // We can be a little under (and have a small body).
+        l_h = q_recip_2_sqrt_j * a * (a_2 + 2 * v_h);                // ramp length on the v_h side
+        l_l = q_recip_2_sqrt_j * s * (s_2 + 2 * v_l);                // ramp length on the v_l side
+        l_c = (l_h + l_l) - L;                                      // >= 0 down to round-off
 
-        // TODO: make these tunable
-        if ((l_c < 0.00001) && (l_c > -1.0)) {  // allow 0.00001 overlap, OR up to a 1mm gap
-            if (l_c < 0.0) {
-                // Case (3a)
-                block->body_length = -l_c;
-            } else {
-                // Case (3b)
-                // fix the overlap
-                block->tail_length = L - block->head_length;
-            }
+        if ((++i >= MEET_ITERATIONS_MAX) || (l_c < MEET_TOLERANCE)) {
             break;
         }
+        a -= l_c / (q_recip_2_sqrt_j * (3 * a_2 + 2 * v_h + (a / s) * (3 * s_2 + 2 * v_l)));
+    }
 
-        const float v_1x3     = 3 * v_1;
-        const float recip_l_d = (2 * sqrt_delta_v_0 * sqrt_delta_v_2) /
-                                ((sqrt_delta_v_0 * (v_1x3 - v_2) - (v_0 - v_1x3) * sqrt_delta_v_2) * q_recip_2_sqrt_j);
+    if (v_0 > v_2) {
+        block->head_length = l_h;
+        block->tail_length = l_l;
+    } else {
+        block->head_length = l_l;
+        block->tail_length = l_h;
+    }
+    block->body_length = 0;
 
-        v_1 = v_1 - (l_c * recip_l_d);
+    if (l_c < 0.0) {
+        // Case (3a) - a round-off gap becomes a small body
+        block->body_length = -l_c;
+    } else {
+        // Case (3b) - fix the overlap
+        block->tail_length = L - block->head_length;
     }
 
+#ifdef __PLANNER_DIAGNOSTICS
     bf->meet_iterations = i;
+#endif
+    mp.mv_calls++;
+    mp.mv_iterations += i;
+    if (i > mp.mv_max) {
+        mp.mv_max = i;
+    }
+    return (v_h + a * a);
+}
 
-    return v_1;
+#ifdef __GLIBC__
+/*
+ * mp_meet_velocity() - entry to the meet velocity solver for host benchmarks (board/sim/sim_zoid.cpp)
+ */
+
+float mp_meet_velocity(const float v_0, const float v_2, const float L, mpBuf_t *bf, mpBlockRuntimeBuf_t *block)
+{
+    return (_get_meet_velocity(v_0, v_2, L, bf, block));
 }
+#endif
@@ -121,7 +121,7 @@ _json_commands_t jc;
 
 // Local Scope Data and Functions
 #define spindle_speed block_time    // local alias for spindle_speed to the time variable
-#define value_vector gm.target      // alias for vector of values
+#define value_vector gm->target     // alias for vector of values
 
 //static void _planner_time_accounting();
 static void _audit_buffers();
@@ -144,6 +144,9 @@ void planner_init()
     planner_init_assertions();
     mp_init_buffers();
     mp.mfo_factor = 1.00;
+    mr.time_scale = 1.00;
+    mr.time_scale_rate = 1 / FEED_OVERRIDE_RAMP_TIME;
+    mp.bp_start_ms = SysTickTimer_getValue();
 }
 
 void planner_reset()
@@ -203,6 +206,7 @@ void mp_halt_runtime()
 void mp_flush_planner()
 {
     cm_abort_arc();
+    cm_abort_coalesced_move();
     mp_init_buffers();
     mr.block_state = BLOCK_INACTIVE;   // invalidate mr buffer to prevent subsequent motion
 }
@@ -233,7 +237,13 @@ void mp_flush_planner()
  */
 
 void mp_set_planner_position(uint8_t axis, const float position) { mp.position[axis] = position; }
-void mp_set_runtime_position(uint8_t axis, const float position) { mr.position[axis] = position; }
+void mp_set_runtime_position(uint8_t axis, const float position)
+{
+    mr.position[axis] = position;
+#ifdef __FIXED_POINT_RUNTIME
+    mr.position_q[axis] = q_from_float(position, Q32_BITS);
+#endif
+}
 
 void mp_set_steps_to_runtime_position()
 {
@@ -249,7 +259,27 @@ void mp_set_steps_to_runtime_position()
         // These must be zero:
         mr.following_error[motor] = 0;
         st_pre.mot[motor].corrected_steps = 0;
+#ifndef __FIXED_POINT_RUNTIME
+        mr.correction_total[motor] = 0;
+#else
+        mr.target_steps_q[motor] = q_from_float(step_position[motor], Q32_BITS);
+        mr.position_steps_q[motor] = mr.target_steps_q[motor];
+        mr.commanded_steps_q[motor] = mr.target_steps_q[motor];
+        mr.following_error_q[motor] = 0;
+        mr.correction_total_q[motor] = 0;
+        st_pre.mot[motor].corrected_steps_q = 0;
+#endif
+        for (uint8_t i=0; i<PREP_HISTORY_SIZE; i++) {       // nothing is queued, so the whole history is here
+            mr.step_history[i][motor] = step_position[motor];
+#ifndef __FIXED_POINT_RUNTIME
+            mr.correction_history[i][motor] = 0;
+#else
+            mr.step_history_q[i][motor] = mr.target_steps_q[motor];
+            mr.correction_history_q[i][motor] = 0;
+#endif
+        }
     }
+    mr.segments_prepped = st_get_segments_loaded();
 }
 
 /************************************************************************************
@@ -258,7 +288,8 @@ void mp_set_steps_to_runtime_position()
  *
  *  How this works:
  *    - The command is called by the Gcode interpreter (cm_<command>, e.g. an M code)
- *    - cm_ function calls mp_queue_command which puts it in the planning queue (bf buffer).
+ *    - cm_ function calls mp_queue_command (via cm_queue_command()) which puts it in the
+ *      planning queue (bf buffer).
  *      This involves setting some parameters and registering a callback to the
  *      execution function in the canonical machine.
  *    - the planning queue gets to the function and calls _exec_command()
@@ -560,49 +591,44 @@ void mp_replan_queue(mpBuf_t *bf)
 }
 
 /*
- *  mp_start_feed_override() - gradually adjust existing and new buffers to target override percentage
- *  mp_end_feed_override() - gradually adjust existing and new buffers to no override percentage
+ *  mp_start_feed_override() - change the feed override for running and new blocks
+ *  mp_end_feed_override() - return the feed override to 100%
  *
  *  Variables:
- *    - 'mfo_factor' is the override scaling factor normalized to 1.0 = 100%
- *      Values < 1.0 are speed decreases, > 1.0 are increases. Upper and lower limits are checked.
+ *    - 'override_factor' is the override scaling factor normalized to 1.0 = 100%
+ *      Values < 1.0 are speed decreases, > 1.0 are increases. Upper and lower limits are
+ *      checked upstream.
  *
- *    - 'ramp_time' is approximate, as the ramp dynamically changes move execution times
- *      The ramp will attempt to meet the time specified but it will not be exact.
+ *    - 'ramp_time' is the time the runtime takes to change speed by 100% of the feed rate.
+ *      Smaller changes take proportionally less time.
  */
 /*  Function:
- *  The override takes effect as close to real-time as possible. Practically, this means about 20 or
- *  so behind the current running move. How it works:
+ *  Queued blocks are not replanned. The override is applied in two places instead:
+ *
+ *    - The runtime scales time for the block it is running (see _scale_segment_time() in
+ *      plan_exec.cpp). Segments cover the same part of the planned velocity profile but
+ *      run in segment_time / time_scale, so the velocity is time_scale times the planned
+ *      velocity. time_scale ramps to the ratio of the new factor to the factor the block
+ *      was planned with. Reductions apply to every part of a block. Increases only apply
+ *      to bodies, up to twice the planned velocity, and ramp back down by the end of each
+ *      body, so accelerations and junctions are never taken faster than planned.
  *
- *    - If the planner is idle just apply the override factor and be done with it. That's easy.
- *    - Otherwise look for the "break point" at 20 ms
+ *    - The planner is told lazily. Blocks primed after the change are planned with the new
+ *      factor (see _calculate_override() in plan_line.cpp), so the runtime ratio goes back
+ *      to 1 as they reach the runtime, and their accelerations and junctions get the
+ *      full increase.
  */
 
 void mp_start_feed_override(const float ramp_time, const float override_factor)
 {
     cm.mfo_state = MFO_REQUESTED;
-
-    if (mp.planner_state == PLANNER_IDLE) {
-        mp.mfo_factor = override_factor;             // that was easy
-        return;
-    }
-
-    // Assume that the min and max values for override_factor have been validated upstream
-    // SUVAT: V = U+AT ==> A = (V-U)/T
-    mp.ramp_target = override_factor;
-    mp.ramp_dvdt = (override_factor - mp.c->override_factor) / ramp_time;
-    mp.mfo_active = true;
-
-    if (fp_NOT_ZERO(mp.ramp_dvdt)) {    // do these things only if you actually have a ramp to run
-        mp.p = mp.c;                    // re-position the planner pointer
-        mp.ramp_active = true;
-        mp.request_planning = true;
-    }
+    mp.mfo_factor = override_factor;            // for blocks primed from now on
+    mr.time_scale_rate = 1 / ramp_time;         // the runtime picks up the new factor next segment
 }
 
 void mp_end_feed_override(const float ramp_time)
 {
-    mp_start_feed_override (FEED_OVERRIDE_RAMP_TIME, 1.00);
+    mp_start_feed_override (ramp_time, 1.00);
 }
 
 void mp_start_traverse_override(const float ramp_time, const float override_factor)
@@ -637,6 +663,46 @@ void mp_planner_time_accounting()
     UPDATE_MP_DIAGNOSTICS //+++++
 }
 
+/*
+ * mp_clp()     - clear back-planning and meet velocity diagnostic counters
+ * mp_get_plp() - get back-planning passes per second since the counters were cleared
+ * mp_get_plv() - get blocks visited by back-planning per new block
+ */
+
+stat_t mp_clp(nvObj_t *nv)
+{
+    mp.bp_blocks = 0;
+    mp.bp_passes = 0;
+    mp.bp_visits = 0;
+    mp.bp_converged = 0;
+    mp.bp_start_ms = SysTickTimer_getValue();
+    mp.mv_calls = 0;
+    mp.mv_iterations = 0;
+    mp.mv_max = 0;
+#ifdef __COALESCE_LINES
+    cm.co.lines_merged = 0;
+#endif
+    cm.co.corners_blended = 0;
+    return(STAT_OK);
+}
+
+stat_t mp_get_plp(nvObj_t *nv)
+{
+    uint32_t elapsed_ms = SysTickTimer_getValue() - mp.bp_start_ms;
+    nv->value = (elapsed_ms == 0) ? 0 : ((float)mp.bp_passes * 1000) / elapsed_ms;
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+
+stat_t mp_get_plv(nvObj_t *nv)
+{
+    nv->value = (mp.bp_blocks == 0) ? 0 : (float)mp.bp_visits / mp.bp_blocks;
+    nv->precision = GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+
 /**** PLANNER BUFFER PRIMITIVES ************************************************************
  *
  *  Planner buffers are used to queue and operate on Gcode blocks. Each buffer contains
@@ -721,6 +787,7 @@ static inline void _clear_buffer(mpBuf_t *bf)
 
     // We'll have to figure something else out for C, sorry.
     bf->reset();
+    bf->gm->reset();
 }
 
 void mp_init_buffers(void)
@@ -735,6 +802,8 @@ void mp_init_buffers(void)
     mb.r = &mb.bf[0];
     pv = &mb.bf[PLANNER_BUFFER_POOL_SIZE-1];
     for (uint8_t i=0; i < PLANNER_BUFFER_POOL_SIZE; i++) {
+        mb.bf[i].gm = &mb.gm[i];                    // bind the Gcode model side table entry
+        mb.bf[i].arc = &mb.arc[i];                  // bind the arc geometry side table entry
         _clear_buffer(&mb.bf[i]);
         uint8_t nx_i = ((i<(PLANNER_BUFFER_POOL_SIZE-1))?(i+1):0); // buffer incr & wrap
 
@@ -801,7 +870,7 @@ void mp_commit_write_buffer(const blockType block_type)
     mb.w->block_type = block_type;
     mb.w->block_state = BLOCK_INITIAL_ACTION;
 
-    if (block_type == BLOCK_TYPE_ALINE) {
+    if ((block_type == BLOCK_TYPE_ALINE) || (block_type == BLOCK_TYPE_ARC)) {
         if (cm.motion_state == MOTION_STOP) {
             cm_set_motion_state(MOTION_PLANNING);
         }
@@ -48,7 +48,8 @@
  * motion segments - is interpreted, queued to the planner, and joined together to produce 
  * continuous, synchronized motion. Non-motion commands such as pauses (dwells) and 
  * peripheral controls such as spindles can also be synchronized in the queue. Arcs are 
- * just a special case consisting of many linear moves. Arcs are not interpreted directly.
+ * queued as a single block (see mp_arc()) and interpolated by the runtime, unless native
+ * arcs are compiled out, in which case they are spooled as many short linear moves.
  *
  * The planner sits in the middle of three system layers: 
  *  - The Gcode interpreter and canonical machine (the 'model'), which feeds...
@@ -72,18 +73,20 @@
  * The buffers in the planner queue are treated as a 'closure' - with all state needed for
  * proper execution carried in the planner structure. This is important as it keeps
  * model state coherent in a heavily pipelined system. The local copy of the Gcode
- * model is carried in the gm structure that is part of each planner buffer.
+ * model is carried in the gm structure that is attached to each planner buffer.
  * See header notes in planner.cpp for more details.
  *
  * The planner is entered by calling one of:
  *  - mp_aline()         - plan and queue a move with acceleration management
+ *  - mp_arc()           - plan and queue an arc or helix as a single move
  *  - mp_dwell()         - plan and queue a pause (dwell) to the planner queue
  *  - mp_queue_command() - queue a canned command
  *  - mp_json_command()  - queue a JSON command for run-time interpretation and execution (M100)  
  *  - mp_json_wait()     - queue a JSON wait for run-time interpretation and execution (M101)
  *  - 
- * In addition, cm_arc_feed() valaidates and sets up a arc paramewters and calls mp_aline() 
- * repeatedly to spool out the arc segments into the planner queue.
+ * In addition, cm_arc_feed() valaidates and sets up a arc paramewters and calls mp_arc()
+ * to queue the arc as one block - or calls mp_aline() repeatedly to spool out the arc
+ * segments into the planner queue if __NATIVE_ARCS is off or the coordinates are rotated.
  *
  * All the above queueing commands other than mp_aline() are relatively trivial; they just
  * post callbacks into the next available planner buffer. Command functions are in 2 parts: 
@@ -150,6 +153,7 @@
 #define PLANNER_H_ONCE
 
 #include "canonical_machine.h"    // used for GCodeState_t
+#include "util.h"                 // used for qScale_t
 
 using Motate::Timeout;
 
@@ -168,7 +172,7 @@ typedef enum {                      // planner operating state
     PLANNER_BACK_PLANNING           // plan by planning all blocks, from the newest added to the running block
 } plannerState;
 
-typedef enum {                      // bf->buffer_state values in incresing order so > and < can be used
+typedef enum : uint8_t {            // bf->buffer_state values in incresing order so > and < can be used
     MP_BUFFER_EMPTY = 0,            // buffer is available for use (MUST BE 0)
     MP_BUFFER_INITIALIZING,         // buffer has been checked out and is being initialzed by aline() or a command
     MP_BUFFER_IN_PROCESS,           // planning is in progress - at least vmaxes have been set
@@ -179,10 +183,11 @@ typedef enum {                      // bf->buffer_state values in incresing orde
     MP_BUFFER_UKRAINE               // Later Stalin did the same to Ukraine
 } bufferState;
 
-typedef enum {                      // bf->block_type values
+typedef enum : uint8_t {            // bf->block_type values
     BLOCK_TYPE_NULL = 0,            // MUST=0  null move - does a no-op
     BLOCK_TYPE_ALINE = 1,           // MUST=1  acceleration planned line
-    BLOCK_TYPE_COMMAND = 2,         // MUST=2  general command
+    BLOCK_TYPE_ARC = 2,             // MUST=2  acceleration planned arc or helix (motion types come before COMMAND)
+    BLOCK_TYPE_COMMAND = 3,         // MUST=3  general command
     BLOCK_TYPE_DWELL,               // Gcode dwell
     BLOCK_TYPE_JSON_WAIT,           // JSON wait command
     BLOCK_TYPE_TOOL,                // T command (T, not M6 tool change)
@@ -191,7 +196,7 @@ typedef enum {                      // bf->block_type values
     BLOCK_TYPE_END                  // program end
 } blockType;
 
-typedef enum {
+typedef enum : uint8_t {
     BLOCK_INACTIVE = 0,             // block is inactive (MUST BE ZERO)
     BLOCK_INITIAL_ACTION,           // initial value if you need an initialization
     BLOCK_ACTIVE                    // run state
@@ -210,7 +215,7 @@ typedef enum {
     SECTION_RUNNING                 // initilized and running
 } sectionState;
 
-typedef enum {                      // code blocks for planning and trapezoid generation
+typedef enum : uint8_t {            // code blocks for planning and trapezoid generation
     NO_HINT = 0,                    // block is not hinted
     COMMAND_BLOCK,                  // this block is a command
     PERFECT_ACCELERATION,           // head-only acceleration at jerk or cannot be improved
@@ -243,10 +248,13 @@ typedef enum {
 
 /*** Most of these factors are the result of a lot of tweaking. Change with caution.***/
 
-#define PLANNER_BUFFER_POOL_SIZE    (48)                // Suggest 12 min. Limit is 255
+#define PLANNER_BUFFER_POOL_SIZE    (60)                // Suggest 12 min. Limit is 255. See RAM notes in Planner structures
 #define PLANNER_BUFFER_HEADROOM     (4)                 // Buffers to reserve in planner before processing new input line
 #define JERK_MULTIPLIER             ((float)1000000)    // DO NOT CHANGE - must always be 1 million
 
+#define MEET_ITERATIONS_MAX         (8)                 // cap on meet velocity solver iterations (measured 4 - 5 typical, 7 max)
+#define MEET_TOLERANCE              (0.00001)           // allowable head + tail overlap (mm) for the meet velocity
+
 #define JUNCTION_INTEGRATION_MIN    (0.05)              // minimum allowable setting
 #define JUNCTION_INTEGRATION_MAX    (5.00)              // maximum allowable setting
 
@@ -255,17 +263,31 @@ typedef enum {
 #define MIN_BLOCK_MS                ((float)1.5)        // minimum block (whole move) milliseconds
 #define BLOCK_TIMEOUT_MS            ((float)30.0)       // MS before deciding there are no new blocks arriving
 #define PHAT_CITY_MS                ((float)100.0)      // if you have at least this much time in the planner
+#define ARC_CORNERING_MS            ((float)10.0)       // time centripetal velocity change is taken over (see mp_arc())
 
 #define NOM_SEGMENT_TIME            ((float)(NOM_SEGMENT_MS / 60000))       // DO NOT CHANGE - time in minutes
 #define NOM_SEGMENT_USEC            ((float)(NOM_SEGMENT_MS * 1000))        // DO NOT CHANGE - time in microseconds
 #define MIN_SEGMENT_TIME            ((float)(MIN_SEGMENT_MS / 60000))       // DO NOT CHANGE - time in minutes
 #define MIN_BLOCK_TIME              ((float)(MIN_BLOCK_MS / 60000))         // DO NOT CHANGE - time in minutes
 #define PHAT_CITY_TIME              ((float)(PHAT_CITY_MS / 60000))         // DO NOT CHANGE - time in minutes
+#define ARC_CORNERING_TIME          ((float)(ARC_CORNERING_MS / 60000))     // DO NOT CHANGE - time in minutes
+
+#ifndef PREP_QUEUE_SIZE                                 // boards may override. Each segment costs ~90 bytes of RAM
+#define PREP_QUEUE_SIZE             (4)                 // segments exec may prepare ahead of the loader. Power of 2 (see stepper.h)
+#endif
+#define PREP_HISTORY_SIZE           (PREP_QUEUE_SIZE * 4)   // DO NOT CHANGE - segment targets kept to line up encoder readings and late inputs
+
+#ifdef __FIXED_POINT_RUNTIME                            // fraction bits used by the fixed-point runtime
+#define LENGTH_Q_BITS               48                  // Q16.48 segment length and forward differences
+#define UNIT_Q_BITS                 30                  // Q1.30 unit vector and arc phasor
+#define ARC_TURN_MAX                (0.25)              // radians - arc segments that turn further use sin() and cos()
+#define SPU_Q_BITS                  15                  // Q16.15 steps per unit - limits steps per unit to 65535
+#endif
 
 #define FEED_OVERRIDE_ENABLE        false               // initial value
 #define FEED_OVERRIDE_MIN           (0.05)              // 5% minimum
 #define FEED_OVERRIDE_MAX           (2.00)              // 200% maximum
-#define FEED_OVERRIDE_RAMP_TIME     (0.500/60)          // ramp time for feed overrides
+#define FEED_OVERRIDE_RAMP_TIME     (0.500/60)          // time for the runtime to change speed by 100% of feed
 #define FEED_OVERRIDE_FACTOR        (1.00)              // initial value
 
 #define TRAVERSE_OVERRIDE_ENABLE    false               // initial value
@@ -298,32 +320,71 @@ typedef enum {
  *  Please refer to header comments in for important details on buffers and blocks
  *    - plan_zoid.cpp / mp_calculate_ramps()
  *    - plan_exec.cpp / mp_exec_aline()
+ *
+ *  Each planner buffer is split in two:
+ *    - The hot part (mpBuf_t) in mb.bf[] holds what back-planning and forward planning
+ *      walk over - links, states, velocities, lengths and jerk terms.
+ *    - The cold part (GCodeState_t) in mb.gm[] is the Gcode model "closure" for the block.
+ *      It is written by aline() or a queued command, read once when the runtime starts the
+ *      block, and is reached from the hot buffer through the static bf->gm pointer.
+ *
+ *  RAM per buffer on the SAM3X (32 bit enums) went from 276 bytes to 220 bytes:
+ *    - target_comp[] (Kahan summation state) moved from every gm copy to the runtime (-24)
+ *    - per-buffer planner diagnostics are now only compiled with __PLANNER_DIAGNOSTICS (-24)
+ *    - buffer, block, state and hint enums are uint8_t (-12)
+ *    - the bf->gm pointer (+4)
+ *  48 buffers cost 13248 bytes before, 60 buffers cost 13200 bytes now - same RAM, deeper queue.
+ *
+ *  Arc blocks (BLOCK_TYPE_ARC) keep their geometry in a third side table, mb.arc[], reached
+ *  through bf->arc. It's 28 bytes per buffer (+4 for the pointer), and replaces the dozens
+ *  of chord buffers an arc used to occupy.
+ *
+ *  Coalesced G1 blocks carry their line number marks in the gm state (see cm_straight_feed()).
+ *  That adds 44 bytes to every GCodeState_t, about 2.6K across mb.gm[], so the marks and the
+ *  merging are only compiled in with __COALESCE_LINES. Each of those buffers can then hold up
+ *  to COALESCE_LINES_MAX lines of CAM output.
  */
 
+//#define __PLANNER_DIAGNOSTICS         // uncomment to compile per-buffer planner diagnostics (+24 bytes per buffer)
+
+typedef struct mpArcBuffer {        // arc geometry for BLOCK_TYPE_ARC buffers - see mp_arc()
+    uint8_t plane_axis_0;           // arc plane axis 0 - e.g. X for G17
+    uint8_t plane_axis_1;           // arc plane axis 1 - e.g. Y for G17
+    uint8_t linear_axis;            // linear axis (normal to plane)
+    bool blend;                     // true for a G64 P corner blend arc (see _calculate_arc_vmax())
+
+    float center_0;                 // center of circle at plane axis 0
+    float center_1;                 // center of circle at plane axis 1
+    float radius;                   // radius at the start of the block
+    float radius_travel;            // end radius - start radius (spreads any endpoint radius error over the arc)
+    float theta;                    // angle at the start of the block (radians from the plane axis 1)
+    float angular_travel;           // travel along the arc in radians (+ is CW)
+} mpArcBuf_t;
+
 struct mpBuffer_to_clear {
     // Note: _clear_buffer() zeros all data from this point down
     stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
     cm_exec_t cm_func;              // callback to canonical machine execution function
 
+#ifdef __PLANNER_DIAGNOSTICS
     //+++++ DIAGNOSTICS for easier debugging
-    uint32_t linenum;               // mirror of bf->gm.linenum
+    uint32_t linenum;               // mirror of bf->gm->linenum
     int iterations;
     float block_time_ms;
     float plannable_time_ms;        // time in planner
     float plannable_length;         // length in planner
     int8_t meet_iterations;         // iterations needed in _get_meet_velocity
     //+++++ to here
+#endif
 
     bufferState buffer_state;       // used to manage queuing/dequeuing
     blockType block_type;           // used to dispatch to run routine
     blockState block_state;         // move state machine sequence
     blockHint hint;                 // hint the block for zoid and other planning operations. Must be accurate or NO_HINT
 
-    // block parameters
-    float unit[AXES];               // unit vector for axis scaling & planning
-    bool axis_flags[AXES];          // set true for axes participating in the move & for command parameters
-
     bool plannable;                 // set true when this block can be used for planning
+    bool replan;                    // set when priming changed this block's vmaxes - back-planning must visit it
+    bool axis_flags[AXES];          // set true for axes participating in the move & for command parameters
 
     float length;                   // total length of line or helix in mm
     float block_time;               // computed move time for entire block (move)
@@ -352,7 +413,7 @@ struct mpBuffer_to_clear {
     float sqrt_j;                   // sqrt(jM) used for planning (computed and cached)
     float q_recip_2_sqrt_j;         // (q/(2 sqrt(jM))) where q = (sqrt(10)/(3^(1/4))), used in length computations (computed and cached)
 
-    GCodeState_t gm;                // Gcode model state - passed from model, used by planner and runtime
+    float unit[AXES];               // unit vector for axis scaling & planning
 
     void reset() {
         //memset((void *)(this), 0, sizeof(mpBuffer_to_clear));
@@ -360,12 +421,14 @@ struct mpBuffer_to_clear {
         bf_func = nullptr;
         cm_func = nullptr;
 
+#ifdef __PLANNER_DIAGNOSTICS
         linenum = 0;
         iterations = 0;
         block_time_ms = 0;
         plannable_time_ms = 0;
         plannable_length = 0;
         meet_iterations = 0;
+#endif
 
         buffer_state = MP_BUFFER_EMPTY;
         block_type = BLOCK_TYPE_NULL;
@@ -378,6 +441,7 @@ struct mpBuffer_to_clear {
         }
 
         plannable = false;
+        replan = false;
         length  = 0.0;
         block_time = 0.0;
         override_factor = 0.0;
@@ -393,15 +457,16 @@ struct mpBuffer_to_clear {
         recip_jerk = 0.0;
         sqrt_j = 0.0;
         q_recip_2_sqrt_j = 0.0;
-        gm.reset();
     }
 };
 
 typedef struct mpBuffer : mpBuffer_to_clear { // See Planning Velocity Notes for variable usage
 
-    // *** CAUTION *** These two pointers are not reset by _clear_buffer()
+    // *** CAUTION *** These four pointers are not reset by _clear_buffer()
     struct mpBuffer *pv;            // static pointer to previous buffer
     struct mpBuffer *nx;            // static pointer to next buffer
+    GCodeState_t *gm;               // static pointer to Gcode model state in the mb.gm[] side table
+    mpArcBuf_t *arc;                // static pointer to arc geometry in the mb.arc[] side table
     uint8_t buffer_number;          //+++++ DIAGNOSTIC for easier debugging
 } mpBuf_t;
 
@@ -411,7 +476,9 @@ typedef struct mpBufferPool {       // ring buffer for sub-moves
     mpBuf_t *r;                     // run buffer pointer
     mpBuf_t *w;                     // write buffer pointer
     uint8_t buffers_available;      // running count of available buffers
-    mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
+    mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage - planning fields
+    GCodeState_t gm[PLANNER_BUFFER_POOL_SIZE];// Gcode model state for each buffer (bf[i].gm == &gm[i])
+    mpArcBuf_t arc[PLANNER_BUFFER_POOL_SIZE];// arc geometry for each buffer (bf[i].arc == &arc[i])
 
     magic_t magic_end;
 } mpBufferPool_t;
@@ -434,14 +501,20 @@ typedef struct mpMotionPlannerSingleton {  // common variables for planning (mov
     plannerState planner_state;     // current state of planner
     bool request_planning;          // set true to request backplanning
     bool backplanning;              // true if planner is in a back-planning pass
-    bool mfo_active;                // true if mfo override is in effect
-    bool ramp_active;               // true when a ramp is occurring
     bool entry_changed;             // mark if exit_velocity changed to invalidate next block's hint
 
-    // feed overrides and ramp variables (these extend the variables in cm.gmx)
-    float mfo_factor;               // runtime override factor
-    float ramp_target;
-    float ramp_dvdt;
+    // back-planning diagnostics - cleared by planner_init() and mp_clp()
+    uint32_t bp_blocks;             // new blocks primed for planning
+    uint32_t bp_passes;             // back-planning passes
+    uint32_t bp_visits;             // blocks visited by back-planning passes
+    uint32_t bp_converged;          // passes that stopped early because the plan had converged
+    uint32_t bp_start_ms;           // SysTick time when the counters were cleared
+    uint32_t mv_calls;              // asymmetric meet velocity solutions (zoid exit 3c)
+    uint32_t mv_iterations;         // total meet velocity solver iterations
+    uint32_t mv_max;                // most iterations taken by a single solution
+
+    // feed overrides (these extend the variables in cm.gmx) - see mp_start_feed_override()
+    float mfo_factor;               // override factor new blocks are planned with
 
     // objects
     Timeout block_timeout;          // Timeout object for block planning
@@ -484,9 +557,15 @@ typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
 
     float target_steps[MOTORS];         // current MR target (absolute target as steps)
     float position_steps[MOTORS];       // current MR position (target from previous segment)
-    float commanded_steps[MOTORS];      // will align with next encoder sample (target from 2nd previous segment)
+    float commanded_steps[MOTORS];      // aligns with the encoder sample (target of the segment before the last one loaded)
     float encoder_steps[MOTORS];        // encoder position in steps - ideally the same as commanded_steps
     float following_error[MOTORS];      // difference between encoder_steps and commanded steps
+    float step_history[PREP_HISTORY_SIZE][MOTORS];  // target_steps of recent segments, indexed by segment number
+#ifndef __FIXED_POINT_RUNTIME
+    float correction_total[MOTORS];     // step corrections made by st_prep_line() since the last reset
+    float correction_history[PREP_HISTORY_SIZE][MOTORS];    // correction_total after each segment, as step_history
+#endif
+    uint32_t segments_prepped;          // line segments prepared - counts in step with st_pre.segments_loaded
 
     mpBlockRuntimeBuf_t *r;             // block that is running
     mpBlockRuntimeBuf_t *p;             // block that is being planned, p might == r
@@ -499,6 +578,12 @@ typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
     float segment_velocity;             // computed velocity for aline segment
     float segment_time;                 // actual time increment per aline segment
 
+    float override_factor;              // override factor the running block was planned with
+    float time_scale;                   // runtime feed override - multiplies segment velocity, divides segment time
+    float time_scale_floor;             // lowest time_scale the running section was segmented for
+    float time_scale_max;               // highest time_scale the running block's velocity limit allows
+    float time_scale_rate;              // fastest change of time_scale, per minute
+
     float forward_diff_1;               // forward difference level 1
     float forward_diff_2;               // forward difference level 2
     float forward_diff_3;               // forward difference level 3
@@ -506,6 +591,43 @@ typedef struct mpMotionRuntimeSingleton {    // persistent runtime variables
     float forward_diff_5;               // forward difference level 5
 
     GCodeState_t gm;                    // gcode model state currently executing
+    float target_comp[AXES];            // summation compensation (Kahan) overflow value - reset for each block
+
+    blockType block_type;               // BLOCK_TYPE_ALINE or BLOCK_TYPE_ARC
+    mpArcBuf_t arc;                     // arc geometry of the running block (copy of bf->arc)
+    float arc_start[AXES];              // position at the start of the arc block
+    float arc_length;                   // total length of the arc block
+    float arc_travel;                   // length travelled so far in the arc block
+
+#ifdef __FIXED_POINT_RUNTIME            // see _exec_aline_segment() for number formats
+    int64_t arc_travel_q;               // Q16.48 master copy of arc_travel
+    int64_t arc_angle_q;                // Q16.48 radians turned so far in the arc block
+    int32_t arc_phasor_q[2];            // Q1.30 sin and cos of the arc angle (see _turn_arc_phasor())
+    qScale_t arc_angle_scale;           // radians turned per unit of arc travel
+    qScale_t arc_radius_scale;          // radius change per unit of arc travel
+    qScale_t arc_axis_scale[AXES];      // axis travel per unit of arc travel (other than the plane axes)
+    int64_t arc_start_q[AXES];          // Q31.32 arc_start
+    int64_t arc_center_q[2];            // Q31.32 arc center on the plane axes
+    int64_t arc_radius_q;               // Q31.32 radius at the start of the block
+    int64_t segment_length_q;           // Q16.48 length of the current segment
+    int64_t section_remaining_q;        // Q16.48 length left in the current section
+    int64_t forward_diff_q1;            // Q16.48 forward differences, scaled to segment length
+    int64_t forward_diff_q2;
+    int64_t forward_diff_q3;
+    int64_t forward_diff_q4;
+    int64_t forward_diff_q5;
+
+    int32_t unit_q[AXES];               // Q1.30 unit vector
+    int32_t steps_per_unit_q[MOTORS];   // Q16.15 steps per unit for the axis each motor is mapped to (0 if inhibited)
+    int64_t position_q[AXES];           // Q31.32 master copy of position - position[] follows this
+    int64_t target_steps_q[MOTORS];     // Q31.32 master copies of the step vectors - float copies follow at section ends
+    int64_t position_steps_q[MOTORS];
+    int64_t commanded_steps_q[MOTORS];
+    int64_t following_error_q[MOTORS];
+    int64_t step_history_q[PREP_HISTORY_SIZE][MOTORS];
+    int64_t correction_total_q[MOTORS]; // Q31.32 correction_total and correction_history
+    int64_t correction_history_q[PREP_HISTORY_SIZE][MOTORS];
+#endif
 
     magic_t magic_end;
 } mpMotionRuntimeSingleton_t;
@@ -558,6 +680,10 @@ void mp_start_traverse_override(const float ramp_time, const float override);
 void mp_end_traverse_override(const float ramp_time);
 void mp_planner_time_accounting(void);
 
+stat_t mp_clp(nvObj_t *nv);
+stat_t mp_get_plp(nvObj_t *nv);
+stat_t mp_get_plv(nvObj_t *nv);
+
 // planner buffer primitives
 void mp_init_buffers(void);
 
@@ -574,13 +700,17 @@ bool mp_free_run_buffer(void);
 // plan_line.c functions
 void mp_zero_segment_velocity(void);                    // getters and setters...
 float mp_get_runtime_velocity(void);
+float mp_get_runtime_time_scale(void);
 float mp_get_runtime_absolute_position(uint8_t axis);
 float mp_get_runtime_work_position(uint8_t axis);
+uint32_t mp_get_runtime_linenum(void);
 void mp_set_runtime_work_offset(float offset[]);
 bool mp_get_runtime_busy(void);
 bool mp_runtime_is_idle(void);
 
 stat_t mp_aline(GCodeState_t *gm_in);                   // line planning...
+stat_t mp_arc(GCodeState_t *gm_in, const mpArcBuf_t *arc_in);
+void mp_get_arc_unit(const mpBuf_t *bf, const float fraction, float unit[]);
 void mp_plan_block_list(void);
 void mp_plan_block_forward(mpBuf_t *bf);
 
@@ -588,6 +718,9 @@ void mp_plan_block_forward(mpBuf_t *bf);
 void mp_calculate_ramps(mpBlockRuntimeBuf_t *block, mpBuf_t *bf, const float entry_velocity);
 float mp_get_target_length(const float v_0, const float v_1, const mpBuf_t *bf);
 float mp_get_target_velocity(const float v_0, const float L, const mpBuf_t *bf); // acceleration ONLY
+#ifdef __GLIBC__
+float mp_meet_velocity(const float v_0, const float v_2, const float L, mpBuf_t *bf, mpBlockRuntimeBuf_t *block);
+#endif
 float mp_get_decel_velocity(const float v_0, const float L, const mpBuf_t *bf);  // deceleration ONLY
 float mp_find_t(const float v_0, const float v_1, const float L, const float totalL, const float initial_t, const float T);
 
@@ -601,6 +734,7 @@ stat_t mp_forward_plan(void);
 stat_t mp_exec_move(void);
 stat_t mp_exec_aline(mpBuf_t *bf);
 void mp_exit_hold_state(void);
+void mp_get_runtime_steps_at(const uint32_t ticks, float steps[]);
 
 void mp_dump_planner(mpBuf_t *bf_start);
 
@@ -71,6 +71,10 @@
 #define CHORDAL_TOLERANCE           0.01    // {ct: chordal tolerance for arcs (in mm)
 #endif
 
+#ifndef COALESCE_TOLERANCE
+#define COALESCE_TOLERANCE          0.0     // {clt: max deviation for merging collinear G1 lines (in mm), 0=off
+#endif
+
 #ifndef MOTOR_POWER_TIMEOUT
 #define MOTOR_POWER_TIMEOUT         2.00    // {mt:  motor power timeout in seconds
 #endif
@@ -149,6 +153,14 @@
 #define XIO_UART_MUTES_WHEN_USB_CONNECTED  0                // UART will be muted when USB connected (off by default)
 #endif
 
+#ifndef TX_BATCHING
+#define TX_BATCHING                 1                       // {txb: 1=send each controller pass's output in one write, 0=write each line
+#endif
+
+#ifndef TX_LATENCY_MS
+#define TX_LATENCY_MS               2                       // {txl: most ms output is held within a long pass, 0=until the pass ends
+#endif
+
 #ifndef JSON_VERBOSITY
 #define JSON_VERBOSITY              JV_MESSAGES             // {jv: JV_SILENT, JV_FOOTER, JV_CONFIGS, JV_MESSAGES, JV_LINENUM, JV_VERBOSE
 #endif
@@ -161,6 +173,18 @@
 #define STATUS_REPORT_VERBOSITY     SR_FILTERED             // {sv: SR_OFF, SR_FILTERED, SR_VERBOSE
 #endif
 
+#ifndef INGEST_LINES_MAX
+#define INGEST_LINES_MAX            8                       // {ilm: most Gcode lines read in one controller pass, 1=one per pass
+#endif
+
+#ifndef INGEST_HEADROOM_MARGIN
+#define INGEST_HEADROOM_MARGIN      4                       // {ilh: free planner buffers above the headroom needed to read another line in the pass
+#endif
+
+#ifndef INGEST_TIME_BUDGET
+#define INGEST_TIME_BUDGET          1000                    // {ilt: microseconds of Gcode lines in one pass before the rest of the pass runs
+#endif
+
 #ifndef STATUS_REPORT_MIN_MS
 #define STATUS_REPORT_MIN_MS        200                     // (no JSON) milliseconds - enforces a viable minimum
 #endif
@@ -232,6 +256,24 @@
 #ifndef M1_POWER_LEVEL
 #define M1_POWER_LEVEL              0.0                     // {1pl:   0.0=no power, 1.0=max power
 #endif
+#ifndef M1_ENCODER_SOURCE
+#define M1_ENCODER_SOURCE           ENCODER_SOURCE_STEPS    // {1es:  0=counted steps, 1=position reported by the motor
+#endif
+#ifndef M1_CORRECTION_P
+#define M1_CORRECTION_P             0.25                    // {1cp:  step correction gains (see stepper.h)
+#endif
+#ifndef M1_CORRECTION_I
+#define M1_CORRECTION_I             0.0
+#endif
+#ifndef M1_CORRECTION_D
+#define M1_CORRECTION_D             0.0
+#endif
+#ifndef M1_CORRECTION_MAX
+#define M1_CORRECTION_MAX           0.60                    // {1cm:  largest correction per segment, in steps
+#endif
+#ifndef M1_FOLLOWING_ERROR_LIMIT
+#define M1_FOLLOWING_ERROR_LIMIT    0.0                     // {1fl:  following error that holds the machine, in steps. 0=disabled
+#endif
 
 // MOTOR 2
 #ifndef M2_MOTOR_MAP
@@ -258,6 +300,24 @@
 #ifndef M2_POWER_LEVEL
 #define M2_POWER_LEVEL              0.0
 #endif
+#ifndef M2_ENCODER_SOURCE
+#define M2_ENCODER_SOURCE           ENCODER_SOURCE_STEPS
+#endif
+#ifndef M2_CORRECTION_P
+#define M2_CORRECTION_P             0.25
+#endif
+#ifndef M2_CORRECTION_I
+#define M2_CORRECTION_I             0.0
+#endif
+#ifndef M2_CORRECTION_D
+#define M2_CORRECTION_D             0.0
+#endif
+#ifndef M2_CORRECTION_MAX
+#define M2_CORRECTION_MAX           0.60
+#endif
+#ifndef M2_FOLLOWING_ERROR_LIMIT
+#define M2_FOLLOWING_ERROR_LIMIT    0.0
+#endif
 
 // MOTOR 3
 #ifndef M3_MOTOR_MAP
@@ -284,6 +344,24 @@
 #ifndef M3_POWER_LEVEL
 #define M3_POWER_LEVEL              0.0
 #endif
+#ifndef M3_ENCODER_SOURCE
+#define M3_ENCODER_SOURCE           ENCODER_SOURCE_STEPS
+#endif
+#ifndef M3_CORRECTION_P
+#define M3_CORRECTION_P             0.25
+#endif
+#ifndef M3_CORRECTION_I
+#define M3_CORRECTION_I             0.0
+#endif
+#ifndef M3_CORRECTION_D
+#define M3_CORRECTION_D             0.0
+#endif
+#ifndef M3_CORRECTION_MAX
+#define M3_CORRECTION_MAX           0.60
+#endif
+#ifndef M3_FOLLOWING_ERROR_LIMIT
+#define M3_FOLLOWING_ERROR_LIMIT    0.0
+#endif
 
 // MOTOR 4
 #ifndef M4_MOTOR_MAP
@@ -310,6 +388,24 @@
 #ifndef M4_POWER_LEVEL
 #define M4_POWER_LEVEL              0.0
 #endif
+#ifndef M4_ENCODER_SOURCE
+#define M4_ENCODER_SOURCE           ENCODER_SOURCE_STEPS
+#endif
+#ifndef M4_CORRECTION_P
+#define M4_CORRECTION_P             0.25
+#endif
+#ifndef M4_CORRECTION_I
+#define M4_CORRECTION_I             0.0
+#endif
+#ifndef M4_CORRECTION_D
+#define M4_CORRECTION_D             0.0
+#endif
+#ifndef M4_CORRECTION_MAX
+#define M4_CORRECTION_MAX           0.60
+#endif
+#ifndef M4_FOLLOWING_ERROR_LIMIT
+#define M4_FOLLOWING_ERROR_LIMIT    0.0
+#endif
 
 // MOTOR 5
 #ifndef M5_MOTOR_MAP
@@ -336,6 +432,24 @@
 #ifndef M5_POWER_LEVEL
 #define M5_POWER_LEVEL              0.0
 #endif
+#ifndef M5_ENCODER_SOURCE
+#define M5_ENCODER_SOURCE           ENCODER_SOURCE_STEPS
+#endif
+#ifndef M5_CORRECTION_P
+#define M5_CORRECTION_P             0.25
+#endif
+#ifndef M5_CORRECTION_I
+#define M5_CORRECTION_I             0.0
+#endif
+#ifndef M5_CORRECTION_D
+#define M5_CORRECTION_D             0.0
+#endif
+#ifndef M5_CORRECTION_MAX
+#define M5_CORRECTION_MAX           0.60
+#endif
+#ifndef M5_FOLLOWING_ERROR_LIMIT
+#define M5_FOLLOWING_ERROR_LIMIT    0.0
+#endif
 
 // MOTOR 6
 #ifndef M6_MOTOR_MAP
@@ -362,6 +476,24 @@
 #ifndef M6_POWER_LEVEL
 #define M6_POWER_LEVEL              0.0
 #endif
+#ifndef M6_ENCODER_SOURCE
+#define M6_ENCODER_SOURCE           ENCODER_SOURCE_STEPS
+#endif
+#ifndef M6_CORRECTION_P
+#define M6_CORRECTION_P             0.25
+#endif
+#ifndef M6_CORRECTION_I
+#define M6_CORRECTION_I             0.0
+#endif
+#ifndef M6_CORRECTION_D
+#define M6_CORRECTION_D             0.0
+#endif
+#ifndef M6_CORRECTION_MAX
+#define M6_CORRECTION_MAX           0.60
+#endif
+#ifndef M6_FOLLOWING_ERROR_LIMIT
+#define M6_FOLLOWING_ERROR_LIMIT    0.0
+#endif
 
 //*****************************************************************************
 //*** Axis Settings ***********************************************************
@@ -868,6 +1000,271 @@
 #define DO13_MODE                   IO_ACTIVE_HIGH
 #endif
 
+// *** CAN Servos *** //
+
+#ifndef CANOPEN_PERIOD_US
+#define CANOPEN_PERIOD_US           10000                 // {cansp: CSP interpolation period in microseconds (see canopen.h)
+#endif
+
+// *** CAN Routes *** //
+// Routes tie CAN frame IDs to digital inputs and outputs (see can_bus.h). All unused by default.
+
+#ifndef CR1_TYPE
+#define CR1_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR1_ID
+#define CR1_ID                      0
+#endif
+#ifndef CR1_MASK
+#define CR1_MASK                    0
+#endif
+#ifndef CR1_CHANNEL
+#define CR1_CHANNEL                 1
+#endif
+#ifndef CR1_COUNT
+#define CR1_COUNT                   1
+#endif
+
+#ifndef CR2_TYPE
+#define CR2_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR2_ID
+#define CR2_ID                      0
+#endif
+#ifndef CR2_MASK
+#define CR2_MASK                    0
+#endif
+#ifndef CR2_CHANNEL
+#define CR2_CHANNEL                 1
+#endif
+#ifndef CR2_COUNT
+#define CR2_COUNT                   1
+#endif
+
+#ifndef CR3_TYPE
+#define CR3_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR3_ID
+#define CR3_ID                      0
+#endif
+#ifndef CR3_MASK
+#define CR3_MASK                    0
+#endif
+#ifndef CR3_CHANNEL
+#define CR3_CHANNEL                 1
+#endif
+#ifndef CR3_COUNT
+#define CR3_COUNT                   1
+#endif
+
+#ifndef CR4_TYPE
+#define CR4_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR4_ID
+#define CR4_ID                      0
+#endif
+#ifndef CR4_MASK
+#define CR4_MASK                    0
+#endif
+#ifndef CR4_CHANNEL
+#define CR4_CHANNEL                 1
+#endif
+#ifndef CR4_COUNT
+#define CR4_COUNT                   1
+#endif
+
+#ifndef CR5_TYPE
+#define CR5_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR5_ID
+#define CR5_ID                      0
+#endif
+#ifndef CR5_MASK
+#define CR5_MASK                    0
+#endif
+#ifndef CR5_CHANNEL
+#define CR5_CHANNEL                 1
+#endif
+#ifndef CR5_COUNT
+#define CR5_COUNT                   1
+#endif
+
+#ifndef CR6_TYPE
+#define CR6_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR6_ID
+#define CR6_ID                      0
+#endif
+#ifndef CR6_MASK
+#define CR6_MASK                    0
+#endif
+#ifndef CR6_CHANNEL
+#define CR6_CHANNEL                 1
+#endif
+#ifndef CR6_COUNT
+#define CR6_COUNT                   1
+#endif
+
+#ifndef CR7_TYPE
+#define CR7_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR7_ID
+#define CR7_ID                      0
+#endif
+#ifndef CR7_MASK
+#define CR7_MASK                    0
+#endif
+#ifndef CR7_CHANNEL
+#define CR7_CHANNEL                 1
+#endif
+#ifndef CR7_COUNT
+#define CR7_COUNT                   1
+#endif
+
+#ifndef CR8_TYPE
+#define CR8_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR8_ID
+#define CR8_ID                      0
+#endif
+#ifndef CR8_MASK
+#define CR8_MASK                    0
+#endif
+#ifndef CR8_CHANNEL
+#define CR8_CHANNEL                 1
+#endif
+#ifndef CR8_COUNT
+#define CR8_COUNT                   1
+#endif
+
+#ifndef CR9_TYPE
+#define CR9_TYPE                    CAN_ROUTE_NONE
+#endif
+#ifndef CR9_ID
+#define CR9_ID                      0
+#endif
+#ifndef CR9_MASK
+#define CR9_MASK                    0
+#endif
+#ifndef CR9_CHANNEL
+#define CR9_CHANNEL                 1
+#endif
+#ifndef CR9_COUNT
+#define CR9_COUNT                   1
+#endif
+
+#ifndef CR10_TYPE
+#define CR10_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR10_ID
+#define CR10_ID                     0
+#endif
+#ifndef CR10_MASK
+#define CR10_MASK                   0
+#endif
+#ifndef CR10_CHANNEL
+#define CR10_CHANNEL                1
+#endif
+#ifndef CR10_COUNT
+#define CR10_COUNT                  1
+#endif
+
+#ifndef CR11_TYPE
+#define CR11_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR11_ID
+#define CR11_ID                     0
+#endif
+#ifndef CR11_MASK
+#define CR11_MASK                   0
+#endif
+#ifndef CR11_CHANNEL
+#define CR11_CHANNEL                1
+#endif
+#ifndef CR11_COUNT
+#define CR11_COUNT                  1
+#endif
+
+#ifndef CR12_TYPE
+#define CR12_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR12_ID
+#define CR12_ID                     0
+#endif
+#ifndef CR12_MASK
+#define CR12_MASK                   0
+#endif
+#ifndef CR12_CHANNEL
+#define CR12_CHANNEL                1
+#endif
+#ifndef CR12_COUNT
+#define CR12_COUNT                  1
+#endif
+
+#ifndef CR13_TYPE
+#define CR13_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR13_ID
+#define CR13_ID                     0
+#endif
+#ifndef CR13_MASK
+#define CR13_MASK                   0
+#endif
+#ifndef CR13_CHANNEL
+#define CR13_CHANNEL                1
+#endif
+#ifndef CR13_COUNT
+#define CR13_COUNT                  1
+#endif
+
+#ifndef CR14_TYPE
+#define CR14_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR14_ID
+#define CR14_ID                     0
+#endif
+#ifndef CR14_MASK
+#define CR14_MASK                   0
+#endif
+#ifndef CR14_CHANNEL
+#define CR14_CHANNEL                1
+#endif
+#ifndef CR14_COUNT
+#define CR14_COUNT                  1
+#endif
+
+#ifndef CR15_TYPE
+#define CR15_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR15_ID
+#define CR15_ID                     0
+#endif
+#ifndef CR15_MASK
+#define CR15_MASK                   0
+#endif
+#ifndef CR15_CHANNEL
+#define CR15_CHANNEL                1
+#endif
+#ifndef CR15_COUNT
+#define CR15_COUNT                  1
+#endif
+
+#ifndef CR16_TYPE
+#define CR16_TYPE                   CAN_ROUTE_NONE
+#endif
+#ifndef CR16_ID
+#define CR16_ID                     0
+#endif
+#ifndef CR16_MASK
+#define CR16_MASK                   0
+#endif
+#ifndef CR16_CHANNEL
+#define CR16_CHANNEL                1
+#endif
+#ifndef CR16_COUNT
+#define CR16_COUNT                  1
+#endif
+
 // *** PWM Settings *** //
 
 #ifndef P1_PWM_FREQUENCY
@@ -70,6 +70,10 @@
 #define CHORDAL_TOLERANCE           0.01    // {ct: chordal tolerance for arcs (in mm)
 #endif
 
+#ifndef COALESCE_TOLERANCE
+#define COALESCE_TOLERANCE          0.0     // {clt: max deviation for merging collinear G1 lines (in mm), 0=off
+#endif
+
 #ifndef MOTOR_POWER_TIMEOUT
 #define MOTOR_POWER_TIMEOUT         2.00    // {mt:  motor power timeout in seconds
 #endif
@@ -204,9 +208,19 @@
 //*** CAN Settings ************************************************************
 //*****************************************************************************
 
-#define CAN_GPIO_INPUT_ADDRESS_1 0xA1
-#define CAN_GPIO_INPUT_ADDRESS_2 0x42
-//#define D_IN_CAN_CHANNELS  0
+// Routes - see can_bus.h. CAN inputs follow the 8 board inputs, so the first is di9
+
+#define CR1_TYPE                    CAN_ROUTE_INPUT         // {cr1ty: 0=none, 1=input, 2=output
+#define CR1_ID                      0xA1                    // {cr1id: CAN ID
+#define CR1_CHANNEL                 9                       // {cr1ch: first input (di9)
+
+#define CR2_TYPE                    CAN_ROUTE_INPUT
+#define CR2_ID                      0x42
+#define CR2_CHANNEL                 10                      // di10
+
+#define CR3_TYPE                    CAN_ROUTE_OUTPUT
+#define CR3_ID                      0x201
+#define CR3_CHANNEL                 10                      // do10 - first CAN output
 
 //*****************************************************************************
 //*** Motor Settings **********************************************************
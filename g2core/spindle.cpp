@@ -78,7 +78,7 @@ stat_t cm_set_spindle_speed(float speed)
 
     float value[AXES] = { speed, 0,0,0,0,0 };
     bool flags[] = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_spindle_speed, value, flags);
+    cm_queue_command(_exec_spindle_speed, value, flags);
     return (STAT_OK);
 }
 
@@ -149,7 +149,7 @@ stat_t cm_spindle_control(uint8_t control)  // requires SPINDLE_CONTROL_xxx styl
 
     float value[] = { (float)spindle.enable, (float)spindle.direction, 0,0,0,0 };
     bool flags[] =  { 1,1,0,0,0,0 };
-    mp_queue_command(_exec_spindle_control, value, flags);
+    cm_queue_command(_exec_spindle_control, value, flags);
     return(STAT_OK);
 }
 
@@ -39,6 +39,10 @@
 #include "util.h"
 #include "controller.h"
 #include "xio.h"
+#include "report.h"
+#include "isr_timing.h"
+
+#include <atomic>                   // std::atomic_signal_fence - orders the prep queue handoff
 
 /**** Debugging output with semihosting ****/
 
@@ -62,7 +66,29 @@ static stRunSingleton_t st_run;
 
 /**** Static functions ****/
 
-static void _load_move(void);
+static void _load_move(const bool segment_ended);
+
+static_assert(((PREP_QUEUE_SIZE-1) & PREP_QUEUE_SIZE) == 0, "PREP_QUEUE_SIZE must be 2^N");
+
+// prep queue helpers - see stepper.h
+static inline uint8_t _prep_queue_count() { return ((uint8_t)(st_pre.head - st_pre.tail)); }
+static inline stPrepSegment_t *_prep_segment() { return (&st_pre.seg[st_pre.head & (PREP_QUEUE_SIZE-1)]); }
+static inline void _prep_queue_commit()
+{
+    std::atomic_signal_fence(std::memory_order_release);    // segment is written before the loader can see it
+    st_pre.head++;
+}
+
+// A command keeps the planner run buffer until the loader runs it, so the exec can't go past one
+static inline bool _prep_queue_has_room()
+{
+    uint8_t queued = _prep_queue_count();
+    if (queued == 0) {
+        return (true);
+    }
+    return ((queued < PREP_QUEUE_SIZE) &&
+            (st_pre.seg[(uint8_t)(st_pre.head-1) & (PREP_QUEUE_SIZE-1)].block_type != BLOCK_TYPE_COMMAND));
+}
 
 // handy macro
 //#define _f_to_period(f) (uint16_t)((float)F_CPU / (float)f)
@@ -80,10 +106,10 @@ exec_timer_type exec_timer;         // triggers calculation of next+1 stepper se
 fwd_plan_timer_type fwd_plan_timer; // triggers planning of next block
 
 // SystickEvent for handling dweels (must be registered before it is active)
-Motate::SysTickEvent dwell_systick_event {[&] {
+Motate::SysTickEvent dwell_systick_event {[] {
     if (--st_run.dwell_ticks_downcount == 0) {
         SysTickTimer.unregisterEvent(&dwell_systick_event);
-        _load_move();       // load the next move at the current interrupt level
+        _load_move(true);   // load the next move at the current interrupt level
     }
 }, nullptr};
 
@@ -123,10 +149,14 @@ void stepper_init()
     // optimal for 200 KHz DDA clock before the time in the OFF cycle is too short.
     // If you need more pulse width you need to drop the DDA clock rate
     dda_timer.setInterrupts(kInterruptOnOverflow | kInterruptPriorityHighest);
+#ifdef __VARIABLE_INTERVAL_DDA
+    st_run.dda_top = dda_timer.getTopValue();       // timer counts per DDA tick
+#endif
 
     // setup software interrupt exec timer & initial condition
     exec_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityHigh);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;
+    st_pre.min_headroom = PREP_QUEUE_SIZE;
+    st_pre.headroom = PREP_QUEUE_SIZE;
 
     // setup software interrupt forward plan timer & initial condition
     fwd_plan_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityMedium);
@@ -149,15 +179,29 @@ void stepper_init()
 void stepper_reset()
 {
     dda_timer.stop();                                   // stop all movement
+    isr_dda_stopped();
     st_run.dda_ticks_downcount = 0;                     // signal the runtime is not busy
+#ifdef __VARIABLE_INTERVAL_DDA
+    st_run.dda_interval = 1;                            // the DDA always (re)starts one tick out
+    dda_timer.setTop(st_run.dda_top);
+#endif
     st_run.dwell_ticks_downcount = 0;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // set to EXEC or it won't restart
+    st_pre.tail = st_pre.head;                          // empty the prep queue or it won't restart
+    for (uint8_t i=0; i<PREP_QUEUE_SIZE; i++) {
+        st_pre.seg[i].block_type = BLOCK_TYPE_NULL;
+    }
 
     for (uint8_t motor=0; motor<MOTORS; motor++) {
-        st_pre.mot[motor].prev_direction = STEP_INITIAL_DIRECTION;
-        st_pre.mot[motor].direction = STEP_INITIAL_DIRECTION;
+        st_run.mot[motor].direction = STEP_INITIAL_DIRECTION;
         st_run.mot[motor].substep_accumulator = 0;      // will become max negative during per-motor setup;
         st_pre.mot[motor].corrected_steps = 0;          // diagnostic only - no action effect
+        st_pre.mot[motor].error_integral = 0;
+        st_pre.mot[motor].previous_error = 0;
+#ifdef __FIXED_POINT_RUNTIME
+        st_pre.mot[motor].error_integral_q = 0;
+        st_pre.mot[motor].previous_error_q = 0;
+        st_pre.mot[motor].corrected_steps_q = 0;
+#endif
     }
     mp_set_steps_to_runtime_position();                 // reset encoder to agree with the above
 }
@@ -203,6 +247,8 @@ bool st_runtime_isbusy()
 
 stat_t st_clc(nvObj_t *nv)    // clear diagnostic counters, reset stepper prep
 {
+    st_pre.underruns = 0;
+    st_pre.min_headroom = PREP_QUEUE_SIZE;
     stepper_reset();
     return(STAT_OK);
 }
@@ -220,7 +266,7 @@ stat_t st_motor_power_callback()     // called by controller
 
     bool have_actually_stopped = false;
     if ((!st_runtime_isbusy()) &&
-        (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER) &&
+        (_prep_queue_count() == 0) &&
         (cm_get_cycle_state() == CYCLE_OFF)
         )
     {    // if there are no moves to load...
@@ -234,6 +280,24 @@ stat_t st_motor_power_callback()     // called by controller
     return (STAT_OK);
 }
 
+/*
+ * st_following_error_callback() - report a motor going over its following error limit
+ *
+ *  st_prep_line() requests the feedhold as soon as the limit is crossed. The report is
+ *  made here as it can't be sent from the exec interrupt.
+ */
+stat_t st_following_error_callback()     // called by controller
+{
+    if (st_pre.fe_motor == 0) {
+        return (STAT_NOOP);
+    }
+    char msg[40];
+    sprintf(msg, "motor %d error %0.1f steps", (int)st_pre.fe_motor, (double)st_pre.fe_error);
+    st_pre.fe_motor = 0;
+    rpt_exception(STAT_FOLLOWING_ERROR_EXCEEDED, msg);
+    return (STAT_OK);
+}
+
 /******************************
  * Interrupt Service Routines *
  ******************************/
@@ -249,19 +313,112 @@ stat_t st_motor_power_callback()     // called by controller
  *    - clear all step pins - this clears those the were set during the previous interrupt
  *    - if downcount == 0 and stop the timer and exit
  *    - run the DDA for each channel
+ *    - with STEP_PORT_BATCHING, write the step bits collected for each port at once
  *    - decrement the downcount - if it reaches zero load the next segment
  *
  *  Note that the motor_N.step.isNull() tests are compile-time tests, not run-time tests.
  *  If motor_N is not defined that if{} clause (i.e. that motor) drops out of the complied code.
+ *
+ *  Boards that define STEP_PORT_BATCHING (see board_stepper.h) replace the pin write per
+ *  motor with one port write per PIO port. The step_port index of each motor is a
+ *  compile-time constant, so step_image[] stays in registers.
+ *
+ *  Variable interval stepping (__VARIABLE_INTERVAL_DDA in g2core.h)
+ *
+ *  The fixed rate DDA runs every tick of FREQUENCY_DDA, but at low step rates almost all
+ *  ticks do nothing. With __VARIABLE_INTERVAL_DDA the interrupt only runs on ticks where
+ *  a motor steps, a pulse ends or a segment ends. Each motor's next step is the first
+ *  tick on which its accumulator goes positive: (-accumulator / increment) + 1 ticks
+ *  away. _dda_schedule() sets the timer TOP to the nearest of these, and the interrupt
+ *  advances every accumulator by that many ticks at once. Steps land on exactly the same
+ *  ticks as the fixed rate DDA and pulses are still one tick wide. Only the interrupt
+ *  count changes. The cost is one divide per moving motor per interrupt.
+ *
+ *  Whenever the DDA is stopped the interval is one tick, so a start from the loader
+ *  (or a load while the last pulses are being ended) runs the next tick as before and
+ *  schedules from there.
+ *
+ *  The new TOP is set at the end of the interrupt, and counts from the start of it. If the
+ *  interrupt ran past the new TOP (a long load, or being held off) the counter has already
+ *  passed the match and would run on until it wraps - about 51 seconds at 84 MHz. So the
+ *  counter is read back after setTop(), and if it is at or past TOP the late tick is moved
+ *  to one tick from now. The accumulators still advance by the scheduled interval, so the
+ *  steps are the same and only come a little late, as they would from a fixed rate DDA
+ *  that overran a tick. st_pre.dda_late counts these.
+ *
+ *  'ticks' is the number of DDA ticks since the last interrupt. It is the constant 1
+ *  for the fixed rate DDA, so that build compiles to the same code as before.
  */
 
+#ifdef STEP_PORT_BATCHING
+#define _step_pin_on(m) (step_image[decltype(m)::step_port] |= decltype(m)::step_mask)
+#else
+#define _step_pin_on(m) (m.stepStart())
+#endif
+
+#ifdef __VARIABLE_INTERVAL_DDA
+#define _step_start(m) (pulse_high = true, _step_pin_on(m))
+
+#define _dda_next_step(M) \
+    if (st_run.mot[M].substep_increment != 0) { \
+        uint32_t n = (st_run.mot[M].substep_accumulator >= 0) ? 1 : \
+                     ((uint32_t)(-st_run.mot[M].substep_accumulator) / st_run.mot[M].substep_increment) + 1; \
+        if (n < interval) { interval = n; } \
+    }
+
+static void _dda_schedule(const bool pulse_high)
+{
+    uint32_t interval = st_run.dda_ticks_downcount;
+    if ((interval == 0) || pulse_high) {
+        interval = 1;                               // end the pulses (and stop if there's nothing loaded)
+    } else {
+        _dda_next_step(MOTOR_1);
+        _dda_next_step(MOTOR_2);
+#if MOTORS > 2
+        _dda_next_step(MOTOR_3);
+#endif
+#if MOTORS > 3
+        _dda_next_step(MOTOR_4);
+#endif
+#if MOTORS > 4
+        _dda_next_step(MOTOR_5);
+#endif
+#if MOTORS > 5
+        _dda_next_step(MOTOR_6);
+#endif
+    }
+    st_run.dda_interval = interval;
+    const uint32_t top = st_run.dda_top * interval;
+    dda_timer.setTop(top);                          // takes effect from the last interrupt...
+    const uint32_t count = dda_timer.getValue();
+    if (count >= top) {                             // ...unless the counter has already passed it
+        dda_timer.setTop(count + st_run.dda_top);
+        st_pre.dda_late++;
+    }
+}
+#else
+#define _step_start(m) _step_pin_on(m)
+#endif
+
 namespace Motate {            // Must define timer interrupts inside the Motate namespace
 template<>
 void dda_timer_type::interrupt()
 {
+    IsrTimer isr_timer(ISR_DDA);
     dda_timer.getInterruptCause();  // clear interrupt condition
+#ifdef __VARIABLE_INTERVAL_DDA
+    const uint32_t ticks = st_run.dda_interval;     // DDA ticks since the last interrupt
+    bool pulse_high = false;
+#else
+    const uint32_t ticks = 1;
+#endif
+    isr_dda_ticks(ticks, isr_timer.start);
 
     // clear all steps from the previous interrupt
+#ifdef STEP_PORT_BATCHING
+    step_ports_clear();             // one CODR per port (see board_stepper.h)
+    uint32_t step_image[STEP_PORTS] = {0};
+#else
 	// for (uint8_t motor=0; motor<MOTORS; motor++) {
 	//	  Motors[motor]->stepEnd();
 	// }
@@ -280,10 +437,12 @@ void dda_timer_type::interrupt()
 #if MOTORS > 5
     motor_6.stepEnd();
 #endif
+#endif // STEP_PORT_BATCHING
 
     // process last DDA tick after end of segment
     if (st_run.dda_ticks_downcount == 0) {
         dda_timer.stop(); // turn it off or it will keep stepping out the last segment
+        isr_dda_stopped();
         return;
     }
 
@@ -297,50 +456,57 @@ void dda_timer_type::interrupt()
 //    }
 
     // process DDAs for each motor
-        if  ((st_run.mot[MOTOR_1].substep_accumulator += st_run.mot[MOTOR_1].substep_increment) > 0) {
-            motor_1.stepStart();        // turn step bit on
+        if  ((st_run.mot[MOTOR_1].substep_accumulator += st_run.mot[MOTOR_1].substep_increment * ticks) > 0) {
+            _step_start(motor_1);       // turn step bit on
             st_run.mot[MOTOR_1].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_1);
         }
-        if ((st_run.mot[MOTOR_2].substep_accumulator += st_run.mot[MOTOR_2].substep_increment) > 0) {
-            motor_2.stepStart();        // turn step bit on
+        if ((st_run.mot[MOTOR_2].substep_accumulator += st_run.mot[MOTOR_2].substep_increment * ticks) > 0) {
+            _step_start(motor_2);       // turn step bit on
             st_run.mot[MOTOR_2].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_2);
         }
 #if MOTORS > 2
-        if ((st_run.mot[MOTOR_3].substep_accumulator += st_run.mot[MOTOR_3].substep_increment) > 0) {
-            motor_3.stepStart();        // turn step bit on
+        if ((st_run.mot[MOTOR_3].substep_accumulator += st_run.mot[MOTOR_3].substep_increment * ticks) > 0) {
+            _step_start(motor_3);       // turn step bit on
             st_run.mot[MOTOR_3].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_3);
         }
 #endif
 #if MOTORS > 3
-        if ((st_run.mot[MOTOR_4].substep_accumulator += st_run.mot[MOTOR_4].substep_increment) > 0) {
-            motor_4.stepStart();        // turn step bit on
+        if ((st_run.mot[MOTOR_4].substep_accumulator += st_run.mot[MOTOR_4].substep_increment * ticks) > 0) {
+            _step_start(motor_4);       // turn step bit on
             st_run.mot[MOTOR_4].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_4);
         }
 #endif
 #if MOTORS > 4
-        if ((st_run.mot[MOTOR_5].substep_accumulator += st_run.mot[MOTOR_5].substep_increment) > 0) {
-            motor_5.stepStart();        // turn step bit on
+        if ((st_run.mot[MOTOR_5].substep_accumulator += st_run.mot[MOTOR_5].substep_increment * ticks) > 0) {
+            _step_start(motor_5);       // turn step bit on
             st_run.mot[MOTOR_5].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_5);
         }
 #endif
 #if MOTORS > 5
-        if ((st_run.mot[MOTOR_6].substep_accumulator += st_run.mot[MOTOR_6].substep_increment) > 0) {
-            motor_6.stepStart();        // turn step bit on
+        if ((st_run.mot[MOTOR_6].substep_accumulator += st_run.mot[MOTOR_6].substep_increment * ticks) > 0) {
+            _step_start(motor_6);       // turn step bit on
             st_run.mot[MOTOR_6].substep_accumulator -= st_run.dda_ticks_X_substeps;
             INCREMENT_ENCODER(MOTOR_6);
         }
 #endif
 
+#ifdef STEP_PORT_BATCHING
+    step_ports_set(step_image);     // one SODR per port
+#endif
+
     // Process end of segment. 
     // One more interrupt will occur to turn of any pulses set in this pass.
-    if (--st_run.dda_ticks_downcount == 0) {
-        _load_move();       // load the next move at the current interrupt level
+    if ((st_run.dda_ticks_downcount -= ticks) == 0) {
+        _load_move(true);   // load the next move at the current interrupt level
     }
+#ifdef __VARIABLE_INTERVAL_DDA
+    _dda_schedule(pulse_high);
+#endif
 } // MOTATE_TIMER_INTERRUPT
 } // namespace Motate
 
@@ -353,6 +519,7 @@ void dda_timer_type::interrupt()
 void st_request_exec_move()
 {
     stepper_debug("e");
+    isr_request(ISR_EXEC);
     exec_timer.setInterruptPending();
     stepper_debug("!\n");
 }
@@ -361,13 +528,17 @@ namespace Motate {    // Define timer inside Motate namespace
     template<>
     void exec_timer_type::interrupt()
     {
+        IsrTimer isr_timer(ISR_EXEC);
         exec_timer.getInterruptCause();                    // clears the interrupt condition
-        if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
+        if (_prep_queue_has_room()) {
             stepper_debug("E>");
             if (mp_exec_move() != STAT_NOOP) {
                 stepper_debug("E+\n");
-                st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
+                _prep_queue_commit();
                 st_request_load_move();
+                if (_prep_queue_has_room()) {
+                    st_request_exec_move();                // keep going until the queue is full
+                }
                 return;
             }
             stepper_debug("E-\n");
@@ -378,6 +549,7 @@ namespace Motate {    // Define timer inside Motate namespace
 void st_request_forward_plan()
 {
     stepper_debug("p");
+    isr_request(ISR_FWD_PLAN);
     fwd_plan_timer.setInterruptPending();
 }
 
@@ -385,6 +557,7 @@ namespace Motate {    // Define timer inside Motate namespace
     template<>
     void fwd_plan_timer_type::interrupt()
     {
+        IsrTimer isr_timer(ISR_FWD_PLAN);
         fwd_plan_timer.getInterruptCause();     // clears the interrupt condition
         stepper_debug("P>");
         if (mp_forward_plan() != STAT_NOOP) {   // We now have a move to exec.
@@ -412,9 +585,9 @@ void st_request_load_move()
         return;
     }
     stepper_debug("l");
-    if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) {       // bother interrupting
+    if (_prep_queue_count() != 0) {                                 // bother interrupting
         stepper_debug("_");
-        _load_move();
+        _load_move(false);
     }
 }
 
@@ -425,22 +598,39 @@ void st_request_load_move()
  *  higher level as the DDA or dwell ISR. A software interrupt has been
  *  provided to allow a non-ISR to request a load (st_request_load_move())
  *
+ *  segment_ended is true when called at the end of a segment or dwell, i.e. when
+ *  the runtime needs the next entry now. Only these loads are counted for the
+ *  underrun and headroom diagnostics. Commands and null entries don't run the
+ *  DDA, so the entry behind them is loaded straight away.
+ *
  *  In aline() code:
  *   - All axes must set steps and compensate for out-of-range pulse phasing.
  *   - If axis has 0 steps the direction setting can be omitted
  *   - If axis has 0 steps the motor power must be set accord to the power mode
  */
 
-static void _load_move()
+// take a fresh sample from motors that report their own position (see stepper.h)
+// motors report in their own direction, so undo the polarity
+#define _sample_encoder(m, motor) if (st_cfg.mot[m].encoder_source == ENCODER_SOURCE_MOTOR) { \
+    int32_t measured; if (motor.readEncoder(measured)) {                                     \
+        SET_ENCODER_MEASURED(m, (st_cfg.mot[m].polarity ? -measured : measured)); } }
+
+static void _load_move(const bool segment_ended)
 {
     // Be aware that dda_ticks_downcount must equal zero for the loader to run.
     // So the initial load must also have this set to zero as part of initialization
     if (st_runtime_isbusy()) {
         return;                                                    // exit if the runtime is busy
     }
-    if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER) {    // if there are no moves to load...
+    IsrTimer isr_timer(ISR_LOAD);
+    uint8_t queued = _prep_queue_count();
+    if (queued == 0) {                                          // if there are no moves to load...
 
         if (cm.motion_state == MOTION_RUN)  {
+            if (segment_ended) {
+                st_pre.underruns++;
+                st_pre.min_headroom = 0;
+            }
 #if IN_DEBUGGER == 1
 //#warning debbugger REQUIRED for running this firmware!
 //            __asm__("BKPT"); // attempted to _load_move with PREP_BUFFER_OWNED_BY_EXEC and cm.motion_state == MOTION_RUN
@@ -448,6 +638,7 @@ static void _load_move()
             st_request_exec_move();
             return;
         }
+        st_pre.headroom = PREP_QUEUE_SIZE;                      // the last segment of the move had none
 
 	// ...start motor power timeouts
 	//	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
@@ -470,17 +661,25 @@ static void _load_move()
 #endif
         stepper_debug("•");
         return;
-    } // if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER)
+    } // if (queued == 0)
 
     stepper_debug("^");
+    std::atomic_signal_fence(std::memory_order_acquire);        // read the entry only after seeing head
+    stPrepSegment_t *seg = &st_pre.seg[st_pre.tail & (PREP_QUEUE_SIZE-1)];
+    if (segment_ended && (cm.motion_state == MOTION_RUN)) {
+        if (st_pre.headroom < st_pre.min_headroom) {
+            st_pre.min_headroom = st_pre.headroom;
+        }
+        st_pre.headroom = queued-1;
+    }
 
     // handle aline loads first (most common case)  NB: there are no more lines, only alines
-    if (st_pre.block_type == BLOCK_TYPE_ALINE) {
+    if (seg->block_type == BLOCK_TYPE_ALINE) {
 
         //**** setup the new segment ****
 
-        st_run.dda_ticks_downcount = st_pre.dda_ticks;
-        st_run.dda_ticks_X_substeps = st_pre.dda_ticks_X_substeps;
+        st_run.dda_ticks_downcount = seg->dda_ticks;
+        st_run.dda_ticks_X_substeps = seg->dda_ticks_X_substeps;
 
         // INLINED VERSION: 4.3us
         //**** MOTOR_1 LOAD ****
@@ -489,152 +688,241 @@ static void _load_move()
         // is supposed to take < 5 uSec (Arm M3 core). Be careful if you mess with this.
 
         // the following if() statement sets the runtime substep increment value or zeroes it
-        if ((st_run.mot[MOTOR_1].substep_increment = st_pre.mot[MOTOR_1].substep_increment) != 0) {
+        if ((st_run.mot[MOTOR_1].substep_increment = seg->mot[MOTOR_1].substep_increment) != 0) {
 
             // NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
             //     always operate on the last segment actually run by this motor, regardless of how many
             //     segments it may have been inactive in between.
 
             // Apply accumulator correction if the time base has changed since previous segment
-            if (st_pre.mot[MOTOR_1].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_1].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_1].substep_accumulator *= st_pre.mot[MOTOR_1].accumulator_correction;
+            if (seg->mot[MOTOR_1].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_1].substep_accumulator *= seg->mot[MOTOR_1].accumulator_correction;
             }
 
             // Detect direction change and if so:
             //    Set the direction bit in hardware.
             //    Compensate for direction change by flipping substep accumulator value about its midpoint.
 
-            if (st_pre.mot[MOTOR_1].direction != st_pre.mot[MOTOR_1].prev_direction) {
-                st_pre.mot[MOTOR_1].prev_direction = st_pre.mot[MOTOR_1].direction;
+            if (seg->mot[MOTOR_1].direction != st_run.mot[MOTOR_1].direction) {
+                st_run.mot[MOTOR_1].direction = seg->mot[MOTOR_1].direction;
                 st_run.mot[MOTOR_1].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_1].substep_accumulator);
-                motor_1.setDirection(st_pre.mot[MOTOR_1].direction);
+                motor_1.setDirection(seg->mot[MOTOR_1].direction);
             }
 
             // Enable the stepper and start/update motor power management
             motor_1.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_1, st_pre.mot[MOTOR_1].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_1, seg->mot[MOTOR_1].step_sign);
 
         } else {  // Motor has 0 steps; might need to energize motor for power mode processing
             motor_1.motionStopped();
         }
         // accumulate counted steps to the step position and zero out counted steps for the segment currently being loaded
+        motor_1.loadSegment(seg->mot[MOTOR_1].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_1);
+        _sample_encoder(MOTOR_1, motor_1);
 
 #if (MOTORS >= 2)
-        if ((st_run.mot[MOTOR_2].substep_increment = st_pre.mot[MOTOR_2].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_2].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_2].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_2].substep_accumulator *= st_pre.mot[MOTOR_2].accumulator_correction;
+        if ((st_run.mot[MOTOR_2].substep_increment = seg->mot[MOTOR_2].substep_increment) != 0) {
+            if (seg->mot[MOTOR_2].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_2].substep_accumulator *= seg->mot[MOTOR_2].accumulator_correction;
             }
-            if (st_pre.mot[MOTOR_2].direction != st_pre.mot[MOTOR_2].prev_direction) {
-                st_pre.mot[MOTOR_2].prev_direction = st_pre.mot[MOTOR_2].direction;
+            if (seg->mot[MOTOR_2].direction != st_run.mot[MOTOR_2].direction) {
+                st_run.mot[MOTOR_2].direction = seg->mot[MOTOR_2].direction;
                 st_run.mot[MOTOR_2].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_2].substep_accumulator);
-                motor_2.setDirection(st_pre.mot[MOTOR_2].direction);
+                motor_2.setDirection(seg->mot[MOTOR_2].direction);
             }
             motor_2.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_2, st_pre.mot[MOTOR_2].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_2, seg->mot[MOTOR_2].step_sign);
         } else {
             motor_2.motionStopped();
         }
+        motor_2.loadSegment(seg->mot[MOTOR_2].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_2);
+        _sample_encoder(MOTOR_2, motor_2);
 #endif
 #if (MOTORS >= 3)
-        if ((st_run.mot[MOTOR_3].substep_increment = st_pre.mot[MOTOR_3].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_3].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_3].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_3].substep_accumulator *= st_pre.mot[MOTOR_3].accumulator_correction;
+        if ((st_run.mot[MOTOR_3].substep_increment = seg->mot[MOTOR_3].substep_increment) != 0) {
+            if (seg->mot[MOTOR_3].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_3].substep_accumulator *= seg->mot[MOTOR_3].accumulator_correction;
             }
-            if (st_pre.mot[MOTOR_3].direction != st_pre.mot[MOTOR_3].prev_direction) {
-                st_pre.mot[MOTOR_3].prev_direction = st_pre.mot[MOTOR_3].direction;
+            if (seg->mot[MOTOR_3].direction != st_run.mot[MOTOR_3].direction) {
+                st_run.mot[MOTOR_3].direction = seg->mot[MOTOR_3].direction;
                 st_run.mot[MOTOR_3].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_3].substep_accumulator);
-                motor_3.setDirection(st_pre.mot[MOTOR_3].direction);
+                motor_3.setDirection(seg->mot[MOTOR_3].direction);
             }
             motor_3.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_3, st_pre.mot[MOTOR_3].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_3, seg->mot[MOTOR_3].step_sign);
         } else {
             motor_3.motionStopped();
         }
+        motor_3.loadSegment(seg->mot[MOTOR_3].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_3);
+        _sample_encoder(MOTOR_3, motor_3);
 #endif
 #if (MOTORS >= 4)
-        if ((st_run.mot[MOTOR_4].substep_increment = st_pre.mot[MOTOR_4].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_4].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_4].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_4].substep_accumulator *= st_pre.mot[MOTOR_4].accumulator_correction;
+        if ((st_run.mot[MOTOR_4].substep_increment = seg->mot[MOTOR_4].substep_increment) != 0) {
+            if (seg->mot[MOTOR_4].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_4].substep_accumulator *= seg->mot[MOTOR_4].accumulator_correction;
             }
-            if (st_pre.mot[MOTOR_4].direction != st_pre.mot[MOTOR_4].prev_direction) {
-                st_pre.mot[MOTOR_4].prev_direction = st_pre.mot[MOTOR_4].direction;
+            if (seg->mot[MOTOR_4].direction != st_run.mot[MOTOR_4].direction) {
+                st_run.mot[MOTOR_4].direction = seg->mot[MOTOR_4].direction;
                 st_run.mot[MOTOR_4].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_4].substep_accumulator);
-                motor_4.setDirection(st_pre.mot[MOTOR_4].direction);
+                motor_4.setDirection(seg->mot[MOTOR_4].direction);
             }
             motor_4.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_4, st_pre.mot[MOTOR_4].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_4, seg->mot[MOTOR_4].step_sign);
         } else {
             motor_4.motionStopped();
         }
+        motor_4.loadSegment(seg->mot[MOTOR_4].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_4);
+        _sample_encoder(MOTOR_4, motor_4);
 #endif
 #if (MOTORS >= 5)
-        if ((st_run.mot[MOTOR_5].substep_increment = st_pre.mot[MOTOR_5].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_5].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_5].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_5].substep_accumulator *= st_pre.mot[MOTOR_5].accumulator_correction;
+        if ((st_run.mot[MOTOR_5].substep_increment = seg->mot[MOTOR_5].substep_increment) != 0) {
+            if (seg->mot[MOTOR_5].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_5].substep_accumulator *= seg->mot[MOTOR_5].accumulator_correction;
             }
-            if (st_pre.mot[MOTOR_5].direction != st_pre.mot[MOTOR_5].prev_direction) {
-                st_pre.mot[MOTOR_5].prev_direction = st_pre.mot[MOTOR_5].direction;
+            if (seg->mot[MOTOR_5].direction != st_run.mot[MOTOR_5].direction) {
+                st_run.mot[MOTOR_5].direction = seg->mot[MOTOR_5].direction;
                 st_run.mot[MOTOR_5].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_5].substep_accumulator);
-                motor_5.setDirection(st_pre.mot[MOTOR_5].direction);
+                motor_5.setDirection(seg->mot[MOTOR_5].direction);
             }
             motor_5.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_5, st_pre.mot[MOTOR_5].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_5, seg->mot[MOTOR_5].step_sign);
         } else {
             motor_5.motionStopped();
         }
+        motor_5.loadSegment(seg->mot[MOTOR_5].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_5);
+        _sample_encoder(MOTOR_5, motor_5);
 #endif
 #if (MOTORS >= 6)
-        if ((st_run.mot[MOTOR_6].substep_increment = st_pre.mot[MOTOR_6].substep_increment) != 0) {
-            if (st_pre.mot[MOTOR_6].accumulator_correction_flag == true) {
-                st_pre.mot[MOTOR_6].accumulator_correction_flag = false;
-                st_run.mot[MOTOR_6].substep_accumulator *= st_pre.mot[MOTOR_6].accumulator_correction;
+        if ((st_run.mot[MOTOR_6].substep_increment = seg->mot[MOTOR_6].substep_increment) != 0) {
+            if (seg->mot[MOTOR_6].accumulator_correction_flag == true) {
+                st_run.mot[MOTOR_6].substep_accumulator *= seg->mot[MOTOR_6].accumulator_correction;
             }
-            if (st_pre.mot[MOTOR_6].direction != st_pre.mot[MOTOR_6].prev_direction) {
-                st_pre.mot[MOTOR_6].prev_direction = st_pre.mot[MOTOR_6].direction;
+            if (seg->mot[MOTOR_6].direction != st_run.mot[MOTOR_6].direction) {
+                st_run.mot[MOTOR_6].direction = seg->mot[MOTOR_6].direction;
                 st_run.mot[MOTOR_6].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_6].substep_accumulator);
-                motor_6.setDirection(st_pre.mot[MOTOR_6].direction);
+                motor_6.setDirection(seg->mot[MOTOR_6].direction);
             }
             motor_6.enable();
-            SET_ENCODER_STEP_SIGN(MOTOR_6, st_pre.mot[MOTOR_6].step_sign);
+            SET_ENCODER_STEP_SIGN(MOTOR_6, seg->mot[MOTOR_6].step_sign);
         } else {
             motor_6.motionStopped();
         }
+        motor_6.loadSegment(seg->mot[MOTOR_6].travel_steps);
         ACCUMULATE_ENCODER(MOTOR_6);
+        _sample_encoder(MOTOR_6, motor_6);
 #endif
 
         //**** do this last ****
 
+        uint32_t loaded = st_pre.segments_loaded + 1;   // the motion clock runs on to the end of this segment
+        st_pre.segment_ticks[loaded & (PREP_HISTORY_SIZE-1)] =
+            st_pre.segment_ticks[(loaded-1) & (PREP_HISTORY_SIZE-1)] + seg->dda_ticks;
+        st_pre.segments_loaded = loaded;                // the encoders now have all segments before this one
         dda_timer.start();                              // start the DDA timer if not already running
 
     // handle dwells and commands
-    } else if (st_pre.block_type == BLOCK_TYPE_DWELL) {
-        st_run.dwell_ticks_downcount = st_pre.dwell_ticks;
+    } else if (seg->block_type == BLOCK_TYPE_DWELL) {
+        st_run.dwell_ticks_downcount = seg->dwell_ticks;
 
         // We now use SysTick events to handle dwells
         SysTickTimer.registerEvent(&dwell_systick_event);
 
         // handle synchronous commands
-    } else if (st_pre.block_type == BLOCK_TYPE_COMMAND) {
-        mp_runtime_command(st_pre.bf);
+    } else if (seg->block_type == BLOCK_TYPE_COMMAND) {
+        mp_runtime_command(seg->bf);
         
     } // else null - which is okay in many cases
 
     // all other cases drop to here (e.g. Null moves after Mcodes skip to here)
-    st_pre.block_type = BLOCK_TYPE_NULL;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // we are done with the prep buffer - flip the flag back
+    seg->block_type = BLOCK_TYPE_NULL;
+    st_pre.tail++;                                      // we are done with the entry - hand it back to the exec
+    if ((queued > 1) && !st_runtime_isbusy()) {         // nothing to run - load the next entry if there is one
+        _load_move(segment_ended);
+        return;
+    }
     st_request_exec_move();                             // exec and prep next move
 }
 
+/***********************************************************************************
+ * _step_correction() - run the correction PID for one motor and return the correction in steps
+ *
+ *  error is the predicted following error and travel the segment's travel, both in steps.
+ *  A following error over the motor's limit requests a feedhold. See stepper.h.
+ */
+
+static float _step_correction(const uint8_t motor, float error, const float travel)
+{
+    cfgMotor_t *cfg = &st_cfg.mot[motor];
+    stPrepMotor_t *pre = &st_pre.mot[motor];
+
+    if ((cfg->following_error_limit > 0) && (fabs(error) > cfg->following_error_limit) &&
+        (st_pre.fe_motor == 0) && (cm.hold_state == FEEDHOLD_OFF)) {
+        st_pre.fe_error = error;
+        st_pre.fe_motor = motor+1;                      // reported by st_following_error_callback()
+        cm_request_feedhold();
+    }
+    if (fabs(error) <= STEP_CORRECTION_THRESHOLD) {
+        error = 0;
+    }
+    pre->error_integral += error;
+    float correction = cfg->correction_p * error +
+                       cfg->correction_i * pre->error_integral +
+                       cfg->correction_d * (error - pre->previous_error);
+    pre->previous_error = error;
+
+    float correction_max = min(cfg->correction_max, (float)fabs(travel));
+    if (fabs(correction) > correction_max) {
+        pre->error_integral -= error;                   // don't wind up while limited
+        correction = (correction > 0) ? correction_max : -correction_max;
+    }
+    return (correction);
+}
+
+/*
+ * _step_correction() - fixed-point version used by the fixed-point st_prep_line()
+ *
+ *  The same PID in Q31.32 steps. The gains and limits are converted when they are set
+ *  (see st_set_correction()), so no float math is done unless the error limit trips.
+ */
+
+#ifdef __FIXED_POINT_RUNTIME
+static int64_t _step_correction(const uint8_t motor, int64_t error, const int64_t travel)
+{
+    stPrepMotor_t *pre = &st_pre.mot[motor];
+    int64_t error_abs = (error < 0) ? -error : error;
+
+    if ((pre->following_error_limit_q > 0) && (error_abs > pre->following_error_limit_q) &&
+        (st_pre.fe_motor == 0) && (cm.hold_state == FEEDHOLD_OFF)) {
+        st_pre.fe_error = q_to_float(error, Q32_BITS);
+        st_pre.fe_motor = motor+1;                      // reported by st_following_error_callback()
+        cm_request_feedhold();
+    }
+    if (error_abs <= STEP_CORRECTION_THRESHOLD_Q) {
+        error = 0;
+    }
+    pre->error_integral_q += error;
+    int64_t correction = q_scale(error, pre->correction_p_q) +
+                         q_scale(pre->error_integral_q, pre->correction_i_q) +
+                         q_scale(error - pre->previous_error_q, pre->correction_d_q);
+    pre->previous_error_q = error;
+
+    int64_t correction_max = (travel < 0) ? -travel : travel;
+    if (correction_max > pre->correction_max_q) {
+        correction_max = pre->correction_max_q;
+    }
+    if ((correction > correction_max) || (correction < -correction_max)) {
+        pre->error_integral_q -= error;                 // don't wind up while limited
+        correction = (correction > 0) ? correction_max : -correction_max;
+    }
+    return (correction);
+}
+#endif // __FIXED_POINT_RUNTIME
+
 /***********************************************************************************
  * st_prep_line() - Prepare the next move for the loader
  *
@@ -662,8 +950,10 @@ static void _load_move()
 stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time)
 {
     stepper_debug("😶");
+    stPrepSegment_t *seg = _prep_segment();
+
     // trap assertion failures and other conditions that would prevent queuing the line
-    if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) {     // never supposed to happen
+    if (_prep_queue_count() >= PREP_QUEUE_SIZE) {               // never supposed to happen
         return (cm_panic(STAT_INTERNAL_ERROR, "st_prep_line() prep sync error"));
     } else if (isinf(segment_time)) {                           // never supposed to happen
         return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "st_prep_line()"));
@@ -676,18 +966,28 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
     // - dda_ticks is the integer number of DDA clock ticks needed to play out the segment
     // - ticks_X_substeps is the maximum depth of the DDA accumulator (as a negative number)
 
-    //st_pre.dda_period = _f_to_period(FREQUENCY_DDA);                // FYI: this is a constant
-    st_pre.dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
-    st_pre.dda_ticks_X_substeps = st_pre.dda_ticks * DDA_SUBSTEPS;
+    //seg->dda_period = _f_to_period(FREQUENCY_DDA);                // FYI: this is a constant
+    seg->dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
+    seg->dda_ticks_X_substeps = seg->dda_ticks * DDA_SUBSTEPS;
 
     // setup motor parameters
 
     float correction_steps;
     for (uint8_t motor=0; motor<MOTORS; motor++) {          // remind us that this is motors, not axes
 
+        // Closed loop correction (see stepper.h). This runs for motors that don't move in the
+        // segment too, so their following error is still checked against the limit.
+        // NOTE: This clause can be commented out to test for numerical accuracy and accumulating errors
+        correction_steps = _step_correction(motor, following_error[motor], travel_steps[motor]);
+        if (fp_NOT_ZERO(correction_steps)) {
+            st_pre.mot[motor].corrected_steps += correction_steps;
+            travel_steps[motor] -= correction_steps;
+        }
+
         // Skip this motor if there are no new steps. Leave all other values intact.
         if (fp_ZERO(travel_steps[motor])) {
-            st_pre.mot[motor].substep_increment = 0;        // substep increment also acts as a motor flag
+            seg->mot[motor].substep_increment = 0;        // substep increment also acts as a motor flag
+            seg->mot[motor].travel_steps = 0;
             continue;
         }
 
@@ -695,54 +995,105 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
         // Set the step_sign which is used by the stepper ISR to accumulate step position
 
         if (travel_steps[motor] >= 0) {                    // positive direction
-            st_pre.mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
-            st_pre.mot[motor].step_sign = 1;
+            seg->mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+            seg->mot[motor].step_sign = 1;
         } else {
-            st_pre.mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
-            st_pre.mot[motor].step_sign = -1;
+            seg->mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+            seg->mot[motor].step_sign = -1;
         }
 
         // Detect segment time changes and setup the accumulator correction factor and flag.
         // Putting this here computes the correct factor even if the motor was dormant for some
         // number of previous moves. Correction is computed based on the last segment time actually used.
 
+        seg->mot[motor].accumulator_correction_flag = false;
         if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
             if (fp_NOT_ZERO(st_pre.mot[motor].prev_segment_time)) {                    // special case to skip first move
-                st_pre.mot[motor].accumulator_correction_flag = true;
-                st_pre.mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+                seg->mot[motor].accumulator_correction_flag = true;
+                seg->mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
             }
             st_pre.mot[motor].prev_segment_time = segment_time;
         }
 
-        // 'Nudge' correction strategy. Inject a single, scaled correction value then hold off
-        // NOTE: This clause can be commented out to test for numerical accuracy and accumulating errors
-        if ((--st_pre.mot[motor].correction_holdoff < 0) &&
-            (fabs(following_error[motor]) > STEP_CORRECTION_THRESHOLD)) {
-
-            st_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
-            correction_steps = following_error[motor] * STEP_CORRECTION_FACTOR;
-
-            if (correction_steps > 0) {
-                correction_steps = min3(correction_steps, fabs(travel_steps[motor]), STEP_CORRECTION_MAX);
-            } else {
-                correction_steps = max3(correction_steps, -fabs(travel_steps[motor]), -STEP_CORRECTION_MAX);
-            }
-            st_pre.mot[motor].corrected_steps += correction_steps;
-            travel_steps[motor] -= correction_steps;
-        }
-
         // Compute substeb increment. The accumulator must be *exactly* the incoming
         // fractional steps times the substep multiplier or positional drift will occur.
         // Rounding is performed to eliminate a negative bias in the uint32 conversion
         // that results in long-term negative drift. (fabs/round order doesn't matter)
 
-        st_pre.mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+        seg->mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+        seg->mot[motor].travel_steps = st_cfg.mot[motor].polarity ? -travel_steps[motor] : travel_steps[motor];
+    }
+    seg->block_type = BLOCK_TYPE_ALINE;                   // the exec interrupt queues it
+    stepper_debug("👍🏻");
+    return (STAT_OK);
+}
+
+/*
+ * st_prep_line() - fixed-point version used by the fixed-point runtime (see plan_exec.cpp)
+ *
+ *  travel_steps[] and following_error[] are in Q31.32 steps. Otherwise this is identical to
+ *  the float version above. The substep increment and the accumulator depth are both scaled
+ *  by the integer DDA_SUBSTEPS_INT so they are exactly consistent with each other.
+ *
+ *  segment_time stays float. It comes from the float feed override, and the accumulator
+ *  correction is the ratio of segment times, not of the truncated DDA ticks (comparing or
+ *  dividing ticks moves the end of some sim programs by a step). The compare is per motor,
+ *  the divide only when the time changes. The other per motor float is travel_steps for
+ *  motor.loadSegment(). The corrections are totalled in Q31.32 (corrected_steps_q).
+ */
+
+#ifdef __FIXED_POINT_RUNTIME
+stat_t st_prep_line(int64_t travel_steps[], int64_t following_error[], float segment_time)
+{
+    stepper_debug("😶");
+    stPrepSegment_t *seg = _prep_segment();
+    if (_prep_queue_count() >= PREP_QUEUE_SIZE) {               // never supposed to happen
+        return (cm_panic(STAT_INTERNAL_ERROR, "st_prep_line() prep sync error"));
+    } else if (isinf(segment_time)) {                           // never supposed to happen
+        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "st_prep_line()"));
+    } else if (isnan(segment_time)) {                           // never supposed to happen
+        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_NAN, "st_prep_line()"));
+    }
+    seg->dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
+    seg->dda_ticks_X_substeps = seg->dda_ticks * DDA_SUBSTEPS_INT;
+
+    for (uint8_t motor=0; motor<MOTORS; motor++) {
+        // Closed loop correction - see the float version. It runs for motors that don't move too.
+        int64_t correction_steps = _step_correction(motor, following_error[motor], travel_steps[motor]);
+        if (correction_steps != 0) {
+            st_pre.mot[motor].corrected_steps_q += correction_steps;    // diagnostic only
+            travel_steps[motor] -= correction_steps;
+        }
+        int64_t travel_abs = (travel_steps[motor] < 0) ? -travel_steps[motor] : travel_steps[motor];
+        if (travel_abs < STEP_EPSILON_Q) {
+            seg->mot[motor].substep_increment = 0;        // substep increment also acts as a motor flag
+            seg->mot[motor].travel_steps = 0;
+            continue;
+        }
+        if (travel_steps[motor] >= 0) {                     // positive direction
+            seg->mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+            seg->mot[motor].step_sign = 1;
+        } else {
+            seg->mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+            seg->mot[motor].step_sign = -1;
+        }
+        seg->mot[motor].accumulator_correction_flag = false;
+        if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
+            if (fp_NOT_ZERO(st_pre.mot[motor].prev_segment_time)) {                    // special case to skip first move
+                seg->mot[motor].accumulator_correction_flag = true;
+                seg->mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+            }
+            st_pre.mot[motor].prev_segment_time = segment_time;
+        }
+        seg->mot[motor].substep_increment = (uint32_t)q_mul(travel_abs, DDA_SUBSTEPS_INT, Q32_BITS);
+        float travel = q_to_float(travel_steps[motor], Q32_BITS);
+        seg->mot[motor].travel_steps = st_cfg.mot[motor].polarity ? -travel : travel;
     }
-    st_pre.block_type = BLOCK_TYPE_ALINE;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    seg->block_type = BLOCK_TYPE_ALINE;                   // the exec interrupt queues it
     stepper_debug("👍🏻");
     return (STAT_OK);
 }
+#endif // __FIXED_POINT_RUNTIME
 
 /*
  * st_prep_null() - Keeps the loader happy. Otherwise performs no action
@@ -750,8 +1101,7 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 
 void st_prep_null()
 {
-    st_pre.block_type = BLOCK_TYPE_NULL;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // signal that prep buffer is empty
+    _prep_segment()->block_type = BLOCK_TYPE_NULL;
 }
 
 /*
@@ -760,9 +1110,9 @@ void st_prep_null()
 
 void st_prep_command(void *bf)
 {
-    st_pre.block_type = BLOCK_TYPE_COMMAND;
-    st_pre.bf = (mpBuf_t *)bf;
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    stPrepSegment_t *seg = _prep_segment();
+    seg->block_type = BLOCK_TYPE_COMMAND;
+    seg->bf = (mpBuf_t *)bf;
 }
 
 /*
@@ -771,10 +1121,10 @@ void st_prep_command(void *bf)
 
 void st_prep_dwell(float microseconds)
 {
-    st_pre.block_type = BLOCK_TYPE_DWELL;
+    stPrepSegment_t *seg = _prep_segment();
+    seg->block_type = BLOCK_TYPE_DWELL;
     // we need dwell_ticks to be at least 1
-    st_pre.dwell_ticks = std::max((uint32_t)((microseconds/1000000) * FREQUENCY_DWELL), 1UL);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    seg->dwell_ticks = std::max((uint32_t)((microseconds/1000000) * FREQUENCY_DWELL), (uint32_t)1);
 }
 
 /*
@@ -784,11 +1134,60 @@ void st_prep_dwell(float microseconds)
  */
 void st_request_out_of_band_dwell(float microseconds)
 {
+    if (_prep_queue_count() >= PREP_QUEUE_SIZE) {
+        return;
+    }
     st_prep_dwell(microseconds);
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;    // signal that prep buffer is ready
+    _prep_queue_commit();
     st_request_load_move();
 }
 
+/*
+ * st_get_segments_loaded() - count of line segments the loader has started
+ *
+ *  The encoders have counted all of these but the last. The exec uses this to find the
+ *  segment the encoder readings line up with (see _exec_aline_segment()).
+ */
+uint32_t st_get_segments_loaded() { return (st_pre.segments_loaded); }
+
+/*
+ * st_get_segment_ticks() - motion clock at the end of a line segment (see st_get_motion_ticks())
+ * st_get_motion_ticks()  - motion clock now
+ * st_get_motion_ticks_ago() - motion clock the given number of DDA ticks ago
+ *
+ *  The motion clock counts the DDA ticks of the line segments loaded. It stops while no
+ *  segment is running, when the motors don't move, so a time on it always has a position
+ *  (see mp_get_runtime_steps_at()). Segments are numbered as for st_get_segments_loaded().
+ *  Only the last PREP_HISTORY_SIZE segments are kept.
+ *
+ *  st_get_motion_ticks() may be called at any interrupt level. It reads again if a
+ *  segment was loaded while it was reading.
+ *
+ *  st_get_motion_ticks_ago() puts an event that happened a while ago on the clock. While
+ *  the clock is stopped the machine stands at the end of the last segment, so it returns
+ *  the clock as it stands - going back from it would give a time the machine was still
+ *  moving. A wait that spans the start of a run is still taken from the running clock.
+ */
+uint32_t st_get_segment_ticks(const uint32_t segment) { return (st_pre.segment_ticks[segment & (PREP_HISTORY_SIZE-1)]); }
+
+uint32_t st_get_motion_ticks()
+{
+    uint32_t loaded, ticks;
+    do {
+        loaded = st_pre.segments_loaded;
+        ticks = st_pre.segment_ticks[loaded & (PREP_HISTORY_SIZE-1)] - st_run.dda_ticks_downcount;
+    } while (loaded != st_pre.segments_loaded);
+    return (ticks);
+}
+
+uint32_t st_get_motion_ticks_ago(const uint32_t ticks)
+{
+    if (st_run.dda_ticks_downcount == 0) {          // no line segment running
+        return (st_get_motion_ticks());
+    }
+    return (st_get_motion_ticks() - ticks);
+}
+
 /*
  * _set_hw_microsteps() - set microsteps in hardware
  */
@@ -1017,6 +1416,64 @@ stat_t st_get_pwr(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+/*
+ * st_set_es() - set motor encoder source
+ *
+ *  Switching a motor to its own position (1) references the position it reports to the
+ *  current encoder count, so the following error carries on from where it was.
+ */
+stat_t st_set_es(nvObj_t *nv)
+{
+    if (nv->value < 0) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_LESS_THAN_MIN_VALUE);
+    }
+    if (nv->value > ENCODER_SOURCE_MOTOR) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_INPUT_EXCEEDS_MAX_VALUE);
+    }
+    uint8_t motor = _get_motor(nv->index);
+    if (motor >= MOTORS) {
+        nv->valuetype = TYPE_NULL;
+        return STAT_INPUT_VALUE_RANGE_ERROR;
+    };
+    int32_t measured;
+    if ((nv->value == ENCODER_SOURCE_MOTOR) && !Motors[motor]->readEncoder(measured)) {
+        nv->valuetype = TYPE_NULL;
+        return (STAT_NO_ENCODER);
+    }
+    if (nv->value == ENCODER_SOURCE_MOTOR) {
+        en.en[motor].measured_steps = (st_cfg.mot[motor].polarity ? -measured : measured);
+        en_set_encoder_steps(motor, en_read_encoder(motor));
+    }
+    return (set_ui8(nv));
+}
+
+/*
+ * st_set_correction() - set a step correction gain or limit ({1cp}, {1ci}, {1cd}, {1cm}, {1fl})
+ *
+ *  The fixed-point runtime keeps its own Q copies of these for the PID (see _step_correction()).
+ */
+stat_t st_set_correction(nvObj_t *nv)
+{
+    uint8_t motor = _get_motor(nv->index);
+    if (motor >= MOTORS) {
+        nv->valuetype = TYPE_NULL;
+        return STAT_INPUT_VALUE_RANGE_ERROR;
+    };
+    ritorno(set_flt(nv));
+#ifdef __FIXED_POINT_RUNTIME
+    cfgMotor_t *cfg = &st_cfg.mot[motor];
+    stPrepMotor_t *pre = &st_pre.mot[motor];
+    pre->correction_p_q = q_scale_from_float(cfg->correction_p, 0);
+    pre->correction_i_q = q_scale_from_float(cfg->correction_i, 0);
+    pre->correction_d_q = q_scale_from_float(cfg->correction_d, 0);
+    pre->correction_max_q = q_from_float(cfg->correction_max, Q32_BITS);
+    pre->following_error_limit_q = q_from_float(cfg->following_error_limit, Q32_BITS);
+#endif
+    return (STAT_OK);
+}
+
 /* GLOBAL FUNCTIONS (SYSTEM LEVEL)
  *
  * st_set_mt() - set global motor timeout in seconds
@@ -1099,6 +1556,12 @@ static const char fmt_0su[] = "[%s%s] m%s steps per unit %17.5f steps per%s\n";
 static const char fmt_0po[] = "[%s%s] m%s polarity%18d [0=normal,1=reverse]\n";
 static const char fmt_0pm[] = "[%s%s] m%s power management%10d [0=disabled,1=always on,2=in cycle,3=when moving]\n";
 static const char fmt_0pl[] = "[%s%s] m%s motor power level%13.3f [0.000=minimum, 1.000=maximum]\n";
+static const char fmt_0es[] = "[%s%s] m%s encoder source%15d [0=steps,1=motor]\n";
+static const char fmt_0cp[] = "[%s%s] m%s correction P gain%13.3f\n";
+static const char fmt_0ci[] = "[%s%s] m%s correction I gain%13.3f\n";
+static const char fmt_0cd[] = "[%s%s] m%s correction D gain%13.3f\n";
+static const char fmt_0cm[] = "[%s%s] m%s correction max%16.3f steps per segment\n";
+static const char fmt_0fl[] = "[%s%s] m%s following error limit%9.3f steps [0=disabled]\n";
 static const char fmt_pwr[] = "[%s%s] Motor %c power level:%12.3f\n";
 
 void st_print_me(nvObj_t *nv) { text_print(nv, fmt_me);}    // TYPE_NULL - message only
@@ -1138,5 +1601,11 @@ void st_print_po(nvObj_t *nv) { _print_motor_int(nv, fmt_0po);}
 void st_print_pm(nvObj_t *nv) { _print_motor_int(nv, fmt_0pm);}
 void st_print_pl(nvObj_t *nv) { _print_motor_flt(nv, fmt_0pl);}
 void st_print_pwr(nvObj_t *nv){ _print_motor_pwr(nv, fmt_pwr);}
+void st_print_es(nvObj_t *nv) { _print_motor_int(nv, fmt_0es);}
+void st_print_cp(nvObj_t *nv) { _print_motor_flt(nv, fmt_0cp);}
+void st_print_ci(nvObj_t *nv) { _print_motor_flt(nv, fmt_0ci);}
+void st_print_cd(nvObj_t *nv) { _print_motor_flt(nv, fmt_0cd);}
+void st_print_cm(nvObj_t *nv) { _print_motor_flt(nv, fmt_0cm);}
+void st_print_fl(nvObj_t *nv) { _print_motor_flt(nv, fmt_0fl);}
 
 #endif // __TEXT_MODE
@@ -177,7 +177,7 @@
  *
  *  - Once the segment has been computed the exec handler finishes up by running the
  *    PREP routine in stepper.cpp. This computes the DDA values and gets the segment
- *    into the prep buffer - and ready for the next LOAD operation.
+ *    into the prep queue - and ready for a following LOAD operation.
  *
  *  - The main loop runs in background to receive gcode blocks, parse them, and send
  *    them to the planner in order to keep the planner queue full so that when the
@@ -217,7 +217,8 @@
  *      be needed to run the move - in this example st_prep_line().
  *
  *   7  st_prep_line() generates the timer and DDA values and stages these into
- *      the prep structure (sp) - ready for loading into the stepper runtime struct
+ *      the next entry of the prep queue (st_pre) - ready for loading into the
+ *      stepper runtime struct. The exec is requested again until the queue is full.
  *
  *   8  stepper.st_prep_line() returns back to planner.mp_exec_move(), which
  *      frees the planning buffer (bf) back to the planner buffer pool if the
@@ -261,11 +262,6 @@
  *********************************/
 //See hardware.h for platform specific stepper definitions
 
-typedef enum {
-    PREP_BUFFER_OWNED_BY_LOADER = 0,    // staging buffer is ready for load
-    PREP_BUFFER_OWNED_BY_EXEC           // staging buffer is being loaded
-} prepBufferState;
-
 typedef enum {                          // used w/start and stop flags to sequence motor power
     MOTOR_OFF = 0,                      // motor is stopped and deenergized
     MOTOR_IDLE,                         // motor is stopped and may be partially energized for torque maintenance
@@ -316,19 +312,51 @@ typedef enum {
  */
 #define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (NOM_SEGMENT_TIME * 60)))
 
-/* Step correction settings
+/* Step correction (closed loop)
+ *
+ *  The encoders are sampled once per segment by the loader. Each motor reads either its
+ *  own step count (encoder source 0, a "virtual" encoder that only sees numerical error)
+ *  or the position its driver reports (encoder source 1, e.g. a servo or an encoder input -
+ *  see Stepper::readEncoder()). The exec turns the sample into a following error against
+ *  the segment that was running when it was taken (see plan_exec.cpp).
+ *
+ *  That sample is 2 or more segments old by the time it is used, and corrections made in
+ *  the segments since then have not shown up in it yet. The exec subtracts these corrections
+ *  "in flight" from the error, so the error given to st_prep_line() is the error expected at
+ *  the end of the segments already queued. This keeps the loop from correcting the same
+ *  error more than once, which is what the old holdoff was for.
+ *
+ *  st_prep_line() runs a PID on that error for every motor, every segment:
  *
- *  Step correction settings determine how the encoder error is fed back to correct position errors.
- *  Since the following_error is running 2 segments behind the current segment you have to be careful
- *  not to overcompensate. The threshold determines if a correction should be applied, and the factor
- *  is how much. The holdoff is how many segments to wait before applying another correction. If threshold
- *  is too small and/or amount too large and/or holdoff is too small you may get a runaway correction
- *  and error will grow instead of shrink (or oscillate).
+ *    correction = P * error + I * sum(error) + D * (error - previous error)
+ *
+ *  The correction is taken off the segment's travel. It is limited to the per motor max
+ *  ({1cm}) and to the segment's travel, so a motor never reverses inside a segment, and one
+ *  that doesn't move in the segment isn't corrected - but its error is still checked against
+ *  the limit below. The integral stops accumulating while the correction is limited. Errors
+ *  inside the threshold are treated as 0, which keeps the P and D terms from chasing encoder
+ *  quantization.
+ *
+ *  If a motor's error goes over its following error limit ({1fl}, 0 to disable) a feedhold
+ *  is requested and STAT_FOLLOWING_ERROR_EXCEEDED is reported from the main loop.
+ *
+ *  The gains are per motor ({1cp}, {1ci}, {1cd}) and are in steps of correction per step
+ *  of error per segment. The defaults (P 0.25, max 0.6 steps) match the old nudge correction.
+ *  Servo axes that follow closely can use much larger P and max values, and an I term to
+ *  take out a steady loss.
  */
-#define STEP_CORRECTION_THRESHOLD   (float)2.00     // magnitude of forwarding error to apply correction (in steps)
-#define STEP_CORRECTION_FACTOR      (float)0.25     // factor to apply to step correction for a single segment
-#define STEP_CORRECTION_MAX         (float)0.60     // max step correction allowed in a single segment
-#define STEP_CORRECTION_HOLDOFF            5        // minimum number of segments to wait between error correction
+#define STEP_CORRECTION_THRESHOLD   (float)2.00     // errors smaller than this are not corrected (in steps)
+
+#ifdef __FIXED_POINT_RUNTIME    // DDA_SUBSTEPS in fixed point (Q31.32 steps)
+#define DDA_SUBSTEPS_INT            ((int32_t)DDA_SUBSTEPS)
+#define STEP_EPSILON_Q              ((int64_t)(EPSILON * 4294967296.0))
+#define STEP_CORRECTION_THRESHOLD_Q ((int64_t)(STEP_CORRECTION_THRESHOLD * 4294967296.0))
+#endif
+
+typedef enum {                              // where the loader reads a motor's encoder from
+    ENCODER_SOURCE_STEPS = 0,               // counted steps (virtual encoder)
+    ENCODER_SOURCE_MOTOR                    // position reported by the motor driver
+} stEncoderSource;
 
 /*
  * Stepper control structures
@@ -359,6 +387,12 @@ typedef struct cfgMotor {                   // per-motor configs
     float travel_rev;                       // mm or deg of travel per motor revolution
     float steps_per_unit;                   // microsteps per mm (or degree) of travel
     float units_per_step;                   // mm or degrees of travel per microstep
+    uint8_t encoder_source;                 // stEncoderSource
+    float correction_p;                     // step correction PID gains (see step correction above)
+    float correction_i;
+    float correction_d;
+    float correction_max;                   // max correction in one segment (steps)
+    float following_error_limit;            // feedhold if the following error goes over this (steps), 0 = off
 
     // private
     float power_level_scaled;               // scaled to internal range - must be between 0 and 1
@@ -374,7 +408,7 @@ typedef struct stConfig {                   // stepper configs
 typedef struct stRunMotor {                 // one per controlled motor
     uint32_t substep_increment;             // total steps in axis times substeps factor
     int32_t substep_accumulator;            // DDA phase angle accumulator
-    bool motor_flag;                        // true if motor is participating in this move
+    uint8_t direction;                      // direction the motor is set to (CW==0. CCW==1)
     uint32_t power_systick;                 // sys_tick for next motor power state transition
     float power_level_dynamic;              // power level for this segment of idle
 } stRunMotor_t;
@@ -384,47 +418,97 @@ typedef struct stRunSingleton {             // Stepper static values and axis pa
     uint32_t dda_ticks_downcount;           // dda tick down-counter (unscaled)
     uint32_t dwell_ticks_downcount;         // dwell tick down-counter (unscaled)
     uint32_t dda_ticks_X_substeps;          // ticks multiplied by scaling factor
+#ifdef __VARIABLE_INTERVAL_DDA
+    uint32_t dda_interval;                  // DDA ticks from the last interrupt to the next one
+    uint32_t dda_top;                       // DDA timer TOP for one tick
+#endif
     stRunMotor_t mot[MOTORS];               // runtime motor structures
     magic_t magic_end;
 } stRunSingleton_t;
 
-// Motor prep structure. Used by exec/prep ISR (MED) and read-only during load
-// Must be careful about volatiles in this one
+/* Prep queue
+ *
+ *  Prepared segments (and dwells and commands) are passed from the exec (MED ISR) to the
+ *  loader (HI ISR) through a ring of PREP_QUEUE_SIZE entries. There is one writer and one
+ *  reader, so no locking is needed: the exec fills the entry at 'head' then advances head,
+ *  the loader empties the entry at 'tail' then advances tail. Each index is only written
+ *  by its owner. Both count up forever and wrap at 256, which is why PREP_QUEUE_SIZE must
+ *  be a power of 2. (head - tail) is the number of entries ready to load.
+ *
+ *  The exec keeps running until the ring is full, so an exec that is late by up to
+ *  (PREP_QUEUE_SIZE - 1) segment times does not starve the DDA. The cost is that the
+ *  runtime (mr) is that many segments ahead of the steppers. PREP_QUEUE_SIZE of 1 is
+ *  the old single prep buffer.
+ *
+ *  underruns and min_headroom show how close the exec came to starving the loader.
+ *  They are cleared by $clc. The headroom left behind a load only counts once the next
+ *  segment ends in motion, so the last segment of a move (nothing behind it) is not a 0.
+ */
 
-typedef struct stPrepMotor {
-    uint32_t substep_increment;             // total steps in axis times substep factor
-    bool motor_flag;                        // true if motor is participating in this move
+// Segment prep structures. Written by exec/prep ISR (MED), read by the loader (HI)
 
-    // direction and direction change
+typedef struct stPrepSegmentMotor {
+    uint32_t substep_increment;             // total steps in axis times substep factor (0 if not in segment)
     uint8_t direction;                      // travel direction corrected for polarity (CW==0. CCW==1)
-    uint8_t prev_direction;                 // travel direction from previous segment run for this motor
     int8_t step_sign;                       // set to +1 or -1 for encoders
+    uint8_t accumulator_correction_flag;    // signals accumulator needs correction
+    float accumulator_correction;           // factor for adjusting accumulator between segments
+    float travel_steps;                     // travel in steps, CW positive (see Stepper::loadSegment())
+} stPrepSegmentMotor_t;
 
+typedef struct stPrepSegment {
+    blockType block_type;                   // move type (requires planner.h). Reset to NULL by the loader
+    struct mpBuffer *bf;                    // buffer for BLOCK_TYPE_COMMAND
+    uint32_t dda_ticks;                     // DDA ticks for the move
+    uint32_t dwell_ticks;                   // dwell ticks remaining
+    uint32_t dda_ticks_X_substeps;          // DDA ticks scaled by substep factor
+    stPrepSegmentMotor_t mot[MOTORS];
+} stPrepSegment_t;
+
+// Motor prep state carried from segment to segment. Used only by exec/prep ISR (MED)
+
+typedef struct stPrepMotor {
     // following error correction
-    int32_t correction_holdoff;             // count down segments between corrections
+    float error_integral;                   // PID integral (steps * segments)
+    float previous_error;                   // PID error from the last segment
     float corrected_steps;                  // accumulated correction steps for the cycle (for diagnostic display only)
+#ifdef __FIXED_POINT_RUNTIME                // the PID runs in Q31.32 steps - see st_set_correction()
+    int64_t error_integral_q;
+    int64_t previous_error_q;
+    int64_t correction_max_q;
+    int64_t following_error_limit_q;
+    qScale_t correction_p_q;
+    qScale_t correction_i_q;
+    qScale_t correction_d_q;
+    int64_t corrected_steps_q;              // corrected_steps in Q31.32, copied to it at section ends
+#endif
 
     // accumulator phase correction
-    float prev_segment_time;                // segment time from previous segment run for this motor
-    float accumulator_correction;           // factor for adjusting accumulator between segments
-    uint8_t accumulator_correction_flag;    // signals accumulator needs correction
+    float prev_segment_time;                // segment time from previous segment prepared for this motor
 } stPrepMotor_t;
 
 typedef struct stPrepSingleton {
     magic_t magic_start;                    // magic number to test memory integrity
-    volatile prepBufferState buffer_state;  // prep buffer state - owned by exec or loader
-    struct mpBuffer *bf;                    // static pointer to relevant buffer
-    blockType block_type;                   // move type (requires planner.h)
-
-    uint32_t dda_ticks;                     // DDA ticks for the move
-    uint32_t dwell_ticks;                   // dwell ticks remaining
-    uint32_t dda_ticks_X_substeps;          // DDA ticks scaled by substep factor
+    volatile uint8_t head;                  // next entry the exec will fill - written only by the exec
+    volatile uint8_t tail;                  // next entry the loader will empty - written only by the loader
+    stPrepSegment_t seg[PREP_QUEUE_SIZE];   // prep queue
     stPrepMotor_t mot[MOTORS];              // prep time motor structs
+
+    volatile uint32_t segments_loaded;      // line segments loaded - see mr.segments_prepped
+    uint32_t segment_ticks[PREP_HISTORY_SIZE];  // motion clock at the end of each line segment, indexed as mr.step_history
+    uint32_t underruns;                     // loads that found the queue empty while in motion
+    uint32_t min_headroom;                  // fewest entries left queued behind a load while in motion
+#ifdef __VARIABLE_INTERVAL_DDA
+    uint32_t dda_late;                      // DDA interrupts that ended past their next TOP (see _dda_schedule())
+#endif
+    uint8_t headroom;                       // entries left behind the last load, counted if motion goes on
+    volatile uint8_t fe_motor;              // motor (1-N) that went over its following error limit, 0 if none
+    float fe_error;                         // ...and its following error
     magic_t magic_end;
 } stPrepSingleton_t;
 
 extern stConfig_t st_cfg;                   // config struct is exposed. The rest are private
-extern stPrepSingleton_t st_pre;            // only used by config_app diagnostics
+extern stPrepSingleton_t st_pre;            // only used by config_app diagnostics and the sim
 
 
 /**** Stepper (base object) ****/
@@ -554,6 +638,18 @@ struct Stepper {
     virtual void setDirection(uint8_t new_direction) { /* must override */ };
     virtual void setMicrosteps(const uint8_t microsteps) { /* must override */ };
     virtual void setPowerLevel(float new_pl) { /* must override */ };
+
+    /* Functions that may be implemented in subclasses */
+
+    // Read the motor's measured position in steps for encoder source 1. CW counts up - the
+    // loader applies the polarity. Called by the loader (HI ISR) once per segment so it
+    // must be quick. Return false if the motor can't report its position.
+    virtual bool readEncoder(int32_t &steps) { return false; };
+
+    // Take the travel of the line segment being loaded, in steps, CW positive. Called by the
+    // loader for every line segment, moving or not. Motors that are sent positions instead
+    // of step pulses (see GeratechServo) use it. Runs in the loader so it must be quick.
+    virtual void loadSegment(const float travel_steps) {};
 };
 
 
@@ -568,6 +664,7 @@ bool st_runtime_isbusy(void);
 stat_t st_clc(nvObj_t *nv);
 void st_set_motor_power(const uint8_t motor);
 stat_t st_motor_power_callback(void);
+stat_t st_following_error_callback(void);
 
 void st_request_forward_plan(void);
 void st_request_exec_move(void);
@@ -576,7 +673,14 @@ void st_prep_null(void);
 void st_prep_command(void *bf);        // use a void pointer since we don't know about mpBuf_t yet)
 void st_prep_dwell(float microseconds);
 void st_request_out_of_band_dwell(float microseconds);
+uint32_t st_get_segments_loaded(void);
+uint32_t st_get_segment_ticks(const uint32_t segment);
+uint32_t st_get_motion_ticks(void);
+uint32_t st_get_motion_ticks_ago(const uint32_t ticks);
 //stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
+#ifdef __FIXED_POINT_RUNTIME
+stat_t st_prep_line(int64_t travel_steps[], int64_t following_error[], float segment_time);
+#endif
 stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
 
 stat_t st_set_ma(nvObj_t *nv);
@@ -589,6 +693,8 @@ stat_t st_set_pm(nvObj_t *nv);
 stat_t st_get_pm(nvObj_t *nv);
 stat_t st_set_pl(nvObj_t *nv);
 stat_t st_get_pwr(nvObj_t *nv);
+stat_t st_set_es(nvObj_t *nv);
+stat_t st_set_correction(nvObj_t *nv);
 
 stat_t st_set_mt(nvObj_t *nv);
 stat_t st_set_md(nvObj_t *nv);
@@ -605,6 +711,12 @@ stat_t st_set_me(nvObj_t *nv);
     void st_print_pm(nvObj_t *nv);
     void st_print_pl(nvObj_t *nv);
     void st_print_pwr(nvObj_t *nv);
+    void st_print_es(nvObj_t *nv);
+    void st_print_cp(nvObj_t *nv);
+    void st_print_ci(nvObj_t *nv);
+    void st_print_cd(nvObj_t *nv);
+    void st_print_cm(nvObj_t *nv);
+    void st_print_fl(nvObj_t *nv);
     void st_print_mt(nvObj_t *nv);
     void st_print_me(nvObj_t *nv);
     void st_print_md(nvObj_t *nv);
@@ -620,6 +732,12 @@ stat_t st_set_me(nvObj_t *nv);
     #define st_print_pm tx_print_stub
     #define st_print_pl tx_print_stub
     #define st_print_pwr tx_print_stub
+    #define st_print_es tx_print_stub
+    #define st_print_cp tx_print_stub
+    #define st_print_ci tx_print_stub
+    #define st_print_cd tx_print_stub
+    #define st_print_cm tx_print_stub
+    #define st_print_fl tx_print_stub
     #define st_print_mt tx_print_stub
     #define st_print_me tx_print_stub
     #define st_print_md tx_print_stub
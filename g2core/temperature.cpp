@@ -305,7 +305,7 @@ PWMOutputPin<-1> fet_pin3;// {kPWMPinInverted};
 // We're going to register a SysTick event
 const int16_t fet_pin1_sample_freq = 10; // every fet_pin1_sample_freq interrupts, sample
 int16_t fet_pin1_sample_counter = fet_pin1_sample_freq;
-SysTickEvent adc_tick_event {[&] {
+SysTickEvent adc_tick_event {[] {
     if (!--fet_pin1_sample_counter) {
         ADC_Module::startSampling();
         fet_pin1_sample_counter = fet_pin1_sample_freq;
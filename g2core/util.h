@@ -51,6 +51,8 @@ using Motate::SysTickTimer;
 
 //*** debug utilities ***
 
+void xio_tx_flush(void);    // xio_tx.cpp
+
 #pragma GCC push_options
 #pragma GCC optimize ("O0")
 inline void _debug_trap(const char *reason) {
@@ -58,6 +60,7 @@ inline void _debug_trap(const char *reason) {
     // and might be deep in an ISR, so we had better just _NOP() and hope for the best.
     __NOP();
 #if IN_DEBUGGER == 1
+    xio_tx_flush();         // the breakpoint may be the last stop - don't leave output staged
     __asm__("BKPT");
 #endif
 }
@@ -113,7 +116,9 @@ using std::max;
 template <typename T>
 inline T square(const T x) { return (x)*(x); }        /* UNSAFE */
 
+#ifndef __GLIBC__                     // glibc's C++ <stdlib.h> already provides float abs(float)
 inline float abs(const float a) { return fabs(a); }
+#endif
 
 #ifndef avg
 template <typename T>
@@ -150,6 +155,74 @@ inline T avg(const T a,const T b) {return (a+b)/2; }
 #define fp_TRUE(a) (a > EPSILON)
 #endif
 
+//**** Fixed Point Support *****
+/*
+ *  Signed fixed-point values are carried in int64_t (or int32_t) with the number of
+ *  fraction bits implied by the variable. These are used by the fixed-point segment
+ *  runtime (see __FIXED_POINT_RUNTIME in g2core.h) so the interpolation and step math
+ *  stays in integer registers on parts without an FPU. Some per-segment work is still
+ *  float - see _exec_aline_segment() in plan_exec.cpp.
+ *
+ *    q_from_float(f,bits) - convert float to fixed point with 'bits' fraction bits
+ *    q_to_float(q,bits)   - convert fixed point with 'bits' fraction bits to float
+ *    q_mul(a,b,shift)     - (a * b) >> shift, rounded, with a 96 bit intermediate
+ */
+
+typedef int64_t q32_t;                  // Q31.32 - positions and step counts
+
+#define Q32_BITS 32
+#define q_from_float(f,bits) ((int64_t)((f) * (float)((int64_t)1 << (bits))))
+#define q_to_float(q,bits) ((float)(q) * ((float)1 / (float)((int64_t)1 << (bits))))
+
+// Only two 32x32->64 multiplies, which the Cortex-M3 does in hardware (UMULL).
+// shift must be between 1 and 32.
+inline int64_t q_mul(const int64_t a, const int32_t b, const uint8_t shift)
+{
+    bool negative = ((a < 0) != (b < 0));
+    uint64_t ua = (a < 0) ? -(uint64_t)a : (uint64_t)a;
+    uint64_t ub = (b < 0) ? -(int64_t)b : (int64_t)b;
+    uint64_t lo = (ua & 0xFFFFFFFF) * ub + ((uint64_t)1 << (shift-1));
+    uint64_t hi = (ua >> 32) * ub;
+    uint64_t r = (hi << (32 - shift)) + (lo >> shift);
+    return (negative ? -(int64_t)r : (int64_t)r);
+}
+
+/*
+ *  A qScale_t carries a float factor of any size as a Q1.30 mantissa and a right shift,
+ *  so a fixed-point value can be multiplied by it without knowing its range in advance.
+ *
+ *    q_scale_from_float(f,drop) - make the scale for factor f. 'drop' fraction bits are
+ *                                 taken off the result (e.g. 16 for Q16.48 -> Q31.32)
+ *    q_scale(a,s)               - a * f, rounded
+ */
+
+typedef struct qScale {
+    int32_t mantissa;
+    uint8_t shift;
+} qScale_t;
+
+inline qScale_t q_scale_from_float(const float f, const uint8_t drop)
+{
+    qScale_t s = { 0, 32 };
+    int exponent;
+    float mantissa = frexpf(f, &exponent);              // f = mantissa * 2^exponent, 0.5 <= |mantissa| < 1
+    int shift = 30 - exponent + drop;
+    if ((mantissa != 0) && (shift <= 62)) {
+        s.mantissa = (int32_t)lroundf(ldexpf(mantissa, 30));
+        s.shift = (shift < 1) ? 1 : shift;              // saturates for f >= 2^(29+drop)
+    }
+    return (s);
+}
+
+inline int64_t q_scale(const int64_t a, const qScale_t s)
+{
+    if (s.shift <= 32) {
+        return (q_mul(a, s.mantissa, s.shift));
+    }
+    uint8_t rest = s.shift - 32;
+    return ((q_mul(a, s.mantissa, 32) + ((int64_t)1 << (rest-1))) >> rest);
+}
+
 // Constants
 #define MAX_LONG (2147483647)
 #define MAX_ULONG (4294967295)
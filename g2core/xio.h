@@ -111,6 +111,26 @@ enum xioSPIMode {
 
 #define RX_BUFFER_SIZE       512            // maximum length of recieved lines from xio_readline
 
+/**** TX staging (see xio_tx.cpp) *****/
+
+#define TX_STAGE_SIZE        512            // bytes of responses held for one device write
+
+typedef struct xioTXStage {
+    uint8_t enable;                         // txb: 1 = coalesce each controller pass's output into one write
+    uint8_t latency_ms;                     // txl: most ms output is held within a pass (0 = to the end of the pass)
+
+    uint16_t length;                        // bytes staged
+    uint32_t first_ms;                      // SysTick when the first of them was staged
+
+    uint32_t lines;                         // xio_write() and xio_writeline() calls to the control devices
+    uint32_t writes;                        // device writes they took
+    uint32_t latency_writes;                // writes forced by the latency cap
+
+    char buf[TX_STAGE_SIZE];
+} xioTXStage_t;
+
+extern xioTXStage_t xtx;
+
 /**** function prototypes ****/
 
 void xio_init(void);
@@ -125,7 +145,11 @@ void xio_flush_to_command();
 void xio_exit_fake_bootloader();
 #endif
 
+size_t xio_write_devices(const char *buffer, size_t size, bool only_to_muted);
+void xio_tx_flush(void);
+
 stat_t xio_set_spi(nvObj_t *nv);
+stat_t xio_cltx(nvObj_t *nv);
 
 /**** newlib-nano support function(s) ****/
 extern "C" {
@@ -233,10 +257,14 @@ bool xio_send_file(xio_flash_file &file);
 #ifdef __TEXT_MODE
 
     void xio_print_spi(nvObj_t *nv);
+    void xio_print_txb(nvObj_t *nv);
+    void xio_print_txl(nvObj_t *nv);
 
 #else
 
     #define xio_print_spi tx_print_stub
+    #define xio_print_txb tx_print_stub
+    #define xio_print_txl tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -0,0 +1,742 @@
+/*
+ * xio_line_buffer.h - line reading over a Motate RXBuffer
+ * This file is part of the g2core project
+ *
+ * Copyright (c) 2013 - 2017 Alden S. Hart Jr.
+ * Copyright (c) 2013 - 2017 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * LineRXBuffer is the RX side of every xio device (see xioDeviceWrapper in xio.cpp). It
+ * is here rather than in xio.cpp so it can be built on the host, over the stub RXBuffer
+ * in board/sim/motate, for the scanner benchmark (see board/sim/sim_scan.cpp).
+ */
+#ifndef XIO_LINE_BUFFER_H_ONCE
+#define XIO_LINE_BUFFER_H_ONCE
+
+#include "g2core.h"
+#include "xio.h"
+#include "util.h"               // _debug_trap()
+
+#include "MotateBuffer.h"
+#include "MotateTimers.h"       // Motate::Timeout
+using Motate::RXBuffer;
+
+// LineRXBuffer takes the Motate RXBuffer (which handles "transfers", usually DMA), and adds G2 line-reading
+// semantics to it.
+// _word_scan selects the word-at-a-time scan of line bodies (see _scanLineBody()). It is only
+// turned off to compare against the per-character scan.
+template <uint16_t _size, typename owner_type, uint8_t _header_count = 8, uint16_t _line_buffer_size = RX_BUFFER_SIZE,
+          bool _word_scan = true>
+struct LineRXBuffer : RXBuffer<_size, owner_type, char> {
+    typedef RXBuffer<_size, owner_type, char> parent_type;
+
+    // Let's help the compiler clarify what we mean by a few things:
+    // (This is because of the templating, it needs a little extra clarification.)
+    using parent_type::_data;
+    using parent_type::_getWriteOffset;
+    using parent_type::_last_known_write_offset;
+    using parent_type::_read_offset;
+    using parent_type::isEmpty;
+    using parent_type::_restartTransfer;
+    using parent_type::_canBeRead;
+
+
+    // START OF LineRXBuffer PROPER
+    static_assert(((_header_count-1)&_header_count)==0, "_header_count must be 2^N");
+
+    char _line_buffer[_line_buffer_size+1]; // hold exactly one line to return
+    uint32_t _line_end_guard = 0xBEEF;
+
+    // General term usage:
+    // * "index" indicates it's in to _headers array
+    // * "offset" means it's a character in the _data array
+
+    uint16_t _scan_offset;          // offset into data of the last character scanned
+    uint16_t _line_start_offset;    // offset into first character of the line, or the first char to ignore (too-long lines)
+    uint16_t _last_line_length;     // used for ensuring lines aren't too long
+    bool     _ignore_until_next_line; // if we get a too-long-line, we ignore the rest by setting this flag
+    bool     _at_start_of_line;     // true if the last character scanned was the end of a line
+
+    uint16_t _lines_found;          // count of complete non-control lines that were found during scanning.
+
+    bool     _holding_line;         // the last line was returned in place from _data - see readline()
+    uint16_t _held_read_offset;     // where _read_offset goes once that line is released
+
+    volatile uint16_t _last_scan_offset;  // DEBUGGING
+
+    bool _last_returned_a_control = false;
+
+#if MARLIN_COMPAT_ENABLED == true
+    enum class STK500V2_State {
+        Done,      // not in the faked stk500v2 bootloader
+        Timeout,   // timeout period, waiting for a start character
+        Start,     // waiting for 0x1B
+        Sequence,  // waiting for sequence byte
+        Length_0,  // waiting for MSB of length
+        Length_1,  // waiting for LSB of length
+        Header_End,// waiting for 0x0E
+        Data,      // waiting for more data
+        Checksum   // waiting for checksum byte
+    };
+    STK500V2_State _stk_parser_state;
+    uint16_t _stk_packet_data_length;
+    Motate::Timeout _stk_timeout;
+
+    void startFakeBootloaderMode() {
+        _stk_parser_state = STK500V2_State::Timeout;
+        _stk_timeout.set(2000); // two seconds
+    }
+
+    void exitFakeBootloaderMode() {
+        _stk_parser_state = STK500V2_State::Done;
+    }
+#endif
+
+    LineRXBuffer(owner_type owner) : parent_type{owner} {};
+
+    void init() {
+        parent_type::init();
+        _at_start_of_line = true;
+    };
+
+
+    struct SkipSections {
+        struct SkipSection {
+            uint16_t start_offset; // the offset of the first character to skip
+            uint16_t end_offset;   // the offset of the next character to read after skipping
+        };
+
+        static constexpr uint16_t _section_count = 16;
+        SkipSection _sections[_section_count];
+
+        uint8_t read_section_idx; // index of the first skip section to skip
+        uint8_t write_section_idx; // index of the next skip section to populate
+
+        bool isFull() {
+            return ((write_section_idx+1)&(_section_count-1)) == read_section_idx;
+        };
+        bool isEmpty() {
+            return (write_section_idx == read_section_idx);
+        };
+
+        void addSkip(uint16_t start_offset, uint16_t end_offset) {
+            if (!isEmpty()) {
+                uint8_t last_write_section_idx = write_section_idx;
+                if (write_section_idx == 0) {
+                    last_write_section_idx = _section_count-1;
+                } else {
+                    last_write_section_idx--;
+                }
+
+                if (_sections[last_write_section_idx].end_offset == start_offset) {
+                    _sections[last_write_section_idx].end_offset = end_offset;
+                    return;
+                }
+            }
+            _sections[write_section_idx].start_offset = start_offset;
+            _sections[write_section_idx].end_offset = end_offset;
+            write_section_idx = ((write_section_idx+1)&(_section_count-1));
+        };
+
+        void popSkip() {
+            _sections[read_section_idx].start_offset = 0;
+            _sections[read_section_idx].end_offset = 0;
+
+            read_section_idx = ((read_section_idx+1)&(_section_count-1));
+        };
+
+        bool skip(volatile uint16_t &from) {
+            if (!isEmpty()) {
+                SkipSection &next_skip = _sections[read_section_idx];
+
+                if (next_skip.start_offset == from) {
+                    from = next_skip.end_offset;
+
+                    popSkip();
+                    return true;
+                }
+            }
+            return false;
+        };
+
+//        const SkipSection& next_skip() {
+//            return _sections[read_section_idx];
+//        }
+    };
+
+    SkipSections _skip_sections;
+
+    uint16_t _getNextScanOffset() {
+        return ((_scan_offset + 1) & (_size-1));
+    }
+
+    bool _isMoreToScan() {
+        return _canBeRead(_scan_offset);
+    };
+
+    /*
+     * _scanLineBody() - skip the body of a line a word at a time
+     *
+     * Inside a line only CR, LF and NUL need the per-character scan below: single character
+     * controls are only taken at the start of a line. So the body is skipped a machine word
+     * (4 bytes on the SAM3X) at a time while the word holds none of them, then a character
+     * at a time up to the one that does. Returns the number of characters skipped - the
+     * caller moves _scan_offset and _last_line_length on by that.
+     *
+     * It stops at the end of _data (the rest is scanned after the wrap) and short of the
+     * character that would make the line too long, so the per-character scan still sees
+     * every line end, wrap and split.
+     */
+    typedef uintptr_t scan_word_t;
+
+    static constexpr scan_word_t _ones = (scan_word_t)-1 / 0xFF;       // 0x0101...01
+    static constexpr scan_word_t _highs = _ones * 0x80;                // 0x8080...80
+
+    static bool _hasZeroByte(const scan_word_t w) {
+        return ((w - _ones) & ~w & _highs) != 0;
+    }
+
+    static bool _hasLineEnd(const scan_word_t w) {
+        return _hasZeroByte(w) || _hasZeroByte(w ^ (_ones * '\n')) || _hasZeroByte(w ^ (_ones * '\r'));
+    }
+
+    uint16_t _scanLineBody() {
+        uint16_t limit = (_getWriteOffset() - _scan_offset) & (_size-1);  // received and not scanned
+        if (limit > (_size - _scan_offset)) {
+            limit = _size - _scan_offset;
+        }
+        if (_last_line_length >= (_line_buffer_size - 2)) {
+            return 0;
+        }
+        if (limit > ((_line_buffer_size - 2) - _last_line_length)) {
+            limit = (_line_buffer_size - 2) - _last_line_length;
+        }
+
+        const char *p = &_data[_scan_offset];
+        uint16_t n = 0;
+        while ((n + sizeof(scan_word_t)) <= limit) {
+            scan_word_t w;
+            memcpy(&w, p + n, sizeof(w));                   // unaligned load
+            if (_hasLineEnd(w)) {
+                break;
+            }
+            n += sizeof(w);
+        }
+        while ((n < limit) && (p[n] != '\n') && (p[n] != '\r') && (p[n] != 0)) {
+            n++;
+        }
+        return n;
+    };
+
+    /*
+     * _scanBuffer()
+     *
+     * Make a pass through the RX DMA buffer to locate any control lines, and count lines.
+     * Single character controls, like !, ~, %, and ^x are also considered control "lines"
+     *
+     * _scanBuffer() is called at the beginning of readline, and is effectively the first
+     * "phase" of readline.
+     *
+     * This function is designed to be able to exit from almost any point, and
+     * come back in and resume where it left off. This allows it to scan to the
+     * end of the buffer then exit. When the function is called next it picks up
+     * where it left off - i.e. avoiding rescanning the entire buffer multiple times.
+     *
+     * _scanBuffer() returns true if it finds a control line.
+     * The control line starts at the character at _line_start_offset and includes 
+     * the characters up to _scan_offset-1. If there are multiple line-ending chars 
+     * ("\r\n" for example) _scan_offset will point to the *first* one.
+     *
+     * With ASCII art (where "." means "invalid data" or "don't care"):
+     *
+     * Example 1 of _scanBuffer() == true:
+     *   _data = "G0X10\n{jvm:5}\n{xvm:1200}\nG0Y10\nG1Z......"
+     *                   ^        ^
+     *                   |        |
+     *   _line_start_offset       |
+     *                         _scan_offset
+     *
+     * Example 2 of _scanBuffer() == true:
+     *   _data = "G0X10\n.........{xvm:1200}\nG0Y10\nG1Z......"
+     *                            ^           ^
+     *                            |           |
+     *            _line_start_offset          |
+     *                                  _scan_offset
+     *
+     * Example 2 of _scanBuffer() == true:
+     *   _data = "G0X10\n!......"
+     *                   ^^
+     *                   ||
+     *  _line_start_offset|
+     *                    _scan_offset
+     *
+     * For _scanBuffer() == false, IGNORE _line_start_offset and _scan_offset!!!
+     * Only use _read_offset, and use _lines_found>0 to determine if _data contains a line to return.
+     * Also note that _read_offset needs to be moved once the data is copied to _line_buffer!
+     */
+    /* Explanation of cases and how we handle it.
+     *
+     * Our first task in this loop is two-fold (done at the same time):
+     *  A) Scan the RX DMA buffer for the next complete line, then classify the line.
+     *  B) Scan for a single-character command (!~% ^D, etc), then classify as a control line.
+     *
+     * If we find a line that classifies as "control" then we return true and stop scanning.
+     *
+     * We also have a constraint that we may run out of characters at any time. This is OK, 
+     * and enough state is kept that we can enter the function at any point with new 
+     * characters added to the RX DMA buffer and get the same results.
+     *
+     * Another constraint is that lines MAY have single character commands embedded in them. 
+     * In this case we need to un-embed them. Since we may not have the end of the line yet, 
+     * we need to move the command to the beginning of the line.
+     *
+     * Note that _at_start_of_line means that we *just* parsed a character that is *at* the end of the line.
+     * So, for a \r\n sequence, _at_start_of_line will go true of the \r, and we'll see the \n and it'll stay
+     * true, then the first non \r or \n char will set it to false, and *then* start the next line.
+     */
+
+    bool _scanBuffer() {
+        _last_scan_offset = _scan_offset;
+        while (_isMoreToScan()) {
+            // in the body of a line skip ahead to the next character that matters
+            if (_word_scan && !_at_start_of_line && !_ignore_until_next_line
+#if MARLIN_COMPAT_ENABLED == true
+                && (_stk_parser_state == STK500V2_State::Done)
+#endif
+               ) {
+                uint16_t skipped = _scanLineBody();
+                if (skipped != 0) {
+                    _scan_offset = (_scan_offset + skipped) & (_size-1);
+                    _last_line_length += skipped;
+                    continue;
+                }
+            }
+
+            bool ends_line  = false;
+            bool is_control = false;
+            char c = _data[_scan_offset];
+
+#if MARLIN_COMPAT_ENABLED == true
+            // it's possible something will try to talk stk500v2 to us.
+            // See https://github.com/synthetos/g2/wiki/Marlin-Compatibility#stk500v2
+
+            if ((_stk_parser_state == STK500V2_State::Done) && (c == 0)) {
+                _debug_trap("scan ran into NULL (Marlin-mode)");
+                flush(); // consider the connection and all data trashed
+                return false;
+            }
+
+            if (_stk_parser_state >= STK500V2_State::Timeout) {
+                if (_stk_parser_state == STK500V2_State::Timeout) {
+                    if (_stk_timeout.isPast()) {
+                        _stk_parser_state = STK500V2_State::Done;
+                        // start over, outside of stk500v2 mode
+                        continue;
+                    }
+                    // if we got something before the timeout, then we're in stk500v2 mode
+                    // we'll look at what we got and maybe exit anyway
+                    _stk_parser_state = STK500V2_State::Start;
+                }
+                if (_stk_parser_state == STK500V2_State::Start) {
+                    if (c == 0x1B) {
+                        _stk_parser_state = STK500V2_State::Sequence;
+
+                        // this is the start of this "line" and we can "read" (skip) everything up to here.
+                        _read_offset = _scan_offset;
+                        _line_start_offset = _scan_offset;
+                    }
+                    else if ((c == '{') || (c == 'N') || (c == '\n') || (c == '\r') || (c == 'G') || (c == 'M')) {
+                        _stk_parser_state = STK500V2_State::Done;           // jump out of bootloader mode
+                        _read_offset = _scan_offset;
+                        continue;
+                    }
+                } else if (_stk_parser_state == STK500V2_State::Sequence) {
+                    _stk_parser_state = STK500V2_State::Length_0;            // we ignore the sequence
+                } else if (_stk_parser_state == STK500V2_State::Length_0) {
+                    _stk_packet_data_length = c << 8;
+                    _stk_parser_state = STK500V2_State::Length_1;
+                } else if (_stk_parser_state == STK500V2_State::Length_1) {
+                    _stk_packet_data_length |= c;
+                    _stk_parser_state = STK500V2_State::Header_End;
+                } else if (_stk_parser_state == STK500V2_State::Header_End) {
+                    if (c == 0x0E) {
+                        _stk_parser_state = STK500V2_State::Data;
+                    } else {   // end-of-header marker was corrupt, start over
+                        _stk_packet_data_length = 0;
+                        _read_offset = _scan_offset;
+                        _stk_parser_state = STK500V2_State::Start;
+                    }
+                } else if (_stk_parser_state == STK500V2_State::Data) {
+                    if (--_stk_packet_data_length == 0) {                   // we don't read the data here, just return it
+                        _stk_parser_state = STK500V2_State::Checksum;
+                    }
+                } else if (_stk_parser_state == STK500V2_State::Checksum) {
+                    // We do NOT check the checksum, since if it's corrupt, we'd need to reply, and we can't reply here.
+                    // At this point, we at least have a complete packet we will use the "control" return mechanism to
+                    // handle this since controls don't have to be \r\n-terminated
+                    is_control = true;
+                    ends_line = true;
+                    _stk_parser_state = STK500V2_State::Start;              // this line is complete, reset the state engine
+                }
+            }
+            else
+#else   // not MARLIN_COMPAT_ENABLED
+
+            if (c == 0) {
+                _debug_trap("scan ran into NULL");
+                flush(); // consider the connection and all data trashed
+                return false;
+            }
+#endif  // MARLIN_COMPAT_ENABLED
+
+            // Look for line endings
+            if (c == '\r' || c == '\n') {
+                if (_ignore_until_next_line) {
+                    // we finally ended the line we were ignoring
+                    // add a skip section to jump over the overage
+                    _skip_sections.addSkip(_line_start_offset, _scan_offset);
+                    // move the start of the next skip section to after this skip
+                    _line_start_offset = _scan_offset;
+
+                    // we DON'T want to end it normally (by counting a line)
+                    _at_start_of_line = true;
+                    _ignore_until_next_line = false;
+
+                    _last_line_length = 0;
+                }
+                else if (!_at_start_of_line) {  // We only mark ends_line for the first end-line char, and if
+                    ends_line  = true;          // _at_start_of_line is already true, this is not the first.
+                }
+            }
+            // prevent going further if we are ignoring
+            else if (_ignore_until_next_line)
+            {
+                // don't do anything
+            }
+            // Classify the line if it's a single character 
+            else if (_at_start_of_line &&
+                ((c == '!')         ||      // feedhold
+                 (c == '~')         ||      // cycle start
+                 (c == ENQ)         ||      // request ENQ/ack
+                 (c == CHAR_RESET)  ||      // ^X - reset (aka cancel, terminate)
+                 (c == CHAR_ALARM)  ||      // ^D - request job kill (end of transmission)
+                 (c == '%' && cm_has_hold()) // flush (only in feedhold or part of control header)
+                ))
+            {
+
+                _line_start_offset = _scan_offset;
+
+                // single-character control
+                is_control = true;
+                ends_line  = true;
+            }
+            else {
+                if (_at_start_of_line) {
+                    // This is the first character at the beginning of the line.
+                    _line_start_offset = _scan_offset;
+                    _last_line_length = 0;
+                }
+                _at_start_of_line = false;
+            }
+
+            // bump the _scan_offset
+            _scan_offset = _getNextScanOffset();
+            _last_line_length++;
+
+            if (ends_line) {
+                // _scan_offset is now one past the end of the line,
+                // which means it is at the start of a new line
+                _at_start_of_line = true;
+
+                // Here we classify the line.
+                // If is_control is already true, it's an already classified
+                // single-character command.
+                if (!is_control) {
+                    // TODO --- Call a function to do this
+
+                    if (_data[_line_start_offset] == '{') {
+                        is_control = true;
+                    }
+                    // TODO ---
+                }
+
+                if (is_control) {       // we found a control
+                    // Quick check for single-character with a \n after it
+                    while (_isMoreToScan() &&
+                           ((_data[_scan_offset] == '\n') ||
+                            (_data[_scan_offset] == '\r'))
+                           )
+                    {
+                        _scan_offset = _getNextScanOffset();
+                    }
+                    return true;
+                } else {                // we did find one more line, though.
+                    _lines_found++;
+                }
+            } // if ends_line
+            else if (_last_line_length == (_line_buffer_size - 1)) {
+                // force an end-of-line, splitting this line into two lines
+                _ignore_until_next_line = true;
+                _line_start_offset = _scan_offset;
+                _lines_found++;
+            }
+        } //while (_isMoreToScan())
+
+        // special edge case: we ran out of items to scan (buffer full?), but we're ignoring because a line was too long
+        // example: we get a line that it multiple-times the length of the buffer
+        // so we'll dump skip sections to the readline will move the read pointer forward
+        if (_ignore_until_next_line && (_line_start_offset != _scan_offset)) {
+            // add a skip section to jump over the overage
+            _skip_sections.addSkip(_line_start_offset, _scan_offset);
+            // move the start of the next skip section to after this skip
+            _line_start_offset = _scan_offset;
+        }
+        return false; // no control was found
+    };
+
+    /*
+     * readline()
+     *
+     * This is the ONLY external interface in this class
+     *
+     * Exit condition when a control is found: _line_start_offset and _scan_offset should be the same.
+     * If the control was the first char of the buffer it also moves the _data_offset, marking it as read
+     *
+     * A data line that does not wrap the end of _data is returned in place: its line end (already
+     * scanned) is overwritten with a NUL and its space is held, so no transfer can reuse it, until
+     * the next readline() or flush. Like _line_buffer, the line may be modified by the caller and
+     * is valid until then. Controls and lines that wrap are copied to _line_buffer.
+     */
+    void _releaseLine() {
+        if (_holding_line) {
+            _read_offset = _held_read_offset;
+            _holding_line = false;
+        }
+    }
+
+    char *readline(bool control_only, uint16_t &line_size) {
+        _releaseLine();
+
+        // This is tricky: if we don't have room for more skip_sections, then we
+        // can't scan any more for controls. So we don't scan, amd hope some lines are read.
+        bool found_control = _skip_sections.isFull() ? false : _scanBuffer();
+
+        _restartTransfer();
+
+        _last_returned_a_control = found_control;
+
+        char *dst_ptr = _line_buffer;
+        line_size = 0;
+
+        if (found_control) {
+            // Optimization: if the control was found at the beginning of _data, we note that now
+            // and update the _read_offset when we update _line_start_offset
+            bool ctrl_is_at_beginning_of_data = (_line_start_offset == _read_offset);
+            if (!ctrl_is_at_beginning_of_data) {
+                _skip_sections.addSkip(_line_start_offset, _scan_offset);
+            }
+
+            // When we get here, _line_start_offset points to either:
+            // A) A single-character command, OR
+            // B) A full line.
+            // Either way, _scan_offset is one past the end, so we don't care which.
+
+            if (_data[_line_start_offset] == 0) {
+                _debug_trap("read ran into NULL");
+            }
+
+            // scan past any leftover CR or LF from the previous line
+            while ((_data[_line_start_offset] == '\n') || (_data[_line_start_offset] == '\r')) {
+                _line_start_offset = (_line_start_offset+1)&(_size-1);
+                if (_scan_offset == _line_start_offset) {
+                    _debug_trap("read ran into scan (1)");
+                }
+            }
+
+            // note that if it's marked as a control, it's guaranteed to fit in the line buffer
+            while (_scan_offset != _line_start_offset) {
+
+                // copy the charater to _line_buffer
+                char c = _data[_line_start_offset];
+                *dst_ptr = c;
+
+                // update the line_size
+                line_size++;
+
+                // update read/write positions
+                dst_ptr++;
+                _line_start_offset = (_line_start_offset+1)&(_size-1);
+            }
+
+            // null-terminate the string
+            *dst_ptr = 0;
+
+            if (ctrl_is_at_beginning_of_data) {
+                _read_offset = _scan_offset;
+            }
+
+            return _line_buffer;
+        } // end if (found_control)
+
+        if (control_only) {
+            line_size = 0;
+            return nullptr;
+        }
+
+        // skip sections will always start at the beginning of a line
+        // handle this, even with no line, in case we're ignoring a huge too-long line
+        _skip_sections.skip(_read_offset);
+
+        if (_lines_found == 0) {
+            // nothing to return
+            line_size = 0;
+            return nullptr;
+        }
+
+        // By the time we get here, we know we have at least one line in _data.
+
+
+        if (_data[_read_offset] == 0) {
+            _debug_trap("read ran into NULL");
+        }
+
+        // scan past any leftover CR or LF from the previous line
+        char c = _data[_read_offset];
+        while ((c == '\n') || (c == '\r')) {
+            _read_offset = (_read_offset+1)&(_size-1);
+            if (_scan_offset == _read_offset) {
+                _debug_trap("read ran into scan (2)");
+            }
+            // this also counts as the beginning of a line
+            _skip_sections.skip(_read_offset);
+            c = _data[_read_offset];
+        }
+
+        // return it in place if it ends before the end of _data
+        uint16_t end_offset = _read_offset;
+        while ((end_offset < _size) && (_data[end_offset] != '\r') && (_data[end_offset] != '\n')) {
+            end_offset++;
+        }
+        if ((end_offset < _size) && ((end_offset - _read_offset) < (_line_buffer_size - 1))) {
+            char *line = &_data[_read_offset];
+            line_size = end_offset - _read_offset;
+            _data[end_offset] = 0;
+            _held_read_offset = (end_offset + 1) & (_size-1);
+            _holding_line = true;
+
+            --_lines_found;
+            _restartTransfer();
+            return line;
+        }
+
+        while (line_size < (_line_buffer_size - 1)) {
+            _read_offset = (_read_offset+1)&(_size-1);
+
+            if ( c == '\r' ||
+                 c == '\n'
+                ) {
+
+                break;
+            }
+
+            line_size++;
+            *dst_ptr = c;
+
+            // update read/write positions
+            dst_ptr++;
+
+            c = _data[_read_offset];
+        }
+        if (line_size == (_line_buffer_size - 1)) {
+            // add a line-ending
+            *dst_ptr++ = '\n';
+        }
+
+        --_lines_found;
+
+        _restartTransfer();
+
+        // null-terminate the string
+        *dst_ptr = 0;
+        return _line_buffer;
+    }; // readline
+
+
+    // this is called from flushRead()
+    void flush() {
+        _holding_line = false;
+        parent_type::flush();
+        _scan_offset = _read_offset;
+
+        // This is similar to the % "queue flush" handling above, except we flush
+        // the scan to the to the read (which was just set tot he write by the parent),
+        // not the other way around.
+
+        // record that we have 0 lines (of data) in the buffer
+        _lines_found = 0;
+
+        // and clear out any skip sections we have
+        while (!_skip_sections.isEmpty()) {
+            _skip_sections.popSkip();
+        }
+    }; // flush
+
+    bool flushToCommand() {
+        if (!_last_returned_a_control) {
+            return false;
+        }
+
+        // Things that must be managed here:
+        // * _read_offset -- we're skipping data
+        // * _lines_found -- we shouldn't have any lines "left"
+        // * _skip_sections -- there's nothing to skip, we just did
+
+        // Things that won't be changed (further):
+        // * _scan_offset -- we're not changing past where it's scanned
+        // * _line_start_offset -- we've already adjusted it
+        // * _at_start_of_line -- should always be true when we're here
+
+        // Note that we DO NOT call parent::flush() here. That will toss data
+        // we haven't scanned yet, beyond where we got the command we want to
+        // flush to.
+
+        // move the read buffer up to where we ended scanning
+        _holding_line = false;
+        _read_offset = _scan_offset;
+
+        // record that we have 0 lines (of data) in the buffer
+        _lines_found = 0;
+
+        // and clear out any skip sections we have
+        while (!_skip_sections.isEmpty()) {
+            _skip_sections.popSkip();
+        }
+
+        _last_returned_a_control = false;
+
+        return true;
+    }; // flush
+
+}; // LineRXBuffer
+
+#endif // End of include guard: XIO_LINE_BUFFER_H_ONCE
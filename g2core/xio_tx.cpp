@@ -0,0 +1,141 @@
+/*
+ * xio_tx.cpp - coalesced writes to the control devices
+ * This file is part of the g2core project
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * All output to the control devices - responses, status and queue reports, exception
+ * reports, text mode listings and printf() - goes through xio_write() or xio_writeline().
+ * Each write used to go straight to the device's TX buffer, and a TX buffer that is idle
+ * starts a USB transfer for every write. When streaming in line mode the host waits for
+ * each response, so the number of transfers - not bytes - set the ack rate.
+ *
+ * With {txb:1} the writes are staged here instead and written out together:
+ *  - at the end of each controller pass (controller_run())
+ *  - after the response to a control line (_dispatch_control()), so those are not held
+ *  - before a write that would not fit, or one that comes more than {txl:} ms after the
+ *    first write staged, so a long pass does not hold output for longer than that
+ *  - before a hard reset (^X or a reset input), after the shutdown and panic exception
+ *    reports, and at a debugger breakpoint (_debug_trap()), which may not get to the end
+ *    of the pass
+ *
+ * Writes to muted devices (only_to_muted) are not staged. xio_write_devices() is the
+ * unstaged write, provided by xio.cpp (or the sim).
+ */
+
+#include "g2core.h"
+#include "config.h"
+#include "xio.h"
+#include "util.h"
+#include "settings.h"
+
+#ifdef __TEXT_MODE
+#include "text_parser.h"
+#endif
+
+/**** Allocations ****/
+
+xioTXStage_t xtx;
+
+/**** CODE ****/
+
+/*
+ * xio_write() - write a buffer to the control devices, or stage it
+ * xio_writeline() - write a NUL terminated line
+ * xio_tx_flush() - write what is staged
+ */
+
+size_t xio_write(const char *buffer, size_t size, bool only_to_muted /*= false*/)
+{
+    if (only_to_muted) {
+        return (xio_write_devices(buffer, size, only_to_muted));
+    }
+    xtx.lines++;
+    if (!xtx.enable) {
+        xtx.writes++;
+        return (xio_write_devices(buffer, size, false));
+    }
+    if (xtx.length > 0) {
+        if (xtx.length + size > TX_STAGE_SIZE) {
+            xio_tx_flush();
+        } else if ((xtx.latency_ms > 0) && ((SysTickTimer_getValue() - xtx.first_ms) >= xtx.latency_ms)) {
+            xtx.latency_writes++;
+            xio_tx_flush();
+        }
+    }
+    if (size > TX_STAGE_SIZE) {                 // too big to stage - just write it
+        xtx.writes++;
+        return (xio_write_devices(buffer, size, false));
+    }
+    if (xtx.length == 0) {
+        xtx.first_ms = SysTickTimer_getValue();
+    }
+    memcpy(&xtx.buf[xtx.length], buffer, size);
+    xtx.length += size;
+    return (size);
+}
+
+int16_t xio_writeline(const char *buffer, bool only_to_muted /*= false*/)
+{
+    return (xio_write(buffer, strlen(buffer), only_to_muted));
+}
+
+void xio_tx_flush()
+{
+    if (xtx.length > 0) {
+        xtx.writes++;
+        xio_write_devices(xtx.buf, xtx.length, false);
+        xtx.length = 0;
+    }
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * xio_cltx() - clear the TX write counters
+ */
+
+stat_t xio_cltx(nvObj_t *nv)
+{
+    xtx.lines = 0;
+    xtx.writes = 0;
+    xtx.latency_writes = 0;
+    return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_txb[] = "[txb] TX batching%18d [0=off,1=on]\n";
+static const char fmt_txl[] = "[txl] TX latency cap%15d ms\n";
+
+void xio_print_txb(nvObj_t *nv) { text_print(nv, fmt_txb);}
+void xio_print_txl(nvObj_t *nv) { text_print(nv, fmt_txl);}
+
+#endif // __TEXT_MODE